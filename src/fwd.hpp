@@ -24,6 +24,9 @@ class ShadowManager;
 class GPUTimingSystem;
 class HierarchicalZBuffers;
 class SceneBuffersManager;
+class ThreadPool;
+class AsyncUploader;
+class AsyncGltfLoader;
 
 // components
 class Transform;
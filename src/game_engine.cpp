@@ -1,12 +1,14 @@
 #include "game_engine.hpp"
 
 #include "imgui.h"
+#include "render/gltf_loader/async_gltf_loader.hpp"
 #include "render/gltf_loader/gltf_loader.hpp"
 #include "render/object_renderer/object_renderer.hpp"
 #include "render/render_pipeline/defered_render_pipeline.hpp"
 #include "render/render_server.hpp"
 #include "render/render_system.hpp"
 #include "scene/components/transform.hpp"
+#include "scene/components/util.hpp"
 #include "scene/scene.hpp"
 
 #include "scene/ui/instantiate_menu.hpp"
@@ -20,7 +22,8 @@ GameEngine::GameEngine(bool headless) {
     m_scene = std::make_unique<Scene>();
 
     if (!headless) {
-        m_renderer = std::make_unique<RenderSystem>(this);
+        m_renderer          = std::make_unique<RenderSystem>(this);
+        m_async_gltf_loader = std::make_unique<AsyncGltfLoader>(m_renderer->get_render_server(), m_scene->get_world());
     }
 
     assert(s_instance == nullptr);
@@ -69,6 +72,8 @@ void GameEngine::run() {
         if (m_renderer) {
             if (!m_renderer->get_render_server()->is_running()) break;
 
+            m_async_gltf_loader->update();
+
             m_renderer->get_render_server()->frame([&](RenderServer::FrameArgs& args) {
                 static bool window_opened = true;
                 if (window_opened) {
@@ -103,29 +108,34 @@ void GameEngine::load_gltf(vke::CommandBuffer& cmd, const std::string& file_path
         LOG_ERROR("failed to load prefab %s. gltf file path : %s", prefab_name.c_str(), file_path.c_str());
         return;
     }
-    entity->set_name(prefab_name.c_str());
-    // m_prefabs.emplace(std::make_pair(prefab_name, entity.value()));
-    m_prefabs[prefab_name] = entity.value();
+    register_prefab(entity.value(), prefab_name);
 }
 
-flecs::entity GameEngine::instantiate_prefab(const std::string& prefab_name, std::optional<Transform> transform) {
-    auto prefab = m_prefabs.at(prefab_name);
-    auto world  = m_scene->get_world();
-
-    auto entity = world->entity().is_a(prefab);
+void GameEngine::load_gltf_async(const std::string& file_path, const std::string& prefab_name, std::function<void(flecs::entity)> on_loaded) {
+    // a headless engine has no renderer to upload the meshes with, the synchronous load can't run either
+    if (m_async_gltf_loader == nullptr) {
+        LOG_ERROR("can't load prefab %s without a renderer. gltf file path : %s", prefab_name.c_str(), file_path.c_str());
+        return;
+    }
 
-    auto* rel_transform = entity.get<RelativeTransform>();
+    m_async_gltf_loader->load(file_path, [this, prefab_name, on_loaded = std::move(on_loaded)](flecs::entity entity) {
+        register_prefab(entity, prefab_name);
+        if (on_loaded) on_loaded(entity);
+    });
+}
 
-    auto t1 = transform.value_or(Transform::IDENTITY);
+void GameEngine::register_prefab(flecs::entity entity, const std::string& prefab_name) {
+    entity.set_name(prefab_name.c_str());
+    // m_prefabs.emplace(std::make_pair(prefab_name, entity.value()));
+    m_prefabs[prefab_name] = entity;
+}
 
-    if (rel_transform) {
-        entity.set<Transform>(t1 * static_cast<Transform>(*rel_transform));
-        entity.remove<RelativeTransform>();
-    } else {
-        entity.set<Transform>(t1);
-    }
+flecs::entity GameEngine::instantiate_prefab(const std::string& prefab_name, std::optional<Transform> transform) {
+    return spawn_prefab_instance(m_scene->get_world(), m_prefabs.at(prefab_name), transform);
+}
 
-    return entity;
+std::vector<flecs::entity_t> GameEngine::instantiate_prefab_bulk(const std::string& prefab_name, std::span<const Transform> transforms) {
+    return spawn_prefab_instances(m_scene->get_world(), m_prefabs.at(prefab_name), transforms);
 }
 
 flecs::world* GameEngine::get_world() {
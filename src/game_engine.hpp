@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory>
+#include <span>
+#include <vector>
 
 #include <vke/fwd.hpp>
 
@@ -30,7 +32,12 @@ public:
     static GameEngine* get_instance();
 
     void load_gltf(vke::CommandBuffer& cmd, const std::string& file_path, const std::string& prefab_name);
+    // the prefab is registered once the file is resident, on_loaded is called right after
+    void load_gltf_async(const std::string& file_path, const std::string& prefab_name, std::function<void(flecs::entity)> on_loaded = {});
+    bool is_prefab_loaded(const std::string& prefab_name) const { return m_prefabs.contains(prefab_name); }
     flecs::entity instantiate_prefab(const std::string& prefab_name,std::optional<Transform> transform);
+    // creates all instances with one bulk creation, their gpu handles & instance data are registered as one contiguous block
+    std::vector<flecs::entity_t> instantiate_prefab_bulk(const std::string& prefab_name, std::span<const Transform> transforms);
 
     flecs::world* get_world();
 
@@ -42,10 +49,14 @@ protected:
     void default_render(RenderServer::FrameArgs&);
 
 private:
+    void register_prefab(flecs::entity entity, const std::string& prefab_name);
+
 protected:
 private:
     std::unique_ptr<vke::Scene> m_scene;
     std::unique_ptr<vke::RenderSystem> m_renderer;
+    // declared after the renderer so that it is destroyed first
+    std::unique_ptr<vke::AsyncGltfLoader> m_async_gltf_loader;
     std::unordered_map<std::string, flecs::entity> m_prefabs;
     std::vector<std::shared_ptr<IMenu>> m_menus;
 
@@ -18,6 +18,7 @@ GPUTimingSystem::~GPUTimingSystem() {}
 
 void GPUTimingSystem::begin_frame(vke::CommandBuffer& cmd) {
     debug_menu();
+    store_last_results();
 
     auto* timer = get_current_timer();
     timer->set_enabled(m_enabled);
@@ -46,6 +47,24 @@ void GPUTimingSystem::debug_menu() {
 
             ImGui::Text("%s: %.3lf ms", labels[i].label.c_str(), time);
         }
+
+        // passes that mark their start & end, other passes may be timed between them
+        ImGui::Separator();
+
+        constexpr std::string_view start_suffix = " start";
+        for (int i = 0; i < labels.size(); i++) {
+            std::string_view label = labels[i].label;
+            if (!label.ends_with(start_suffix)) continue;
+
+            std::string_view pass = label.substr(0, label.size() - start_suffix.size());
+            std::string end_label = std::string(pass) + " end";
+            for (int j = i + 1; j < labels.size(); j++) {
+                if (labels[j].label != end_label) continue;
+
+                ImGui::Text("%.*s: %.3lf ms", static_cast<int>(pass.size()), pass.data(), timer->get_delta_time_in_miliseconds(i, j));
+                break;
+            }
+        }
     }
 
     ImGui::End();
@@ -53,6 +72,34 @@ void GPUTimingSystem::debug_menu() {
 
 void GPUTimingSystem::timestamp(vke::CommandBuffer& cmd, std::string_view label, VkPipelineStageFlagBits stage) { get_current_timer()->timestamp(cmd, label, stage); }
 
+void GPUTimingSystem::store_last_results() {
+    m_last_results.clear();
+    if (!m_enabled) return;
+
+    // debug_menu has already queried & sorted the results
+    auto* timer = get_current_timer();
+    auto labels = timer->get_labels();
+
+    for (u32 i = 0; i < labels.size(); i++) {
+        m_last_results.emplace_back(labels[i].label, timer->get_delta_time_in_miliseconds(0, i));
+    }
+}
+
+std::optional<double> GPUTimingSystem::get_time_between(std::string_view start_label, std::string_view end_label) {
+    auto find_time = [&](std::string_view label) -> std::optional<double> {
+        for (auto& [result_label, time] : m_last_results) {
+            if (result_label == label) return time;
+        }
+        return std::nullopt;
+    };
+
+    auto start = find_time(start_label);
+    auto end   = find_time(end_label);
+    if (!start || !end) return std::nullopt;
+
+    return *end - *start;
+}
+
 GPUTimer* GPUTimingSystem::get_current_timer() { return m_timers[m_render_server->get_frame_index()].get(); }
 
 } // namespace vke
\ No newline at end of file
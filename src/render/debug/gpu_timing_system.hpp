@@ -5,6 +5,11 @@
 
 #include <vke/fwd.hpp>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace vke{
@@ -19,14 +24,21 @@ public:
     void end_frame(vke::CommandBuffer& cmd);
 
     void timestamp(vke::CommandBuffer& cmd, std::string_view label, VkPipelineStageFlagBits stage);
+
+    // the time between two timestamps of the frame whose results were read back last, nullopt if either of them wasn't written in it
+    std::optional<double> get_time_between(std::string_view start_label, std::string_view end_label);
 private:
     GPUTimer* get_current_timer();
     void debug_menu();
+    void store_last_results();
 
 private:
     std::unique_ptr<vke::GPUTimer> m_timers[FRAME_OVERLAP];
     vke::RenderServer* m_render_server = nullptr;
     bool m_enabled = true;
+
+    // label & time since the first timestamp of the frame that was read back last, the timer is reset before it can be queried again
+    std::vector<std::pair<std::string, double>> m_last_results;
 };
 
 
@@ -19,6 +19,7 @@ LineDrawer::LineDrawer(RenderServer* render_server) {
     vi_builder.push_attribute<float>(3);
     vi_builder.push_attribute<u32>(1);
 
+    auto lock = m_render_server->lock_pipeline_loader();
     pg_provider->vertex_input_descriptions["vke::debug_line_vertex"] = std::make_unique<vke::VertexInputDescriptionBuilder>(std::move(vi_builder));
 }
 
@@ -84,7 +85,7 @@ void LineDrawer::draw_line(glm::vec3 a, glm::vec3 b, u32 color) {
 void LineDrawer::flush(vke::CommandBuffer& cmd, const Camera* camera, const std::string& renderpass_name) {
     // lazily load the pipeline as renderpass is not initialized in the creation of this class
     if (!m_line_drawer_pipeline) {
-        m_line_drawer_pipeline = m_render_server->get_pipeline_loader()->load("vke::debug_line_draw_pipeline");
+        m_line_drawer_pipeline = m_render_server->load_pipeline("vke::debug_line_draw_pipeline");
     }
 
     // return if vertex buffers are empty
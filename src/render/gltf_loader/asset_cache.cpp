@@ -0,0 +1,485 @@
+#include "asset_cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <type_traits>
+
+#include <vke/util.hpp>
+
+#include "gltf_loader.hpp"
+#include "util/hash.hpp"
+#include "util/mapped_file.hpp"
+
+namespace vke {
+
+namespace {
+
+constexpr u32 ASSET_MAGIC = 0x41'45'4B'56; // "VKEA"
+// arrays are aligned so that they can be viewed in place inside the mapping
+constexpr size_t ARRAY_ALIGNMENT = 16;
+
+struct AssetHeader {
+    u32 magic;
+    u32 version;
+    u64 source_size;
+    i64 source_write_time;
+    u32 compression_enabled;
+    u32 compression_quality;
+    u32 lod_enabled;
+    u32 lod_max_count;
+    u32 lod_min_triangle_count;
+    float lod_triangle_ratio;
+    float lod_max_relative_error;
+    u32 padding[3];
+    u64 payload_size;
+    u64 payload_hash;
+};
+
+static_assert(sizeof(AssetHeader) % ARRAY_ALIGNMENT == 0);
+
+class AssetWriter {
+public:
+    template <class T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        append(&value, sizeof(T));
+    }
+
+    template <class T>
+    void write_array(std::span<const T> values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write<u64>(values.size());
+
+        m_bytes.resize((m_bytes.size() + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT);
+        append(values.data(), values.size_bytes());
+    }
+
+    void write_string(const std::string& string) { write_array(std::span<const char>(string)); }
+
+    std::vector<u8>& bytes() { return m_bytes; }
+
+private:
+    void append(const void* data, size_t size) {
+        size_t offset = m_bytes.size();
+        m_bytes.resize(offset + size);
+        if (size > 0) memcpy(m_bytes.data() + offset, data, size);
+    }
+
+private:
+    std::vector<u8> m_bytes;
+};
+
+// every read is bounds checked, a failed read leaves the reader failed so that a whole section can be checked at once
+class AssetReader {
+public:
+    AssetReader(std::span<const u8> bytes) : m_bytes(bytes) {}
+
+    template <class T>
+    T read() {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        T value{};
+        if (!reserve(sizeof(T))) return value;
+
+        memcpy(&value, m_bytes.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return value;
+    }
+
+    // the returned span points into the mapped file
+    template <class T>
+    std::span<const T> read_array() {
+        u64 count = read<u64>();
+        if (m_failed) return {};
+
+        m_offset = (m_offset + ARRAY_ALIGNMENT - 1) / ARRAY_ALIGNMENT * ARRAY_ALIGNMENT;
+        if (count > m_bytes.size() / sizeof(T) || !reserve(count * sizeof(T))) {
+            m_failed = true;
+            return {};
+        }
+
+        auto* data = reinterpret_cast<const T*>(m_bytes.data() + m_offset);
+        m_offset += count * sizeof(T);
+        return {data, count};
+    }
+
+    // element counts are capped by the remaining size so that a corrupted count can't cause a huge allocation
+    u32 read_count() {
+        u32 count = read<u32>();
+        if (count > m_bytes.size() - m_offset) {
+            m_failed = true;
+            return 0;
+        }
+        return count;
+    }
+
+    std::string read_string() {
+        auto chars = read_array<char>();
+        return std::string(chars.begin(), chars.end());
+    }
+
+    bool failed() const { return m_failed; }
+    bool at_end() const { return m_offset == m_bytes.size(); }
+
+private:
+    bool reserve(size_t size) {
+        if (m_failed || m_offset > m_bytes.size() || m_bytes.size() - m_offset < size) {
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::span<const u8> m_bytes;
+    size_t m_offset = 0;
+    bool m_failed   = false;
+};
+
+template <class T>
+std::vector<T> to_vector(std::span<const T> span) {
+    return std::vector<T>(span.begin(), span.end());
+}
+
+void write_builder(AssetWriter& writer, const MeshBuilder& builder) {
+    writer.write<u32>(static_cast<u32>(builder.get_index_type()));
+    writer.write(builder.get_boundary());
+    writer.write_array(builder.get_positions());
+    writer.write_array(builder.get_texture_coords());
+    writer.write_array(builder.get_normals());
+    writer.write_array(builder.get_indicies());
+    writer.write_array(builder.get_meshlets());
+}
+
+void read_builder(AssetReader& reader, MeshBuilder& builder) {
+    auto index_type = static_cast<VkIndexType>(reader.read<u32>());
+
+    builder.set_boundary(reader.read<AABB>());
+    builder.set_positions(reader.read_array<glm::vec3>());
+    builder.set_texture_coords(reader.read_array<glm::vec2>());
+    builder.set_normals(reader.read_array<glm::vec3>());
+    builder.set_indicies(reader.read_array<u32>(), index_type);
+    builder.set_meshlets(reader.read_array<Meshlet>());
+}
+
+std::vector<u8> serialize_payload(const GltfImportData& data) {
+    AssetWriter writer;
+
+    writer.write<u32>(data.images.size());
+    for (auto& image : data.images) {
+        writer.write<u32>(static_cast<u32>(image.usage));
+        writer.write<u32>(image.width);
+        writer.write<u32>(image.height);
+        writer.write<u32>(image.compressed.has_value());
+        writer.write<u64>(image.content_hash);
+
+        if (image.compressed.has_value()) {
+            auto& compressed = image.compressed.value();
+            writer.write<u32>(static_cast<u32>(compressed.format));
+            writer.write<u32>(compressed.srgb);
+            writer.write<u32>(compressed.width);
+            writer.write<u32>(compressed.height);
+            writer.write<u32>(compressed.mips.size());
+            for (auto& mip : compressed.mips) writer.write_array(mip.span());
+        } else {
+            writer.write_array(image.rgba.span());
+        }
+    }
+
+    writer.write_array(std::span<const ImportedMaterial>(data.materials));
+
+    writer.write<u32>(data.meshes.size());
+    for (auto& mesh : data.meshes) {
+        writer.write_string(mesh.name);
+        writer.write<u32>(mesh.primitives.size());
+
+        for (auto& primitive : mesh.primitives) {
+            writer.write<i32>(primitive.material);
+            write_builder(writer, primitive.builder);
+            writer.write<u64>(primitive.content_hash);
+
+            writer.write<u32>(primitive.lods.size());
+            for (auto& lod : primitive.lods) {
+                writer.write<float>(lod.error);
+                write_builder(writer, lod.builder);
+                writer.write<u64>(lod.content_hash);
+            }
+        }
+    }
+
+    writer.write<u32>(data.nodes.size());
+    for (auto& node : data.nodes) {
+        writer.write(node.transform);
+        writer.write<i32>(node.mesh);
+        writer.write_array(std::span<const u32>(node.children));
+        writer.write_array(std::span<const RelativeTransform>(node.instances));
+        writer.write<u32>(node.is_static);
+    }
+
+    writer.write<u32>(data.root_node);
+
+    return std::move(writer.bytes());
+}
+
+// the pixels are views into the payload that mapping keeps alive, everything else is copied out of it
+std::optional<GltfImportData> deserialize_payload(std::span<const u8> payload, std::shared_ptr<const MappedFile> mapping) {
+    AssetReader reader(payload);
+    GltfImportData data;
+
+    data.images.resize(reader.read_count());
+    for (auto& image : data.images) {
+        if (reader.failed()) return std::nullopt;
+
+        image.usage  = static_cast<TextureUsage>(reader.read<u32>());
+        image.width  = reader.read<u32>();
+        image.height = reader.read<u32>();
+
+        bool is_compressed = reader.read<u32>() != 0;
+        image.content_hash = reader.read<u64>();
+
+        if (is_compressed) {
+            auto& compressed  = image.compressed.emplace();
+            compressed.format = static_cast<BCFormat>(reader.read<u32>());
+            compressed.srgb   = reader.read<u32>() != 0;
+            compressed.width  = reader.read<u32>();
+            compressed.height = reader.read<u32>();
+
+            compressed.mips.resize(reader.read_count());
+            for (auto& mip : compressed.mips) {
+                if (reader.failed()) return std::nullopt;
+                mip = SharedBytes(reader.read_array<u8>(), mapping);
+            }
+        } else {
+            image.rgba = SharedBytes(reader.read_array<u8>(), mapping);
+        }
+    }
+
+    data.materials = to_vector(reader.read_array<ImportedMaterial>());
+
+    data.meshes.resize(reader.read_count());
+    for (auto& mesh : data.meshes) {
+        if (reader.failed()) return std::nullopt;
+
+        mesh.name = reader.read_string();
+        mesh.primitives.resize(reader.read_count());
+
+        for (auto& primitive : mesh.primitives) {
+            if (reader.failed()) return std::nullopt;
+
+            primitive.material = reader.read<i32>();
+            read_builder(reader, primitive.builder);
+            primitive.content_hash = reader.read<u64>();
+
+            primitive.lods.resize(reader.read_count());
+            for (auto& lod : primitive.lods) {
+                if (reader.failed()) return std::nullopt;
+
+                lod.error = reader.read<float>();
+                read_builder(reader, lod.builder);
+                lod.content_hash = reader.read<u64>();
+            }
+        }
+    }
+
+    data.nodes.resize(reader.read_count());
+    for (auto& node : data.nodes) {
+        if (reader.failed()) return std::nullopt;
+
+        node.transform = reader.read<RelativeTransform>();
+        node.mesh      = reader.read<i32>();
+        node.children  = to_vector(reader.read_array<u32>());
+        node.instances = to_vector(reader.read_array<RelativeTransform>());
+        node.is_static = reader.read<u32>() != 0;
+    }
+
+    data.root_node = reader.read<u32>();
+
+    if (reader.failed() || !reader.at_end()) return std::nullopt;
+
+    return data;
+}
+
+// calls func(builder, lod) for the full detail mesh as lod 0 and then every lod
+void for_each_builder(const ImportedPrimitive& primitive, auto&& func) {
+    func(primitive.builder, 0u);
+    for (u32 i = 0; i < primitive.lods.size(); i++) func(primitive.lods[i].builder, i + 1);
+}
+
+// runs on every load, a corrupted index would make the gpu read outside of the vertex buffers
+void check_references(const GltfImportData& data, std::vector<std::string>& errors) {
+    for (u32 i = 0; i < data.materials.size(); i++) {
+        int image = data.materials[i].base_color_image;
+        if (image >= static_cast<int>(data.images.size())) errors.push_back(std::format("material {} refers to missing image {}", i, image));
+    }
+
+    for (u32 i = 0; i < data.meshes.size(); i++) {
+        for (u32 j = 0; j < data.meshes[i].primitives.size(); j++) {
+            auto& primitive = data.meshes[i].primitives[j];
+
+            if (primitive.material >= static_cast<int>(data.materials.size())) {
+                errors.push_back(std::format("primitive {} of mesh {} refers to missing material {}", j, i, primitive.material));
+            }
+
+            for_each_builder(primitive, [&](const MeshBuilder& builder, u32 lod) {
+                size_t vertex_count = builder.get_positions().size();
+                if (builder.get_texture_coords().size() != vertex_count || builder.get_normals().size() != vertex_count) {
+                    errors.push_back(std::format("lod {} of primitive {} of mesh {} has vertex streams of different lengths", lod, j, i));
+                }
+
+                u32 max_index = builder.get_index_type() == VK_INDEX_TYPE_UINT16 ? 0xFFFF : 0xFFFF'FFFF;
+                for (u32 index : builder.get_indicies()) {
+                    if (index >= vertex_count || index > max_index) {
+                        errors.push_back(std::format("lod {} of primitive {} of mesh {} has out of range index {}", lod, j, i, index));
+                        break;
+                    }
+                }
+
+                // the meshlets are back to back so the last one has to end at the last triangle
+                auto meshlets = builder.get_meshlets();
+                if (!meshlets.empty() && static_cast<u64>(meshlets.back().triangle_offset) + meshlets.back().triangle_count != builder.get_indicies().size() / 3) {
+                    errors.push_back(std::format("lod {} of primitive {} of mesh {} has meshlets that don't match its triangles", lod, j, i));
+                }
+            });
+        }
+    }
+
+    for (u32 i = 0; i < data.nodes.size(); i++) {
+        auto& node = data.nodes[i];
+        if (node.mesh >= static_cast<int>(data.meshes.size())) errors.push_back(std::format("node {} refers to missing mesh {}", i, node.mesh));
+
+        for (auto child : node.children) {
+            if (child >= data.nodes.size()) errors.push_back(std::format("node {} refers to missing child {}", i, child));
+        }
+    }
+
+    if (!data.nodes.empty() && data.root_node >= data.nodes.size()) errors.push_back(std::format("root node {} is missing", data.root_node));
+}
+
+struct SourceInfo {
+    u64 size;
+    i64 write_time;
+};
+
+std::optional<SourceInfo> get_source_info(const std::string& source_path) {
+    std::error_code ec;
+
+    u64 size = fs::file_size(source_path, ec);
+    if (ec) return std::nullopt;
+
+    auto write_time = fs::last_write_time(source_path, ec);
+    if (ec) return std::nullopt;
+
+    return SourceInfo{
+        .size       = size,
+        .write_time = static_cast<i64>(write_time.time_since_epoch().count()),
+    };
+}
+
+} // namespace
+
+std::string asset_cache_path(const AssetCacheSettings& settings, const std::string& source_path) {
+    std::error_code ec;
+    auto absolute_path = fs::absolute(source_path, ec).string();
+    if (ec) absolute_path = source_path;
+
+    u64 hash = hash_bytes(vke::span_cast<const u8>(std::span<const char>(absolute_path)));
+
+    return (fs::path(settings.cache_directory) / std::format("{:016x}.vkeasset", hash)).string();
+}
+
+std::optional<GltfImportData> read_asset_cache(const AssetCacheSettings& settings, const std::string& source_path, const TextureCompressionSettings& compression_settings, const LodSettings& lod_settings) {
+    auto source_info = get_source_info(source_path);
+    if (!source_info.has_value()) return std::nullopt;
+
+    auto path = asset_cache_path(settings, source_path);
+    auto file = MappedFile::open(path);
+    if (!file.has_value()) return std::nullopt;
+
+    // shared with the images that view it, it stays mapped while they are alive
+    auto mapping = std::make_shared<const MappedFile>(std::move(file.value()));
+
+    auto bytes = mapping->bytes();
+    if (bytes.size() < sizeof(AssetHeader)) return std::nullopt;
+
+    AssetHeader header;
+    memcpy(&header, bytes.data(), sizeof(header));
+
+    bool is_stale = header.magic != ASSET_MAGIC || header.version != ASSET_CACHE_VERSION         //
+                    || header.source_size != source_info->size                                   //
+                    || header.source_write_time != source_info->write_time                       //
+                    || header.compression_enabled != compression_settings.enabled                //
+                    || header.compression_quality != static_cast<u32>(compression_settings.quality) //
+                    || header.lod_enabled != lod_settings.enabled                                //
+                    || header.lod_max_count != lod_settings.max_lod_count                        //
+                    || header.lod_min_triangle_count != lod_settings.min_triangle_count          //
+                    || header.lod_triangle_ratio != lod_settings.triangle_ratio                  //
+                    || header.lod_max_relative_error != lod_settings.max_relative_error          //
+                    || header.payload_size != bytes.size() - sizeof(AssetHeader);
+    if (is_stale) return std::nullopt;
+
+    auto data = deserialize_payload(bytes.subspan(sizeof(AssetHeader)), mapping);
+    if (!data.has_value()) {
+        LOG_WARNING("asset cache %s of %s is corrupted, importing the source file", path.c_str(), source_path.c_str());
+        return std::nullopt;
+    }
+
+    std::vector<std::string> errors;
+    check_references(data.value(), errors);
+    if (!errors.empty()) {
+        LOG_WARNING("asset cache %s of %s is corrupted(%s), importing the source file", path.c_str(), source_path.c_str(), errors[0].c_str());
+        return std::nullopt;
+    }
+
+    data->file_path = source_path;
+    return data;
+}
+
+void write_asset_cache(const AssetCacheSettings& settings, const GltfImportData& data, const TextureCompressionSettings& compression_settings, const LodSettings& lod_settings) {
+    auto source_info = get_source_info(data.file_path);
+    if (!source_info.has_value()) return;
+
+    fs::path path = asset_cache_path(settings, data.file_path);
+
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+
+    auto payload = serialize_payload(data);
+
+    AssetHeader header{
+        .magic                  = ASSET_MAGIC,
+        .version                = ASSET_CACHE_VERSION,
+        .source_size            = source_info->size,
+        .source_write_time      = source_info->write_time,
+        .compression_enabled    = compression_settings.enabled,
+        .compression_quality    = static_cast<u32>(compression_settings.quality),
+        .lod_enabled            = lod_settings.enabled,
+        .lod_max_count          = lod_settings.max_lod_count,
+        .lod_min_triangle_count = lod_settings.min_triangle_count,
+        .lod_triangle_ratio     = lod_settings.triangle_ratio,
+        .lod_max_relative_error = lod_settings.max_relative_error,
+        .padding                = {},
+        .payload_size           = payload.size(),
+        .payload_hash           = hash_bytes(payload),
+    };
+
+    // written to a temporary file first so that a crash never leaves a truncated cache entry behind
+    auto temp_path = path;
+    temp_path += ".tmp";
+
+    {
+        std::ofstream file(temp_path, std::ios::binary);
+        if (!file) {
+            LOG_WARNING("failed to write asset cache %s", temp_path.c_str());
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+    }
+
+    fs::rename(temp_path, path, ec);
+}
+
+} // namespace vke
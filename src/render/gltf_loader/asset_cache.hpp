@@ -0,0 +1,31 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "render/texture/texture_compression.hpp"
+
+namespace vke {
+
+struct GltfImportData;
+struct LodSettings;
+
+struct AssetCacheSettings {
+    bool enabled                = true;
+    std::string cache_directory = ".vke_cache/assets";
+};
+
+// .vkeasset files store a GltfImportData with its vertex streams and compressed textures laid out the way they are uploaded.
+// they are memory mapped when read. the pixels are uploaded straight from the mapping, the other arrays are a single copy out of it.
+// entries are keyed by the path of the source file and go stale when the source file, the compression or lod settings or the version change.
+// the version must be bumped whenever the import produces different data
+constexpr u32 ASSET_CACHE_VERSION = 8;
+
+std::string asset_cache_path(const AssetCacheSettings& settings, const std::string& source_path);
+
+std::optional<GltfImportData> read_asset_cache(const AssetCacheSettings& settings, const std::string& source_path, const TextureCompressionSettings& compression_settings, const LodSettings& lod_settings);
+void write_asset_cache(const AssetCacheSettings& settings, const GltfImportData& data, const TextureCompressionSettings& compression_settings, const LodSettings& lod_settings);
+
+} // namespace vke
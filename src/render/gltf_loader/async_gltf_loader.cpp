@@ -0,0 +1,126 @@
+#include "async_gltf_loader.hpp"
+
+#include "render/object_renderer/object_renderer.hpp"
+#include "render/object_renderer/resource_manager.hpp"
+#include "render/render_server.hpp"
+#include "render/streaming/async_uploader.hpp"
+#include "tiny_gltf.h"
+#include "util/thread_pool.hpp"
+
+namespace vke {
+
+struct AsyncGltfLoader::StreamingFile {
+    std::shared_ptr<GltfImportData> data;
+    GltfResources resources;
+    LoadedCallback on_loaded;
+    // images recorded into a batch that hasn't completed yet
+    std::vector<std::unique_ptr<vke::Image>> uploaded_images;
+};
+
+AsyncGltfLoader::AsyncGltfLoader(RenderServer* render_server, flecs::world* world) : m_render_server(render_server), m_world(world) {}
+
+void AsyncGltfLoader::load(const std::string& file_path, LoadedCallback on_loaded) {
+    auto* resource_manager = m_render_server->get_object_renderer()->get_resource_manager();
+    auto* thread_pool      = m_render_server->get_thread_pool();
+
+    // copied since the settings may change while the import is running
+    auto compression_settings = resource_manager->get_texture_compression_settings();
+    auto cache_settings       = resource_manager->get_asset_cache_settings();
+    auto lod_settings         = resource_manager->get_lod_settings();
+    auto vertex_format        = m_render_server->get_vertex_format();
+
+    // the meshes are encoded here too so that the upload job only copies them
+    auto import = thread_pool->submit([file_path, compression_settings, cache_settings, lod_settings, vertex_format, thread_pool] {
+        auto data = import_gltf_file(file_path, compression_settings, cache_settings, lod_settings, thread_pool);
+        if (data.has_value()) encode_gltf_meshes(data.value(), vertex_format, thread_pool);
+        return data;
+    });
+
+    m_pending_imports.push_back(PendingImport{
+        .file_path = file_path,
+        .import    = std::move(import),
+        .on_loaded = std::move(on_loaded),
+    });
+}
+
+void AsyncGltfLoader::update() {
+    for (int i = 0; i < m_pending_imports.size(); i++) {
+        auto& pending = m_pending_imports[i];
+        if (pending.import.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+
+        auto data = pending.import.get();
+        if (data.has_value()) {
+            auto file       = std::make_shared<StreamingFile>();
+            file->data      = std::make_shared<GltfImportData>(std::move(data.value()));
+            file->on_loaded = std::move(pending.on_loaded);
+            stream(std::move(file));
+        } else {
+            LOG_ERROR("failed to import gltf file %s", pending.file_path.c_str());
+        }
+
+        m_pending_imports.erase(m_pending_imports.begin() + i);
+        i--;
+    }
+}
+
+void AsyncGltfLoader::stream(std::shared_ptr<StreamingFile> file) {
+    auto* uploader         = m_render_server->get_async_uploader();
+    auto* renderer         = m_render_server->get_object_renderer();
+    auto* resource_manager = renderer->get_resource_manager();
+    auto* world            = m_world;
+
+    size_t image_count = file->data->images.size();
+    file->uploaded_images.resize(image_count);
+
+    size_t mesh_bytes = 0;
+    for (auto& mesh : file->data->meshes) {
+        for (auto& primitive : mesh.primitives) mesh_bytes += primitive.builder.byte_size(m_render_server->get_vertex_format());
+    }
+
+    // images that were already uploaded for another file are used right away and don't get an upload job
+    std::vector<ImageID> initial_images(image_count, resource_manager->get_null_texture_id());
+    for (size_t i = 0; i < image_count; i++) {
+        if (!file->data->images[i].is_valid()) continue;
+        if (auto existing = reuse_gltf_image(resource_manager, file->data->images[i])) initial_images[i] = existing.value();
+    }
+
+    // meshes and materials go first so that image jobs can refer to the materials that sample them
+    uploader->enqueue(AsyncUploader::Job{
+        .byte_size = mesh_bytes,
+        .record =
+            [=](vke::CommandBuffer& cmd) {
+                file->resources = create_gltf_resources(cmd, renderer, file->data, initial_images);
+            },
+        .on_complete =
+            [=] {
+                log_content_dedup(resource_manager, *file->data);
+
+                auto prefab = create_gltf_prefab(world, resource_manager, *file->data, file->resources);
+                if (file->on_loaded) file->on_loaded(prefab);
+            },
+    });
+
+    for (size_t i = 0; i < image_count; i++) {
+        if (!file->data->images[i].is_valid() || initial_images[i] != resource_manager->get_null_texture_id()) continue;
+
+        uploader->enqueue(AsyncUploader::Job{
+            .byte_size = file->data->images[i].byte_size(),
+            .record =
+                [=](vke::CommandBuffer& cmd) {
+                    file->uploaded_images[i] = upload_decoded_image(cmd, file->data->images[i]);
+                },
+            .on_complete =
+                [=] {
+                    auto image_id = resource_manager->create_image(std::move(file->uploaded_images[i]));
+                    // the decoded pixels stay in host memory so the image can be re-streamed after its mips are evicted
+                    register_gltf_image(resource_manager, image_id, file->data, i);
+
+                    for (auto material_id : file->resources.image_materials[i]) {
+                        resource_manager->set_material_image(material_id, 0, image_id);
+                    }
+                },
+        });
+    }
+}
+
+} // namespace vke
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "fwd.hpp"
+#include <vke/fwd.hpp>
+
+#include "gltf_loader.hpp"
+
+namespace vke {
+
+// streams gltf files in without blocking the frame loop.
+// files are parsed and their images decoded on the thread pool, then uploaded through the async uploader.
+// the prefab is created once the meshes are resident, materials sample the null texture until their images are
+class AsyncGltfLoader {
+public:
+    using LoadedCallback = std::function<void(flecs::entity prefab)>;
+
+    AsyncGltfLoader(RenderServer* render_server, flecs::world* world);
+
+    void load(const std::string& file_path, LoadedCallback on_loaded);
+
+    // hands finished imports over to the uploader. called once per frame
+    void update();
+
+    size_t get_pending_import_count() const { return m_pending_imports.size(); }
+
+private:
+    struct PendingImport {
+        std::string file_path;
+        std::future<std::optional<GltfImportData>> import;
+        LoadedCallback on_loaded;
+    };
+
+    struct StreamingFile;
+
+    void stream(std::shared_ptr<StreamingFile> file);
+
+private:
+    RenderServer* m_render_server;
+    flecs::world* m_world;
+
+    std::vector<PendingImport> m_pending_imports;
+};
+
+} // namespace vke
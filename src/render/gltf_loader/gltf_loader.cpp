@@ -1,13 +1,22 @@
 #include "gltf_loader.hpp"
 
+#include <algorithm>
 #include <filesystem>
+#include <format>
+#include <unordered_map>
+#include <unordered_set>
 #include <flecs/addons/flecs_cpp.h>
 
 #include "flecs/addons/cpp/world.hpp"
 #include "glm/ext/matrix_float4x4.hpp"
 #include "render/object_renderer/object_renderer.hpp"
 #include "render/object_renderer/resource_manager.hpp"
+#include "render/render_server.hpp"
+#include "render/texture/texture_compression.hpp"
+#include "render/texture/texture_util.hpp"
 #include "tiny_gltf.h"
+#include "util/hash.hpp"
+#include "util/thread_pool.hpp"
 
 #include "scene/components/transform.hpp"
 
@@ -56,79 +65,190 @@ static bool load_gltf_into_model(tg::Model& model, const std::string& file_path)
     return true;
 }
 
-std::optional<flecs::entity> load_gltf_file(vke::CommandBuffer& cmd, flecs::world* world, ObjectRenderer* renderer, const std::string& file_path) {
-    tg::Model model;
-    if (!load_gltf_into_model(model, file_path)) return std::nullopt;
+static VkSamplerAddressMode convert_wrap_mode(int wrap) {
+    switch (wrap) {
+    case TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE: return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    case TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT: return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+    default: return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    }
+}
 
-    auto* resource_manager = renderer->get_resource_manager();
+static SamplerDescription convert_sampler(const tg::Sampler& sampler) {
+    SamplerDescription description{
+        .address_mode_u = convert_wrap_mode(sampler.wrapS),
+        .address_mode_v = convert_wrap_mode(sampler.wrapT),
+    };
 
-    StencilBuffer stencil = StencilBuffer(1 << 21);
+    if (sampler.magFilter == TINYGLTF_TEXTURE_FILTER_NEAREST) {
+        description.mag_filter = VK_FILTER_NEAREST;
+    }
 
-    std::string registered_name_prefix = file_path + "$";
+    // unspecified(-1) min filters keep the trilinear defaults
+    switch (sampler.minFilter) {
+    case TINYGLTF_TEXTURE_FILTER_NEAREST:
+        description.min_filter = VK_FILTER_NEAREST;
+        description.use_mips   = false;
+        break;
+    case TINYGLTF_TEXTURE_FILTER_LINEAR:
+        description.use_mips = false;
+        break;
+    case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
+        description.min_filter  = VK_FILTER_NEAREST;
+        description.mipmap_mode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        break;
+    case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
+        description.mipmap_mode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        break;
+    case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR:
+        description.min_filter = VK_FILTER_NEAREST;
+        break;
+    default: break;
+    }
 
-    auto make_name = [&](const std::string& base_name) {
-        return base_name.empty() ? std::string() : registered_name_prefix + base_name;
-    };
+    // pixel art style textures shouldn't be smeared by anisotropic filtering
+    if (description.mag_filter == VK_FILTER_NEAREST && description.min_filter == VK_FILTER_NEAREST) {
+        description.max_anisotropy = 1.f;
+    }
 
-    auto get_buffer_view = [&]<typename T>(Type<T>, int buffer_view, size_t byte_offset = 0) -> std::span<T> {
-        auto& view   = model.bufferViews.at(buffer_view);
-        auto& buffer = model.buffers.at(view.buffer);
+    return description;
+}
 
-        size_t byte_end = view.byteOffset + view.byteLength;
-        if (buffer.data.size() < byte_end) {
-            THROW_ERROR("while loading gltf file %s:buffer view %d overflows buffer %d by %ld bytes\n", file_path.c_str(), buffer_view, view.buffer, byte_end - buffer.data.size());
+// expands every 8 or 16 bit image into tightly packed rgba8
+static std::optional<std::vector<u8>> convert_to_rgba8(const tg::Image& image) {
+    bool is_8bit  = image.bits == 8 && image.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    bool is_16bit = image.bits == 16 && image.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+
+    if (!(is_8bit || is_16bit) || image.component < 1 || image.component > 4) return std::nullopt;
+    if (is_8bit && image.component == 4) return image.image;
+
+    size_t pixel_count = static_cast<size_t>(image.width) * image.height;
+    std::vector<u8> rgba(pixel_count * 4);
+
+    for (size_t i = 0; i < pixel_count; i++) {
+        u8 channels[4] = {0, 0, 0, 255};
+        for (int c = 0; c < image.component; c++) {
+            size_t index = i * image.component + c;
+            // 16 bit data is little endian, only the high byte is kept
+            channels[c] = is_16bit ? image.image[index * 2 + 1] : image.image[index];
         }
 
-        if (view.byteLength < byte_offset) {
-            THROW_ERROR("while loading gltf file %s: accessor overflow by %ld", file_path.c_str(), byte_offset - view.byteLength);
+        // grey and grey + alpha images
+        if (image.component <= 2) {
+            channels[3] = image.component == 2 ? channels[1] : 255;
+            channels[1] = channels[0];
+            channels[2] = channels[0];
         }
 
-        // return std::span<T>(reinterpret_cast<T*>(buffer.data.data() + view.byteOffset + byte_offset), view.byteLength / sizeof(T));
-        return vke::span_cast<T>(std::span(buffer.data).subspan(view.byteOffset + byte_offset, view.byteLength - byte_offset));
-    };
+        memcpy(&rgba[i * 4], channels, 4);
+    }
+
+    return rgba;
+}
+
+// images referenced by several texture slots are treated as color if any of them is
+static std::vector<TextureUsage> classify_image_usages(const tg::Model& model) {
+    std::vector<TextureUsage> usages(model.images.size(), TextureUsage::LINEAR_COLOR);
+    std::vector<bool> is_color(model.images.size(), false);
+
+    auto mark = [&](int texture_index, TextureUsage usage) {
+        if (texture_index == -1) return;
 
-    auto get_buffer_view_from_accessor = [&]<typename T>(Type<T> t, int accessor_index) {
-        auto& accessor = model.accessors.at(accessor_index);
+        int image_index = model.textures.at(texture_index).source;
+        if (image_index == -1 || is_color[image_index]) return;
 
-        return get_buffer_view(t, accessor.bufferView, accessor.byteOffset).subspan(0, accessor.count);
+        usages[image_index] = usage;
+        if (usage == TextureUsage::COLOR) is_color[image_index] = true;
     };
 
-    // model.textures[0].source
-    // model.images[0].bufferView
+    for (auto& material : model.materials) {
+        mark(material.pbrMetallicRoughness.metallicRoughnessTexture.index, TextureUsage::LINEAR_COLOR);
+        mark(material.occlusionTexture.index, TextureUsage::SINGLE_CHANNEL);
+        mark(material.normalTexture.index, TextureUsage::NORMAL);
+        mark(material.emissiveTexture.index, TextureUsage::COLOR);
+        mark(material.pbrMetallicRoughness.baseColorTexture.index, TextureUsage::COLOR);
+    }
 
-    auto images = vke::map_vec(model.images, [&](const tg::Image& image) {
-        if (!(image.bits == 8 && image.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE && image.component == 4)) {
-            // handle unsupported formats
-            TODO();
-        }
+    return usages;
+}
 
-        auto vke_image = Image::image_from_bytes(cmd, std::span(image.image),
-            vke::ImageArgs{
-                .format      = VK_FORMAT_R8G8B8A8_SRGB,
-                .usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT,
-                .width       = static_cast<u32>(image.width),
-                .height      = static_cast<u32>(image.height),
-                .layers      = 1,
-            });
+size_t DecodedImage::byte_size() const {
+    if (compressed.has_value()) {
+        return vke::fold(compressed->mips, size_t(0), [](size_t a, const SharedBytes& mip) { return a + mip.size(); });
+    }
 
-        return resource_manager->create_image(std::move(vke_image));
-    });
+    // the mip chain is generated on the gpu
+    return rgba.size() * 4 / 3;
+}
 
-    auto get_image = [&](int texture_index) {
-        auto& texture = model.textures.at(texture_index);
+u32 DecodedImage::mip_count() const {
+    return compressed.has_value() ? static_cast<u32>(compressed->mips.size()) : calculate_mip_count(width, height);
+}
 
-        return images.at(texture.source);
-    };
+std::unique_ptr<vke::Image> upload_decoded_image(vke::CommandBuffer& cmd, const DecodedImage& image, u32 first_mip) {
+    if (image.compressed.has_value()) {
+        return upload_compressed_texture(cmd, image.compressed.value(), first_mip);
+    }
 
-    auto default_id   = resource_manager->create_material(ObjectRenderer::pbr_pipeline_name, {});
-    auto material_ids = vke::map_vec(model.materials, [&](const tg::Material& material) {
-        int pbr_texture_index = material.pbrMetallicRoughness.baseColorTexture.index;
-        if (pbr_texture_index == -1) {
-            return default_id;
-        }
+    std::span<const u8> pixels = image.rgba;
+    std::vector<u8> downsampled;
 
-        return resource_manager->create_material(ObjectRenderer::pbr_pipeline_name, {get_image(pbr_texture_index)});
-    });
+    u32 width = image.width, height = image.height;
+    for (u32 i = 0; i < first_mip && (width > 1 || height > 1); i++) {
+        downsampled = downsample_rgba8(pixels, width, height, image.usage == TextureUsage::COLOR);
+        pixels      = downsampled;
+        width       = std::max(width / 2, 1u);
+        height      = std::max(height / 2, 1u);
+    }
+
+    auto vke_image = Image::image_from_bytes(cmd, pixels,
+        vke::ImageArgs{
+            .format      = image.usage == TextureUsage::COLOR ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM,
+            .usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .width       = width,
+            .height      = height,
+            .layers      = 1,
+            .mip_levels  = calculate_mip_count(width, height),
+        });
+
+    generate_mipmaps(cmd, vke_image.get());
+
+    return vke_image;
+}
+
+struct GltfModelView {
+    const tg::Model& model;
+    const std::string& file_path;
+};
+
+template <typename T>
+static std::span<const T> get_buffer_view(GltfModelView view_info, Type<T>, int buffer_view, size_t byte_offset = 0) {
+    auto& model     = view_info.model;
+    auto& file_path = view_info.file_path;
+
+    auto& view   = model.bufferViews.at(buffer_view);
+    auto& buffer = model.buffers.at(view.buffer);
+
+    size_t byte_end = view.byteOffset + view.byteLength;
+    if (buffer.data.size() < byte_end) {
+        THROW_ERROR("while loading gltf file %s:buffer view %d overflows buffer %d by %ld bytes\n", file_path.c_str(), buffer_view, view.buffer, byte_end - buffer.data.size());
+    }
+
+    if (view.byteLength < byte_offset) {
+        THROW_ERROR("while loading gltf file %s: accessor overflow by %ld", file_path.c_str(), byte_offset - view.byteLength);
+    }
+
+    return vke::span_cast<const T>(std::span(buffer.data).subspan(view.byteOffset + byte_offset, view.byteLength - byte_offset));
+}
+
+template <typename T>
+static std::span<const T> get_buffer_view_from_accessor(GltfModelView view_info, Type<T> t, int accessor_index) {
+    auto& accessor = view_info.model.accessors.at(accessor_index);
+
+    return get_buffer_view(view_info, t, accessor.bufferView, accessor.byteOffset).subspan(0, accessor.count);
+}
+
+static MeshBuilder build_primitive(GltfModelView view_info, const tg::Primitive& primitive) {
+    auto& model = view_info.model;
 
     auto set_indicies = [&](MeshBuilder& builder, int ib_accessor_index) {
         if (ib_accessor_index == -1) return;
@@ -136,83 +256,605 @@ std::optional<flecs::entity> load_gltf_file(vke::CommandBuffer& cmd, flecs::worl
         auto& index_accessor = model.accessors.at(ib_accessor_index);
 
         if (index_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-            builder.set_indicies(get_buffer_view_from_accessor(Type<uint16_t>(), ib_accessor_index));
+            builder.set_indicies(get_buffer_view_from_accessor(view_info, Type<uint16_t>(), ib_accessor_index));
             return;
         }
 
         if (index_accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-            builder.set_indicies(get_buffer_view_from_accessor(Type<uint32_t>(), ib_accessor_index));
+            builder.set_indicies(get_buffer_view_from_accessor(view_info, Type<uint32_t>(), ib_accessor_index));
             return;
         }
 
         TODO();
     };
 
-    auto create_mesh_from_primitive = [&](const tg::Primitive& primitive) {
-        //"TEXCOORD_0" "NORMAL" "POSITION"
-        // auto& position_accessor = model.accessors[primitive.attributes.at("POSITION")];
+    //"TEXCOORD_0" "NORMAL" "POSITION"
+    auto position_view       = get_buffer_view_from_accessor(view_info, Type<glm::vec3>(), primitive.attributes.at("POSITION"));
+    auto texture_coords_view = get_buffer_view_from_accessor(view_info, Type<glm::vec2>(), primitive.attributes.at("TEXCOORD_0"));
+    auto normals_view        = get_buffer_view_from_accessor(view_info, Type<glm::vec3>(), primitive.attributes.at("NORMAL"));
 
-        auto position_view       = get_buffer_view_from_accessor(Type<glm::vec3>(), primitive.attributes.at("POSITION"));
-        auto texture_coords_view = get_buffer_view_from_accessor(Type<glm::vec2>(), primitive.attributes.at("TEXCOORD_0"));
-        auto normals_view        = get_buffer_view_from_accessor(Type<glm::vec3>(), primitive.attributes.at("NORMAL"));
+    auto& position_accessor = model.accessors[primitive.attributes.at("POSITION")];
 
-        auto& position_accessor = model.accessors[primitive.attributes.at("POSITION")];
+    MeshBuilder builder;
+    builder.set_positions(position_view);
+    builder.set_texture_coords(texture_coords_view);
+    builder.set_normals(normals_view);
 
-        MeshBuilder builder;
-        builder.set_positions(position_view);
-        builder.set_texture_coords(texture_coords_view);
-        builder.set_normals(normals_view);
+    builder.set_boundary(AABB{
+        .start = {position_accessor.minValues[0], position_accessor.minValues[1], position_accessor.minValues[2]},
+        .end   = {position_accessor.maxValues[0], position_accessor.maxValues[1], position_accessor.maxValues[2]},
+    });
 
-        builder.set_boundary(AABB{
-            .start = {position_accessor.minValues[0], position_accessor.minValues[1], position_accessor.minValues[2]},
-            .end   = {position_accessor.maxValues[0], position_accessor.maxValues[1], position_accessor.maxValues[2]},
-        });
+    set_indicies(builder, primitive.indices);
 
-        set_indicies(builder, primitive.indices);
+    return builder;
+}
 
-        return resource_manager->create_mesh(builder.build(&cmd, &stencil));
+static DecodedImage decode_image(tg::Image& image, const std::string& file_path, u32 image_index, TextureUsage usage, const TextureCompressionSettings& compression_settings, ThreadPool* thread_pool) {
+    DecodedImage decoded{
+        .usage  = usage,
+        .width  = static_cast<u32>(image.width),
+        .height = static_cast<u32>(image.height),
     };
 
-    auto model_ids = vke::map_vec(model.meshes, [&](const tg::Mesh& mesh) {
-        auto parts = vke::map_vec(mesh.primitives, [&](const tg::Primitive& primitive) {
-            return std::pair(create_mesh_from_primitive(primitive), material_ids.at(primitive.material));
-        });
+    auto rgba = convert_to_rgba8(image);
+    if (!rgba.has_value()) {
+        LOG_WARNING("while loading gltf file %s: image %u has an unsupported format(%d bits, %d components), using the null texture", file_path.c_str(), image_index, image.bits, image.component);
+        return decoded;
+    }
+
+    if (compression_settings.enabled) {
+        decoded.compressed = compress_texture(rgba.value(), decoded.width, decoded.height, decoded.usage, compression_settings, thread_pool);
+    } else {
+        decoded.rgba = std::move(rgba.value());
+    }
+
+    u64 hash = hash_value(decoded.usage, hash_value(decoded.width, hash_value(decoded.height)));
+    if (decoded.compressed.has_value()) {
+        hash = hash_value(decoded.compressed->format, hash);
+        for (auto& mip : decoded.compressed->mips) hash = hash_bytes(mip, hash);
+    } else {
+        hash = hash_bytes(decoded.rgba, hash);
+    }
+    decoded.content_hash = hash;
+
+    // the decoded copy is all that is needed from here on
+    image.image = {};
+
+    return decoded;
+}
+
+static RelativeTransform convert_node_transform(const tg::Node& node) {
+    if (node.matrix.size() == 16) {
+        glm::mat4 mat(1);
+        for (int i = 0; i < 16; i++) {
+            mat[i / 4][i % 4] = static_cast<float>(node.matrix[i]);
+        }
+        return RelativeTransform::decompose_from_matrix(mat);
+    }
+
+    RelativeTransform transform;
+
+    if (node.translation.size() == 3) {
+        transform.position[0] = static_cast<float>(node.translation[0]);
+        transform.position[1] = static_cast<float>(node.translation[1]);
+        transform.position[2] = static_cast<float>(node.translation[2]);
+    } else {
+        transform.position = {0, 0, 0};
+    }
+
+    transform.scale    = {1, 1, 1};
+    transform.rotation = glm::quat(1, 0, 0, 0);
+
+    assert(node.rotation.empty());
+    assert(node.scale.empty());
+
+    return transform;
+}
+
+// leaf nodes of the same mesh under a parent are merged into one instanced node once there are this many of them
+constexpr u32 INSTANCE_GROUP_MIN_NODES = 16;
+
+// the per instance transforms of EXT_mesh_gpu_instancing, empty when the node doesn't use the extension
+static std::vector<RelativeTransform> convert_node_instances(GltfModelView view_info, const tg::Node& node) {
+    auto extension = node.extensions.find("EXT_mesh_gpu_instancing");
+    if (extension == node.extensions.end() || node.mesh == -1) return {};
+
+    auto& attributes = extension->second.Get("attributes");
+
+    // only float attributes are supported, the normalized integer rotations & scales the extension allows are skipped
+    auto get_accessor = [&](const char* name, int component_count) -> int {
+        if (!attributes.Has(name)) return -1;
+
+        int accessor_index = attributes.Get(name).GetNumberAsInt();
+        auto& accessor     = view_info.model.accessors.at(accessor_index);
+        if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || tg::GetNumComponentsInType(accessor.type) != component_count) {
+            LOG_WARNING("%s: instance attribute %s of node \"%s\" isn't a float vec%d, it is ignored", view_info.file_path.c_str(), name, node.name.c_str(), component_count);
+            return -1;
+        }
+
+        return accessor_index;
+    };
+
+    int translation_accessor = get_accessor("TRANSLATION", 3);
+    int rotation_accessor    = get_accessor("ROTATION", 4);
+    int scale_accessor       = get_accessor("SCALE", 3);
+
+    std::span<const glm::vec3> translations, scales;
+    std::span<const glm::vec4> rotations;
+    if (translation_accessor != -1) translations = get_buffer_view_from_accessor(view_info, Type<glm::vec3>(), translation_accessor);
+    if (rotation_accessor != -1) rotations = get_buffer_view_from_accessor(view_info, Type<glm::vec4>(), rotation_accessor);
+    if (scale_accessor != -1) scales = get_buffer_view_from_accessor(view_info, Type<glm::vec3>(), scale_accessor);
+
+    size_t instance_count = std::max({translations.size(), rotations.size(), scales.size()});
+    if ((!translations.empty() && translations.size() != instance_count) || (!rotations.empty() && rotations.size() != instance_count) || (!scales.empty() && scales.size() != instance_count)) {
+        LOG_WARNING("%s: instance attributes of node \"%s\" have different counts, the node isn't instanced", view_info.file_path.c_str(), node.name.c_str());
+        return {};
+    }
+
+    std::vector<RelativeTransform> instances(instance_count);
+    for (size_t i = 0; i < instance_count; i++) {
+        auto& instance = instances[i];
+
+        // gltf stores quaternions as xyzw
+        instance.position = translations.empty() ? glm::vec3(0.f) : translations[i];
+        instance.rotation = rotations.empty() ? glm::quat(1, 0, 0, 0) : glm::quat(rotations[i].w, rotations[i].x, rotations[i].y, rotations[i].z);
+        instance.scale    = scales.empty() ? glm::vec3(1.f) : scales[i];
+    }
+
+    return instances;
+}
+
+// returns the number of nodes that were merged away
+static u32 group_duplicate_nodes(std::vector<ImportedNode>& nodes) {
+    u32 merged_count = 0;
+
+    std::unordered_map<int, std::vector<u32>> leaves_by_mesh;
+    std::unordered_set<u32> merged;
+
+    for (auto& node : nodes) {
+        leaves_by_mesh.clear();
+        merged.clear();
+
+        for (u32 child : node.children) {
+            auto& child_node = nodes.at(child);
+            if (child_node.mesh != -1 && child_node.children.empty() && child_node.instances.empty()) leaves_by_mesh[child_node.mesh].push_back(child);
+        }
+
+        for (auto& [mesh, leaves] : leaves_by_mesh) {
+            if (leaves.size() < INSTANCE_GROUP_MIN_NODES) continue;
+
+            // the first leaf becomes the group, the transforms of the leaves are already relative to the parent
+            auto& group     = nodes[leaves[0]];
+            group.instances = vke::map_vec(leaves, [&](u32 leaf) { return nodes[leaf].transform; });
+            group.transform = static_cast<RelativeTransform>(Transform::IDENTITY);
+
+            merged.insert(leaves.begin() + 1, leaves.end());
+        }
+
+        if (merged.empty()) continue;
+
+        std::erase_if(node.children, [&](u32 child) { return merged.contains(child); });
+        merged_count += merged.size();
+    }
+
+    return merged_count;
+}
+
+// runs func(i) for every i in [0, count), on the pool if there is one
+static void for_each_task(ThreadPool* thread_pool, u32 count, auto&& func) {
+    if (thread_pool != nullptr) {
+        thread_pool->parallel_for(count, func);
+        return;
+    }
+
+    for (u32 i = 0; i < count; i++) func(i);
+}
+
+// the stats of the primitives of each mesh are combined, weighted by their triangle counts
+static void log_optimization_stats(const GltfImportData& data, std::span<const std::pair<u32, u32>> primitives, std::span<const MeshOptimizationStats> stats) {
+    struct MeshStats {
+        u32 triangle_count = 0;
+        u32 meshlet_count  = 0;
+        float acmr_before = 0.f, acmr_after = 0.f, atvr_before = 0.f, atvr_after = 0.f;
+    };
+
+    std::vector<MeshStats> mesh_stats(data.meshes.size());
+    for (u32 i = 0; i < primitives.size(); i++) {
+        auto& mesh_stat = mesh_stats[primitives[i].first];
+        float weight    = static_cast<float>(stats[i].triangle_count);
+
+        mesh_stat.triangle_count += stats[i].triangle_count;
+        mesh_stat.meshlet_count += stats[i].meshlet_count;
+        mesh_stat.acmr_before += stats[i].before.acmr * weight;
+        mesh_stat.acmr_after += stats[i].after.acmr * weight;
+        mesh_stat.atvr_before += stats[i].before.atvr * weight;
+        mesh_stat.atvr_after += stats[i].after.atvr * weight;
+    }
+
+    for (u32 i = 0; i < mesh_stats.size(); i++) {
+        auto& mesh_stat = mesh_stats[i];
+        if (mesh_stat.triangle_count == 0) continue;
+
+        float weight = 1.f / mesh_stat.triangle_count;
+        LOG_INFO("%s: mesh \"%s\" %u triangles in %u meshlets, acmr %.3f -> %.3f, atvr %.3f -> %.3f", data.file_path.c_str(), data.meshes[i].name.c_str(), mesh_stat.triangle_count, mesh_stat.meshlet_count, //
+                 mesh_stat.acmr_before * weight, mesh_stat.acmr_after * weight, mesh_stat.atvr_before * weight, mesh_stat.atvr_after * weight);
+    }
+}
+
+static void log_lods(const GltfImportData& data) {
+    for (auto& mesh : data.meshes) {
+        for (u32 i = 0; i < mesh.primitives.size(); i++) {
+            auto& primitive = mesh.primitives[i];
+            if (primitive.lods.empty()) continue;
+
+            std::string chain = std::to_string(primitive.builder.get_indicies().size() / 3);
+            for (auto& lod : primitive.lods) {
+                chain += std::format(" -> {}(error {:.4f})", lod.builder.get_indicies().size() / 3, lod.error);
+            }
+
+            LOG_INFO("%s: mesh \"%s\" primitive %u lod triangles %s", data.file_path.c_str(), mesh.name.c_str(), i, chain.c_str());
+        }
+    }
+}
+
+static std::optional<GltfImportData> import_gltf_source(const std::string& file_path, const TextureCompressionSettings& compression_settings, const LodSettings& lod_settings, ThreadPool* thread_pool) {
+    tg::Model model;
+    if (!load_gltf_into_model(model, file_path)) return std::nullopt;
+
+    GltfImportData data;
+    data.file_path = file_path;
+
+    auto image_usages = classify_image_usages(model);
+
+    auto get_image_index = [&](int texture_index) {
+        return model.textures.at(texture_index).source;
+    };
+
+    data.materials = vke::map_vec(model.materials, [&](const tg::Material& material) {
+        int texture_index = material.pbrMetallicRoughness.baseColorTexture.index;
+        if (texture_index == -1) return ImportedMaterial{};
+
+        auto& texture = model.textures.at(texture_index);
+
+        return ImportedMaterial{
+            .base_color_image   = get_image_index(texture_index),
+            .base_color_sampler = texture.sampler == -1 ? SamplerDescription{} : convert_sampler(model.samplers.at(texture.sampler)),
+        };
+    });
+
+    data.nodes = vke::map_vec(model.nodes, [&](const tg::Node& node) {
+        return ImportedNode{
+            .transform = convert_node_transform(node),
+            .mesh      = node.mesh,
+            .children  = vke::map_vec(node.children, [](int child) { return static_cast<u32>(child); }),
+            .instances = convert_node_instances(GltfModelView{model, file_path}, node),
+            .is_static = node.extras.Has("static") && node.extras.Get("static").IsBool() && node.extras.Get("static").Get<bool>(),
+        };
+    });
+
+    if (u32 merged_count = group_duplicate_nodes(data.nodes); merged_count > 0) {
+        LOG_INFO("%s: merged %u duplicate nodes into instance groups", file_path.c_str(), merged_count);
+    }
+
+    std::vector<std::pair<u32, u32>> primitives;
+    data.meshes.resize(model.meshes.size());
+    for (u32 mesh_index = 0; mesh_index < model.meshes.size(); mesh_index++) {
+        data.meshes[mesh_index].name = model.meshes[mesh_index].name;
+        data.meshes[mesh_index].primitives.resize(model.meshes[mesh_index].primitives.size());
+
+        for (u32 primitive_index = 0; primitive_index < model.meshes[mesh_index].primitives.size(); primitive_index++) {
+            data.meshes[mesh_index].primitives[primitive_index].material = model.meshes[mesh_index].primitives[primitive_index].material;
+            primitives.push_back({mesh_index, primitive_index});
+        }
+    }
+
+    data.images.resize(model.images.size());
+    std::vector<MeshOptimizationStats> optimization_stats(primitives.size());
+
+    // every task writes to its own image or primitive so they don't need any synchronization
+    u32 image_count = static_cast<u32>(model.images.size());
+    for_each_task(thread_pool, image_count + static_cast<u32>(primitives.size()), [&](u32 task_index) {
+        if (task_index < image_count) {
+            data.images[task_index] = decode_image(model.images[task_index], file_path, task_index, image_usages[task_index], compression_settings, thread_pool);
+            return;
+        }
+
+        u32 primitive_task                 = task_index - image_count;
+        auto [mesh_index, primitive_index] = primitives[primitive_task];
+        auto& primitive                    = data.meshes[mesh_index].primitives[primitive_index];
+        primitive.builder                  = build_primitive(GltfModelView{model, file_path}, model.meshes[mesh_index].primitives[primitive_index]);
+
+        optimization_stats[primitive_task] = primitive.builder.optimize();
+        primitive.lods                     = primitive.builder.generate_lods(lod_settings);
 
-        return resource_manager->create_model(parts, make_name(mesh.name));
+        // hashed here so that the asset cache stores them and loads from it don't have to hash again
+        primitive.content_hash = primitive.builder.content_hash();
+        for (auto& lod : primitive.lods) lod.content_hash = lod.builder.content_hash();
     });
 
-    auto create_transformation_from_node = [&](tg::Node& node) {
-        if (node.matrix.size() == 16) {
-            glm::mat4 mat(1);
-            for (int i = 0; i < 16; i++) {
-                mat[i / 4][i % 4] = static_cast<float>(node.matrix[i]);
+    log_optimization_stats(data, primitives, optimization_stats);
+    log_lods(data);
+
+    return data;
+}
+
+std::optional<GltfImportData> import_gltf_file(const std::string& file_path, const TextureCompressionSettings& compression_settings, const AssetCacheSettings& cache_settings, const LodSettings& lod_settings, ThreadPool* thread_pool) {
+    if (cache_settings.enabled) {
+        if (auto cached = read_asset_cache(cache_settings, file_path, compression_settings, lod_settings)) return cached;
+    }
+
+    auto data = import_gltf_source(file_path, compression_settings, lod_settings, thread_pool);
+
+    if (data.has_value() && cache_settings.enabled) {
+        write_asset_cache(cache_settings, data.value(), compression_settings, lod_settings);
+    }
+
+    return data;
+}
+
+void encode_gltf_meshes(GltfImportData& data, VertexFormat format, ThreadPool* thread_pool) {
+    struct EncodeJob {
+        ImportedPrimitive* primitive;
+        u32 lod;
+    };
+
+    // in the same order as create_gltf_resources so that the first primitive of each content is the one that gets encoded
+    std::vector<EncodeJob> jobs;
+    std::unordered_set<u64> seen_hashes;
+    for (auto& mesh : data.meshes) {
+        for (auto& primitive : mesh.primitives) {
+            primitive.encoded_lods.clear();
+            primitive.encoded_lods.resize(primitive.lods.size() + 1);
+
+            for (u32 lod = 0; lod < primitive.encoded_lods.size(); lod++) {
+                u64 hash = lod == 0 ? primitive.content_hash : primitive.lods[lod - 1].content_hash;
+                if (hash != 0 && !seen_hashes.insert(hash).second) continue;
+
+                jobs.push_back({&primitive, lod});
             }
-            return RelativeTransform::decompose_from_matrix(mat);
         }
+    }
+
+    for_each_task(thread_pool, static_cast<u32>(jobs.size()), [&](u32 task_index) {
+        auto [primitive, lod] = jobs[task_index];
+
+        auto& builder                = lod == 0 ? primitive->builder : primitive->lods[lod - 1].builder;
+        primitive->encoded_lods[lod] = builder.encode(format);
+    });
+
+    data.encoded_format = format;
+}
+
+GltfResources create_gltf_resources(vke::CommandBuffer& cmd, ObjectRenderer* renderer, std::shared_ptr<GltfImportData> data, std::span<const ImageID> images) {
+    auto& file_path         = data->file_path;
+    auto* resource_manager  = renderer->get_resource_manager();
+    auto* residency_manager = resource_manager->get_residency_manager();
+    auto vertex_format      = renderer->get_render_server()->get_vertex_format();
+
+    std::string registered_name_prefix = file_path + "$";
+
+    auto make_name = [&](const std::string& base_name) {
+        return base_name.empty() ? std::string() : registered_name_prefix + base_name;
+    };
+
+    GltfResources resources;
+    resources.image_materials.resize(data->images.size());
+
+    auto default_id        = resource_manager->create_material(ObjectRenderer::pbr_pipeline_name, {});
+    resources.material_ids = vke::map_vec(data->materials, [&](const ImportedMaterial& material) {
+        if (material.base_color_image == -1) {
+            return default_id;
+        }
+
+        auto sampler = resource_manager->get_sampler(material.base_color_sampler);
+        auto image   = images[material.base_color_image];
+
+        // images that are still streaming in are the null texture here, their materials can't be matched yet
+        u64 content_hash = image == resource_manager->get_null_texture_id() ? 0 : hash_value(sampler, hash_value(image.id));
+        if (auto existing = resource_manager->find_material_by_content(content_hash)) {
+            resource_manager->get_content_dedup_stats().reused_materials++;
+            return existing.value();
+        }
+
+        auto id = resource_manager->create_material(ObjectRenderer::pbr_pipeline_name, {image}, "", {sampler});
+        resource_manager->register_material_content(content_hash, id);
+
+        resources.image_materials[material.base_color_image].push_back(id);
+        return id;
+    });
+
+    auto get_material_id = [&](int material) {
+        return material == -1 ? default_id : resources.material_ids.at(material);
+    };
+
+    // lod 0 is the full detail mesh of the primitive
+    struct MeshJob {
+        u32 mesh_index, primitive_index, lod;
+    };
+
+    auto get_builder = [](const GltfImportData& data, const MeshJob& job) -> const MeshBuilder& {
+        auto& primitive = data.meshes[job.mesh_index].primitives[job.primitive_index];
+        return job.lod == 0 ? primitive.builder : primitive.lods[job.lod - 1].builder;
+    };
+
+    std::vector<MeshJob> jobs;
+    for (u32 mesh_index = 0; mesh_index < data->meshes.size(); mesh_index++) {
+        for (u32 primitive_index = 0; primitive_index < data->meshes[mesh_index].primitives.size(); primitive_index++) {
+            u32 lod_count = data->meshes[mesh_index].primitives[primitive_index].lods.size() + 1;
+            for (u32 lod = 0; lod < lod_count; lod++) jobs.push_back({mesh_index, primitive_index, lod});
+        }
+    }
+
+    auto get_content_hash = [&](const MeshJob& job) {
+        auto& primitive = data->meshes[job.mesh_index].primitives[job.primitive_index];
+        return job.lod == 0 ? primitive.content_hash : primitive.lods[job.lod - 1].content_hash;
+    };
+
+    // meshes that already exist, from another file or from an earlier job of this one, are reused instead of being built again
+    std::vector<std::optional<MeshID>> existing_mesh_ids(jobs.size());
+    std::vector<i32> duplicate_of(jobs.size(), -1);
+    std::vector<u32> build_jobs;
+
+    std::unordered_map<u64, u32> first_jobs;
+    for (u32 i = 0; i < jobs.size(); i++) {
+        u64 hash = get_content_hash(jobs[i]);
+
+        if (hash != 0) {
+            existing_mesh_ids[i] = resource_manager->find_mesh_by_content(hash);
+            if (existing_mesh_ids[i].has_value()) continue;
+
+            auto [it, is_first] = first_jobs.try_emplace(hash, i);
+            if (!is_first) {
+                duplicate_of[i] = it->second;
+                continue;
+            }
+        }
+
+        build_jobs.push_back(i);
+    }
+
+    // encoding happens on the import worker, this thread only copies the encoded meshes into staging memory.
+    // it's encoded here only when the caller didn't do it
+    if (data->encoded_format != vertex_format) {
+        LOG_WARNING("%s: the meshes weren't encoded before the upload, encoding them on the upload thread", file_path.c_str());
+        encode_gltf_meshes(*data, vertex_format);
+    }
+
+    std::vector<Mesh> gpu_meshes(jobs.size());
+    StencilBuffer stencil;
+    for (u32 i : build_jobs) {
+        auto& job     = jobs[i];
+        gpu_meshes[i] = data->meshes[job.mesh_index].primitives[job.primitive_index].encoded_lods[job.lod].upload(&cmd, &stencil);
+    }
+
+    stencil.flush_copies(cmd);
+
+    // the builders are what the residency sources rebuild from, the encoded copies aren't needed after the upload
+    for (auto& mesh : data->meshes) {
+        for (auto& primitive : mesh.primitives) primitive.encoded_lods = {};
+    }
+    data->encoded_format.reset();
+
+    auto& dedup_stats     = resource_manager->get_content_dedup_stats();
+    u32 reused_mesh_count = 0;
+
+    // the allowed error a lod starts to be drawn at, lod 0 is the full detail mesh. it's kept non decreasing
+    // so that the ranges of the lods neither overlap nor leave gaps, even for lods that didn't come from generate_lods
+    auto lod_start_error = [](const ImportedPrimitive& primitive, u32 lod) {
+        if (lod > primitive.lods.size()) return INFINITY;
+
+        float error = 0.f;
+        for (u32 i = 0; i < lod; i++) error = std::max(error, primitive.lods[i].error);
+        return error;
+    };
+
+    std::vector<MeshID> mesh_ids(jobs.size());
+    std::vector<std::vector<ResourceManager::RenderModel::Part>> model_parts(data->meshes.size());
+    for (u32 i = 0; i < jobs.size(); i++) {
+        auto job        = jobs[i];
+        auto& primitive = data->meshes[job.mesh_index].primitives[job.primitive_index];
+        auto& builder   = get_builder(*data, job);
 
-        RelativeTransform transform;
+        if (existing_mesh_ids[i].has_value() || duplicate_of[i] != -1) {
+            mesh_ids[i] = existing_mesh_ids[i].has_value() ? existing_mesh_ids[i].value() : mesh_ids[duplicate_of[i]];
 
-        if (node.translation.size() == 3) {
-            transform.position[0] = static_cast<float>(node.translation[0]);
-            transform.position[1] = static_cast<float>(node.translation[1]);
-            transform.position[2] = static_cast<float>(node.translation[2]);
+            reused_mesh_count++;
+            dedup_stats.reused_meshes++;
+            dedup_stats.saved_mesh_bytes += builder.byte_size(vertex_format);
         } else {
-            transform.position = {0, 0, 0};
+            mesh_ids[i] = resource_manager->create_mesh(std::move(gpu_meshes[i]));
+            resource_manager->register_mesh_content(get_content_hash(job), mesh_ids[i]);
+
+            // the builders are kept alive by the source so the mesh can be rebuilt after an eviction
+            residency_manager->register_mesh(mesh_ids[i], builder.byte_size(vertex_format), [data, job, get_builder, vertex_format](vke::CommandBuffer& cmd) {
+                StencilBuffer stencil;
+                auto mesh = get_builder(*data, job).build(vertex_format, &cmd, &stencil);
+                stencil.flush_copies(cmd);
+                return mesh;
+            });
         }
 
-        transform.scale    = {1, 1, 1};
-        transform.rotation = glm::quat(1, 0, 0, 0);
+        // the lod is drawn until the allowed error reaches the error of the next coarser one
+        model_parts[job.mesh_index].push_back(ResourceManager::RenderModel::Part{
+            .mesh_id       = mesh_ids[i],
+            .material_id   = get_material_id(primitive.material),
+            .lod_error     = lod_start_error(primitive, job.lod),
+            .lod_max_error = lod_start_error(primitive, job.lod + 1),
+        });
+    }
+
+    if (reused_mesh_count > 0) {
+        LOG_INFO("%s: reused %u of %lu meshes", file_path.c_str(), reused_mesh_count, jobs.size());
+    }
+
+    // every lod is a part of its own, an instance only goes through MAX_MODEL_PARTS parts so larger meshes are split into several models
+    resources.model_ids = vke::map_vec(data->meshes, [&](const ImportedMesh& mesh) {
+        auto& parts = model_parts[&mesh - data->meshes.data()];
+
+        std::vector<RenderModelID> ids{resource_manager->create_model(std::span(parts).first(std::min<size_t>(MAX_MODEL_PARTS, parts.size())), make_name(mesh.name))};
+        for (u32 offset = MAX_MODEL_PARTS; offset < parts.size(); offset += MAX_MODEL_PARTS) {
+            ids.push_back(resource_manager->create_model(std::span(parts).subspan(offset, std::min<size_t>(MAX_MODEL_PARTS, parts.size() - offset))));
+        }
+
+        return ids;
+    });
+
+    return resources;
+}
+
+std::optional<ImageID> reuse_gltf_image(ResourceManager* resource_manager, const DecodedImage& image) {
+    auto existing = resource_manager->find_image_by_content(image.content_hash);
+    if (!existing.has_value()) return std::nullopt;
+
+    auto& dedup_stats = resource_manager->get_content_dedup_stats();
+    dedup_stats.reused_images++;
+    dedup_stats.saved_image_bytes += image.byte_size();
+
+    return existing;
+}
+
+void log_content_dedup(ResourceManager* resource_manager, const GltfImportData& data) {
+    auto& dedup_stats = resource_manager->get_content_dedup_stats();
+    LOG_INFO("%s: content dedup totals: %u meshes, %u images & %u materials reused, %.1f MiB of meshes & %.1f MiB of images saved", data.file_path.c_str(), //
+             dedup_stats.reused_meshes, dedup_stats.reused_images, dedup_stats.reused_materials, dedup_stats.saved_mesh_bytes / (1024.0 * 1024.0), dedup_stats.saved_image_bytes / (1024.0 * 1024.0));
+}
+
+void register_gltf_image(ResourceManager* resource_manager, ImageID id, std::shared_ptr<GltfImportData> data, u32 image_index) {
+    auto& image = data->images[image_index];
+
+    resource_manager->register_image_content(image.content_hash, id);
+
+    resource_manager->get_residency_manager()->register_image(id, image.byte_size(), image.mip_count(), [data, image_index](vke::CommandBuffer& cmd, u32 skipped_mips) -> std::unique_ptr<IImageView> {
+        return upload_decoded_image(cmd, data->images[image_index], skipped_mips);
+    });
+}
+
+flecs::entity create_gltf_prefab(flecs::world* world, ResourceManager* resource_manager, const GltfImportData& data, const GltfResources& resources) {
+    using Part = ResourceManager::RenderModel::Part;
 
-        assert(node.rotation.empty());
-        assert(node.scale.empty());
+    auto& model_ids = resources.model_ids;
 
-        return transform;
+    // entities & drawn instances the prefab is made of, each instance of the prefab costs that many
+    struct PrefabCounts {
+        u32 entities  = 0;
+        u32 instances = 0;
     };
 
-    auto convert_node = vke::make_y_combinator([&](auto& self, int node_index, std::optional<flecs::entity> parent = std::nullopt) -> flecs::entity {
-        auto& node     = model.nodes.at(node_index);
-        auto transform = create_transformation_from_node(node);
+    PrefabCounts unflattened_counts, counts;
+    bool has_static_nodes = false;
+
+    auto count_node = vke::make_y_combinator([&](auto& self, u32 node_index) -> void {
+        auto& node = data.nodes.at(node_index);
 
+        unflattened_counts.entities++;
+        if (node.mesh != -1) unflattened_counts.instances += node.instances.empty() ? 1 : node.instances.size();
+
+        for (auto child_index : node.children) self(child_index);
+    });
+    count_node(data.root_node);
+
+    auto create_entity = [&](std::optional<flecs::entity> parent, const RelativeTransform& transform) {
         auto e = world->prefab();
 
         if (parent.has_value()) {
@@ -221,10 +863,84 @@ std::optional<flecs::entity> load_gltf_file(vke::CommandBuffer& cmd, flecs::worl
 
         e.set<RelativeTransform>(transform);
 
-        if (node.mesh != -1) {
-            auto model_id = model_ids[node.mesh];
+        counts.entities++;
+        return e;
+    };
+
+    // the models after the first one of a split mesh go on child entities at the same place
+    auto get_model_entity = [&](flecs::entity e, u32 model_index) {
+        return model_index == 0 ? e : create_entity(e, static_cast<RelativeTransform>(Transform::IDENTITY));
+    };
 
-            e.set<Renderable>(Renderable{model_ids.at(node.mesh)});
+    auto set_renderable = [&](flecs::entity e, const ImportedNode& node) {
+        auto& ids = model_ids.at(node.mesh);
+        for (u32 i = 0; i < ids.size(); i++) {
+            get_model_entity(e, i).set<Renderable>(Renderable{ids[i]});
+            counts.instances++;
+        }
+    };
+
+    auto set_instance_group = [&](flecs::entity e, const ImportedNode& node) {
+        auto& ids       = model_ids.at(node.mesh);
+        auto transforms = std::make_shared<const std::vector<RelativeTransform>>(node.instances);
+        for (u32 i = 0; i < ids.size(); i++) {
+            get_model_entity(e, i).set<InstanceGroup>(InstanceGroup{
+                .model_id   = ids[i],
+                .transforms = transforms,
+            });
+
+            counts.instances += node.instances.size();
+        }
+    };
+
+    // the parts of every primitive under the static node, placed relative to it. instanced nodes stay entities of their own
+    auto flatten_node = vke::make_y_combinator([&](auto& self, u32 node_index, const glm::mat4& matrix, flecs::entity static_entity, std::vector<Part>& parts) -> void {
+        auto& node = data.nodes.at(node_index);
+
+        if (node.mesh != -1 && !node.instances.empty()) {
+            set_instance_group(create_entity(static_entity, RelativeTransform::decompose_from_matrix(matrix)), node);
+        } else if (node.mesh != -1) {
+            for (auto model_id : model_ids.at(node.mesh)) {
+                for (auto part : resource_manager->get_model(model_id)->parts) {
+                    part.local_matrix = matrix * part.local_matrix;
+                    parts.push_back(part);
+                }
+            }
+        }
+
+        for (auto child_index : node.children) {
+            self(child_index, matrix * data.nodes.at(child_index).transform.get_model_matrix(), static_entity, parts);
+        }
+    };
+
+    auto convert_node = vke::make_y_combinator([&](auto& self, u32 node_index, std::optional<flecs::entity> parent = std::nullopt) -> flecs::entity {
+        auto& node = data.nodes.at(node_index);
+
+        auto e = create_entity(parent, node.transform);
+
+        if (node.is_static) {
+            has_static_nodes = true;
+
+            std::vector<Part> parts;
+            flatten_node(node_index, glm::mat4(1.f), e, parts);
+
+            // an instance only goes through MAX_MODEL_PARTS parts of its model, the rest are split into models of child entities
+            for (u32 offset = 0; offset < parts.size(); offset += MAX_MODEL_PARTS) {
+                auto chunk    = std::span<const Part>(parts).subspan(offset, std::min<size_t>(MAX_MODEL_PARTS, parts.size() - offset));
+                auto model_id = resource_manager->create_model(chunk);
+
+                auto chunk_entity = offset == 0 ? e : create_entity(e, static_cast<RelativeTransform>(Transform::IDENTITY));
+                chunk_entity.set<Renderable>(Renderable{model_id});
+                counts.instances++;
+            }
+
+            return e;
+        }
+
+        if (node.mesh != -1 && !node.instances.empty()) {
+            set_instance_group(e, node);
+        } else if (node.mesh != -1) {
+            set_renderable(e, node);
         }
 
         for (auto child_index : node.children) {
@@ -234,10 +950,48 @@ std::optional<flecs::entity> load_gltf_file(vke::CommandBuffer& cmd, flecs::worl
         return e;
     });
 
-    auto res  = convert_node(0);
+    auto prefab = convert_node(data.root_node);
 
-    stencil.flush_copies(cmd);
+    if (has_static_nodes) {
+        LOG_INFO("%s: flattened static nodes, the prefab went from %u entities & %u instances to %u entities & %u instances", data.file_path.c_str(), //
+                 unflattened_counts.entities, unflattened_counts.instances, counts.entities, counts.instances);
+    }
+
+    return prefab;
+}
+
+std::optional<flecs::entity> load_gltf_file(vke::CommandBuffer& cmd, flecs::world* world, ObjectRenderer* renderer, const std::string& file_path) {
+    auto* resource_manager = renderer->get_resource_manager();
+    auto* thread_pool      = renderer->get_render_server()->get_thread_pool();
+
+    auto import = import_gltf_file(file_path, resource_manager->get_texture_compression_settings(), resource_manager->get_asset_cache_settings(), resource_manager->get_lod_settings(), thread_pool);
+    if (!import.has_value()) return std::nullopt;
+
+    auto data = std::make_shared<GltfImportData>(std::move(import.value()));
+    encode_gltf_meshes(*data, renderer->get_render_server()->get_vertex_format(), thread_pool);
+
+    std::vector<ImageID> images;
+    for (u32 i = 0; i < data->images.size(); i++) {
+        auto& image = data->images[i];
+        if (!image.is_valid()) {
+            images.push_back(resource_manager->get_null_texture_id());
+            continue;
+        }
+
+        if (auto existing = reuse_gltf_image(resource_manager, image)) {
+            images.push_back(existing.value());
+            continue;
+        }
+
+        auto id = resource_manager->create_image(upload_decoded_image(cmd, image));
+        register_gltf_image(resource_manager, id, data, i);
+        images.push_back(id);
+    }
+
+    auto resources = create_gltf_resources(cmd, renderer, data, images);
+
+    log_content_dedup(resource_manager, *data);
 
-    return res;
+    return create_gltf_prefab(world, resource_manager, *data, resources);
 }
-} // namespace vke
\ No newline at end of file
+} // namespace vke
@@ -3,16 +3,115 @@
 
 #include <flecs.h>
 #include <flecs/addons/flecs_cpp.h>
+#include <memory>
+#include <span>
 #include <string>
 
 #include "fwd.hpp"
 #include <optional>
 #include <vke/fwd.hpp>
 
+#include "render/gltf_loader/asset_cache.hpp"
+#include "render/iobject_renderer.hpp"
+#include "render/mesh/mesh.hpp"
+#include "render/texture/texture_compression.hpp"
+#include "render/texture/texture_util.hpp"
+#include "scene/components/transform.hpp"
 
 namespace vke {
 
+// an image decoded into the format it will be uploaded in
+struct DecodedImage {
+    TextureUsage usage;
+    u32 width = 0, height = 0;
+    std::optional<CompressedTexture> compressed;
+    // used instead of compressed when texture compression is disabled
+    SharedBytes rgba;
+    // hash of the pixels & their format, images with the same hash are the same on the gpu. 0 for images that failed to decode
+    u64 content_hash = 0;
 
+    bool is_valid() const { return compressed.has_value() || !rgba.empty(); }
+    // size on the gpu including the mip chain
+    size_t byte_size() const;
+    u32 mip_count() const;
+};
+
+struct ImportedMaterial {
+    int base_color_image = -1; // -1 means the material has no base color texture
+    SamplerDescription base_color_sampler;
+};
+
+struct ImportedPrimitive {
+    MeshBuilder builder;
+    int material = -1; // -1 means the default material
+    std::vector<MeshLod> lods;
+    u64 content_hash = 0; // MeshBuilder::content_hash of builder
+    // lod 0 is the full detail mesh. filled by encode_gltf_meshes and released once the meshes are uploaded
+    std::vector<EncodedMesh> encoded_lods;
+};
+
+struct ImportedMesh {
+    std::string name;
+    std::vector<ImportedPrimitive> primitives;
+};
+
+struct ImportedNode {
+    RelativeTransform transform;
+    int mesh = -1;
+    std::vector<u32> children;
+    // when not empty the mesh is drawn once per instance, relative to the node. it comes from EXT_mesh_gpu_instancing
+    // or from leaf nodes of the same mesh that were merged into the node
+    std::vector<RelativeTransform> instances;
+    // set by a "static": true in the extras of the node. the node and everything under it are flattened into a single model
+    bool is_static = false;
+};
+
+// cpu side result of importing a gltf file. doesn't touch any gpu state so it can be created on any thread.
+// it only holds engine types so that it can also be read back from the asset cache
+struct GltfImportData {
+    std::string file_path;
+    std::vector<DecodedImage> images;
+    std::vector<ImportedMaterial> materials;
+    // indexed the same as the meshes and nodes of the gltf file
+    std::vector<ImportedMesh> meshes;
+    std::vector<ImportedNode> nodes;
+    u32 root_node = 0;
+    // the format encoded_lods of the primitives are in, empty when they aren't encoded
+    std::optional<VertexFormat> encoded_format;
+};
+
+struct GltfResources {
+    // the models of each mesh, a mesh with more than MAX_MODEL_PARTS parts is split into several
+    std::vector<std::vector<RenderModelID>> model_ids;
+    std::vector<MaterialID> material_ids;
+    // materials that sample each image
+    std::vector<std::vector<MaterialID>> image_materials;
+};
+
+// images are decoded and primitives are processed on the thread pool when one is given.
+// the result is read from the asset cache when it has an up to date entry for the file, and written to it otherwise
+std::optional<GltfImportData> import_gltf_file(const std::string& file_path, const TextureCompressionSettings& compression_settings, const AssetCacheSettings& cache_settings, const LodSettings& lod_settings, ThreadPool* thread_pool = nullptr);
+// encodes the meshes of every primitive & lod so that create_gltf_resources only copies them into staging memory.
+// primitives with the content of an earlier one are skipped. call it on a worker, it runs on the thread pool when one is given
+void encode_gltf_meshes(GltfImportData& data, VertexFormat format, ThreadPool* thread_pool = nullptr);
+
+// mips before first_mip are skipped, the image is created at the resolution of first_mip
+std::unique_ptr<vke::Image> upload_decoded_image(vke::CommandBuffer& cmd, const DecodedImage& image, u32 first_mip = 0);
+// images are indexed the same as the images of the gltf file.
+// meshes are registered to the residency manager, their sources keep data alive.
+// the lods of a primitive become parts of the model next to it
+GltfResources create_gltf_resources(vke::CommandBuffer& cmd, ObjectRenderer* renderer, std::shared_ptr<GltfImportData> data, std::span<const ImageID> images);
+// the id of an image with the same content that was uploaded for an earlier file, counted in the dedup stats
+std::optional<ImageID> reuse_gltf_image(ResourceManager* resource_manager, const DecodedImage& image);
+// registers an uploaded image of the file to the residency manager and for content deduplication
+void register_gltf_image(ResourceManager* resource_manager, ImageID id, std::shared_ptr<GltfImportData> data, u32 image_index);
+// logs the content dedup stats of the resource manager after the file was loaded
+void log_content_dedup(ResourceManager* resource_manager, const GltfImportData& data);
+// nodes with instances become a single InstanceGroup entity instead of an entity per instance.
+// the top node of a static tree becomes one entity whose models hold the primitives of the whole tree, with the node transforms baked into the parts
+flecs::entity create_gltf_prefab(flecs::world* world, ResourceManager* resource_manager, const GltfImportData& data, const GltfResources& resources);
+
+// imports and uploads the file synchronously
 std::optional<flecs::entity> load_gltf_file(vke::CommandBuffer& cmd, flecs::world*, ObjectRenderer* renderer, const std::string& file_path);
 
-} // namespace vke
\ No newline at end of file
+} // namespace vke
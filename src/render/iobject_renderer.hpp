@@ -4,7 +4,15 @@
 #include <vke/fwd.hpp>
 #include <vke/util.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <cstdint>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "scene/components/transform.hpp"
+
 namespace vke {
 
 namespace impl {
@@ -38,11 +46,49 @@ class GenericIDManager {
 public:
     using GIDType = T;
 
-    GIDType new_id() { return GIDType(id_manager.new_id()); }
-    void free_id(GIDType id) { id_manager.free_id(id.id); }
+    GenericIDManager(uint32_t first_id = 1) : m_next_id(first_id) {}
 
-public:
-    vke::IDManager<uint32_t> id_manager = vke::IDManager<uint32_t>(1);
+    GIDType new_id() { return new_id_range(1); }
+
+    // reserves count consecutive ids and returns the first one. the lowest run of freed ids that is long enough is reused,
+    // otherwise the range is taken from the end
+    GIDType new_id_range(uint32_t count) {
+        assert(count > 0);
+
+        uint32_t run_start = 0, run_length = 0;
+        for (uint32_t id : m_free_ids) {
+            if (run_length == 0 || id != run_start + run_length) {
+                run_start  = id;
+                run_length = 0;
+            }
+
+            if (++run_length == count) break;
+        }
+
+        // a run that ends at the last id is extended past it
+        bool is_trailing_run = run_length > 0 && run_start + run_length == m_next_id;
+        if (run_length == count || is_trailing_run) {
+            m_free_ids.erase(m_free_ids.find(run_start), m_free_ids.lower_bound(run_start + run_length));
+            m_next_id = std::max(m_next_id, run_start + count);
+            return GIDType(run_start);
+        }
+
+        uint32_t first_id = m_next_id;
+        m_next_id += count;
+        return GIDType(first_id);
+    }
+
+    void free_id(GIDType id) {
+        assert(id.id < m_next_id);
+        m_free_ids.insert(id.id);
+    }
+
+    // one past the highest id that was handed out
+    uint32_t id_count() const { return m_next_id; }
+
+private:
+    uint32_t m_next_id;
+    std::set<uint32_t> m_free_ids;
 };
 
 // Component for rendering
@@ -50,9 +96,21 @@ struct Renderable {
     RenderModelID model_id;
 };
 
+// tag for Renderable entities that move. their instance is uploaded again every frame
+// and views that cache static instances, like the shadow maps, draw them on top of the cache every frame
+struct DynamicRenderable {};
+
+// draws the model once per transform, relative to the entity. the instances are uploaded as one contiguous block
+// and don't have entities of their own. the transforms are shared with the prefab the entity is instantiated from
+struct InstanceGroup {
+    RenderModelID model_id;
+    std::shared_ptr<const std::vector<RelativeTransform>> transforms;
+};
+
 struct CPointLight {
     glm::vec3 color;
     float range;
+    bool casts_shadows = false; // the shadows are drawn into tiles of the shadow atlas, see ShadowAtlas
 };
 
 struct CDirectionalLight {
@@ -1,66 +1,194 @@
 #include "mesh.hpp"
 
 #include <cmath>
+#include <algorithm>
 #include <cstring>
 #include <vke/util.hpp>
 #include <vke/vke.hpp>
 
+#include "util/hash.hpp"
+
 namespace vke {
 
 Mesh::~Mesh() {}
-void MeshBuilder::set_indicies(std::span<uint16_t> span) {
-    m_indicies_in_bytes = vke::span_cast<uint8_t>(span);
-    m_index_type        = VK_INDEX_TYPE_UINT16;
+
+size_t Mesh::byte_size() const {
+    size_t size = index_buffer ? index_buffer->byte_size() : 0;
+    for (auto& buffer : vertex_buffers) size += buffer->byte_size();
+    return size;
+}
+
+void MeshBuilder::set_indicies(std::span<const uint16_t> span) {
+    m_indicies.assign(span.begin(), span.end());
+    m_index_type = VK_INDEX_TYPE_UINT16;
+    m_meshlets.clear();
+}
+
+void MeshBuilder::set_indicies(std::span<const uint32_t> span, VkIndexType index_type) {
+    m_indicies.assign(span.begin(), span.end());
+    m_index_type = index_type;
+    m_meshlets.clear();
+}
+
+size_t MeshBuilder::byte_size(VertexFormat format) const {
+    size_t index_size = m_index_type == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+
+    return m_positions.size() * vertex_format_stride(format) + m_indicies.size() * index_size;
+}
+
+u64 MeshBuilder::content_hash() const {
+    // the element counts are mixed in so that streams of different lengths can't hash the same by shifting bytes between them
+    u64 hash = hash_value(m_index_type);
+    hash     = hash_value(m_positions.size(), hash_bytes(vke::span_cast<const u8>(std::span(m_positions)), hash));
+    hash     = hash_value(m_texture_coords.size(), hash_bytes(vke::span_cast<const u8>(std::span(m_texture_coords)), hash));
+    hash     = hash_value(m_normals.size(), hash_bytes(vke::span_cast<const u8>(std::span(m_normals)), hash));
+    hash     = hash_value(m_indicies.size(), hash_bytes(vke::span_cast<const u8>(std::span(m_indicies)), hash));
+    return hash;
+}
+
+MeshOptimizationStats MeshBuilder::optimize() {
+    u32 vertex_count = m_positions.size();
+
+    MeshOptimizationStats stats{
+        .before         = analyze_vertex_cache(m_indicies, vertex_count),
+        .triangle_count = static_cast<u32>(m_indicies.size() / 3),
+        .vertex_count   = vertex_count,
+        .index_type     = m_index_type,
+    };
+
+    if (m_indicies.empty()) {
+        stats.after = stats.before;
+        return stats;
+    }
+
+    optimize_vertex_cache(m_indicies, vertex_count);
+    optimize_overdraw(m_indicies, m_positions);
+
+    auto remap   = optimize_vertex_fetch_remap(m_indicies, vertex_count);
+    vertex_count = static_cast<u32>(std::count_if(remap.begin(), remap.end(), [](u32 index) { return index != UNUSED_VERTEX; }));
+
+    m_positions      = remap_vertex_stream<glm::vec3>(m_positions, remap, vertex_count);
+    m_texture_coords = remap_vertex_stream<glm::vec2>(m_texture_coords, remap, vertex_count);
+    m_normals        = remap_vertex_stream<glm::vec3>(m_normals, remap, vertex_count);
+
+    // 0xFFFF is left out since it is the primitive restart value
+    m_index_type = vertex_count < 0xFFFF ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+
+    m_meshlets = build_meshlets(m_indicies, m_positions);
+
+    stats.after         = analyze_vertex_cache(m_indicies, vertex_count);
+    stats.vertex_count  = vertex_count;
+    stats.index_type    = m_index_type;
+    stats.meshlet_count = m_meshlets.size();
+
+    return stats;
+}
+
+std::vector<MeshLod> MeshBuilder::generate_lods(const LodSettings& settings) const {
+    std::vector<MeshLod> lods;
+
+    u32 triangle_count = m_indicies.size() / 3;
+    if (!settings.enabled || triangle_count < settings.min_triangle_count * 2) return lods;
+
+    float max_error = settings.max_relative_error * mesh_extent(m_positions);
+
+    u32 previous_triangle_count = triangle_count;
+    float previous_error        = 0.f;
+    for (u32 lod = 1; lod < settings.max_lod_count; lod++) {
+        u32 target_triangle_count = static_cast<u32>(previous_triangle_count * settings.triangle_ratio);
+        if (target_triangle_count < settings.min_triangle_count) break;
+
+        // every lod is simplified from the full detail mesh so that its error is measured against it
+        auto result = simplify_mesh(m_indicies, m_positions, target_triangle_count * 3, max_error);
+
+        // stop once the simplifier gets stuck on locked vertices or the error limit
+        u32 lod_triangle_count = result.indicies.size() / 3;
+        if (lod_triangle_count > previous_triangle_count * 0.85f) break;
+
+        MeshBuilder builder;
+        builder.set_positions(m_positions);
+        builder.set_texture_coords(m_texture_coords);
+        builder.set_normals(m_normals);
+        builder.set_indicies(std::span<const u32>(result.indicies), m_index_type);
+        builder.set_boundary(m_boundary);
+
+        // drops the vertices the simplified mesh no longer uses
+        builder.optimize();
+
+        // a coarser lod can measure a lower error than the previous one, the error ranges of the lods can't overlap though
+        float error = std::max(result.error, previous_error);
+
+        lods.push_back(MeshLod{.builder = std::move(builder), .error = error});
+        previous_triangle_count = lod_triangle_count;
+        previous_error          = error;
+    }
+
+    return lods;
 }
 
-void MeshBuilder::set_indicies(std::span<uint32_t> span) {
-    m_indicies_in_bytes = vke::span_cast<uint8_t>(span);
-    m_index_type        = VK_INDEX_TYPE_UINT32;
+EncodedMesh MeshBuilder::encode(VertexFormat format) const {
+    assert(!std::isnan(m_boundary.start.x) && "set the boundary or calculate the boundary");
+
+    EncodedMesh encoded;
+    encoded.vertices = encode_vertices(format, m_positions, m_texture_coords, m_normals);
+
+    encoded.boundary = m_boundary;
+
+    if (m_indicies.size() > 0) {
+        if (m_index_type == VK_INDEX_TYPE_UINT16) {
+            std::vector<uint16_t> indicies(m_indicies.begin(), m_indicies.end());
+            auto bytes       = vke::span_cast<const u8>(std::span<const uint16_t>(indicies));
+            encoded.indicies = std::vector<u8>(bytes.begin(), bytes.end());
+        } else {
+            auto bytes       = vke::span_cast<const u8>(std::span<const uint32_t>(m_indicies));
+            encoded.indicies = std::vector<u8>(bytes.begin(), bytes.end());
+        }
+
+        encoded.index_count = m_indicies.size();
+        encoded.index_type  = m_index_type;
+        encoded.meshlets    = m_meshlets.empty() ? build_meshlets(m_indicies, m_positions) : m_meshlets;
+    } else {
+        encoded.index_type  = VK_INDEX_TYPE_NONE_KHR;
+        encoded.index_count = m_positions.size();
+    }
+
+    return encoded;
 }
 
-Mesh MeshBuilder::build(vke::CommandBuffer* cmd, StencilBuffer* stencil) const {
-    // size_t total_byte_size = 0;
-    // total_byte_size += m_positions.size_bytes();
-    // total_byte_size += m_texture_coords.size_bytes();
-    // total_byte_size += m_normals.size_bytes();
-    // total_byte_size += m_indicies_in_bytes.size_bytes();
+Mesh MeshBuilder::build(VertexFormat format, vke::CommandBuffer* cmd, StencilBuffer* stencil) const {
+    return encode(format).upload(cmd, stencil);
+}
 
+Mesh EncodedMesh::upload(vke::CommandBuffer* cmd, StencilBuffer* stencil) const {
     Mesh mesh;
 
-    auto create_buffer = [&]<class T>(VkBufferUsageFlags usage, std::span<T> data) {
+    auto create_buffer = [&](VkBufferUsageFlags usage, std::span<const u8> data) {
         bool create_on_device = (cmd != nullptr) && (stencil != nullptr);
 
         std::unique_ptr<vke::Buffer> buffer = std::make_unique<vke::Buffer>(usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, data.size_bytes(), !create_on_device);
 
         if (create_on_device) {
-            stencil->copy_data(buffer->subspan(0), vke::span_cast<u8>(data));
+            stencil->copy_data(buffer->subspan(0), data);
         } else {
             memcpy(buffer->mapped_data_bytes().data(), data.data(), data.size_bytes());
         }
         return buffer;
     };
 
-    auto add_buffer = [&]<class T>(VkBufferUsageFlags usage, std::span<T> data) {
-        mesh.vertex_buffers.push_back(create_buffer(usage, data));
-    };
-
-    add_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_positions);
-    add_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_texture_coords);
-    add_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_normals);
+    for (auto& stream : vertices.streams) {
+        mesh.vertex_buffers.push_back(create_buffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, std::span<const u8>(stream)));
+    }
 
-    if (m_indicies_in_bytes.size() > 0) {
-        mesh.index_buffer = create_buffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_indicies_in_bytes);
-        mesh.index_count  = m_indicies_in_bytes.size_bytes() / (m_index_type == VK_INDEX_TYPE_UINT16 ? 2 : 4);
-        mesh.index_type   = m_index_type;
+    mesh.encoding = vertices.encoding;
 
-    } else {
-        mesh.index_type  = VK_INDEX_TYPE_NONE_KHR;
-        mesh.index_count = m_positions.size();
+    if (!indicies.empty()) {
+        mesh.index_buffer = create_buffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, std::span<const u8>(indicies));
+        mesh.meshlets     = meshlets;
     }
 
-    assert(!std::isnan(m_boundary.start.x) && "set the boundary or calculate the boundary");
-
-    mesh.boundary = m_boundary;
+    mesh.index_type  = index_type;
+    mesh.index_count = index_count;
+    mesh.boundary    = boundary;
 
     mesh.update_vba();
     return mesh;
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cmath>
 #include <memory>
 
 #include <span>
+#include <vector>
 #include <vulkan/vulkan_core.h>
 
 #include <glm/common.hpp>
+#include <glm/mat4x4.hpp>
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <vke/fwd.hpp>
@@ -13,6 +16,11 @@
 #include <vke/util.hpp>
 #include <vke/vke.hpp>
 
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "vertex_format.hpp"
+
 namespace vke {
 
 struct AABB {
@@ -28,6 +36,18 @@ struct AABB {
     glm::vec3 size() const { return end - start; }
     glm::vec3 half_size() const { return size() / 2.f; }
     glm::vec3 mip_point() const { return start + half_size(); }
+
+    // the box around the 8 transformed corners
+    AABB transformed(const glm::mat4& matrix) const {
+        AABB result{.start = glm::vec3(INFINITY), .end = glm::vec3(-INFINITY)};
+        for (int i = 0; i < 8; i++) {
+            glm::vec3 corner(i & 1 ? end.x : start.x, i & 2 ? end.y : start.y, i & 4 ? end.z : start.z);
+            glm::vec3 p  = glm::vec3(matrix * glm::vec4(corner, 1.f));
+            result.start = glm::min(result.start, p);
+            result.end   = glm::max(result.end, p);
+        }
+        return result;
+    }
 };
 
 // this is for caching vkBuffers and their offsets that normally comes from IBufferSpan's virtual getters called at CommandBuffer::bind_vertex_buffers when an array it is passed.
@@ -79,10 +99,15 @@ struct Mesh {
     VkIndexType index_type = VK_INDEX_TYPE_NONE_KHR;
     uint32_t index_count; // if index_type is VK_INDEX_TYPE_NONE than it means vertex_count
     AABB boundary;
+    VertexEncoding encoding;
+    // cpu copy that the scene buffers upload for cluster culling, empty for non indexed meshes
+    std::vector<Meshlet> meshlets;
 
     VertexBufferArrayCache vba_cache;
 
     void update_vba() { vba_cache.reset(vertex_buffers); }
+    // device memory used by the index and vertex buffers
+    size_t byte_size() const;
 
 public:
     Mesh()                                 = default;
@@ -91,27 +116,100 @@ public:
     ~Mesh();
 };
 
+struct MeshOptimizationStats {
+    VertexCacheStats before, after;
+    u32 triangle_count;
+    u32 vertex_count; // after unused vertices are dropped
+    VkIndexType index_type;
+    u32 meshlet_count = 0;
+};
+
+struct LodSettings {
+    bool enabled           = true;
+    u32 max_lod_count      = 4;    // including the full detail mesh
+    float triangle_ratio   = 0.5f; // triangle count of every lod relative to the previous one
+    u32 min_triangle_count = 256;  // meshes below it don't get lods and no lod goes below it
+    // lods that would deviate more than this from the full detail mesh aren't made, relative to the mesh extent
+    float max_relative_error = 0.1f;
+};
+
+struct MeshLod;
+
+// cpu side of a mesh with its vertices encoded and its indicies in their final type.
+// preparing it is the costly part of building a mesh, so it can be done on a worker and uploaded later
+struct EncodedMesh {
+    EncodedVertices vertices;
+    std::vector<u8> indicies; // empty for non indexed meshes
+    VkIndexType index_type = VK_INDEX_TYPE_NONE_KHR;
+    u32 index_count        = 0; // vertex count for non indexed meshes
+    AABB boundary;
+    std::vector<Meshlet> meshlets;
+
+    // only copies the prepared bytes, see MeshBuilder::build for the upload paths
+    Mesh upload(vke::CommandBuffer* cmd = nullptr, StencilBuffer* stencil = nullptr) const;
+};
+
+// owns a copy of the vertex streams so that it can be filled on one thread and built on another
 class MeshBuilder {
 public:
-    void set_positions(std::span<glm::vec3> span) { m_positions = span; }
-    void set_texture_coords(std::span<glm::vec2> span) { m_texture_coords = span; }
-    void set_normals(std::span<glm::vec3> span) { m_normals = span; }
+    void set_positions(std::span<const glm::vec3> span) { m_positions.assign(span.begin(), span.end()); }
+    void set_texture_coords(std::span<const glm::vec2> span) { m_texture_coords.assign(span.begin(), span.end()); }
+    void set_normals(std::span<const glm::vec3> span) { m_normals.assign(span.begin(), span.end()); }
     void set_boundary(const AABB& boundary) { m_boundary = boundary; }
-
-    void set_indicies(std::span<uint16_t> span);
-    void set_indicies(std::span<uint32_t> span);
-
-    Mesh build(vke::CommandBuffer* = nullptr, StencilBuffer* stencil = nullptr) const;
+    // has to be set after the indicies since setting them clears the meshlets
+    void set_meshlets(std::span<const Meshlet> span) { m_meshlets.assign(span.begin(), span.end()); }
+
+    void set_indicies(std::span<const uint16_t> span);
+    // index_type is the type of the built index buffer, the indicies have to fit into it
+    void set_indicies(std::span<const uint32_t> span, VkIndexType index_type = VK_INDEX_TYPE_UINT32);
+
+    std::span<const glm::vec3> get_positions() const { return m_positions; }
+    std::span<const glm::vec2> get_texture_coords() const { return m_texture_coords; }
+    std::span<const glm::vec3> get_normals() const { return m_normals; }
+    std::span<const uint32_t> get_indicies() const { return m_indicies; }
+    VkIndexType get_index_type() const { return m_index_type; }
+    const AABB& get_boundary() const { return m_boundary; }
+    std::span<const Meshlet> get_meshlets() const { return m_meshlets; }
+
+    // device memory the built mesh will use
+    size_t byte_size(VertexFormat format) const;
+    // hash of the vertex & index streams, builders with the same hash build the same mesh
+    u64 content_hash() const;
+
+    // reorders triangles for vertex cache reuse and overdraw, reorders vertices for fetch locality
+    // and switches to 16 bit indicies when the vertex count allows. only applies to indexed meshes.
+    // the meshlets are built from the optimized order
+    MeshOptimizationStats optimize();
+
+    // simplified versions of the mesh with decreasing triangle counts and non decreasing errors, the full detail mesh isn't included.
+    // every lod keeps the boundary of this mesh so that they are culled the same
+    std::vector<MeshLod> generate_lods(const LodSettings& settings) const;
+
+    // everything build does on the cpu, meshlets are built here for indexed meshes that weren't optimized
+    EncodedMesh encode(VertexFormat format) const;
+
+    // the vertex format has to match the "vke::default_mesh" vertex input, see RenderServer::set_vertex_format.
+    // cmd is only used to select the upload path, nothing is recorded into it.
+    // the copies are recorded when the stencil buffer is flushed
+    Mesh build(VertexFormat format, vke::CommandBuffer* = nullptr, StencilBuffer* stencil = nullptr) const;
 
     void calculate_boundary();
 
 private:
-    std::span<glm::vec3> m_positions       = {};
-    std::span<glm::vec3> m_normals         = {};
-    std::span<glm::vec2> m_texture_coords  = {};
-    std::span<uint8_t> m_indicies_in_bytes = {};
-    VkIndexType m_index_type;
-    AABB m_boundary = AABB{.start = glm::vec3(NAN), .end = glm::vec3(NAN)};
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::vec3> m_normals;
+    std::vector<glm::vec2> m_texture_coords;
+    // widened to 32 bits regardless of the index type
+    std::vector<uint32_t> m_indicies;
+    VkIndexType m_index_type = VK_INDEX_TYPE_NONE_KHR;
+    AABB m_boundary          = AABB{.start = glm::vec3(NAN), .end = glm::vec3(NAN)};
+    std::vector<Meshlet> m_meshlets;
+};
+
+struct MeshLod {
+    MeshBuilder builder;
+    float error;          // geometric error relative to the full detail mesh in model units, see SimplifyResult::error
+    u64 content_hash = 0; // MeshBuilder::content_hash of builder, filled in by the importer
 };
 
 } // namespace vke
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include <glm/geometric.hpp>
+
+namespace vke {
+
+namespace {
+
+// scoring constants from Tom Forsyth's paper
+constexpr u32 SCORE_CACHE_SIZE      = 32;
+constexpr float CACHE_DECAY_POWER   = 1.5f;
+constexpr float LAST_TRI_SCORE      = 0.75f;
+constexpr float VALENCE_BOOST_SCALE = 2.0f;
+constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+float vertex_score(int cache_position, u32 remaining_triangles) {
+    // vertices without triangles left are never picked again
+    if (remaining_triangles == 0) return -1.f;
+
+    float score = 0.f;
+    if (cache_position >= 0) {
+        if (cache_position < 3) {
+            // the vertices of the last triangle get a fixed score so that strips aren't favoured too much
+            score = LAST_TRI_SCORE;
+        } else {
+            float scale = 1.f / (SCORE_CACHE_SIZE - 3);
+            score       = std::pow(1.f - (cache_position - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+
+    // boosts vertices with few triangles left so that they are finished off instead of leaving lone triangles behind
+    score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining_triangles), -VALENCE_BOOST_POWER);
+
+    return score;
+}
+
+// triangles of each vertex, stored in one array
+struct TriangleAdjacency {
+    std::vector<u32> offsets; // vertex_count + 1 entries
+    std::vector<u32> counts;  // triangles that haven't been removed yet
+    std::vector<u32> triangles;
+
+    TriangleAdjacency(std::span<const u32> indicies, u32 vertex_count) {
+        counts.assign(vertex_count, 0);
+        for (u32 index : indicies) counts[index]++;
+
+        offsets.resize(vertex_count + 1);
+        offsets[0] = 0;
+        for (u32 i = 0; i < vertex_count; i++) offsets[i + 1] = offsets[i] + counts[i];
+
+        triangles.resize(indicies.size());
+        std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+        for (u32 i = 0; i < indicies.size(); i++) {
+            triangles[fill[indicies[i]]++] = i / 3;
+        }
+    }
+
+    std::span<u32> of(u32 vertex) { return std::span(triangles).subspan(offsets[vertex], counts[vertex]); }
+
+    void remove(u32 vertex, u32 triangle) {
+        auto list = of(vertex);
+        auto it   = std::find(list.begin(), list.end(), triangle);
+        assert(it != list.end());
+
+        std::swap(*it, list.back());
+        counts[vertex]--;
+    }
+};
+
+// fifo cache simulated with timestamps, a vertex is in the cache if it was loaded within the last cache_size misses
+struct FifoCache {
+    std::vector<u32> timestamps;
+    u32 time       = 0;
+    u32 cache_size = 16;
+
+    FifoCache(u32 vertex_count, u32 cache_size) : timestamps(vertex_count, 0), time(cache_size + 1), cache_size(cache_size) {}
+
+    // returns true on a miss
+    bool access(u32 vertex) {
+        if (time - timestamps[vertex] <= cache_size) return false;
+
+        timestamps[vertex] = time++;
+        return true;
+    }
+
+    void reset() { time += cache_size + 1; }
+};
+
+} // namespace
+
+VertexCacheStats analyze_vertex_cache(std::span<const u32> indicies, u32 vertex_count, u32 cache_size) {
+    if (indicies.empty()) return VertexCacheStats{.acmr = 0.f, .atvr = 0.f};
+
+    FifoCache cache(vertex_count, cache_size);
+    std::vector<bool> is_referenced(vertex_count, false);
+
+    u32 misses = 0, unique_vertices = 0;
+    for (u32 index : indicies) {
+        if (cache.access(index)) misses++;
+
+        if (!is_referenced[index]) {
+            is_referenced[index] = true;
+            unique_vertices++;
+        }
+    }
+
+    return VertexCacheStats{
+        .acmr = static_cast<float>(misses) / (indicies.size() / 3),
+        .atvr = static_cast<float>(misses) / unique_vertices,
+    };
+}
+
+void optimize_vertex_cache(std::span<u32> indicies, u32 vertex_count) {
+    u32 triangle_count = indicies.size() / 3;
+    if (triangle_count == 0) return;
+
+    TriangleAdjacency adjacency(indicies, vertex_count);
+
+    std::vector<int> cache_positions(vertex_count, -1);
+    std::vector<float> vertex_scores(vertex_count);
+    for (u32 i = 0; i < vertex_count; i++) {
+        vertex_scores[i] = vertex_score(-1, adjacency.counts[i]);
+    }
+
+    std::vector<float> triangle_scores(triangle_count);
+    std::vector<bool> is_emitted(triangle_count, false);
+    for (u32 t = 0; t < triangle_count; t++) {
+        triangle_scores[t] = vertex_scores[indicies[t * 3]] + vertex_scores[indicies[t * 3 + 1]] + vertex_scores[indicies[t * 3 + 2]];
+    }
+
+    std::vector<u32> result;
+    result.reserve(indicies.size());
+
+    std::vector<u32> cache, new_cache;
+    cache.reserve(SCORE_CACHE_SIZE + 3);
+    new_cache.reserve(SCORE_CACHE_SIZE + 3);
+
+    int best_triangle = static_cast<int>(std::max_element(triangle_scores.begin(), triangle_scores.end()) - triangle_scores.begin());
+    u32 scan_cursor   = 0;
+
+    for (u32 emitted = 0; emitted < triangle_count; emitted++) {
+        if (best_triangle == -1) {
+            // nothing in the cache has triangles left, continue with the next triangle in the original order
+            while (is_emitted[scan_cursor]) scan_cursor++;
+            best_triangle = scan_cursor;
+        }
+
+        u32 triangle         = best_triangle;
+        is_emitted[triangle] = true;
+
+        const u32 triangle_vertices[3] = {indicies[triangle * 3], indicies[triangle * 3 + 1], indicies[triangle * 3 + 2]};
+
+        new_cache.clear();
+        for (u32 v : triangle_vertices) {
+            result.push_back(v);
+            adjacency.remove(v, triangle);
+            new_cache.push_back(v);
+        }
+
+        for (u32 v : cache) {
+            if (v != triangle_vertices[0] && v != triangle_vertices[1] && v != triangle_vertices[2]) new_cache.push_back(v);
+        }
+
+        // vertices pushed out of the cache lose their cache score
+        for (u32 i = SCORE_CACHE_SIZE; i < new_cache.size(); i++) {
+            cache_positions[new_cache[i]] = -1;
+        }
+
+        for (u32 i = 0; i < new_cache.size(); i++) {
+            u32 v = new_cache[i];
+            if (i < SCORE_CACHE_SIZE) cache_positions[v] = static_cast<int>(i);
+
+            float score      = vertex_score(cache_positions[v], adjacency.counts[v]);
+            float delta      = score - vertex_scores[v];
+            vertex_scores[v] = score;
+
+            for (u32 t : adjacency.of(v)) triangle_scores[t] += delta;
+        }
+
+        if (new_cache.size() > SCORE_CACHE_SIZE) new_cache.resize(SCORE_CACHE_SIZE);
+        std::swap(cache, new_cache);
+
+        // only triangles touching the cache are candidates, this keeps every step O(cache size)
+        best_triangle    = -1;
+        float best_score = -1.f;
+        for (u32 v : cache) {
+            for (u32 t : adjacency.of(v)) {
+                if (triangle_scores[t] > best_score) {
+                    best_score    = triangle_scores[t];
+                    best_triangle = static_cast<int>(t);
+                }
+            }
+        }
+    }
+
+    std::copy(result.begin(), result.end(), indicies.begin());
+}
+
+void optimize_overdraw(std::span<u32> indicies, std::span<const glm::vec3> positions, float threshold, u32 cache_size) {
+    u32 triangle_count = indicies.size() / 3;
+    u32 vertex_count   = positions.size();
+    if (triangle_count == 0) return;
+
+    // hard boundaries are where the cache optimized order restarts, every vertex of the triangle is a miss
+    std::vector<u32> hard_clusters;
+    {
+        FifoCache cache(vertex_count, cache_size);
+        for (u32 t = 0; t < triangle_count; t++) {
+            u32 misses = cache.access(indicies[t * 3]) + cache.access(indicies[t * 3 + 1]) + cache.access(indicies[t * 3 + 2]);
+            if (t == 0 || misses == 3) hard_clusters.push_back(t);
+        }
+    }
+    hard_clusters.push_back(triangle_count);
+
+    // hard clusters can be as large as the whole mesh, they are split further where restarting the cache is cheap enough
+    std::vector<u32> clusters;
+    for (u32 c = 0; c + 1 < hard_clusters.size(); c++) {
+        u32 start = hard_clusters[c], end = hard_clusters[c + 1];
+
+        FifoCache cache(vertex_count, cache_size);
+        u32 cluster_misses = 0;
+        for (u32 i = start * 3; i < end * 3; i++) cluster_misses += cache.access(indicies[i]);
+
+        float cluster_threshold = threshold * static_cast<float>(cluster_misses) / (end - start);
+
+        cache.reset();
+        u32 sub_start = start, sub_misses = 0;
+        clusters.push_back(start);
+
+        for (u32 t = start; t < end; t++) {
+            sub_misses += cache.access(indicies[t * 3]) + cache.access(indicies[t * 3 + 1]) + cache.access(indicies[t * 3 + 2]);
+
+            u32 sub_triangles = t + 1 - sub_start;
+            if (t + 1 < end && static_cast<float>(sub_misses) / sub_triangles <= cluster_threshold) {
+                clusters.push_back(t + 1);
+                sub_start  = t + 1;
+                sub_misses = 0;
+                cache.reset();
+            }
+        }
+    }
+    clusters.push_back(triangle_count);
+
+    glm::vec3 mesh_centroid = std::accumulate(positions.begin(), positions.end(), glm::vec3(0.f)) / static_cast<float>(std::max(vertex_count, 1u));
+
+    struct ClusterKey {
+        float sort_key;
+        u32 start, end;
+    };
+
+    std::vector<ClusterKey> keys;
+    keys.reserve(clusters.size() - 1);
+
+    for (u32 c = 0; c + 1 < clusters.size(); c++) {
+        u32 start = clusters[c], end = clusters[c + 1];
+
+        // area weighted centroid & normal of the cluster
+        glm::vec3 centroid(0.f), normal(0.f);
+        float area = 0.f;
+        for (u32 t = start; t < end; t++) {
+            glm::vec3 p0 = positions[indicies[t * 3]], p1 = positions[indicies[t * 3 + 1]], p2 = positions[indicies[t * 3 + 2]];
+            glm::vec3 n  = glm::cross(p1 - p0, p2 - p0);
+            float a      = glm::length(n);
+
+            centroid += (p0 + p1 + p2) * (a / 3.f);
+            normal += n;
+            area += a;
+        }
+
+        centroid            = area > 0.f ? centroid / area : positions[indicies[start * 3]];
+        float normal_length = glm::length(normal);
+
+        // clusters facing away from the center of the mesh are likely to occlude the others
+        float sort_key = normal_length > 0.f ? glm::dot(centroid - mesh_centroid, normal / normal_length) : 0.f;
+        keys.push_back({sort_key, start, end});
+    }
+
+    std::stable_sort(keys.begin(), keys.end(), [](const ClusterKey& a, const ClusterKey& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<u32> result;
+    result.reserve(indicies.size());
+    for (auto& key : keys) {
+        result.insert(result.end(), indicies.begin() + key.start * 3, indicies.begin() + key.end * 3);
+    }
+
+    std::copy(result.begin(), result.end(), indicies.begin());
+}
+
+std::vector<u32> optimize_vertex_fetch_remap(std::span<u32> indicies, u32 vertex_count) {
+    std::vector<u32> remap(vertex_count, UNUSED_VERTEX);
+
+    u32 next_vertex = 0;
+    for (u32& index : indicies) {
+        if (remap[index] == UNUSED_VERTEX) remap[index] = next_vertex++;
+        index = remap[index];
+    }
+
+    return remap;
+}
+
+} // namespace vke
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "common.hpp"
+
+namespace vke {
+
+// statistics of a simulated fifo post transform cache
+struct VertexCacheStats {
+    float acmr; // average cache miss ratio, vertex shader invocations per triangle. 0.5 is the ideal for large regular grids
+    float atvr; // average transformed vertex ratio, vertex shader invocations per referenced vertex. 1.0 is ideal
+};
+
+VertexCacheStats analyze_vertex_cache(std::span<const u32> indicies, u32 vertex_count, u32 cache_size = 16);
+
+// reorders triangles for post transform cache reuse, based on Tom Forsyth's linear speed vertex cache optimisation
+void optimize_vertex_cache(std::span<u32> indicies, u32 vertex_count);
+
+// reorders clusters of triangles so that the ones facing outwards are drawn first, should be run after optimize_vertex_cache.
+// clusters are split where it doesn't raise the acmr above threshold times the acmr of the cache optimized order
+void optimize_overdraw(std::span<u32> indicies, std::span<const glm::vec3> positions, float threshold = 1.05f, u32 cache_size = 16);
+
+// renumbers vertices in the order they are first referenced and rewrites the indicies.
+// returns the new index of each old vertex, unreferenced vertices are mapped to UNUSED_VERTEX
+constexpr u32 UNUSED_VERTEX = ~0u;
+std::vector<u32> optimize_vertex_fetch_remap(std::span<u32> indicies, u32 vertex_count);
+
+// moves the vertices of a stream to their remapped locations and drops unused ones
+template <class T>
+std::vector<T> remap_vertex_stream(std::span<const T> stream, std::span<const u32> remap, u32 new_vertex_count) {
+    std::vector<T> result(new_vertex_count);
+    for (size_t i = 0; i < stream.size(); i++) {
+        if (remap[i] != UNUSED_VERTEX) result[remap[i]] = stream[i];
+    }
+    return result;
+}
+
+} // namespace vke
@@ -0,0 +1,252 @@
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace vke {
+
+namespace {
+
+// sum of the squared distances to a set of planes, weighted by the area of the triangles they come from.
+// kept in doubles since the plane equations lose a lot of precision when they are summed up
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c      = 0;
+    double weight = 0;
+
+    // the plane dot(normal, p) + d = 0
+    static Quadric from_plane(glm::vec3 normal, float d, float weight) {
+        double x = normal.x, y = normal.y, z = normal.z;
+
+        return Quadric{
+            .a00    = x * x * weight,
+            .a01    = x * y * weight,
+            .a02    = x * z * weight,
+            .a11    = y * y * weight,
+            .a12    = y * z * weight,
+            .a22    = z * z * weight,
+            .b0     = x * d * weight,
+            .b1     = y * d * weight,
+            .b2     = z * d * weight,
+            .c      = static_cast<double>(d) * d * weight,
+            .weight = weight,
+        };
+    }
+
+    void add(const Quadric& o) {
+        a00 += o.a00, a01 += o.a01, a02 += o.a02, a11 += o.a11, a12 += o.a12, a22 += o.a22;
+        b0 += o.b0, b1 += o.b1, b2 += o.b2;
+        c += o.c;
+        weight += o.weight;
+    }
+
+    // mean squared distance of p to the planes
+    double error(glm::vec3 p) const {
+        if (weight <= 0) return 0;
+
+        double x = p.x, y = p.y, z = p.z;
+        double r = x * (a00 * x + a01 * y + a02 * z) + y * (a01 * x + a11 * y + a12 * z) + z * (a02 * x + a12 * y + a22 * z) //
+                   + 2 * (b0 * x + b1 * y + b2 * z) + c;
+
+        return std::max(r, 0.0) / weight;
+    }
+};
+
+struct Collapse {
+    double cost;
+    u32 from, to;
+};
+
+// vertices on an edge that isn't shared by exactly two triangles. attribute seams show up as borders too since
+// the triangles on the two sides of a seam refer to different vertices
+std::vector<bool> find_locked_vertices(std::span<const u32> indicies, u32 vertex_count) {
+    std::unordered_map<u64, u32> edge_counts;
+    edge_counts.reserve(indicies.size());
+
+    for (u32 i = 0; i < indicies.size(); i += 3) {
+        for (u32 e = 0; e < 3; e++) {
+            u32 a = indicies[i + e], b = indicies[i + (e + 1) % 3];
+            edge_counts[static_cast<u64>(std::min(a, b)) << 32 | std::max(a, b)]++;
+        }
+    }
+
+    std::vector<bool> is_locked(vertex_count, false);
+    for (auto& [key, count] : edge_counts) {
+        if (count == 2) continue;
+
+        is_locked[key >> 32]        = true;
+        is_locked[key & 0xFFFFFFFF] = true;
+    }
+
+    return is_locked;
+}
+
+} // namespace
+
+float mesh_extent(std::span<const glm::vec3> positions) {
+    if (positions.empty()) return 0.f;
+
+    glm::vec3 min = positions[0], max = positions[0];
+    for (auto& p : positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    return glm::length(max - min) * 0.5f;
+}
+
+SimplifyResult simplify_mesh(std::span<const u32> indicies, std::span<const glm::vec3> positions, u32 target_index_count, float max_error) {
+    SimplifyResult result;
+    result.indicies.assign(indicies.begin(), indicies.end());
+
+    u32 vertex_count = positions.size();
+    if (indicies.size() <= target_index_count || vertex_count == 0) return result;
+
+    auto& triangles = result.indicies;
+
+    // positions are centered so that the quadrics of meshes far away from the origin don't lose precision
+    glm::vec3 min = positions[0], max = positions[0];
+    for (auto& p : positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    glm::vec3 center = (min + max) * 0.5f;
+    std::vector<glm::vec3> points(vertex_count);
+    for (u32 i = 0; i < vertex_count; i++) points[i] = positions[i] - center;
+
+    auto is_locked = find_locked_vertices(triangles, vertex_count);
+
+    std::vector<Quadric> quadrics(vertex_count);
+    for (u32 i = 0; i < triangles.size(); i += 3) {
+        glm::vec3 p0 = points[triangles[i]], p1 = points[triangles[i + 1]], p2 = points[triangles[i + 2]];
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length     = glm::length(normal);
+        if (length == 0.f) continue;
+
+        normal /= length;
+        auto quadric = Quadric::from_plane(normal, -glm::dot(normal, p0), length * 0.5f);
+        for (u32 j = 0; j < 3; j++) quadrics[triangles[i + j]].add(quadric);
+    }
+
+    double max_cost = static_cast<double>(max_error) * max_error;
+
+    std::vector<u32> remap(vertex_count);
+    std::iota(remap.begin(), remap.end(), 0);
+
+    std::vector<bool> is_touched(vertex_count);
+    std::vector<u32> adjacency_offsets(vertex_count + 1), adjacency;
+    std::vector<Collapse> collapses;
+
+    u32 target_triangle_count = target_index_count / 3;
+
+    while (triangles.size() / 3 > target_triangle_count) {
+        u32 triangle_count = triangles.size() / 3;
+
+        // triangles of each vertex
+        std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+        for (u32 index : triangles) adjacency_offsets[index + 1]++;
+        for (u32 i = 0; i < vertex_count; i++) adjacency_offsets[i + 1] += adjacency_offsets[i];
+
+        adjacency.resize(triangles.size());
+        std::vector<u32> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (u32 i = 0; i < triangles.size(); i++) adjacency[fill[triangles[i]]++] = i / 3;
+
+        // interior edges are in two triangles with opposite directions, only the one going up is taken
+        collapses.clear();
+        for (u32 i = 0; i < triangles.size(); i += 3) {
+            for (u32 e = 0; e < 3; e++) {
+                u32 a = triangles[i + e], b = triangles[i + (e + 1) % 3];
+                if (a > b || (is_locked[a] && is_locked[b])) continue;
+
+                double cost_ab = is_locked[a] ? INFINITY : quadrics[a].error(points[b]);
+                double cost_ba = is_locked[b] ? INFINITY : quadrics[b].error(points[a]);
+
+                if (cost_ab <= cost_ba) {
+                    collapses.push_back({cost_ab, a, b});
+                } else {
+                    collapses.push_back({cost_ba, b, a});
+                }
+            }
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        std::fill(is_touched.begin(), is_touched.end(), false);
+
+        u32 removable_triangles = triangle_count - target_triangle_count;
+        u32 removed_triangles   = 0;
+
+        for (auto& collapse : collapses) {
+            if (collapse.cost > max_cost || removed_triangles >= removable_triangles) break;
+
+            // every vertex is moved at most once per pass, so remap is never more than one level deep
+            if (is_touched[collapse.from] || is_touched[collapse.to]) continue;
+
+            bool is_flipping = false;
+            u32 degenerates  = 0;
+
+            for (u32 a = adjacency_offsets[collapse.from]; a < adjacency_offsets[collapse.from + 1]; a++) {
+                u32 t              = adjacency[a];
+                u32 v[3]           = {remap[triangles[t * 3]], remap[triangles[t * 3 + 1]], remap[triangles[t * 3 + 2]]};
+                bool is_degenerate = v[0] == v[1] || v[1] == v[2] || v[0] == v[2];
+                if (is_degenerate) continue;
+
+                if (v[0] == collapse.to || v[1] == collapse.to || v[2] == collapse.to) {
+                    degenerates++;
+                    continue;
+                }
+
+                glm::vec3 before[3], after[3];
+                for (u32 j = 0; j < 3; j++) {
+                    before[j] = points[v[j]];
+                    after[j]  = v[j] == collapse.from ? points[collapse.to] : points[v[j]];
+                }
+
+                glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normal_after  = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+                // rejects triangles that would flip or turn by more than ~75 degrees, small turns add up over the passes otherwise
+                if (glm::dot(normal_before, normal_after) < 0.25f * glm::length(normal_before) * glm::length(normal_after)) {
+                    is_flipping = true;
+                    break;
+                }
+            }
+
+            if (is_flipping) continue;
+
+            remap[collapse.from]      = collapse.to;
+            is_touched[collapse.from] = true;
+            is_touched[collapse.to]   = true;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+
+            result.error = std::max(result.error, static_cast<float>(std::sqrt(collapse.cost)));
+            removed_triangles += degenerates;
+        }
+
+        if (removed_triangles == 0) break;
+
+        // collapsed edges leave degenerate triangles behind
+        u32 write = 0;
+        for (u32 i = 0; i < triangles.size(); i += 3) {
+            u32 a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+            if (a == b || b == c || a == c) continue;
+
+            triangles[write++] = a;
+            triangles[write++] = b;
+            triangles[write++] = c;
+        }
+        triangles.resize(write);
+    }
+
+    return result;
+}
+
+} // namespace vke
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "common.hpp"
+
+namespace vke {
+
+struct SimplifyResult {
+    std::vector<u32> indicies;
+    // largest error of the collapses that were made, in the units of the positions.
+    // it is the area weighted rms distance of a moved vertex to the planes of the triangles it was collapsed from
+    float error = 0.f;
+};
+
+// quadric error edge collapse simplification (Garland & Heckbert).
+// edges are collapsed cheapest first until the index count reaches target_index_count or the next collapse would exceed max_error.
+// vertices are only ever moved onto their neighbours so the result indexes the same vertex streams.
+// vertices on borders, attribute seams and non manifold edges stay in place, which also keeps the parts of a model watertight
+SimplifyResult simplify_mesh(std::span<const u32> indicies, std::span<const glm::vec3> positions, u32 target_index_count, float max_error = std::numeric_limits<float>::max());
+
+// radius of the bounding sphere around the aabb center, errors are usually compared relative to it
+float mesh_extent(std::span<const glm::vec3> positions);
+
+} // namespace vke
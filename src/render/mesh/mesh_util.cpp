@@ -4,18 +4,42 @@
 
 namespace vke{
 
-std::unique_ptr<vke::VertexInputDescriptionBuilder> make_default_vertex_layout() {
+std::unique_ptr<vke::VertexInputDescriptionBuilder> make_default_vertex_layout(VertexFormat format) {
     auto builder = std::make_unique<vke::VertexInputDescriptionBuilder>();
 
-    builder->push_binding<glm::vec3>();
-    builder->push_attribute<float>(3);
+    // every attribute is read as unsigned integers and decoded in vs_input/default.glsl,
+    // that way the locations & types the shader declares don't change between formats
+    switch (format) {
+    case VertexFormat::SEPARATE_FLOAT:
+        builder->push_binding<glm::vec3>();
+        builder->push_attribute<u32>(3);
 
-    builder->push_binding<glm::vec2>();
-    builder->push_attribute<float>(2);
+        builder->push_binding<glm::vec2>();
+        builder->push_attribute<u32>(2);
 
-    builder->push_binding<glm::vec3>();
-    builder->push_attribute<float>(3);
+        builder->push_binding<glm::vec3>();
+        builder->push_attribute<u32>(3);
+        break;
+    case VertexFormat::INTERLEAVED_FLOAT:
+        builder->push_binding<InterleavedFloatVertex>();
+        builder->push_attribute<u32>(3);
+        builder->push_attribute<u32>(2);
+        builder->push_attribute<u32>(3);
+        break;
+    case VertexFormat::INTERLEAVED_COMPACT:
+        builder->push_binding<CompactVertex>();
+        builder->push_attribute<u32>(3);
+        builder->push_attribute<u16>(2);
+        builder->push_attribute<u16>(2);
+        break;
+    case VertexFormat::INTERLEAVED_QUANTIZED:
+        builder->push_binding<QuantizedVertex>();
+        builder->push_attribute<u16>(4);
+        builder->push_attribute<u16>(2);
+        builder->push_attribute<u16>(2);
+        break;
+    }
 
     return builder;
 }
-} // namespace vke
\ No newline at end of file
+} // namespace vke
@@ -8,5 +8,5 @@ namespace vke{
 
 class VertexInputDescriptionBuilder;
 
-std::unique_ptr<vke::VertexInputDescriptionBuilder> make_default_vertex_layout();
-}
\ No newline at end of file
+std::unique_ptr<vke::VertexInputDescriptionBuilder> make_default_vertex_layout(VertexFormat format = VertexFormat::SEPARATE_FLOAT);
+}
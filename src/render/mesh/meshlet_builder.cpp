@@ -0,0 +1,135 @@
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+namespace vke {
+
+namespace {
+
+// keeps float error in the normals from making the cone test cull triangles that are exactly side on
+constexpr float CONE_CUTOFF_EPSILON = 1e-3f;
+
+glm::vec3 triangle_normal(std::span<const u32> indicies, std::span<const glm::vec3> positions, u32 triangle, float& length) {
+    glm::vec3 p0 = positions[indicies[triangle * 3]], p1 = positions[indicies[triangle * 3 + 1]], p2 = positions[indicies[triangle * 3 + 2]];
+
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    length           = glm::length(normal);
+    return length > 0.f ? normal / length : normal;
+}
+
+// ritter's bounding sphere, starts from the two points that are approximately the furthest apart and grows to cover the rest
+void compute_sphere(Meshlet& meshlet, std::span<const u32> indicies, std::span<const glm::vec3> positions) {
+    auto meshlet_indicies = indicies.subspan(meshlet.triangle_offset * 3, meshlet.triangle_count * 3);
+
+    auto furthest_from = [&](glm::vec3 point) {
+        glm::vec3 furthest = point;
+        float distance     = -1.f;
+        for (u32 index : meshlet_indicies) {
+            float d = glm::distance(point, positions[index]);
+            if (d > distance) {
+                distance = d;
+                furthest = positions[index];
+            }
+        }
+        return furthest;
+    };
+
+    glm::vec3 a = furthest_from(positions[meshlet_indicies[0]]);
+    glm::vec3 b = furthest_from(a);
+
+    glm::vec3 center = (a + b) * 0.5f;
+    float radius     = glm::distance(a, b) * 0.5f;
+
+    for (u32 index : meshlet_indicies) {
+        float distance = glm::distance(center, positions[index]);
+        if (distance <= radius) continue;
+
+        // moves the sphere towards the point just enough to cover it
+        float new_radius = (radius + distance) * 0.5f;
+        center += (positions[index] - center) * ((new_radius - radius) / distance);
+        radius = new_radius;
+    }
+
+    meshlet.center = center;
+    meshlet.radius = radius;
+}
+
+void compute_cone(Meshlet& meshlet, std::span<const u32> indicies, std::span<const glm::vec3> positions) {
+    meshlet.cone_axis   = glm::vec3(0.f, 0.f, 1.f);
+    meshlet.cone_cutoff = 1.f;
+
+    glm::vec3 normal_sum(0.f);
+    for (u32 t = meshlet.triangle_offset; t < meshlet.triangle_offset + meshlet.triangle_count; t++) {
+        float length;
+        normal_sum += triangle_normal(indicies, positions, t, length);
+    }
+
+    float axis_length = glm::length(normal_sum);
+    if (axis_length == 0.f) return;
+
+    glm::vec3 axis = normal_sum / axis_length;
+
+    float min_dot = 1.f;
+    for (u32 t = meshlet.triangle_offset; t < meshlet.triangle_offset + meshlet.triangle_count; t++) {
+        float length;
+        glm::vec3 normal = triangle_normal(indicies, positions, t, length);
+        if (length > 0.f) min_dot = std::min(min_dot, glm::dot(normal, axis));
+    }
+
+    // a cone of 90 degrees or wider can't be back facing from any point
+    if (min_dot <= 0.f) return;
+
+    meshlet.cone_axis   = axis;
+    meshlet.cone_cutoff = std::min(std::sqrt(1.f - min_dot * min_dot) + CONE_CUTOFF_EPSILON, 1.f);
+}
+
+} // namespace
+
+std::vector<Meshlet> build_meshlets(std::span<const u32> indicies, std::span<const glm::vec3> positions, u32 max_vertices, u32 max_triangles) {
+    assert(max_vertices >= 3 && max_triangles >= 1);
+
+    std::vector<Meshlet> meshlets;
+
+    u32 triangle_count = indicies.size() / 3;
+    if (triangle_count == 0) return meshlets;
+
+    // the meshlet each vertex was last added to, so that membership doesn't have to be reset between meshlets
+    std::vector<u32> vertex_meshlets(positions.size(), ~0u);
+
+    // vertices of triangle t that aren't in the meshlet yet, repeated indicies of degenerate triangles are counted once
+    auto count_new_vertices = [&](u32 t, u32 meshlet_index) {
+        u32 a = indicies[t * 3], b = indicies[t * 3 + 1], c = indicies[t * 3 + 2];
+        return static_cast<u32>(vertex_meshlets[a] != meshlet_index)                   //
+               + static_cast<u32>(b != a && vertex_meshlets[b] != meshlet_index)       //
+               + static_cast<u32>(c != a && c != b && vertex_meshlets[c] != meshlet_index);
+    };
+
+    Meshlet current{};
+    for (u32 t = 0; t < triangle_count; t++) {
+        u32 new_vertices = count_new_vertices(t, meshlets.size());
+
+        if (current.triangle_count == max_triangles || current.vertex_count + new_vertices > max_vertices) {
+            meshlets.push_back(current);
+            current      = Meshlet{.triangle_offset = t};
+            new_vertices = count_new_vertices(t, meshlets.size());
+        }
+
+        for (u32 j = 0; j < 3; j++) vertex_meshlets[indicies[t * 3 + j]] = meshlets.size();
+
+        current.vertex_count += new_vertices;
+        current.triangle_count++;
+    }
+    meshlets.push_back(current);
+
+    for (auto& meshlet : meshlets) {
+        compute_sphere(meshlet, indicies, positions);
+        compute_cone(meshlet, indicies, positions);
+    }
+
+    return meshlets;
+}
+
+} // namespace vke
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "common.hpp"
+
+namespace vke {
+
+// limits that fit the common mesh shader output sizes, 124 keeps the u8 triangle list of a mesh shader under 384 bytes
+constexpr u32 MESHLET_MAX_VERTICES  = 64;
+constexpr u32 MESHLET_MAX_TRIANGLES = 124;
+
+// a contiguous range of triangles in the index buffer, so a meshlet can be drawn with the regular vertex pipeline
+struct Meshlet {
+    u32 triangle_offset;
+    u32 triangle_count;
+    u32 vertex_count; // unique vertices referenced by the triangles
+
+    // bounding sphere of the vertices
+    glm::vec3 center;
+    float radius;
+
+    // every triangle normal is within the cone around cone_axis. cone_cutoff is the sine of its half angle,
+    // the meshlet is back facing from camera if dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius.
+    // it is 1 when the normals are spread too much for the test to ever pass
+    glm::vec3 cone_axis;
+    float cone_cutoff;
+};
+
+// splits the triangles into meshlets in index order, a meshlet is closed when the next triangle would exceed one of the limits.
+// the index order should already be optimized for the vertex cache, which also keeps the meshlets spatially compact
+std::vector<Meshlet> build_meshlets(std::span<const u32> indicies, std::span<const glm::vec3> positions, u32 max_vertices = MESHLET_MAX_VERTICES, u32 max_triangles = MESHLET_MAX_TRIANGLES);
+
+} // namespace vke
@@ -0,0 +1,317 @@
+#include "vertex_format.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include "render/shader/scene_data.h"
+
+namespace vke {
+
+// upper bound of the angle between a unit normal and its decoded octahedral snorm16 encoding, measured over a dense sphere sampling with some margin
+constexpr float OCTAHEDRAL_NORMAL_MAX_DEGREES = 0.01f;
+
+namespace {
+
+static_assert(sizeof(InterleavedFloatVertex) == 32);
+static_assert(sizeof(CompactVertex) == 20);
+static_assert(sizeof(QuantizedVertex) == 16);
+
+struct DecodedVertex {
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+};
+
+template <class T>
+void write_stream(std::vector<u8>& stream, std::span<const T> data) {
+    stream.resize(data.size_bytes());
+    memcpy(stream.data(), data.data(), data.size_bytes());
+}
+
+template <class T>
+T read_item(const std::vector<u8>& stream, u32 index) {
+    T item;
+    memcpy(&item, stream.data() + index * sizeof(T), sizeof(T));
+    return item;
+}
+
+float snorm16_to_float(u16 bits) { return std::max(static_cast<float>(std::bit_cast<int16_t>(bits)) / 32767.f, -1.f); }
+
+u16 float_to_snorm16(float value) { return std::bit_cast<u16>(static_cast<int16_t>(std::round(std::clamp(value, -1.f, 1.f) * 32767.f))); }
+
+// quantization range of the given values, empty ranges get a scale of 0 which decodes every value to the offset
+template <class V>
+void calculate_range(std::span<const V> values, V& offset, V& scale) {
+    if (values.empty()) {
+        offset = V(0.f);
+        scale  = V(1.f);
+        return;
+    }
+
+    V min = values[0], max = values[0];
+    for (auto& v : values) {
+        min = glm::min(min, v);
+        max = glm::max(max, v);
+    }
+
+    offset = min;
+    scale  = max - min;
+}
+
+DecodedVertex decode_vertex(const EncodedVertices& encoded, u32 index) {
+    auto& encoding = encoded.encoding;
+
+    switch (encoding.format) {
+    case VertexFormat::SEPARATE_FLOAT:
+        return DecodedVertex{
+            .position = read_item<glm::vec3>(encoded.streams[0], index),
+            .uv       = read_item<glm::vec2>(encoded.streams[1], index),
+            .normal   = read_item<glm::vec3>(encoded.streams[2], index),
+        };
+    case VertexFormat::INTERLEAVED_FLOAT: {
+        auto vertex = read_item<InterleavedFloatVertex>(encoded.streams[0], index);
+        return DecodedVertex{.position = vertex.position, .uv = vertex.uv, .normal = vertex.normal};
+    }
+    case VertexFormat::INTERLEAVED_COMPACT: {
+        auto vertex = read_item<CompactVertex>(encoded.streams[0], index);
+        return DecodedVertex{
+            .position = vertex.position,
+            .uv       = glm::vec2(decode_half(vertex.uv[0]), decode_half(vertex.uv[1])),
+            .normal   = decode_octahedral_normal(vertex.normal),
+        };
+    }
+    case VertexFormat::INTERLEAVED_QUANTIZED: {
+        auto vertex = read_item<QuantizedVertex>(encoded.streams[0], index);
+
+        glm::vec3 position;
+        for (int i = 0; i < 3; i++) position[i] = decode_unorm16(vertex.position[i], encoding.position_offset[i], encoding.position_scale[i]);
+
+        return DecodedVertex{
+            .position = position,
+            .uv       = glm::vec2(decode_unorm16(vertex.uv[0], encoding.uv_offset.x, encoding.uv_scale.x), decode_unorm16(vertex.uv[1], encoding.uv_offset.y, encoding.uv_scale.y)),
+            .normal   = decode_octahedral_normal(vertex.normal),
+        };
+    }
+    }
+
+    return {};
+}
+
+} // namespace
+
+u32 vertex_format_stride(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::SEPARATE_FLOAT: return sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(glm::vec3);
+    case VertexFormat::INTERLEAVED_FLOAT: return sizeof(InterleavedFloatVertex);
+    case VertexFormat::INTERLEAVED_COMPACT: return sizeof(CompactVertex);
+    case VertexFormat::INTERLEAVED_QUANTIZED: return sizeof(QuantizedVertex);
+    }
+
+    return 0;
+}
+
+u32 VertexEncoding::shader_flags() const {
+    switch (format) {
+    case VertexFormat::SEPARATE_FLOAT:
+    case VertexFormat::INTERLEAVED_FLOAT: return 0;
+    case VertexFormat::INTERLEAVED_COMPACT: return VERTEX_FLAG_HALF_UV | VERTEX_FLAG_OCTAHEDRAL_NORMAL;
+    case VertexFormat::INTERLEAVED_QUANTIZED: return VERTEX_FLAG_QUANTIZED_POSITION | VERTEX_FLAG_UNORM_UV | VERTEX_FLAG_OCTAHEDRAL_NORMAL;
+    }
+
+    return 0;
+}
+
+EncodedVertices encode_vertices(VertexFormat format, std::span<const glm::vec3> positions, std::span<const glm::vec2> uvs, std::span<const glm::vec3> normals) {
+    u32 vertex_count = positions.size();
+
+    auto uv_at     = [&](u32 i) { return i < uvs.size() ? uvs[i] : glm::vec2(0.f); };
+    auto normal_at = [&](u32 i) { return i < normals.size() ? normals[i] : glm::vec3(0.f, 0.f, 1.f); };
+
+    EncodedVertices encoded;
+    encoded.encoding.format = format;
+    encoded.vertex_count    = vertex_count;
+
+    auto& encoding = encoded.encoding;
+
+    switch (format) {
+    case VertexFormat::SEPARATE_FLOAT: {
+        std::vector<glm::vec2> full_uvs(vertex_count);
+        std::vector<glm::vec3> full_normals(vertex_count);
+        for (u32 i = 0; i < vertex_count; i++) {
+            full_uvs[i]     = uv_at(i);
+            full_normals[i] = normal_at(i);
+        }
+
+        encoded.streams.resize(3);
+        write_stream(encoded.streams[0], positions);
+        write_stream(encoded.streams[1], std::span<const glm::vec2>(full_uvs));
+        write_stream(encoded.streams[2], std::span<const glm::vec3>(full_normals));
+    } break;
+    case VertexFormat::INTERLEAVED_FLOAT: {
+        std::vector<InterleavedFloatVertex> vertices(vertex_count);
+        for (u32 i = 0; i < vertex_count; i++) {
+            vertices[i] = InterleavedFloatVertex{.position = positions[i], .uv = uv_at(i), .normal = normal_at(i)};
+        }
+
+        encoded.streams.resize(1);
+        write_stream(encoded.streams[0], std::span<const InterleavedFloatVertex>(vertices));
+    } break;
+    case VertexFormat::INTERLEAVED_COMPACT: {
+        std::vector<CompactVertex> vertices(vertex_count);
+        for (u32 i = 0; i < vertex_count; i++) {
+            glm::vec2 uv = uv_at(i);
+            vertices[i]  = CompactVertex{
+                 .position = positions[i],
+                 .uv       = {encode_half(uv.x), encode_half(uv.y)},
+                 .normal   = encode_octahedral_normal(normal_at(i)),
+            };
+        }
+
+        encoded.streams.resize(1);
+        write_stream(encoded.streams[0], std::span<const CompactVertex>(vertices));
+    } break;
+    case VertexFormat::INTERLEAVED_QUANTIZED: {
+        calculate_range(positions, encoding.position_offset, encoding.position_scale);
+        if (uvs.size() == vertex_count) calculate_range(uvs, encoding.uv_offset, encoding.uv_scale);
+
+        std::vector<QuantizedVertex> vertices(vertex_count);
+        for (u32 i = 0; i < vertex_count; i++) {
+            auto& vertex = vertices[i];
+            glm::vec2 uv = uv_at(i);
+
+            for (int c = 0; c < 3; c++) vertex.position[c] = encode_unorm16(positions[i][c], encoding.position_offset[c], encoding.position_scale[c]);
+            vertex.position[3] = 0;
+            vertex.uv[0]       = encode_unorm16(uv.x, encoding.uv_offset.x, encoding.uv_scale.x);
+            vertex.uv[1]       = encode_unorm16(uv.y, encoding.uv_offset.y, encoding.uv_scale.y);
+            vertex.normal      = encode_octahedral_normal(normal_at(i));
+        }
+
+        encoded.streams.resize(1);
+        write_stream(encoded.streams[0], std::span<const QuantizedVertex>(vertices));
+    } break;
+    }
+
+    return encoded;
+}
+
+VertexEncodingError measure_vertex_encoding_error(const EncodedVertices& encoded, std::span<const glm::vec3> positions, std::span<const glm::vec2> uvs, std::span<const glm::vec3> normals) {
+    VertexEncodingError error;
+
+    for (u32 i = 0; i < encoded.vertex_count; i++) {
+        auto vertex = decode_vertex(encoded, i);
+
+        error.position = std::max(error.position, glm::length(vertex.position - positions[i]));
+        if (i < uvs.size()) error.uv = std::max(error.uv, glm::length(vertex.uv - uvs[i]));
+
+        // zero length normals have no direction to lose. atan2 stays precise for tiny angles unlike acos
+        if (i < normals.size() && glm::length(normals[i]) > 0.f) {
+            float angle          = std::atan2(glm::length(glm::cross(normals[i], vertex.normal)), glm::dot(normals[i], vertex.normal));
+            error.normal_degrees = std::max(error.normal_degrees, glm::degrees(angle));
+        }
+    }
+
+    return error;
+}
+
+VertexEncodingError vertex_encoding_error_bound(const VertexEncoding& encoding, std::span<const glm::vec3> positions, std::span<const glm::vec2> uvs) {
+    // covers the float rounding of the decode, relative to the magnitude of the decoded values
+    constexpr float ROUNDING_MARGIN = 1e-5f;
+
+    float max_position = 0.f, max_uv = 0.f;
+    for (auto& p : positions) max_position = std::max(max_position, glm::length(p));
+    for (auto& uv : uvs) max_uv = std::max(max_uv, glm::length(uv));
+
+    VertexEncodingError bound;
+
+    switch (encoding.format) {
+    case VertexFormat::SEPARATE_FLOAT:
+    case VertexFormat::INTERLEAVED_FLOAT: break;
+    case VertexFormat::INTERLEAVED_COMPACT:
+        // f16 keeps 11 significant bits, values below 2^-14 are subnormals with an absolute step of 2^-24 on each of the 2 axes
+        bound.uv             = max_uv * std::exp2(-11.f) + std::sqrt(2.f) * std::exp2(-25.f) + max_uv * ROUNDING_MARGIN;
+        bound.normal_degrees = OCTAHEDRAL_NORMAL_MAX_DEGREES;
+        break;
+    case VertexFormat::INTERLEAVED_QUANTIZED:
+        // rounding to the nearest step is off by at most half a step on every axis
+        bound.position       = glm::length(encoding.position_scale) * (0.5f / 65535.f) + max_position * ROUNDING_MARGIN;
+        bound.uv             = glm::length(encoding.uv_scale) * (0.5f / 65535.f) + max_uv * ROUNDING_MARGIN;
+        bound.normal_degrees = OCTAHEDRAL_NORMAL_MAX_DEGREES;
+        break;
+    }
+
+    return bound;
+}
+
+u32 encode_octahedral_normal(glm::vec3 normal) {
+    float l1_length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1_length == 0.f) return encode_octahedral_normal(glm::vec3(0.f, 0.f, 1.f));
+
+    // project onto the octahedron and fold the lower half over the upper one
+    glm::vec2 e = glm::vec2(normal.x, normal.y) / l1_length;
+    if (normal.z < 0.f) {
+        glm::vec2 sign = glm::vec2(e.x >= 0.f ? 1.f : -1.f, e.y >= 0.f ? 1.f : -1.f);
+        e              = (1.f - glm::abs(glm::vec2(e.y, e.x))) * sign;
+    }
+
+    return static_cast<u32>(float_to_snorm16(e.x)) | static_cast<u32>(float_to_snorm16(e.y)) << 16;
+}
+
+glm::vec3 decode_octahedral_normal(u32 bits) {
+    glm::vec2 e = glm::vec2(snorm16_to_float(bits & 0xFFFF), snorm16_to_float(bits >> 16));
+
+    glm::vec3 normal = glm::vec3(e.x, e.y, 1.f - std::abs(e.x) - std::abs(e.y));
+    float t          = std::max(-normal.z, 0.f);
+    normal.x += normal.x >= 0.f ? -t : t;
+    normal.y += normal.y >= 0.f ? -t : t;
+
+    return glm::normalize(normal);
+}
+
+u16 encode_half(float value) {
+    u32 bits = std::bit_cast<u32>(value);
+    u32 sign = (bits >> 16) & 0x8000;
+    u32 abs  = bits & 0x7FFF'FFFF;
+
+    // nan & infinity
+    if (abs >= 0x7F80'0000) return sign | 0x7C00 | (abs > 0x7F80'0000 ? 0x200 : 0);
+    // 65520 and above round to infinity
+    if (abs >= 0x477F'F000) return sign | 0x7C00;
+
+    // subnormals are multiples of 2^-24. rounding up to 1024 results in the smallest normal number which is still correct
+    if (abs < 0x3880'0000) return sign | static_cast<u32>(std::nearbyint(std::bit_cast<float>(abs) * 16777216.f));
+
+    // rebias the exponent and round the mantissa to nearest even
+    u32 rounded = abs + 0xFFF + ((abs >> 13) & 1);
+    return sign | ((rounded - (112u << 23)) >> 13);
+}
+
+float decode_half(u16 bits) {
+    u32 sign     = static_cast<u32>(bits & 0x8000) << 16;
+    u32 exponent = (bits >> 10) & 0x1F;
+    u32 mantissa = bits & 0x3FF;
+
+    if (exponent == 0) {
+        float value = static_cast<float>(mantissa) / 16777216.f;
+        return sign ? -value : value;
+    }
+
+    if (exponent == 31) return std::bit_cast<float>(sign | 0x7F80'0000 | (mantissa << 13));
+
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+u16 encode_unorm16(float value, float offset, float scale) {
+    if (scale <= 0.f) return 0;
+    return static_cast<u16>(std::round(std::clamp((value - offset) / scale, 0.f, 1.f) * 65535.f));
+}
+
+float decode_unorm16(u16 bits, float offset, float scale) {
+    return offset + static_cast<float>(bits) / 65535.f * scale;
+}
+
+} // namespace vke
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "common.hpp"
+
+namespace vke {
+
+// layouts the vertex streams of a mesh can be built in.
+// every attribute is read as raw bits and decoded in vs_input/default.glsl, so the same pipelines work with all of them
+enum class VertexFormat : u32 {
+    SEPARATE_FLOAT,        // 3 streams of f32 position, uv & normal. 32 bytes
+    INTERLEAVED_FLOAT,     // 1 stream with the same attributes. 32 bytes
+    INTERLEAVED_COMPACT,   // f32 position, f16 uv & octahedral snorm16 normal. 20 bytes
+    INTERLEAVED_QUANTIZED, // unorm16 position in the mesh aabb, unorm16 uv in the uv bounds & octahedral snorm16 normal. 16 bytes
+};
+
+// vertices of the interleaved formats, the attribute order matches the locations in vs_input/default.glsl
+struct InterleavedFloatVertex {
+    glm::vec3 position;
+    glm::vec2 uv;
+    glm::vec3 normal;
+};
+
+struct CompactVertex {
+    glm::vec3 position;
+    u16 uv[2];
+    u32 normal;
+};
+
+struct QuantizedVertex {
+    u16 position[4]; // w is padding, it keeps the attribute 8 byte aligned
+    u16 uv[2];
+    u32 normal;
+};
+
+// bytes per vertex summed over every stream
+u32 vertex_format_stride(VertexFormat format);
+
+// what the vertex shader needs to decode the attributes of a mesh, the ranges are only used by the quantized attributes
+struct VertexEncoding {
+    VertexFormat format       = VertexFormat::SEPARATE_FLOAT;
+    glm::vec3 position_offset = glm::vec3(0.f);
+    glm::vec3 position_scale  = glm::vec3(1.f);
+    glm::vec2 uv_offset       = glm::vec2(0.f);
+    glm::vec2 uv_scale        = glm::vec2(1.f);
+
+    // VERTEX_FLAG_* bits of scene_data.h
+    u32 shader_flags() const;
+};
+
+struct EncodedVertices {
+    VertexEncoding encoding;
+    u32 vertex_count = 0;
+    std::vector<std::vector<u8>> streams; // one per vertex buffer
+};
+
+// uvs and normals that are missing are filled with zeroes and +z
+EncodedVertices encode_vertices(VertexFormat format, std::span<const glm::vec3> positions, std::span<const glm::vec2> uvs, std::span<const glm::vec3> normals);
+
+// largest difference between the source attributes and what the vertex shader decodes
+struct VertexEncodingError {
+    float position       = 0.f;
+    float uv             = 0.f;
+    float normal_degrees = 0.f;
+
+    bool is_within(const VertexEncodingError& bound) const { return position <= bound.position && uv <= bound.uv && normal_degrees <= bound.normal_degrees; }
+};
+
+VertexEncodingError measure_vertex_encoding_error(const EncodedVertices& encoded, std::span<const glm::vec3> positions, std::span<const glm::vec2> uvs, std::span<const glm::vec3> normals);
+// the error measure_vertex_encoding_error is guaranteed to stay under for the given source attributes
+VertexEncodingError vertex_encoding_error_bound(const VertexEncoding& encoding, std::span<const glm::vec3> positions, std::span<const glm::vec2> uvs);
+
+// the scalar encoders, their decoders mirror the ones in vs_input/default.glsl
+u32 encode_octahedral_normal(glm::vec3 normal); // 2 snorm16 packed into the low & high half
+glm::vec3 decode_octahedral_normal(u32 bits);
+u16 encode_half(float value);
+float decode_half(u16 bits);
+u16 encode_unorm16(float value, float offset, float scale);
+float decode_unorm16(u16 bits, float offset, float scale);
+
+} // namespace vke
@@ -2,6 +2,8 @@
 
 #include <flecs.h>
 
+#include <optional>
+
 #include "../iobject_renderer.hpp"
 #include "scene/components/transform.hpp"
 
@@ -24,8 +26,10 @@ public:
     GPUHandleIDManager(flecs::world* world) {
         m_world = world;
 
-        m_observers.push_back(m_world->observer<TargetComponent>().event(flecs::OnAdd).each([&](flecs::entity e, const auto& c) {
-            m_new_entities.push_back(e.id());
+        // entities that are created together, like by a bulk spawn, are notified as one batch
+        m_observers.push_back(m_world->observer<TargetComponent>().event(flecs::OnAdd).each([&](flecs::iter& it, size_t i, const TargetComponent& c) {
+            if (i == 0) m_new_entity_batch_sizes.push_back(it.count());
+            m_new_entities.push_back(it.entity(i).id());
         }));
 
         m_observers.push_back(m_world->observer<TargetComponent>().event(flecs::OnRemove).each([&](flecs::entity e, const auto& c) {
@@ -40,20 +44,26 @@ public:
         }
     }
 
+    // every batch gets a range of consecutive handles, even when freed handles are scattered
     void flush_and_register_handles(auto&& func) {
-        for (auto& ent_id : m_new_entities) {
-            auto e = flecs::entity(*m_world, ent_id);
+        u32 entity_index = 0;
+        for (u32 batch_size : m_new_entity_batch_sizes) {
+            auto first_id = id_manager.new_id_range(batch_size);
 
-            auto handle_id = id_manager.new_id();
+            for (u32 i = 0; i < batch_size; i++) {
+                auto e         = flecs::entity(*m_world, m_new_entities[entity_index++]);
+                auto handle_id = HandleID(first_id.id + i);
 
-            e.set(HandleComponent{
-                .id = handle_id,
-            });
+                e.set(HandleComponent{
+                    .id = handle_id,
+                });
 
-            func(e, handle_id);
+                func(e, handle_id);
+            }
         }
 
         m_new_entities.clear();
+        m_new_entity_batch_sizes.clear();
     }
 
     void flush_destroyed_handles() {
@@ -64,6 +74,14 @@ public:
         m_destroyed_entity_handles.clear();
     }
 
+    // entities get their handle on the first flush after the component was added
+    std::optional<HandleID> get_handle(flecs::entity e) const {
+        auto* handle = e.get<HandleComponent>();
+        if (handle == nullptr) return std::nullopt;
+
+        return handle->id;
+    }
+
 public:
     const auto& get_destroyed_entities() { return m_destroyed_entity_handles; }
     auto& get_id_manager() { return id_manager; }
@@ -73,6 +91,7 @@ private:
     flecs::world* m_world;
     vke::SlimVec<flecs::observer> m_observers;
     SlimVec<flecs::entity_t> m_new_entities;
+    SlimVec<u32> m_new_entity_batch_sizes;
     SlimVec<HandleID> m_destroyed_entity_handles;
 };
 
@@ -49,8 +49,9 @@ HierarchicalZBuffers::HierarchicalZBuffers(RenderServer* rd, IImageView* target)
 
     if (mip_layer_count == 11 || mip_layer_count == 12) mip_layer_count = 10;
 
+    // depth formats can't be storage images on most devices, the chain keeps the depth in a color format
     m_depth_chain = std::make_unique<vke::Image>(ImageArgs{
-        .format      = target->format(),
+        .format      = VK_FORMAT_R32_SFLOAT,
         .usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
         .width       = width,
         .height      = height,
@@ -105,10 +106,13 @@ void HierarchicalZBuffers::get_or_create_shared_data() {
     builder.add_binding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, MAX_MIPS_IN_ONE_PASS);
     VkDescriptorSetLayout set_layout = builder.build();
 
-    m_render_server->get_pipeline_loader()->get_pipeline_globals_provider()->set_layouts["vke::depth_mip_chain_set"] = set_layout;
+    {
+        auto lock = m_render_server->lock_pipeline_loader();
+        m_render_server->get_pipeline_loader()->get_pipeline_globals_provider()->set_layouts["vke::depth_mip_chain_set"] = set_layout;
+    }
 
     m_shared_data = std::make_shared<SharedData>(SharedData{
-        .mip_pipeline         = m_render_server->get_pipeline_loader()->load("vke::depth_mip_pipeline"),
+        .mip_pipeline         = m_render_server->load_pipeline("vke::depth_mip_pipeline"),
         .min_sampler          = sampler,
         .cull_sampler = create_cull_sampler(device()),
         .mip_chain_set_layout = set_layout,
@@ -18,7 +18,16 @@ public:
     ~HierarchicalZBuffers();
 
     void update_mips(vke::CommandBuffer& compute_cmd);
-    void update_hzb_proj_view(const glm::mat4& m) { m_hzb_proj_view = m; }
+    // the target is drawn with m after it, so its depth can be reprojected into the next draw again
+    void update_hzb_proj_view(const glm::mat4& m) {
+        m_hzb_proj_view = m;
+        m_is_valid      = true;
+    }
+
+    // the depth in the target can't be reprojected into the next draw, e.g. the view turned or the occluders in it were removed.
+    // the next draw isn't culled against it
+    void invalidate() { m_is_valid = false; }
+    bool is_valid() const { return m_is_valid; }
 
     glm::mat4 get_hzb_proj_view() const { return m_hzb_proj_view; }
 
@@ -53,6 +62,8 @@ private:
     glm::mat4 m_hzb_proj_view;
 
     bool m_are_images_new = false;
+    // the target holds nothing until it is drawn for the first time
+    bool m_is_valid = false;
 };
 
 } // namespace vke
\ No newline at end of file
@@ -19,6 +19,15 @@ public:
     virtual void update(vke::CommandBuffer& cmd) = 0;
     virtual void set_world(flecs::world* reg) {}
 
+    // increases whenever the static instances or the resources they are drawn with change.
+    // views may keep what they drew from the static instances while it stays the same
+    virtual u64 get_static_revision() const { return 0; }
+    virtual u32 get_dynamic_instance_count() const { return 0; }
+    // read back from the gpu, so it is the count of a render of the target FRAME_OVERLAP frames ago
+    virtual u64 get_drawn_instance_count(const std::string& render_target_name) const { return 0; }
+    // read back like the drawn count, the instances that only the hzb of the target culled
+    virtual u64 get_occlusion_culled_instance_count(const std::string& render_target_name) const { return 0; }
+
 private:
 };
 
@@ -21,8 +21,11 @@ LightBuffersManager::LightBuffersManager(vke::RenderServer* render_server, flecs
         sizeof(SceneLightData) + sizeof(PointLight) * m_max_point_light_count, false //
     );
 
+    m_point_light_shadow_buffer = std::make_unique<vke::Buffer>(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(PointLightShadow) * m_max_point_light_count, false);
+
     m_shadow_manager = std::make_unique<ShadowManager>(m_render_server);
     m_light_handle_manager = std::make_unique<GPUHandleIDManager<CPointLight>>(world);
+    m_point_light_query    = world->query_builder<const CPointLight, const Transform>().build();
 }
 
 LightBuffersManager::~LightBuffersManager() {
@@ -31,7 +34,9 @@ LightBuffersManager::~LightBuffersManager() {
 void LightBuffersManager::flush_pending_lights(vke::CommandBuffer& cmd) {
     StencilBuffer stencil;
 
-    auto point_lights = m_light_buffer->subspan(sizeof(SceneLightData));
+    auto point_lights        = m_light_buffer->subspan(sizeof(SceneLightData));
+    auto point_light_shadows = m_point_light_shadow_buffer->subspan(0);
+    auto* shadow_atlas       = m_shadow_manager->get_shadow_atlas();
 
     m_light_handle_manager->flush_and_register_handles([&](flecs::entity e, LightID id) {
         auto t = e.get<Transform>();
@@ -44,8 +49,30 @@ void LightBuffersManager::flush_pending_lights(vke::CommandBuffer& cmd) {
         };
 
         stencil.copy_data(point_lights.subspan_item<PointLight>(id.id, 1), &light, 1);
+        // the atlas overwrites it once the light has its faces drawn
+        PointLightShadow no_shadow{};
+        stencil.copy_data(point_light_shadows.subspan_item<PointLightShadow>(id.id, 1), &no_shadow, 1);
+    });
+
+    m_shadow_requests.clear();
+    m_point_light_query.each([&](flecs::entity e, const CPointLight& l, const Transform& t) {
+        auto id = m_light_handle_manager->get_handle(e);
+        if (!l.casts_shadows || !id) return;
+
+        m_shadow_requests.push_back(ShadowAtlas::LightRequest{
+            .light_id = id->id,
+            .position = glm::vec3(t.position),
+            .range    = l.range,
+        });
     });
 
+    m_shadow_manager->update_point_light_shadows(m_shadow_requests);
+
+    for (u32 id : shadow_atlas->get_changed_lights()) {
+        stencil.copy_data(point_light_shadows.subspan_item<PointLightShadow>(id, 1), &shadow_atlas->get_light_shadow(id), 1);
+    }
+    shadow_atlas->clear_changed_lights();
+
     glm::vec3 directional_light_dir = glm::normalize(glm::vec3(1, -1, 1));
 
     // m_shadow_manager->set_direct_shadow_map_camera(0, ShadowMapCameraData{
@@ -65,7 +92,7 @@ void LightBuffersManager::flush_pending_lights(vke::CommandBuffer& cmd) {
             // .proj_view = m_shadow_manager->get_direct_shadow_map(0)->get_projection_view_matrix(),
         },
         .ambient_light     = glm::vec4(0.04, 0.03, 0.03, 0.0),
-        .point_light_count = static_cast<u32>(m_light_handle_manager->get_id_manager().id_manager.id_count()),
+        .point_light_count = static_cast<u32>(m_light_handle_manager->get_id_manager().id_count()),
     };
 
     auto& min_zs = m_shadow_manager->get_min_zs_for_direct_shadow_maps(0);
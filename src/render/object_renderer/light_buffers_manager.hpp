@@ -9,6 +9,7 @@
 #include "fwd.hpp"
 #include "render/iobject_renderer.hpp"
 #include "generic_entity_gpu_handle_manager.hpp"
+#include "render/shadow/shadow_atlas.hpp"
 
 
 namespace vke {
@@ -24,10 +25,13 @@ public:
     void flush_pending_lights(vke::CommandBuffer& cmd);
 
     IBuffer* get_get_lights_buffer() const { return m_light_buffer.get(); }
+    // PointLightShadow of every point light, indexed like the lights
+    IBuffer* get_point_light_shadow_buffer() const { return m_point_light_shadow_buffer.get(); }
     vke::ShadowManager* get_shadow_manager() { return m_shadow_manager.get(); }
 
 private:
     std::unique_ptr<vke::Buffer> m_light_buffer;
+    std::unique_ptr<vke::Buffer> m_point_light_shadow_buffer;
     std::unordered_map<std::string, std::unique_ptr<vke::Buffer>> m_light_tile_buffers;
     flecs::world* m_world;
     vke::RenderServer* m_render_server;
@@ -35,7 +39,8 @@ private:
 
 
     std::unique_ptr<GPUHandleIDManager<CPointLight>> m_light_handle_manager;
-    
+    flecs::query<const CPointLight, const Transform> m_point_light_query;
+    std::vector<ShadowAtlas::LightRequest> m_shadow_requests;
 
     u32 m_max_point_light_count = 1020;
 };
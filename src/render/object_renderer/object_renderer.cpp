@@ -2,6 +2,7 @@
 
 #include "imgui.h"
 #include "render/object_renderer/light_buffers_manager.hpp"
+#include "render/object_renderer/resource_manager.hpp"
 #include "render/object_renderer/sub_systems/indirect_model_renderer.hpp"
 #include "render/render_server.hpp"
 #include "render/shader/scene_data.h"
@@ -41,7 +42,10 @@ ObjectRenderer::ObjectRenderer(RenderServer* render_server) {
 
     m_resource_manager = std::make_unique<ResourceManager>(render_server);
 
-    m_view_set_layout = pg_provider->set_layouts["vke::object_renderer::view_set"];
+    {
+        auto lock         = m_render_server->lock_pipeline_loader();
+        m_view_set_layout = pg_provider->set_layouts["vke::object_renderer::view_set"];
+    }
 
     for (auto& framely : m_framely_data) {
     }
@@ -60,6 +64,9 @@ void ObjectRenderer::update_scene_data(CommandBuffer& cmd) {
     for (auto& rs : m_render_systems) {
         rs->update(cmd);
     }
+
+    m_resource_manager->collect_garbage();
+    m_resource_manager->get_residency_manager()->update();
 }
 
 void ObjectRenderer::render(const RenderArguments& args) {
@@ -88,7 +95,9 @@ void ObjectRenderer::create_render_target(const std::string& name, const std::st
         .info = RenderTargetInfo{
             .subpass_name = subpass_name,
             .camera       = nullptr,
-        }};
+        },
+        .arguments = render_target_arguments,
+    };
 
     for (int i = 0; i < FRAME_OVERLAP; i++) {
         target.view_buffers[i] = std::make_unique<vke::Buffer>(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(ViewData), true);
@@ -107,7 +116,7 @@ void ObjectRenderer::update_view_descriptor_set(RenderTarget* target, u32 i) {
     vke::DescriptorSetBuilder builder;
     builder.add_ubo(target->view_buffers[i].get(), VK_SHADER_STAGE_ALL);
 
-    auto* hzb      = target->hzb;
+    auto* hzb      = target->hzb ? target->hzb : target->receiver_hzb;
     auto hzb_stage = VK_SHADER_STAGE_COMPUTE_BIT;
     if (hzb) {
         builder.add_image_sampler(hzb->get_mips(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, hzb->get_sampler(), hzb_stage);
@@ -134,13 +143,37 @@ void ObjectRenderer::update_view_set(RenderTarget* target) {
 
     data.frustum = calculate_frustum(data.inv_proj_view);
 
+    // projection()[1][1] scales view space y to ndc, which spans 2 units over the viewport. atlas tiles are a part of the framebuffer
+    float framebuffer_height = target->arguments.framebuffer_height != 0 ? target->arguments.framebuffer_height : m_render_server->get_window()->height();
+    float pixels_per_unit    = std::abs(target->info.camera->projection()[1][1]) * framebuffer_height * target->atlas_rect.w * 0.5f;
+    data.lod_parameters      = glm::vec4(pixels_per_unit, m_lod_pixel_error, 0.f, 0.f);
+
+    data.instance_filter.x = static_cast<u32>(target->arguments.instance_filter);
+
+    data.layer_count.x = target->layer_cameras.size();
+    for (u32 i = 0; i < target->layer_cameras.size(); i++) {
+        data.layers[i].proj_view = target->layer_cameras[i]->proj_view();
+        data.layers[i].frustum   = calculate_frustum(glm::inverse(data.layers[i].proj_view));
+    }
+
+    data.atlas_rect = target->atlas_rect;
+
+    if (target->receivers) {
+        data.receivers = *target->receivers;
+
+        // the hzb is the depth of an earlier frame, it has to be tested with the matrix it was drawn with
+        if (target->receiver_hzb) data.receivers.proj_view = target->receiver_hzb->get_hzb_proj_view();
+    } else {
+        data.receivers.light_dir.w = 0.f;
+    }
+
     if (target->is_view_set_needs_update[frame_index]) {
         update_view_descriptor_set(target, frame_index);
 
         target->is_view_set_needs_update[frame_index] = 0;
     }
 
-    if (target->hzb) {
+    if (target->hzb && target->hzb->is_valid()) {
         data.old_proj_view            = target->hzb->get_hzb_proj_view();
         data.is_hzb_culling_enabled.x = 1;
     } else {
@@ -183,8 +216,55 @@ void ObjectRenderer::set_hzb(const std::string& render_target, HierarchicalZBuff
     }
 }
 
+void ObjectRenderer::set_shadow_receivers(const std::string& render_target, const std::optional<ReceiverData>& receivers, HierarchicalZBuffers* receiver_hzb) {
+    auto* rd = &m_render_targets.at(render_target);
+    assert(rd->hzb == nullptr || receiver_hzb == nullptr);
+
+    rd->receivers = receivers;
+
+    if (rd->receiver_hzb != receiver_hzb) {
+        rd->receiver_hzb = receiver_hzb;
+
+        for (bool& b : rd->is_view_set_needs_update) {
+            b = true;
+        }
+    }
+}
+
+u64 ObjectRenderer::get_static_revision() const {
+    u64 revision = 0;
+    for (auto& rs : m_render_systems) revision += rs->get_static_revision();
+    return revision;
+}
+
+u32 ObjectRenderer::get_dynamic_instance_count() const {
+    u32 count = 0;
+    for (auto& rs : m_render_systems) count += rs->get_dynamic_instance_count();
+    return count;
+}
+
+u64 ObjectRenderer::get_drawn_instance_count(const std::string& render_target_name) const {
+    u64 count = 0;
+    for (auto& rs : m_render_systems) count += rs->get_drawn_instance_count(render_target_name);
+    return count;
+}
+
+u64 ObjectRenderer::get_occlusion_culled_instance_count(const std::string& render_target_name) const {
+    u64 count = 0;
+    for (auto& rs : m_render_systems) count += rs->get_occlusion_culled_instance_count(render_target_name);
+    return count;
+}
+
 void ObjectRenderer::set_camera(const std::string& render_target, Camera* camera) { m_render_targets.at(render_target).info.camera = camera; }
 
+void ObjectRenderer::set_layer_cameras(const std::string& render_target, std::span<Camera* const> cameras) {
+    assert(cameras.size() <= MAX_VIEW_LAYERS);
+
+    m_render_targets.at(render_target).layer_cameras.assign(cameras.begin(), cameras.end());
+}
+
+void ObjectRenderer::set_atlas_rect(const std::string& render_target, glm::vec4 atlas_rect) { m_render_targets.at(render_target).atlas_rect = atlas_rect; }
+
 void ObjectRenderer::create_render_systems() {
     add_render_system(std::make_unique<vke::IndirectModelRenderer>(this));
 }
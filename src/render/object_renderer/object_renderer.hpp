@@ -1,5 +1,7 @@
 #pragma once
 
+#include <optional>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
@@ -11,6 +13,7 @@
 #include "render/iobject_renderer.hpp"
 #include "render/mesh/mesh.hpp"
 #include "render/object_renderer/render_state.hpp"
+#include "render/shader/scene_data.h"
 #include "renderer_common.hpp"
 
 #include "fwd.hpp"
@@ -23,9 +26,19 @@ class LightBuffersManager;
 
 struct RenderState;
 
+// which instances a render target draws, the values match INSTANCE_FILTER_* in scene_data.h
+enum class InstanceFilter : u32 {
+    ALL     = 0,
+    STATIC  = 1, // only instances without the DynamicRenderable tag
+    DYNAMIC = 2,
+};
+
 struct RenderTargetArguments {
-    bool allow_indirect_render = true;
-    bool allow_hzb_culling     = false;
+    bool allow_indirect_render     = true;
+    bool allow_hzb_culling         = false;
+    InstanceFilter instance_filter = InstanceFilter::ALL;
+    // pixel height of the framebuffer the target draws into, the lods are selected for it. 0 follows the window height
+    u32 framebuffer_height = 0;
 };
 
 class ObjectRenderer final : public DeviceGetter {
@@ -47,10 +60,23 @@ public:
     void update_scene_data(CommandBuffer& cmd);
 
     void set_camera(const std::string& render_target, Camera* camera);
+    // makes the render target layered, its instances are drawn once into every layer whose camera sees them.
+    // the pipelines of its subpass have to route the primitives to the layers, see shadow_layered.geom
+    void set_layer_cameras(const std::string& render_target, std::span<Camera* const> cameras);
+    // culls the casters of a shadow render target that can't shadow a receiver visible to a camera, see is_shadow_receiver_visible in cull_util.glsl.
+    // receiver_hzb is the hzb of that camera, receivers.proj_view is replaced with the matrix it was drawn with. nullopt disables the culling
+    void set_shadow_receivers(const std::string& render_target, const std::optional<ReceiverData>& receivers, HierarchicalZBuffers* receiver_hzb = nullptr);
     void set_hzb(const std::string& render_target, HierarchicalZBuffers* hzb);
+    // the tile of the framebuffer the render target draws into as xy offset & zw size in uvs, the pipelines of its subpass have to place
+    // the primitives into it, see shadow_atlas.vert. culling still uses the camera as if it covered the framebuffer, lods use the size of the tile
+    void set_atlas_rect(const std::string& render_target, glm::vec4 atlas_rect);
 
     ResourceManager* get_resource_manager() { return m_resource_manager.get(); }
 
+    // the screen space error in pixels the lods of a mesh may have before a more detailed one is used, 0 always draws the full detail meshes
+    void set_lod_pixel_error(float pixel_error) { m_lod_pixel_error = pixel_error; }
+    float get_lod_pixel_error() const { return m_lod_pixel_error; }
+
     void create_render_target(const std::string& name, const std::string& subpass_name, const RenderTargetArguments& render_target_arguments = {});
 
     LightBuffersManager* get_light_manager() { return m_light_manager.get(); }
@@ -60,12 +86,24 @@ public:
 
     const RenderTargetInfo* get_render_target_info(const std::string& render_target_name) const { return &m_render_targets.at(render_target_name).info; }
 
+    // summed over the render systems, see IObjectRendererSystem
+    u64 get_static_revision() const;
+    u32 get_dynamic_instance_count() const;
+    u64 get_drawn_instance_count(const std::string& render_target_name) const;
+    u64 get_occlusion_culled_instance_count(const std::string& render_target_name) const;
+
 private:
     struct IndirectRenderBuffers;
 
 public:
     struct RenderTarget {
         RenderTargetInfo info;
+        RenderTargetArguments arguments;
+        std::vector<Camera*> layer_cameras; // empty for render targets that aren't layered
+
+        std::optional<ReceiverData> receivers;
+        HierarchicalZBuffers* receiver_hzb = nullptr; // bound in place of hzb, which has to be null for it
+        glm::vec4 atlas_rect               = glm::vec4(0, 0, 1, 1);
 
         std::unique_ptr<vke::Buffer> view_buffers[FRAME_OVERLAP];
         bool is_view_set_needs_update[FRAME_OVERLAP];
@@ -108,6 +146,7 @@ private:
     flecs::world* m_world         = nullptr;
 
     glm::dvec3 m_render_origin = {0, 0, 0};
+    float m_lod_pixel_error    = 1.f;
 
     std::vector<std::unique_ptr<IObjectRendererSystem>> m_render_systems;
 
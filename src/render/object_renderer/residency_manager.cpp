@@ -0,0 +1,277 @@
+#include "residency_manager.hpp"
+
+#include <algorithm>
+
+#include "imgui.h"
+
+#include "render/streaming/async_uploader.hpp"
+#include "resource_manager.hpp"
+
+namespace vke {
+
+// resources drawn within this many frames are never evicted, this keeps the camera turning around from causing thrashing
+constexpr u64 EVICTION_GRACE_FRAMES = 120;
+// the smallest mips of an image are always kept so there is something to sample
+constexpr u32 RESIDENT_MIP_TAIL = 6;
+
+size_t ResidencyManager::Entry::resident_byte_size() const {
+    if (state == ResidencyState::EVICTED) return 0;
+
+    // every mip is a quarter of the previous one
+    return full_byte_size >> (2 * skipped_mips);
+}
+
+ResourceResidency ResidencyManager::Entry::to_residency() const {
+    return ResourceResidency{
+        .state              = state,
+        .full_byte_size     = full_byte_size,
+        .resident_byte_size = resident_byte_size(),
+        .last_used_frame    = last_used_frame,
+        .skipped_mips       = skipped_mips,
+    };
+}
+
+ResidencyManager::ResidencyManager(ResourceManager* resource_manager, AsyncUploader* uploader) : m_resource_manager(resource_manager), m_uploader(uploader) {}
+
+ResidencyManager::~ResidencyManager() {}
+
+void ResidencyManager::register_mesh(MeshID id, size_t byte_size, MeshSource source) {
+    MeshEntry entry;
+    entry.state           = ResidencyState::RESIDENT;
+    entry.full_byte_size  = byte_size;
+    entry.last_used_frame = m_frame;
+    entry.source          = std::move(source);
+
+    m_meshes[id] = std::move(entry);
+}
+
+void ResidencyManager::register_image(ImageID id, size_t byte_size, u32 mip_count, ImageSource source) {
+    ImageEntry entry;
+    entry.state            = ResidencyState::RESIDENT;
+    entry.full_byte_size   = byte_size;
+    entry.last_used_frame  = m_frame;
+    entry.max_skipped_mips = mip_count > RESIDENT_MIP_TAIL ? mip_count - RESIDENT_MIP_TAIL : 0;
+    entry.source           = std::move(source);
+
+    m_images[id] = std::move(entry);
+}
+
+void ResidencyManager::mark_mesh_used(MeshID id) {
+    if (auto it = m_meshes.find(id); it != m_meshes.end()) {
+        it->second.last_used_frame = m_frame;
+    }
+}
+
+void ResidencyManager::mark_material_used(MaterialID id) {
+    auto* material = m_resource_manager->get_material(id);
+    if (material == nullptr) return;
+
+    for (auto image_id : material->images) {
+        if (auto it = m_images.find(image_id); it != m_images.end()) {
+            it->second.last_used_frame = m_frame;
+        }
+    }
+}
+
+bool ResidencyManager::is_recently_used(const Entry& entry) const {
+    return entry.last_used_frame + EVICTION_GRACE_FRAMES > m_frame;
+}
+
+void ResidencyManager::update() {
+    debug_menu();
+
+    collect_garbage();
+    restream_used();
+    evict_over_budget();
+
+    m_frame++;
+}
+
+void ResidencyManager::evict_over_budget() {
+    auto stats = get_stats();
+    if (stats.resident_bytes <= m_budget) return;
+
+    size_t resident_bytes = stats.resident_bytes;
+
+    struct Candidate {
+        u64 last_used_frame;
+        bool is_mesh;
+        u32 id;
+    };
+
+    std::vector<Candidate> candidates;
+    for (auto& [id, entry] : m_meshes) {
+        if (entry.state != ResidencyState::RESIDENT || is_recently_used(entry)) continue;
+        candidates.push_back({entry.last_used_frame, true, id.id});
+    }
+
+    for (auto& [id, entry] : m_images) {
+        bool is_reducable = entry.state == ResidencyState::RESIDENT || entry.state == ResidencyState::REDUCED;
+        if (!is_reducable || entry.skipped_mips >= entry.max_skipped_mips || is_recently_used(entry)) continue;
+        candidates.push_back({entry.last_used_frame, false, id.id});
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.last_used_frame < b.last_used_frame; });
+
+    for (auto& candidate : candidates) {
+        if (resident_bytes <= m_budget) break;
+
+        if (candidate.is_mesh) {
+            auto id     = MeshID(candidate.id);
+            auto& entry = m_meshes.at(id);
+
+            resident_bytes -= entry.resident_byte_size();
+            evict_mesh(id, entry);
+        } else {
+            // images lose one mip at a time, they may lose another one next frame if still over budget
+            auto id     = ImageID(candidate.id);
+            auto& entry = m_images.at(id);
+
+            size_t size = entry.resident_byte_size();
+            resident_bytes -= size - size / 4;
+            reduce_image(id, entry);
+        }
+    }
+}
+
+void ResidencyManager::restream_used() {
+    size_t resident_bytes = get_stats().resident_bytes;
+
+    for (auto& [id, entry] : m_meshes) {
+        // evicted meshes aren't drawn at all so they are streamed back regardless of the budget
+        if (entry.state != ResidencyState::EVICTED || entry.last_used_frame + 1 < m_frame) continue;
+
+        resident_bytes += entry.full_byte_size;
+        stream_mesh(id, entry);
+    }
+
+    for (auto& [id, entry] : m_images) {
+        if (entry.state != ResidencyState::REDUCED || entry.last_used_frame + 1 < m_frame) continue;
+
+        size_t extra_bytes = entry.full_byte_size - entry.resident_byte_size();
+        if (resident_bytes + extra_bytes > m_budget) continue;
+
+        resident_bytes += extra_bytes;
+        stream_image(id, entry, 0);
+    }
+}
+
+void ResidencyManager::collect_garbage() {
+    auto is_done = [&](auto& pair) { return pair.first + FRAME_OVERLAP + 1 <= m_frame; };
+
+    std::erase_if(m_mesh_graveyard, is_done);
+    std::erase_if(m_image_graveyard, is_done);
+}
+
+void ResidencyManager::evict_mesh(MeshID id, MeshEntry& entry) {
+    m_mesh_graveyard.emplace_back(m_frame, m_resource_manager->evict_mesh(id));
+
+    entry.state = ResidencyState::EVICTED;
+    m_evictions++;
+}
+
+void ResidencyManager::reduce_image(ImageID id, ImageEntry& entry) {
+    stream_image(id, entry, entry.skipped_mips + 1);
+    m_evictions++;
+}
+
+void ResidencyManager::stream_mesh(MeshID id, MeshEntry& entry) {
+    entry.state = ResidencyState::STREAMING;
+    m_restreams++;
+
+    auto mesh = std::make_shared<Mesh>();
+
+    m_uploader->enqueue(AsyncUploader::Job{
+        .byte_size = entry.full_byte_size,
+        .record    = [mesh, source = entry.source](vke::CommandBuffer& cmd) { *mesh = source(cmd); },
+        .on_complete =
+            [this, id, mesh] {
+                m_resource_manager->restore_mesh(id, std::move(*mesh));
+                m_meshes.at(id).state = ResidencyState::RESIDENT;
+            },
+    });
+}
+
+void ResidencyManager::stream_image(ImageID id, ImageEntry& entry, u32 skipped_mips) {
+    bool is_restream = skipped_mips < entry.skipped_mips;
+    if (is_restream) m_restreams++;
+
+    // the target size is accounted for while streaming
+    entry.state        = ResidencyState::STREAMING;
+    entry.skipped_mips = skipped_mips;
+
+    auto image = std::make_shared<std::unique_ptr<IImageView>>();
+
+    m_uploader->enqueue(AsyncUploader::Job{
+        .byte_size = entry.resident_byte_size(),
+        .record    = [image, skipped_mips, source = entry.source](vke::CommandBuffer& cmd) { *image = source(cmd, skipped_mips); },
+        .on_complete =
+            [this, id, image, skipped_mips] {
+                m_image_graveyard.emplace_back(m_frame, m_resource_manager->replace_image(id, std::move(*image)));
+                m_images.at(id).state = skipped_mips == 0 ? ResidencyState::RESIDENT : ResidencyState::REDUCED;
+            },
+    });
+}
+
+std::optional<ResourceResidency> ResidencyManager::query_mesh(MeshID id) const {
+    auto it = m_meshes.find(id);
+    if (it == m_meshes.end()) return std::nullopt;
+
+    return it->second.to_residency();
+}
+
+std::optional<ResourceResidency> ResidencyManager::query_image(ImageID id) const {
+    auto it = m_images.find(id);
+    if (it == m_images.end()) return std::nullopt;
+
+    return it->second.to_residency();
+}
+
+ResidencyStats ResidencyManager::get_stats() const {
+    ResidencyStats stats{
+        .budget         = m_budget,
+        .resident_bytes = 0,
+        .full_bytes     = 0,
+        .mesh_count     = static_cast<u32>(m_meshes.size()),
+        .image_count    = static_cast<u32>(m_images.size()),
+        .eviction_count = m_evictions,
+        .restream_count = m_restreams,
+    };
+
+    for (auto& [id, entry] : m_meshes) {
+        stats.resident_bytes += entry.resident_byte_size();
+        stats.full_bytes += entry.full_byte_size;
+        if (entry.state == ResidencyState::EVICTED) stats.evicted_mesh_count++;
+    }
+
+    for (auto& [id, entry] : m_images) {
+        stats.resident_bytes += entry.resident_byte_size();
+        stats.full_bytes += entry.full_byte_size;
+        if (entry.skipped_mips > 0) stats.reduced_image_count++;
+    }
+
+    return stats;
+}
+
+void ResidencyManager::debug_menu() {
+    if (ImGui::Begin("Residency", &m_menu_open)) {
+        constexpr double MIB = 1024.0 * 1024.0;
+
+        auto stats = get_stats();
+
+        int budget_mib = static_cast<int>(m_budget / (1024 * 1024));
+        if (ImGui::InputInt("budget (MiB)", &budget_mib, 64, 256)) {
+            m_budget = static_cast<size_t>(std::max(budget_mib, 0)) * 1024 * 1024;
+        }
+
+        ImGui::Text("resident: %.1f / %.1f MiB", stats.resident_bytes / MIB, stats.budget / MIB);
+        ImGui::Text("fully resident size: %.1f MiB", stats.full_bytes / MIB);
+        ImGui::Text("meshes: %u (%u evicted)", stats.mesh_count, stats.evicted_mesh_count);
+        ImGui::Text("images: %u (%u reduced)", stats.image_count, stats.reduced_image_count);
+        ImGui::Text("evictions: %lu, restreams: %lu", stats.eviction_count, stats.restream_count);
+        ImGui::Text("pending uploads: %lu", m_uploader->get_pending_job_count());
+    }
+    ImGui::End();
+}
+
+} // namespace vke
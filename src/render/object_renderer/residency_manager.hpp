@@ -0,0 +1,124 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <vke/fwd.hpp>
+
+#include "common.hpp"
+#include "fwd.hpp"
+#include "render/iobject_renderer.hpp"
+#include "render/mesh/mesh.hpp"
+
+namespace vke {
+
+enum class ResidencyState {
+    RESIDENT,
+    REDUCED,   // images only, some of the top mips are evicted
+    EVICTED,   // meshes only, nothing is on the gpu
+    STREAMING, // an upload is in flight
+};
+
+struct ResourceResidency {
+    ResidencyState state;
+    size_t full_byte_size;
+    size_t resident_byte_size;
+    u64 last_used_frame;
+    u32 skipped_mips; // always 0 for meshes
+};
+
+struct ResidencyStats {
+    size_t budget;
+    size_t resident_bytes;
+    size_t full_bytes; // what everything would take if it were fully resident
+    u32 mesh_count, evicted_mesh_count;
+    u32 image_count, reduced_image_count;
+    u64 eviction_count, restream_count;
+};
+
+// keeps the device memory used by streamed meshes and images under a budget.
+// resources are marked used from what the cull pass reports as drawn, the least recently used ones are evicted
+// when over budget and re-streamed through the async uploader once they are drawn again.
+// only resources registered with a source are managed, the source re-creates them from host memory
+class ResidencyManager {
+public:
+    using MeshSource = std::function<Mesh(vke::CommandBuffer& cmd)>;
+    // creates the image without its first skipped_mips mips
+    using ImageSource = std::function<std::unique_ptr<IImageView>(vke::CommandBuffer& cmd, u32 skipped_mips)>;
+
+    ResidencyManager(ResourceManager* resource_manager, AsyncUploader* uploader);
+    ~ResidencyManager();
+
+    void register_mesh(MeshID id, size_t byte_size, MeshSource source);
+    // mip_count is the mip count of the full image, a mip tail is always kept resident
+    void register_image(ImageID id, size_t byte_size, u32 mip_count, ImageSource source);
+
+    void mark_mesh_used(MeshID id);
+    void mark_material_used(MaterialID id);
+
+    // evicts over budget, re-streams what was used and frees resources that are no longer referenced by frames in flight.
+    // called once per frame
+    void update();
+
+    void set_budget(size_t bytes) { m_budget = bytes; }
+    size_t get_budget() const { return m_budget; }
+
+    std::optional<ResourceResidency> query_mesh(MeshID id) const;
+    std::optional<ResourceResidency> query_image(ImageID id) const;
+    ResidencyStats get_stats() const;
+
+private:
+    struct Entry {
+        ResidencyState state;
+        size_t full_byte_size;
+        u64 last_used_frame = 0;
+        u32 skipped_mips    = 0;
+        u32 max_skipped_mips = 0;
+
+        size_t resident_byte_size() const;
+        ResourceResidency to_residency() const;
+    };
+
+    struct MeshEntry : Entry {
+        MeshSource source;
+    };
+
+    struct ImageEntry : Entry {
+        ImageSource source;
+    };
+
+    void evict_over_budget();
+    void restream_used();
+    void collect_garbage();
+
+    void evict_mesh(MeshID id, MeshEntry& entry);
+    void reduce_image(ImageID id, ImageEntry& entry);
+    void stream_mesh(MeshID id, MeshEntry& entry);
+    void stream_image(ImageID id, ImageEntry& entry, u32 skipped_mips);
+
+    bool is_recently_used(const Entry& entry) const;
+
+    void debug_menu();
+
+private:
+    ResourceManager* m_resource_manager;
+    AsyncUploader* m_uploader;
+
+    std::unordered_map<MeshID, MeshEntry> m_meshes;
+    std::unordered_map<ImageID, ImageEntry> m_images;
+
+    // evicted gpu resources are kept until every frame that could have used them has finished
+    std::vector<std::pair<u64, Mesh>> m_mesh_graveyard;
+    std::vector<std::pair<u64, std::unique_ptr<IImageView>>> m_image_graveyard;
+
+    size_t m_budget  = size_t(1) << 30;
+    u64 m_frame      = 0;
+    u64 m_evictions  = 0;
+    u64 m_restreams  = 0;
+    bool m_menu_open = false;
+};
+
+} // namespace vke
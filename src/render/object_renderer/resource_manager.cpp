@@ -6,32 +6,64 @@
 
 #include "render/render_server.hpp"
 #include "render_state.hpp"
+#include "util/thread_pool.hpp"
 
 namespace vke {
 
 ResourceManager::ResourceManager(RenderServer* render_server) : m_render_server(render_server) {
 
-    m_material_set_layout = render_server->get_pipeline_loader()->get_pipeline_globals_provider()->set_layouts["vke::object_renderer::material_set"];
+    {
+        auto lock             = render_server->lock_pipeline_loader();
+        m_material_set_layout = render_server->get_pipeline_loader()->get_pipeline_globals_provider()->set_layouts["vke::object_renderer::material_set"];
+    }
 
     m_descriptor_pool = std::make_unique<vke::DescriptorPool>();
 
+    // anisotropic filtering is clamped to the limit of the device & disabled when it isn't supported
+    VkPhysicalDevice physical_device = VulkanContext::get_context()->get_physical_device();
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physical_device, &features);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    m_max_sampler_anisotropy = features.samplerAnisotropy ? properties.limits.maxSamplerAnisotropy : 1.f;
+
     create_null_texture(16);
 
-    VkSamplerCreateInfo sampler_info{
-        .sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-        .magFilter    = VK_FILTER_NEAREST,
-        .minFilter    = VK_FILTER_NEAREST,
-        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-    };
+    m_nearest_sampler = get_sampler(SamplerDescription{
+        .mag_filter     = VK_FILTER_NEAREST,
+        .min_filter     = VK_FILTER_NEAREST,
+        .mipmap_mode    = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .max_anisotropy = 1.f,
+        .use_mips       = false,
+    });
+
+    m_default_material_sampler = get_sampler(SamplerDescription{});
 
-    VK_CHECK(vkCreateSampler(device(), &sampler_info, nullptr, &m_nearest_sampler));
+    m_residency_manager = std::make_unique<ResidencyManager>(this, render_server->get_async_uploader());
 }
 
 ResourceManager::~ResourceManager() {
+    // pipelines that are still compiling may reference the material set layout
+    for (auto& [name, multi_pipeline] : m_multi_pipelines) {
+        multi_pipeline.resolve_all();
+    }
+
     vkDestroyDescriptorSetLayout(device(), m_material_set_layout, nullptr);
-    vkDestroySampler(device(), m_nearest_sampler, nullptr);
+    for (auto& [description, sampler] : m_samplers) {
+        vkDestroySampler(device(), sampler, nullptr);
+    }
+}
+
+VkSampler ResourceManager::get_sampler(const SamplerDescription& description) {
+    if (auto sampler = vke::at(m_samplers, description)) return sampler.value();
+
+    auto sampler_info = description.to_create_info(m_max_sampler_anisotropy);
+
+    VkSampler sampler;
+    VK_CHECK(vkCreateSampler(device(), &sampler_info, nullptr, &sampler));
+
+    m_samplers[description] = sampler;
+    return sampler;
 }
 
 void ResourceManager::create_multi_target_pipeline(const std::string& name, std::span<const std::string> pipeline_names) {
@@ -40,10 +72,7 @@ void ResourceManager::create_multi_target_pipeline(const std::string& name, std:
     };
 
     for (const auto& name : pipeline_names) {
-        auto pipeline = load_pipeline_cached(name);
-
-        auto subpass_name                      = std::string(pipeline->subpass_name());
-        multi_pipeline.pipelines[subpass_name] = std::move(pipeline);
+        multi_pipeline.pending_pipelines.push_back(load_pipeline_cached(name));
     }
 
     m_multi_pipelines[name] = std::move(multi_pipeline);
@@ -52,29 +81,22 @@ void ResourceManager::create_multi_target_pipeline(const std::string& name, std:
 void ResourceManager::add_pipeline2multi_pipeline(const std::string& multi_pipeline_name, const std::string& pipeline_name, const std::string& renderpass_name, std::span<const std::string> modifiers) {
     auto& multi_pipeline = m_multi_pipelines.at(multi_pipeline_name);
 
-    auto pipeline = load_pipeline_cached(pipeline_name);
-
-    auto subpass_name                      = std::string(pipeline->subpass_name());
-    multi_pipeline.pipelines[subpass_name] = std::move(pipeline);
+    multi_pipeline.pending_pipelines.push_back(load_pipeline_cached(pipeline_name));
 }
 
-MaterialID ResourceManager::create_material(const std::string& pipeline_name, std::vector<ImageID> images, const std::string& material_name) {
+MaterialID ResourceManager::create_material(const std::string& pipeline_name, std::vector<ImageID> images, const std::string& material_name, std::vector<VkSampler> samplers) {
     images.resize(4, m_null_texture_id);
+    samplers.resize(4, VK_NULL_HANDLE);
 
     Material m{
         .multi_pipeline = &m_multi_pipelines.at(pipeline_name),
         .material_set   = VK_NULL_HANDLE,
         .images         = images,
+        .samplers       = vke::map_vec(samplers, [&](VkSampler sampler) { return sampler != VK_NULL_HANDLE ? sampler : m_default_material_sampler; }),
         .name           = material_name,
     };
 
-    auto views = vke::map_vec(images, [&](auto& id) {
-        return std::pair(get_image(id), m_nearest_sampler);
-    });
-
-    vke::DescriptorSetBuilder builder;
-    builder.add_image_samplers(views, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_SHADER_STAGE_FRAGMENT_BIT);
-    m.material_set = builder.build(m_descriptor_pool.get(), m_material_set_layout);
+    m.material_set = build_material_set(m);
 
     auto id = MaterialID(m_material_id_manager.new_id());
 
@@ -88,6 +110,51 @@ MaterialID ResourceManager::create_material(const std::string& pipeline_name, st
     return id;
 }
 
+VkDescriptorSet ResourceManager::build_material_set(const Material& material) {
+    std::vector<std::pair<IImageView*, VkSampler>> views;
+    for (int i = 0; i < material.images.size(); i++) {
+        views.push_back(std::pair(get_image(material.images[i]), material.samplers[i]));
+    }
+
+    vke::DescriptorSetBuilder builder;
+    builder.add_image_samplers(views, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+    if (m_free_material_sets.empty()) return builder.build(m_descriptor_pool.get(), m_material_set_layout);
+
+    VkDescriptorSet set = m_free_material_sets.back();
+    m_free_material_sets.pop_back();
+
+    builder.update_set(set, m_material_set_layout);
+    return set;
+}
+
+void ResourceManager::retire_material_set(VkDescriptorSet set) {
+    m_material_set_graveyard.emplace_back(m_frame, set);
+}
+
+void ResourceManager::collect_garbage() {
+    std::erase_if(m_material_set_graveyard, [&](auto& pair) {
+        if (pair.first + FRAME_OVERLAP + 1 > m_frame) return false;
+
+        m_free_material_sets.push_back(pair.second);
+        return true;
+    });
+
+    m_frame++;
+}
+
+void ResourceManager::set_material_image(MaterialID id, u32 slot, ImageID image) {
+    auto& material = m_materials.at(id);
+    assert(slot < material.images.size());
+
+    material.images[slot] = image;
+    // the old set may still be used by frames in flight so it is replaced instead of updated
+    retire_material_set(material.material_set);
+    material.material_set = build_material_set(material);
+
+    m_updates.material_updates.push_back(id);
+}
+
 MeshID ResourceManager::create_mesh(Mesh mesh, const std::string& name) {
     auto id = MeshID(m_mesh_id_manager.new_id());
 
@@ -106,7 +173,7 @@ void ResourceManager::calculate_boundary(RenderModel& model) {
     using Part = RenderModel::Part;
 
     auto boundary = vke::fold(model.parts, AABB{}, [&](const AABB& a, const Part& b) {
-        return a.combined(get_mesh(b.mesh_id)->boundary);
+        return a.combined(get_mesh(b.mesh_id)->boundary.transformed(b.local_matrix));
     });
 
     model.boundary = boundary;
@@ -151,6 +218,38 @@ RenderModelID ResourceManager::create_model(const std::vector<std::pair<MeshID,
     return id;
 }
 
+RenderModelID ResourceManager::create_model(std::span<const RenderModel::Part> parts, const std::string& name) {
+    auto id = RenderModelID(m_render_model_id_manager.new_id());
+
+    RenderModel model = {
+        .parts = map_vec(parts, [](const RenderModel::Part& part) { return part; }),
+    };
+    calculate_boundary(model);
+    m_render_models[id] = std::move(model);
+
+    if (!name.empty()) {
+        bind_name2model(id, name);
+    }
+
+    m_updates.model_updates.push_back(id);
+    return id;
+}
+
+void ResourceManager::register_mesh_content(u64 hash, MeshID id) {
+    if (hash == 0) return;
+    m_mesh_content_ids.try_emplace(hash, id);
+}
+
+void ResourceManager::register_image_content(u64 hash, ImageID id) {
+    if (hash == 0) return;
+    m_image_content_ids.try_emplace(hash, id);
+}
+
+void ResourceManager::register_material_content(u64 hash, MaterialID id) {
+    if (hash == 0) return;
+    m_material_content_ids.try_emplace(hash, id);
+}
+
 void ResourceManager::bind_name2model(RenderModelID id, const std::string& name) {
     assert(!m_render_model_names2model_ids.contains(name) && "model name is already present");
 
@@ -171,6 +270,40 @@ ImageID ResourceManager::create_image(std::unique_ptr<IImageView> image_view, co
     return id;
 }
 
+Mesh ResourceManager::evict_mesh(MeshID id) {
+    auto& mesh = m_meshes.at(id);
+
+    Mesh evicted;
+    evicted.index_buffer   = std::move(mesh.index_buffer);
+    evicted.vertex_buffers = std::move(mesh.vertex_buffers);
+
+    mesh.vertex_buffers.clear();
+    mesh.update_vba();
+
+    return evicted;
+}
+
+void ResourceManager::restore_mesh(MeshID id, Mesh mesh) {
+    m_meshes.at(id) = std::move(mesh);
+    m_updates.mesh_updates.push_back(id);
+}
+
+std::unique_ptr<IImageView> ResourceManager::replace_image(ImageID id, std::unique_ptr<IImageView> image_view) {
+    auto old_image = std::exchange(m_images.at(id), std::move(image_view));
+
+    for (auto& [material_id, material] : m_materials) {
+        if (std::find(material.images.begin(), material.images.end(), id) == material.images.end()) continue;
+
+        // same as set_material_image, frames in flight keep the old set
+        retire_material_set(material.material_set);
+        material.material_set = build_material_set(material);
+        m_updates.material_updates.push_back(material_id);
+    }
+
+    m_updates.image_updates.push_back(id);
+    return old_image;
+}
+
 void ResourceManager::create_null_texture(int size) {
     auto image = std::make_unique<vke::Image>(ImageArgs{
         .format       = VK_FORMAT_R8G8B8A8_SRGB,
@@ -229,22 +362,57 @@ IImageView* ResourceManager::get_image(ImageID id) {
     }
 }
 
-RCResource<vke::IPipeline> ResourceManager::load_pipeline_cached(const std::string& name) {
+std::shared_future<RCResource<vke::IPipeline>> ResourceManager::load_pipeline_cached(const std::string& name) {
     auto val = vke::at(m_cached_pipelines, name);
     if (val.has_value()) return val.value();
 
-    RCResource<IPipeline> pipeline = m_render_server->get_pipeline_loader()->load(name.c_str());
-    m_cached_pipelines[name]       = pipeline;
+    auto* render_server = m_render_server;
+
+    std::shared_future<RCResource<IPipeline>> pipeline = m_render_server->get_thread_pool()->submit([render_server, name]() -> RCResource<IPipeline> {
+        return render_server->load_pipeline(name);
+    });
+
+    m_cached_pipelines[name] = pipeline;
 
     return pipeline;
 }
 
+IPipeline* ResourceManager::MultiPipeline::get_pipeline(const std::string& subpass_name) {
+    if (auto it = pipelines.find(subpass_name); it != pipelines.end()) {
+        return it->second.get();
+    }
+
+    while (!pending_pipelines.empty()) {
+        auto pipeline = pending_pipelines.front().get();
+        pending_pipelines.erase(pending_pipelines.begin());
+
+        auto pipeline_subpass_name = std::string(pipeline->subpass_name());
+        auto* ptr                  = pipeline.get();
+
+        pipelines[pipeline_subpass_name] = std::move(pipeline);
+
+        if (pipeline_subpass_name == subpass_name) return ptr;
+    }
+
+    return nullptr;
+}
+
+void ResourceManager::MultiPipeline::resolve_all() {
+    for (auto& future : pending_pipelines) {
+        auto pipeline = future.get();
+
+        pipelines[std::string(pipeline->subpass_name())] = std::move(pipeline);
+    }
+
+    pending_pipelines.clear();
+}
+
 bool ResourceManager::bind_mesh(BindState* state, MeshID id) {
     // BENCHMARK_FUNCTION();
 
     if (state->bound_mesh_id == id) return true;
 
-    if (auto it = m_meshes.find(id); it != m_meshes.end()) {
+    if (auto it = m_meshes.find(id); it != m_meshes.end() && !it->second.vertex_buffers.empty()) {
         state->mesh = &it->second;
     } else {
         LOG_ERROR("failed to bind mesh with id %d", id.id);
@@ -270,7 +438,11 @@ bool ResourceManager::bind_material(BindState* state, MaterialID id) {
         return false;
     }
 
-    auto pipeline = state->material->multi_pipeline->pipelines.at(state->rd_info->subpass_name).get();
+    auto pipeline = state->material->multi_pipeline->get_pipeline(state->rd_info->subpass_name);
+    if (pipeline == nullptr) {
+        LOG_ERROR("material %d has no pipeline for subpass %s", id.id, state->rd_info->subpass_name.c_str());
+        return false;
+    }
 
     if (state->bound_pipeline != pipeline) {
         state->bound_pipeline = pipeline;
@@ -289,7 +461,9 @@ ResourceManager::BindState ResourceManager::create_bindstate(vke::CommandBuffer&
 };
 
 void ResourceManager::load_multipipelines() {
-    auto pl = m_render_server->get_pipeline_loader();
+    // create_multi_target_pipeline only queues the loads, they share the lock with this loop
+    auto lock = m_render_server->lock_pipeline_loader_shared();
+    auto pl   = m_render_server->get_pipeline_loader();
     for (auto& pipeline_file : pl->get_pipeline_files()) {
         for (auto& multi_pipeline_detail : pipeline_file->multi_pipelines) {
             create_multi_target_pipeline(multi_pipeline_detail.name, multi_pipeline_detail.pipelines);
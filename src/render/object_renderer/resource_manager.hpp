@@ -1,17 +1,25 @@
 #pragma once
 
+#include "render/gltf_loader/asset_cache.hpp"
 #include "render/mesh/mesh.hpp"
+#include "render/object_renderer/residency_manager.hpp"
+#include "render/texture/texture_compression.hpp"
+#include "render/texture/texture_util.hpp"
 
 #include "common.hpp"
 
 #include "../iobject_renderer.hpp"
 #include "render/object_renderer/renderer_common.hpp"
+#include <future>
 #include <unordered_map>
 
 #include <vke/vke.hpp>
 
 namespace vke {
 
+// parts an instance can draw, has to match MAX_PARTS of scene_data.h
+constexpr u32 MAX_MODEL_PARTS = 64;
+
 struct RenderState;
 struct RenderTargetInfo;
 
@@ -38,9 +46,16 @@ public:
 
 public: // getters
     VkSampler get_nearest_sampler() { return m_nearest_sampler; }
+    // samplers are cached by their description and live as long as the resource manager
+    VkSampler get_sampler(const SamplerDescription& description);
     IImageView* get_null_texture() { return m_null_texture; }
+    ImageID get_null_texture_id() const { return m_null_texture_id; }
     VkDescriptorSetLayout get_material_set_layout() const { return m_material_set_layout; }
     UpdatedResources& get_updated_resource() { return m_updates; }
+    TextureCompressionSettings& get_texture_compression_settings() { return m_texture_compression_settings; }
+    AssetCacheSettings& get_asset_cache_settings() { return m_asset_cache_settings; }
+    LodSettings& get_lod_settings() { return m_lod_settings; }
+    ResidencyManager* get_residency_manager() { return m_residency_manager.get(); }
     // id getters
     RenderModelID get_model_id(const std::string& name) const { return m_render_model_names2model_ids.at(name); }
 
@@ -66,6 +81,11 @@ public: // getters
     }
 
     const Mesh* get_mesh(MeshID id) const { return vke::at_ptr(m_meshes, id); }
+    // evicted meshes keep their entry but have no buffers
+    bool is_mesh_resident(MeshID id) const {
+        auto* mesh = get_mesh(id);
+        return mesh != nullptr && !mesh->vertex_buffers.empty();
+    }
     const Mesh* get_mesh(const std::string& name) const {
         return vke::map_optional(try_get_mesh_id(name), [&](auto id) { return get_mesh(id); }).value_or(nullptr);
     }
@@ -78,12 +98,42 @@ public: // creation
     void create_multi_target_pipeline(const std::string& name, std::span<const std::string> pipelines);
     void add_pipeline2multi_pipeline(const std::string& multi_pipeline_name, const std::string& pipeline_name, const std::string& renderpass_name = "", std::span<const std::string> modifiers = {});
 
-    MaterialID create_material(const std::string& multi_pipeline_name, std::vector<ImageID> images = {}, const std::string& material_name = "");
+    // samplers default to the trilinear sampler for images that don't have one
+    MaterialID create_material(const std::string& multi_pipeline_name, std::vector<ImageID> images = {}, const std::string& material_name = "", std::vector<VkSampler> samplers = {});
     MeshID create_mesh(Mesh mesh, const std::string& name = "");
     RenderModelID create_model(MeshID mesh, MaterialID material, const std::string& name = "");
     RenderModelID create_model(const std::vector<std::pair<MeshID, MaterialID>>& parts, const std::string& name = "");
     ImageID create_image(std::unique_ptr<IImageView> image_view, const std::string& name = "");
 
+    // replaces an image of the material, used to swap in streamed images once they are resident
+    void set_material_image(MaterialID id, u32 slot, ImageID image);
+
+public: // content deduplication
+    // resources imported from different files are matched by the hash of their content, see MeshBuilder::content_hash & DecodedImage::content_hash
+    struct ContentDedupStats {
+        u32 reused_meshes = 0, reused_images = 0, reused_materials = 0;
+        u64 saved_mesh_bytes = 0, saved_image_bytes = 0;
+    };
+
+    std::optional<MeshID> find_mesh_by_content(u64 hash) const { return vke::at(m_mesh_content_ids, hash); }
+    std::optional<ImageID> find_image_by_content(u64 hash) const { return vke::at(m_image_content_ids, hash); }
+    // materials are matched by the ids of their images & their samplers, so that parts of different files share draw buckets
+    std::optional<MaterialID> find_material_by_content(u64 hash) const { return vke::at(m_material_content_ids, hash); }
+    // a hash of 0 means the content is unknown and is never registered
+    void register_mesh_content(u64 hash, MeshID id);
+    void register_image_content(u64 hash, ImageID id);
+    void register_material_content(u64 hash, MaterialID id);
+    ContentDedupStats& get_content_dedup_stats() { return m_content_dedup_stats; }
+
+public: // residency
+    // the returned resources may still be used by frames in flight, the caller has to keep them alive until those are finished
+    Mesh evict_mesh(MeshID id);
+    void restore_mesh(MeshID id, Mesh mesh);
+    std::unique_ptr<IImageView> replace_image(ImageID id, std::unique_ptr<IImageView> image_view);
+    // recycles the material sets that were replaced by set_material_image & replace_image once no frame in flight uses them.
+    // called once per frame
+    void collect_garbage();
+
     void bind_name2model(RenderModelID id, const std::string& name);
 
 public: // render state binding
@@ -97,16 +147,25 @@ public:
 
 private:
     void calculate_boundary(RenderModel& model);
+    VkDescriptorSet build_material_set(const Material& material);
+    void retire_material_set(VkDescriptorSet set);
     void create_null_texture(int size);
     void load_multipipelines();
 
-    RCResource<vke::IPipeline> load_pipeline_cached(const std::string& name);
+    // pipelines are compiled on the render server's thread pool. the returned future is shared between every multi pipeline that uses it
+    std::shared_future<RCResource<vke::IPipeline>> load_pipeline_cached(const std::string& name);
 
 public:
     struct RenderModel {
         struct Part {
             MeshID mesh_id;
             MaterialID material_id;
+            // the part is drawn while the error allowed for an instance is within [lod_error, lod_max_error).
+            // lod_max_error is the error of the next coarser lod of the same part
+            float lod_error     = 0.f;
+            float lod_max_error = INFINITY;
+            // placement of the part in the model, parts of flattened node trees keep their node transforms here
+            glm::mat4 local_matrix = glm::mat4(1.f);
         };
 
         vke::SmallVec<Part> parts;
@@ -114,15 +173,26 @@ public:
         AABB boundary;
     };
 
+    // declared after RenderModel since it takes its parts. the lods of a primitive are parts of their own
+    RenderModelID create_model(std::span<const RenderModel::Part> parts, const std::string& name = "");
+
     struct MultiPipeline {
         std::unordered_map<std::string, vke::RCResource<IPipeline>> pipelines;
+        // pipelines that are still being compiled. their subpass is unknown until they are resolved
+        std::vector<std::shared_future<vke::RCResource<IPipeline>>> pending_pipelines;
         std::string name;
+
+        // returns the pipeline for the subpass. pending pipelines are resolved in order until a match is found
+        // so only the pipelines up to the requested one are waited for
+        IPipeline* get_pipeline(const std::string& subpass_name);
+        void resolve_all();
     };
 
     struct Material {
         MultiPipeline* multi_pipeline;
         VkDescriptorSet material_set;
         vke::SmallVec<ImageID> images;
+        vke::SmallVec<VkSampler> samplers;
         std::string name;
     };
 
@@ -156,7 +226,12 @@ private:
     std::unordered_map<std::string, RenderModelID> m_render_model_names2model_ids;
     std::unordered_map<std::string, ImageID> m_image_names2image_ids;
 
-    std::unordered_map<std::string, vke::RCResource<vke::IPipeline>> m_cached_pipelines;
+    std::unordered_map<u64, MeshID> m_mesh_content_ids;
+    std::unordered_map<u64, ImageID> m_image_content_ids;
+    std::unordered_map<u64, MaterialID> m_material_content_ids;
+    ContentDedupStats m_content_dedup_stats;
+
+    std::unordered_map<std::string, std::shared_future<vke::RCResource<vke::IPipeline>>> m_cached_pipelines;
 
     // pointer stability is required since there are pointers to values of this container
     std::unordered_map<std::string, MultiPipeline> m_multi_pipelines;
@@ -165,9 +240,22 @@ private:
 
     std::unique_ptr<vke::DescriptorPool> m_descriptor_pool;
 
+    // replaced material sets are kept until every frame that could have used them has finished, then they are rewritten for new sets
+    std::vector<std::pair<u64, VkDescriptorSet>> m_material_set_graveyard;
+    std::vector<VkDescriptorSet> m_free_material_sets;
+    u64 m_frame = 0;
+
     VkDescriptorSetLayout m_material_set_layout;
 
     VkSampler m_nearest_sampler;
+    VkSampler m_default_material_sampler;
+    std::unordered_map<SamplerDescription, VkSampler> m_samplers;
+    float m_max_sampler_anisotropy = 1.f;
+
+    TextureCompressionSettings m_texture_compression_settings;
+    AssetCacheSettings m_asset_cache_settings;
+    LodSettings m_lod_settings;
+    std::unique_ptr<ResidencyManager> m_residency_manager;
 
     IImageView* m_null_texture = nullptr;
     ImageID m_null_texture_id;
@@ -1,5 +1,8 @@
 #include "scene_buffers_manager.hpp"
 
+#include <algorithm>
+
+#include <glm/geometric.hpp>
 
 #include <flecs.h>
 #include <flecs/addons/flecs_cpp.h>
@@ -11,7 +14,9 @@
 
 namespace vke {
 
-SceneBuffersManager::SceneBuffersManager(RenderServer* render_server, ResourceManager* resource_manager) : m_model_part_buffer_sub_allocator(part_capacity) {
+static_assert(MAX_MODEL_PARTS == MAX_PARTS);
+
+SceneBuffersManager::SceneBuffersManager(RenderServer* render_server, ResourceManager* resource_manager) : m_model_part_buffer_sub_allocator(part_capacity), m_meshlet_sub_allocator(meshlet_capacity), m_group_instance_sub_allocator(group_instance_capacity) {
     m_render_server    = render_server;
     m_resource_manager = resource_manager;
 
@@ -22,9 +27,17 @@ SceneBuffersManager::SceneBuffersManager(RenderServer* render_server, ResourceMa
     m_material_info_buffer   = std::make_unique<vke::Buffer>(buffer_usage, sizeof(MaterialData) * material_capacity, false);
     m_instance_buffer        = std::make_unique<vke::GrowableBuffer>(buffer_usage, sizeof(InstanceData) * instance_capacity, false);
     m_mesh_info_buffer       = std::make_unique<vke::Buffer>(buffer_usage, sizeof(MeshData) * mesh_capacity, false);
+    m_meshlet_buffer         = std::make_unique<vke::Buffer>(buffer_usage, sizeof(MeshletData) * meshlet_capacity, false);
+    m_group_instance_buffer  = std::make_unique<vke::GrowableBuffer>(buffer_usage, sizeof(InstanceData) * instance_capacity, false);
 }
 
 SceneBuffersManager::~SceneBuffersManager() {
+    if (m_world) m_dynamic_tag_observer.destruct();
+}
+
+u32 SceneBuffersManager::get_mesh_meshlet_count(MeshID id) const {
+    auto it = m_mesh_meshlet_allocations.find(id);
+    return it == m_mesh_meshlet_allocations.end() ? 0 : it->second.size;
 }
 
 auto create_model_matrix_getter(flecs::world* registry) {
@@ -55,39 +68,135 @@ auto create_model_matrix_getter(flecs::world* registry) {
 
 static glm::vec4 quat2vec4(const glm::quat& q) { return glm::vec4(q.x, q.y, q.z, q.w); }
 
+static InstanceData create_instance_data(const glm::mat4& model_matrix, RenderModelID model_id, bool is_dynamic) {
+    auto t = Transform::decompose_from_matrix(model_matrix);
+
+    return InstanceData{
+        .world_position = glm::dvec4(t.position, 0.0),
+        .rotation       = glm::vec4(quat2vec4(t.rotation)),
+        .size           = t.scale,
+        .model_id       = model_id.id | (is_dynamic ? INSTANCE_FLAG_DYNAMIC : 0u),
+    };
+}
+
+// instances with consecutive ids are uploaded with a single copy
+static void copy_instance_runs(StencilBuffer& stencil, vke::GrowableBuffer& instance_buffer, std::span<const std::pair<u32, InstanceData>> instances) {
+    std::vector<InstanceData> run;
+
+    for (u32 i = 0; i < instances.size();) {
+        u32 run_start = instances[i].first;
+
+        run.clear();
+        for (; i < instances.size() && instances[i].first == run_start + run.size(); i++) {
+            run.push_back(instances[i].second);
+        }
+
+        u32 run_end = run_start + run.size();
+        if (run_end > instance_buffer.item_size<InstanceData>()) {
+            u32 new_capacity = std::max(run_end, static_cast<u32>(instance_buffer.item_size<InstanceData>() * 3 / 2));
+            instance_buffer.resize(new_capacity * sizeof(InstanceData));
+        }
+
+        stencil.copy_data(instance_buffer.subspan_item<InstanceData>(run_start, run.size()), std::span<const InstanceData>(run));
+    }
+}
+
 void SceneBuffersManager::flush_pending_entities(vke::CommandBuffer& cmd, StencilBuffer& stencil) {
     auto model_matrix_getter = create_model_matrix_getter(m_world);
 
-    auto instance_capacity = m_instance_buffer->item_size<InstanceData>();
+    // handles of entities created together are consecutive
+    std::vector<std::pair<u32, InstanceData>> instances;
 
-    m_handle_manager->flush_and_register_handles([&](flecs::entity entity,InstanceHandleID instance_id){
-        auto model_id   = entity.get<Renderable>()->model_id;
+    m_handle_manager->flush_and_register_handles([&](flecs::entity entity, InstanceHandleID instance_id) {
+        auto model_id = entity.get<Renderable>()->model_id;
         m_model_instance_counters[model_id] += 1;
 
-        auto model_matrix = model_matrix_getter(entity);
-        auto t            = Transform::decompose_from_matrix(model_matrix);
+        bool is_dynamic = entity.has<DynamicRenderable>();
+        if (!is_dynamic) m_static_revision++;
 
-        InstanceData instance_data = {
-            .world_position = glm::dvec4(t.position, 0.0),
-            .rotation       = glm::vec4(quat2vec4(t.rotation)),
-            .size           = t.scale,
-            .model_id       = model_id.id,
-        };
-        
-        if (instance_id.id >= instance_capacity) {
-            auto* instance_buffer = m_instance_buffer.get();
-            instance_buffer->resize((instance_buffer->byte_size() * 3) / 2);
-            instance_capacity = instance_buffer->item_size<InstanceData>();
+        instances.emplace_back(instance_id.id, create_instance_data(model_matrix_getter(entity), model_id, is_dynamic));
+
+        m_entity_instance_count = std::max(m_entity_instance_count, instance_id.id + 1);
+    });
+
+    copy_instance_runs(stencil, *m_instance_buffer, instances);
+}
+
+void SceneBuffersManager::flush_dynamic_entities(StencilBuffer& stencil) {
+    auto model_matrix_getter = create_model_matrix_getter(m_world);
+
+    std::vector<std::pair<u32, InstanceData>> instances;
+
+    m_dynamic_query.each([&](flecs::entity entity, const Renderable& renderable) {
+        // entities without a handle yet are uploaded by flush_pending_entities
+        auto handle = m_handle_manager->get_handle(entity);
+        if (!handle.has_value()) return;
+
+        instances.emplace_back(handle->id, create_instance_data(model_matrix_getter(entity), renderable.model_id, true));
+    });
+
+    copy_instance_runs(stencil, *m_instance_buffer, instances);
+}
+
+void SceneBuffersManager::flush_pending_instance_groups(StencilBuffer& stencil) {
+    auto model_matrix_getter = create_model_matrix_getter(m_world);
+
+    m_group_handle_manager->flush_and_register_handles([&](flecs::entity entity, auto) {
+        auto* group = entity.get<InstanceGroup>();
+        if (group->transforms == nullptr || group->transforms->empty()) return;
+
+        auto& transforms = *group->transforms;
+
+        auto allocation = m_group_instance_sub_allocator.allocate(transforms.size());
+        if (!allocation.has_value()) {
+            LOG_WARNING("group instance buffer is full, an instance group of %lu instances isn't drawn", transforms.size());
+            return;
         }
 
-        stencil.copy_data(m_instance_buffer->subspan_item<InstanceData>(instance_id.id, 1), &instance_data, 1);
+        m_model_instance_counters[group->model_id] += transforms.size();
+        m_static_revision++;
+
+        auto group_matrix = model_matrix_getter(entity);
+
+        auto instances = map_vec(transforms, [&](const RelativeTransform& transform) {
+            return create_instance_data(group_matrix * transform.get_model_matrix(), group->model_id, false);
+        });
+
+        u32 instance_end = allocation->offset + allocation->size;
+        if (instance_end > m_group_instance_buffer->item_size<InstanceData>()) {
+            u32 new_capacity = std::max(instance_end, static_cast<u32>(m_group_instance_buffer->item_size<InstanceData>() * 3 / 2));
+            m_group_instance_buffer->resize(std::min(new_capacity, group_instance_capacity) * sizeof(InstanceData));
+        }
+
+        // the whole group is a single copy
+        stencil.copy_data(m_group_instance_buffer->subspan_item<InstanceData>(allocation->offset, allocation->size), std::span<const InstanceData>(instances));
     });
 }
 
+VirtualAllocator::Allocation SceneBuffersManager::allocate_meshlets(MeshID id, u32 meshlet_count) {
+    if (meshlet_count == 0) return VirtualAllocator::Allocation{};
+
+    // meshes are rebuilt from the same builder after an eviction so the previous allocation fits
+    if (auto it = m_mesh_meshlet_allocations.find(id); it != m_mesh_meshlet_allocations.end() && it->second.size == meshlet_count) {
+        return it->second;
+    }
+
+    auto allocation = m_meshlet_sub_allocator.allocate(meshlet_count);
+    if (!allocation.has_value()) {
+        LOG_WARNING("meshlet buffer is full, mesh %d is drawn without cluster culling", id.id);
+        m_mesh_meshlet_allocations.erase(id);
+        return VirtualAllocator::Allocation{};
+    }
+
+    m_mesh_meshlet_allocations[id] = allocation.value();
+    return allocation.value();
+}
+
 void SceneBuffersManager::updates_for_indirect_render(vke::CommandBuffer& cmd) {
     assert(m_world != nullptr && "registry can not be null");
     
     auto& resource_updates = m_resource_manager->get_updated_resource();
+    if (resource_updates.model_updates.size() > 0 || resource_updates.mesh_updates.size() > 0) m_static_revision++;
 
     StencilBuffer stencil;
 
@@ -108,9 +217,16 @@ void SceneBuffersManager::updates_for_indirect_render(vke::CommandBuffer& cmd) {
         stencil.copy_data(m_model_info_buffer->subspan_item<ModelData>(model_id.id, 1), &model_data, 1);
 
         auto parts = map_vec2small_vec(model->parts, [&](const ResourceManager::RenderModel::Part& part) {
+            // lod errors are in the units of the mesh, the cull shader compares them in the units of the model
+            auto& m           = part.local_matrix;
+            float local_scale = std::max({glm::length(glm::vec3(m[0])), glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))});
+
             return PartData{
-                .mesh_id     = part.mesh_id.id,
-                .material_id = part.material_id.id,
+                .mesh_id       = part.mesh_id.id,
+                .material_id   = part.material_id.id,
+                .lod_error     = part.lod_error * local_scale,
+                .lod_max_error = part.lod_max_error * local_scale,
+                .local_matrix  = part.local_matrix,
             };
         });
 
@@ -126,15 +242,42 @@ void SceneBuffersManager::updates_for_indirect_render(vke::CommandBuffer& cmd) {
     for (auto mesh_id : resource_updates.mesh_updates) {
         auto* mesh = m_resource_manager->get_mesh(mesh_id);
 
+        auto& encoding = mesh->encoding;
+
+        auto meshlet_allocation = allocate_meshlets(mesh_id, mesh->meshlets.size());
+        if (meshlet_allocation.size > 0) {
+            auto meshlets = map_vec(mesh->meshlets, [](const Meshlet& meshlet) {
+                return MeshletData{
+                    .sphere          = vec4(meshlet.center, meshlet.radius),
+                    .cone            = vec4(meshlet.cone_axis, meshlet.cone_cutoff),
+                    .triangle_offset = meshlet.triangle_offset,
+                    .triangle_count  = meshlet.triangle_count,
+                };
+            });
+
+            stencil.copy_data(m_meshlet_buffer->subspan_item<MeshletData>(meshlet_allocation.offset, meshlet_allocation.size), std::span<const MeshletData>(meshlets));
+        }
+
         MeshData mesh_data = {
-            .index_offset = 0,
-            .index_count  = mesh->index_count,
+            .index_offset    = 0,
+            .index_count     = mesh->index_count,
+            .position_offset = vec4(encoding.position_offset, 0.f),
+            .position_scale  = vec4(encoding.position_scale, 0.f),
+            .uv_transform    = vec4(encoding.uv_offset, encoding.uv_scale),
+            .vertex_flags    = encoding.shader_flags(),
+            .meshlet_offset  = meshlet_allocation.offset,
+            .meshlet_count   = meshlet_allocation.size,
         };
 
         stencil.copy_data(m_mesh_info_buffer->subspan_item<MeshData>(mesh_id.id, 1), &mesh_data, 1);
     }
 
+    // before the pending entities so that the new dynamic ones aren't uploaded twice
+    flush_dynamic_entities(stencil);
     flush_pending_entities(cmd, stencil);
+    flush_pending_instance_groups(stencil);
+
+    m_dynamic_instance_count = m_dynamic_query.count();
 
     resource_updates.reset();
 
@@ -181,6 +324,22 @@ void SceneBuffersManager::updates_for_indirect_render(vke::CommandBuffer& cmd) {
             .offset = 0,
             .size = VK_WHOLE_SIZE,
         },
+        VkBufferMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .buffer = m_meshlet_buffer->handle(),
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        },
+        VkBufferMemoryBarrier{
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .buffer = m_group_instance_buffer->handle(),
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        },
     };
 
     cmd.pipeline_barrier(PipelineBarrierArgs{
@@ -193,6 +352,10 @@ void SceneBuffersManager::updates_for_indirect_render(vke::CommandBuffer& cmd) {
 void SceneBuffersManager::set_world(flecs::world* world) {
     m_world = world;
 
-    m_handle_manager = std::make_unique<GPUHandleIDManager<Renderable>>(world);
+    m_handle_manager       = std::make_unique<GPUHandleIDManager<Renderable>>(world);
+    m_group_handle_manager = std::make_unique<GPUHandleIDManager<InstanceGroup>>(world);
+
+    m_dynamic_query        = world->query_builder<const Renderable>().with<DynamicRenderable>().build();
+    m_dynamic_tag_observer = world->observer().with<DynamicRenderable>().event(flecs::OnAdd).each([this](flecs::entity) { m_static_revision++; });
 }
 } // namespace vke
\ No newline at end of file
@@ -20,6 +20,9 @@ constexpr u32 material_capacity      = 1 << 10;
 constexpr u32 instance_capacity      = 1 << 15;
 constexpr u32 mesh_capacity          = 1 << 10;
 constexpr u32 indirect_draw_capacity = 1 << 10;
+constexpr u32 meshlet_capacity       = 1 << 18;
+// instances of every InstanceGroup, the buffer grows on demand up to this
+constexpr u32 group_instance_capacity = 1 << 22;
 
 // this class manages buffers for indirect rendering data
 class SceneBuffersManager {
@@ -41,15 +44,31 @@ public: // getters
     vke::IBuffer* get_material_info_buffer() { return m_material_info_buffer.get(); }
     vke::IBuffer* get_mesh_info_buffer() { return m_mesh_info_buffer.get(); }
     vke::IBuffer* get_instance_data_buffer() { return m_instance_buffer.get(); }
+    vke::IBuffer* get_meshlet_buffer() { return m_meshlet_buffer.get(); }
+    vke::IBuffer* get_group_instance_buffer() { return m_group_instance_buffer.get(); }
+
+    // instances are culled as entity instances [0, entity_count) followed by group instances [0, group_count)
+    u32 get_entity_instance_count() const { return m_entity_instance_count; }
+    u32 get_group_instance_count() const { return m_group_instance_sub_allocator.max_id(); }
 
     u32 get_part_max_id() const { return m_model_part_buffer_sub_allocator.max_id(); }
 
+    // see IObjectRendererSystem::get_static_revision
+    u64 get_static_revision() const { return m_static_revision; }
+    u32 get_dynamic_instance_count() const { return m_dynamic_instance_count; }
+
     const std::unordered_map<RenderModelID, i32>& get_model_instance_counters() const { return m_model_instance_counters; }
     const auto& get_model_part_sub_allocations() const { return m_model_part_sub_allocations; }
+    // meshlets uploaded for the mesh, 0 when it has none or they didn't fit into the meshlet buffer
+    u32 get_mesh_meshlet_count(MeshID id) const;
 
     // entt::registry* get_registry() const { return m_registry; }
 private:
     void flush_pending_entities(vke::CommandBuffer& cmd, StencilBuffer& stencil);
+    // uploads the instances of DynamicRenderable entities again
+    void flush_dynamic_entities(StencilBuffer& stencil);
+    void flush_pending_instance_groups(StencilBuffer& stencil);
+    VirtualAllocator::Allocation allocate_meshlets(MeshID id, u32 meshlet_count);
 
 private:
 private:
@@ -64,9 +83,25 @@ private:
 
     // stores instance specific data
     std::unique_ptr<vke::GrowableBuffer> m_instance_buffer;
+    u32 m_entity_instance_count = 0;
+
+    u64 m_static_revision        = 0;
+    u32 m_dynamic_instance_count = 0;
+    flecs::query<const Renderable> m_dynamic_query;
+    // entities that become dynamic after they were uploaded are in the caches of static instances
+    flecs::observer m_dynamic_tag_observer;
+
+    // instances of InstanceGroups, every group is a single allocation in instances
+    std::unique_ptr<vke::GrowableBuffer> m_group_instance_buffer;
+    VirtualAllocator m_group_instance_sub_allocator;
 
     std::unique_ptr<vke::Buffer> m_mesh_info_buffer;
 
+    std::unique_ptr<vke::Buffer> m_meshlet_buffer;
+    // allocations are done in meshlets. meshes that are uploaded again keep their allocation
+    VirtualAllocator m_meshlet_sub_allocator;
+    std::unordered_map<MeshID, VirtualAllocator::Allocation> m_mesh_meshlet_allocations;
+
     std::unordered_map<RenderModelID, i32> m_model_instance_counters;
 
     flecs::world* m_world               = nullptr;
@@ -74,6 +109,7 @@ private:
     ResourceManager* m_resource_manager = nullptr;
 
     std::unique_ptr<GPUHandleIDManager<Renderable>> m_handle_manager;
+    std::unique_ptr<GPUHandleIDManager<InstanceGroup>> m_group_handle_manager;
 };
 
 } // namespace vke
\ No newline at end of file
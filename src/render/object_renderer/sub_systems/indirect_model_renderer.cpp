@@ -13,6 +13,7 @@
 
 #include "render/debug/gpu_timing_system.hpp"
 #include "render/shader/scene_data.h"
+#include "util/thread_pool.hpp"
 
 namespace vke {
 
@@ -37,27 +38,48 @@ void IndirectModelRenderer::debug_menu() {
     }
 
     if (ImGui::Begin("IndirectModelRenderer", &m_debug_menu_data->menu_open)) {
-        m_query_indirect_render_counters = true;
+        ImGui::Checkbox("cluster culling", &m_cluster_culling_enabled);
 
         ImGui::Text("Stats");
         for (const auto& [rd_name, data] : m_indirect_render_buffers) {
-            u64 sum       = 0;
-            auto counters = data.host_instance_count_buffers[m_render_server->get_frame_index()]->mapped_data_as_span<u32>();
-            for (auto counter : counters) {
-                sum += counter;
+            u64 sum = get_drawn_instance_count(rd_name);
+
+            u64 cluster_sum = 0;
+            for (auto counter : data.host_cluster_count_buffers[m_render_server->get_frame_index()]->mapped_data_as_span<u32>()) {
+                cluster_sum += counter;
             }
 
-            ImGui::Text("render target \"%s\": %ld", rd_name.c_str(), sum);
+            ImGui::Text("render target \"%s\": %ld instances, %ld meshlets, %ld occlusion culled", rd_name.c_str(), sum, cluster_sum, get_occlusion_culled_instance_count(rd_name));
         }
-
-    } else {
-        m_query_indirect_render_counters = false;
     }
     ImGui::End();
 }
 
 IndirectModelRenderer::~IndirectModelRenderer() {}
 
+u64 IndirectModelRenderer::get_static_revision() const { return m_scene_data->get_static_revision(); }
+
+u32 IndirectModelRenderer::get_dynamic_instance_count() const { return m_scene_data->get_dynamic_instance_count(); }
+
+u64 IndirectModelRenderer::get_drawn_instance_count(const std::string& render_target_name) const {
+    auto it = m_indirect_render_buffers.find(render_target_name);
+    if (it == m_indirect_render_buffers.end()) return 0;
+
+    u64 sum = 0;
+    for (auto counter : it->second.host_instance_count_buffers[m_render_server->get_frame_index()]->mapped_data_as_span<u32>()) {
+        sum += counter;
+    }
+
+    return sum;
+}
+
+u64 IndirectModelRenderer::get_occlusion_culled_instance_count(const std::string& render_target_name) const {
+    auto it = m_indirect_render_buffers.find(render_target_name);
+    if (it == m_indirect_render_buffers.end()) return 0;
+
+    return it->second.host_cull_stats_buffers[m_render_server->get_frame_index()]->mapped_data_as_span<u32>()[0];
+}
+
 void IndirectModelRenderer::register_render_target(const std::string& render_target_name) {
     initialize_irb(m_indirect_render_buffers[render_target_name]);
 }
@@ -68,7 +90,31 @@ void IndirectModelRenderer::initialize_scene_data() {
     m_scene_data = std::make_unique<SceneBuffersManager>(m_render_server, m_object_renderer->get_resource_manager());
 }
 
+void IndirectModelRenderer::mark_drawn_resources(IndirectRenderBuffers& draw_data) {
+    auto* resource_manager  = m_object_renderer->get_resource_manager();
+    auto* residency_manager = resource_manager->get_residency_manager();
+
+    // the counters were written FRAME_OVERLAP frames ago, the frame fence guarantees they are visible on the host by now
+    auto counters = draw_data.host_instance_count_buffers[m_render_server->get_frame_index()]->mapped_data_as_span<u32>();
+
+    for (auto& [model_id, instance_count] : m_scene_data->get_model_instance_counters()) {
+        auto* model = resource_manager->get_model(model_id);
+        if (model == nullptr) continue;
+
+        auto& model_parts = m_scene_data->get_model_part_sub_allocations().at(model_id);
+
+        for (u32 i = 0; i < model->parts.size(); i++) {
+            u32 part_id = model_parts.offset + i;
+            if (part_id >= counters.size() || counters[part_id] == 0) continue;
+
+            residency_manager->mark_mesh_used(model->parts[i].mesh_id);
+            residency_manager->mark_material_used(model->parts[i].material_id);
+        }
+    }
+}
+
 void IndirectModelRenderer::render(RenderArguments& args) {
+    // there are no mesh shader pipelines yet, meshlets are drawn by the indirect count draws of the cluster cull
     bool mesh_shaders_enabled = false;
 
     auto ctx                        = VulkanContext::get_context();
@@ -85,6 +131,7 @@ void IndirectModelRenderer::render(RenderArguments& args) {
     struct PartEntry {
         u32 part_id;
         MeshID mesh_id;
+        bool is_cluster_culled;
     };
 
     std::unordered_map<MaterialID, SmallVec<PartEntry>> material_part_ids;
@@ -92,6 +139,8 @@ void IndirectModelRenderer::render(RenderArguments& args) {
 
     auto* draw_data = &m_indirect_render_buffers.at(args.render_target_name);
 
+    mark_drawn_resources(*draw_data);
+
     u32 total_instance_counter   = 0;
     auto allocate_instance_space = [&](u32 instance_count) {
         u32 index = total_instance_counter;
@@ -99,7 +148,15 @@ void IndirectModelRenderer::render(RenderArguments& args) {
         return glm::uvec2(index, instance_count);
     };
 
+    u32 total_cluster_counter   = 0;
+    auto allocate_cluster_space = [&](u32 cluster_count) {
+        u32 index = total_cluster_counter;
+        total_cluster_counter += cluster_count;
+        return glm::uvec2(index, cluster_count);
+    };
+
     auto instance_offsets = draw_data->instance_draw_parameter_location_buffer[m_render_server->get_frame_index()]->mapped_data_as_span<glm::uvec2>();
+    auto cluster_offsets  = draw_data->cluster_draw_location_buffer[m_render_server->get_frame_index()]->mapped_data_as_span<glm::uvec2>();
 
     for (auto& [model_id, instance_count] : m_scene_data->get_model_instance_counters()) {
         assert(instance_count > 0);
@@ -119,18 +176,30 @@ void IndirectModelRenderer::render(RenderArguments& args) {
 
             u32 part_id = model_parts.offset + i;
 
+            instance_offsets[part_id] = allocate_instance_space(instance_count);
+            cluster_offsets[part_id]  = glm::uvec2(0, 0);
+
+            // parts of evicted meshes are still culled so that their counters keep the mesh marked as used,
+            // they just don't get an indirect draw until the mesh is streamed back in
+            if (!resource_manager->is_mesh_resident(part.mesh_id)) continue;
+
+            // every instance slot of the part can draw each of its meshlets
+            u32 meshlet_count      = m_cluster_culling_enabled ? m_scene_data->get_mesh_meshlet_count(part.mesh_id) : 0;
+            bool is_cluster_culled = meshlet_count > 0;
+            if (is_cluster_culled) cluster_offsets[part_id] = allocate_cluster_space(instance_count * meshlet_count);
+
             material_part_ids[part.material_id].push_back({
-                .part_id = part_id,
-                .mesh_id = part.mesh_id,
+                .part_id           = part_id,
+                .mesh_id           = part.mesh_id,
+                .is_cluster_culled = is_cluster_culled,
             });
-
-            instance_offsets[part_id] = allocate_instance_space(instance_count);
         }
     }
 
     struct Push {
         mat4 pad[2];
         uint32_t mode;
+        uint32_t mesh_id; // selects the vertex decode in the shader
     };
 
     Push push = {
@@ -148,25 +217,38 @@ void IndirectModelRenderer::render(RenderArguments& args) {
 
     auto indirect_draw_buffer = draw_data->indirect_draw_buffer.get();
 
+    // the draws below record the handle, so the buffer has to be large enough before recording them
+    if (total_cluster_counter > draw_data->cluster_draw_buffer->item_size<VkDrawIndexedIndirectCommand>()) {
+        draw_data->cluster_draw_buffer->resize(total_cluster_counter * sizeof(VkDrawIndexedIndirectCommand));
+    }
+
     u32 total_indirect_draws = 0;
     for (auto& [material_id, parts] : material_part_ids) {
         resource_manager->bind_material(&bind_state, material_id);
 
-        cmd.push_constant(&push);
-
         for (u32 i = 0, parts_size = parts.size(); i < parts_size; i++) {
-            auto& part              = parts[i];
-            u32 part_id             = part.part_id;
-            u32 indirect_draw_index = total_indirect_draws + i;
+            auto& part  = parts[i];
+            u32 part_id = part.part_id;
 
             resource_manager->bind_mesh(&bind_state, part.mesh_id);
 
-            indirect_draw_location[part_id] = indirect_draw_index;
+            push.mesh_id = part.mesh_id.id;
+            cmd.push_constant(&push);
 
-            cmd.draw_indexed_indirect(indirect_draw_buffer->subspan_item<VkDrawIndexedIndirectCommand>(indirect_draw_index, 1), 1);
+            if (part.is_cluster_culled) {
+                // the cluster cull writes a draw per visible meshlet and counts them per part
+                auto cluster_offset = cluster_offsets[part_id];
+                vkCmdDrawIndexedIndirectCount(cmd.handle(), draw_data->cluster_draw_buffer->handle(), cluster_offset.x * sizeof(VkDrawIndexedIndirectCommand), //
+                                              draw_data->cluster_count_buffer->handle(), part_id * sizeof(u32), cluster_offset.y, sizeof(VkDrawIndexedIndirectCommand));
+                continue;
+            }
+
+            indirect_draw_location[part_id] = total_indirect_draws;
+
+            cmd.draw_indexed_indirect(indirect_draw_buffer->subspan_item<VkDrawIndexedIndirectCommand>(total_indirect_draws, 1), 1);
+            total_indirect_draws++;
         }
 
-        total_indirect_draws += parts.size();
         assert(total_indirect_draws <= indirect_draw_capacity);
     }
 
@@ -176,6 +258,8 @@ void IndirectModelRenderer::render(RenderArguments& args) {
     timer->timestamp(compute_cmd, std::format("cull start for render target: {}", args.render_target_name), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
     compute_cmd.fill_buffer(*draw_data->instance_count_buffer, 0);
+    compute_cmd.fill_buffer(*draw_data->cluster_count_buffer, 0);
+    compute_cmd.fill_buffer(*draw_data->cull_stats_buffer, 0);
 
     VkBufferMemoryBarrier buffer_barriers0[] = {
         VkBufferMemoryBarrier{
@@ -186,6 +270,22 @@ void IndirectModelRenderer::render(RenderArguments& args) {
             .offset        = 0,
             .size          = VK_WHOLE_SIZE,
         },
+        VkBufferMemoryBarrier{
+            .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+            .buffer        = draw_data->cluster_count_buffer->handle(),
+            .offset        = 0,
+            .size          = VK_WHOLE_SIZE,
+        },
+        VkBufferMemoryBarrier{
+            .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+            .buffer        = draw_data->cull_stats_buffer->handle(),
+            .offset        = 0,
+            .size          = VK_WHOLE_SIZE,
+        },
     };
 
     compute_cmd.pipeline_barrier({
@@ -204,9 +304,23 @@ void IndirectModelRenderer::render(RenderArguments& args) {
         draw_data->instance_draw_parameters->resize(total_instance_counter * sizeof(InstanceDrawParameter));
     }
 
-    // assert(total_instance_counter <= instance_capacity);
-    compute_cmd.push_constant(&total_instance_counter);
-    compute_cmd.dispatch(calculate_dispatch_size(total_instance_counter, 128), 1, 1);
+    if (total_instance_counter > draw_data->instance_draw_parts->item_size<u32>()) {
+        draw_data->instance_draw_parts->resize(total_instance_counter * sizeof(u32));
+    }
+
+    struct CullPush {
+        u32 entity_instance_count;
+        u32 group_instance_count;
+    };
+
+    // a thread per instance, the group instances come after the entity instances
+    CullPush cull_push = {
+        .entity_instance_count = m_scene_data->get_entity_instance_count(),
+        .group_instance_count  = m_scene_data->get_group_instance_count(),
+    };
+
+    compute_cmd.push_constant(&cull_push);
+    compute_cmd.dispatch(calculate_dispatch_size(cull_push.entity_instance_count + cull_push.group_instance_count, 128), 1, 1);
 
     VkBufferMemoryBarrier buffer_barriers[] = {
         VkBufferMemoryBarrier{
@@ -217,6 +331,23 @@ void IndirectModelRenderer::render(RenderArguments& args) {
             .offset        = 0,
             .size          = VK_WHOLE_SIZE,
         },
+        // read by the cluster cull
+        VkBufferMemoryBarrier{
+            .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+            .buffer        = draw_data->instance_draw_parameters->handle(),
+            .offset        = 0,
+            .size          = VK_WHOLE_SIZE,
+        },
+        VkBufferMemoryBarrier{
+            .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+            .buffer        = draw_data->instance_draw_parts->handle(),
+            .offset        = 0,
+            .size          = VK_WHOLE_SIZE,
+        },
     };
 
     compute_cmd.pipeline_barrier({
@@ -231,6 +362,26 @@ void IndirectModelRenderer::render(RenderArguments& args) {
     compute_cmd.bind_pipeline(m_indirect_draw_command_gen_pipeline.get());
     compute_cmd.dispatch(calculate_dispatch_size(part_count, 128), 1, 1);
 
+    if (total_cluster_counter > 0) {
+        struct ClusterCullPush {
+            u32 slot_count;
+            u32 part_count;
+        };
+
+        ClusterCullPush cluster_push = {
+            .slot_count = total_instance_counter,
+            .part_count = part_count,
+        };
+
+        // a workgroup per instance slot, split into rows since the x dimension is only guaranteed to reach 65535
+        u32 group_count_x = std::min(total_instance_counter, 65535u);
+        u32 group_count_y = calculate_dispatch_size(total_instance_counter, group_count_x);
+
+        compute_cmd.bind_pipeline(m_cluster_cull_pipeline.get());
+        compute_cmd.push_constant(&cluster_push);
+        compute_cmd.dispatch(group_count_x, group_count_y, 1);
+    }
+
     VkBufferMemoryBarrier buffer_barriers2[] = {
         VkBufferMemoryBarrier{
             .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
@@ -248,19 +399,44 @@ void IndirectModelRenderer::render(RenderArguments& args) {
             .offset        = 0,
             .size          = VK_WHOLE_SIZE,
         },
+        VkBufferMemoryBarrier{
+            .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+            .buffer        = draw_data->cluster_draw_buffer->handle(),
+            .offset        = 0,
+            .size          = VK_WHOLE_SIZE,
+        },
+        VkBufferMemoryBarrier{
+            .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT,
+            .buffer        = draw_data->cluster_count_buffer->handle(),
+            .offset        = 0,
+            .size          = VK_WHOLE_SIZE,
+        },
+        VkBufferMemoryBarrier{
+            .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+            .buffer        = draw_data->cull_stats_buffer->handle(),
+            .offset        = 0,
+            .size          = VK_WHOLE_SIZE,
+        },
     };
 
     compute_cmd.pipeline_barrier({
         .src_stage_mask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
         .dst_stage_mask = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT //
                           | (mesh_shaders_enabled ? VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT : 0u)     //
-                          | (m_query_indirect_render_counters ? VK_PIPELINE_STAGE_TRANSFER_BIT : 0u),
+                          | VK_PIPELINE_STAGE_TRANSFER_BIT,
         .buffer_memory_barriers = buffer_barriers2,
     });
 
-    if (m_query_indirect_render_counters) {
-        compute_cmd.copy_buffer(draw_data->instance_count_buffer->subspan(0), draw_data->host_instance_count_buffers[m_render_server->get_frame_index()]->subspan(0));
-    }
+    // always read back, the residency manager marks resources as used from these counters
+    compute_cmd.copy_buffer(draw_data->instance_count_buffer->subspan(0), draw_data->host_instance_count_buffers[m_render_server->get_frame_index()]->subspan(0));
+    compute_cmd.copy_buffer(draw_data->cluster_count_buffer->subspan(0), draw_data->host_cluster_count_buffers[m_render_server->get_frame_index()]->subspan(0));
+    compute_cmd.copy_buffer(draw_data->cull_stats_buffer->subspan(0), draw_data->host_cull_stats_buffers[m_render_server->get_frame_index()]->subspan(0));
 
     timer->timestamp(compute_cmd, std::format("cull end for render target: {}", args.render_target_name), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 }
@@ -272,6 +448,7 @@ void IndirectModelRenderer::update(vke::CommandBuffer& cmd) {
 }
 
 void IndirectModelRenderer::create_irb_set_layout() {
+    auto lock                    = m_render_server->lock_pipeline_loader();
     m_indirect_render_set_layout = m_render_server->get_pipeline_loader()->get_pipeline_globals_provider()->set_layouts["vke::indirect_scene_set_layout"];
 }
 
@@ -290,6 +467,14 @@ void IndirectModelRenderer::create_descriptor_set_for_irb(IndirectRenderBuffers&
         builder.add_ssbo(m_scene_data->get_model_part_info_buffer(), VK_SHADER_STAGE_ALL);
         builder.add_ssbo(m_scene_data->get_mesh_info_buffer(), VK_SHADER_STAGE_ALL);
 
+        builder.add_ssbo(m_scene_data->get_meshlet_buffer(), VK_SHADER_STAGE_COMPUTE_BIT);                    // meshlets
+        builder.add_ssbo(render_buffers.instance_draw_parts.get(), VK_SHADER_STAGE_ALL);                      // instance_draw_parts, its layer masks are read by layered passes
+        builder.add_ssbo(render_buffers.cluster_draw_location_buffer[i].get(), VK_SHADER_STAGE_COMPUTE_BIT); // cluster_draw_locations
+        builder.add_ssbo(render_buffers.cluster_count_buffer.get(), VK_SHADER_STAGE_COMPUTE_BIT);            // cluster_counters
+        builder.add_ssbo(render_buffers.cluster_draw_buffer.get(), VK_SHADER_STAGE_COMPUTE_BIT);             // cluster_draw_commands
+        builder.add_ssbo(m_scene_data->get_group_instance_buffer(), VK_SHADER_STAGE_COMPUTE_BIT);            // group_instances
+        builder.add_ssbo(render_buffers.cull_stats_buffer.get(), VK_SHADER_STAGE_COMPUTE_BIT);               // cull_stats
+
         render_buffers.indirect_render_sets[i] = builder.build(m_object_renderer->get_render_server()->get_descriptor_pool(), m_indirect_render_set_layout);
     }
 }
@@ -299,6 +484,10 @@ void IndirectModelRenderer::initialize_irb(IndirectRenderBuffers& irb) {
     irb.indirect_draw_buffer     = std::make_unique<vke::Buffer>(usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, sizeof(VkDrawIndexedIndirectCommand) * indirect_draw_capacity, false);
     irb.instance_count_buffer    = std::make_unique<vke::Buffer>(usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(u32) * part_capacity, false);
     irb.instance_draw_parameters = std::make_unique<vke::GrowableBuffer>(usage, sizeof(InstanceDrawParameter) * instance_capacity, false);
+    irb.instance_draw_parts      = std::make_unique<vke::GrowableBuffer>(usage, sizeof(u32) * instance_capacity, false);
+    irb.cluster_count_buffer     = std::make_unique<vke::Buffer>(usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(u32) * part_capacity, false);
+    irb.cluster_draw_buffer      = std::make_unique<vke::GrowableBuffer>(usage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, sizeof(VkDrawIndexedIndirectCommand) * instance_capacity, false);
+    irb.cull_stats_buffer        = std::make_unique<vke::Buffer>(usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(u32), false);
 
     vke::set_array(irb.part2indirect_draw_location, [&] {
         return std::make_unique<vke::Buffer>(usage, sizeof(u32) * part_capacity, true);
@@ -309,18 +498,39 @@ void IndirectModelRenderer::initialize_irb(IndirectRenderBuffers& irb) {
     vke::set_array(irb.host_instance_count_buffers, [&] {
         return std::make_unique<vke::Buffer>(usage, sizeof(uint) * part_capacity, true);
     });
+    vke::set_array(irb.cluster_draw_location_buffer, [&] {
+        return std::make_unique<vke::Buffer>(usage, sizeof(glm::uvec2) * part_capacity, true);
+    });
+    vke::set_array(irb.host_cluster_count_buffers, [&] {
+        return std::make_unique<vke::Buffer>(usage, sizeof(uint) * part_capacity, true);
+    });
+    vke::set_array(irb.host_cull_stats_buffers, [&] {
+        return std::make_unique<vke::Buffer>(usage, sizeof(uint), true);
+    });
 
     create_descriptor_set_for_irb(irb);
 }
 void IndirectModelRenderer::initialize_pipelines() {
-    auto* pipeline_loader  = m_render_server->get_pipeline_loader();
+    auto* render_server    = m_render_server;
     auto* resource_manager = m_object_renderer->get_resource_manager();
 
-    m_cull_pipeline                      = pipeline_loader->load("vke::object_renderer::cull_shader");
-    m_indirect_draw_command_gen_pipeline = pipeline_loader->load("vke::object_renderer::indirect_draw_gen");
+    auto* thread_pool      = m_render_server->get_thread_pool();
+
+    auto load_async = [&](const char* name) {
+        return thread_pool->submit([render_server, name]() -> RCResource<IPipeline> { return render_server->load_pipeline(name); });
+    };
+
+    auto cull_pipeline                      = load_async("vke::object_renderer::cull_shader");
+    auto indirect_draw_command_gen_pipeline = load_async("vke::object_renderer::indirect_draw_gen");
+    auto cluster_cull_pipeline              = load_async("vke::object_renderer::cluster_cull");
 
+    // material pipelines are resolved lazily on their first bind
     std::string pipelines[] = {"vke::default"};
     resource_manager->create_multi_target_pipeline(ObjectRenderer::pbr_pipeline_name, pipelines);
+
+    m_cull_pipeline                      = cull_pipeline.get();
+    m_indirect_draw_command_gen_pipeline = indirect_draw_command_gen_pipeline.get();
+    m_cluster_cull_pipeline              = cluster_cull_pipeline.get();
 }
 
 void IndirectModelRenderer::set_world(flecs::world* reg) {
@@ -20,6 +20,11 @@ public:
     void update(vke::CommandBuffer& cmd) override;
     void set_world(flecs::world* reg) override;
 
+    u64 get_static_revision() const override;
+    u32 get_dynamic_instance_count() const override;
+    u64 get_drawn_instance_count(const std::string& render_target_name) const override;
+    u64 get_occlusion_culled_instance_count(const std::string& render_target_name) const override;
+
 private:
     void create_descriptor_set_for_irb(IndirectRenderBuffers& irb);
     void create_irb_set_layout();
@@ -28,6 +33,8 @@ private:
     void initialize_pipelines();
 
     void debug_menu();
+    // marks the meshes and materials of parts that had visible instances as used for the residency manager
+    void mark_drawn_resources(IndirectRenderBuffers& draw_data);
 private:
     struct IndirectRenderBuffers {
         std::unique_ptr<vke::Buffer> indirect_draw_buffer;
@@ -44,6 +51,19 @@ private:
         std::unique_ptr<vke::Buffer> host_instance_count_buffers[FRAME_OVERLAP];
 
         std::unique_ptr<vke::GrowableBuffer> instance_draw_parameters;
+        // the part of each instance_draw_parameters entry, so that the cluster cull can go from an instance to its meshlets
+        std::unique_ptr<vke::GrowableBuffer> instance_draw_parts;
+
+        // offset & capacity of every part in cluster_draw_buffer, indexed by part id
+        std::unique_ptr<vke::Buffer> cluster_draw_location_buffer[FRAME_OVERLAP];
+        // visible meshlets of every part, the draw count of its indirect count draw
+        std::unique_ptr<vke::Buffer> cluster_count_buffer;
+        std::unique_ptr<vke::Buffer> host_cluster_count_buffers[FRAME_OVERLAP];
+        std::unique_ptr<vke::GrowableBuffer> cluster_draw_buffer;
+
+        // a single u32, the instances culled by the hzb of the view
+        std::unique_ptr<vke::Buffer> cull_stats_buffer;
+        std::unique_ptr<vke::Buffer> host_cull_stats_buffers[FRAME_OVERLAP];
 
         VkDescriptorSet indirect_render_sets[2];
     };
@@ -60,10 +80,12 @@ private:
 
     RCResource<vke::IPipeline> m_cull_pipeline;
     RCResource<vke::IPipeline> m_indirect_draw_command_gen_pipeline;
+    RCResource<vke::IPipeline> m_cluster_cull_pipeline;
 
-    std::unique_ptr<DebugMenuData> m_debug_menu_data;
+    // meshes with meshlets are drawn per visible meshlet instead of per instance
+    bool m_cluster_culling_enabled = true;
 
-    bool m_query_indirect_render_counters = true;
+    std::unique_ptr<DebugMenuData> m_debug_menu_data;
 };
 
 } // namespace vke
\ No newline at end of file
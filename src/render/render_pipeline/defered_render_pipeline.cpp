@@ -52,18 +52,30 @@ DeferredRenderPipeline::DeferredRenderPipeline(vke::RenderServer* render_server)
 
     m_deferred_render_pass = create_render_pass(render_server->get_window());
     auto pg_provider       = m_render_server->get_pipeline_loader()->get_pipeline_globals_provider();
-    pg_provider->subpasses.emplace(
-        m_deferred_render_pass.subpass_name,
-        m_deferred_render_pass.renderpass->get_subpass(0)->create_copy());
+    {
+        auto lock = m_render_server->lock_pipeline_loader();
+        pg_provider->subpasses.emplace(
+            m_deferred_render_pass.subpass_name,
+            m_deferred_render_pass.renderpass->get_subpass(0)->create_copy());
+    }
 
     vke::DescriptorSetLayoutBuilder builder;
     builder.add_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 3);
     builder.add_ubo(VK_SHADER_STAGE_FRAGMENT_BIT);
     builder.add_ssbo(VK_SHADER_STAGE_FRAGMENT_BIT);
     builder.add_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1); // shadows
+    builder.add_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1); // shadow atlas
+    builder.add_ssbo(VK_SHADER_STAGE_FRAGMENT_BIT);                                                 // point light shadows
+    builder.add_ssbo(VK_SHADER_STAGE_FRAGMENT_BIT);                                                 // virtual shadow map
+    builder.add_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1); // virtual shadow map pool
+    builder.add_binding(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, 1); // shadow mask
+    builder.add_ubo(VK_SHADER_STAGE_FRAGMENT_BIT);                                                  // shadow mask data
     m_deferred_set_layout = builder.build();
 
-    pg_provider->set_layouts.emplace("vke::deferred_render_set", m_deferred_set_layout);
+    {
+        auto lock = m_render_server->lock_pipeline_loader();
+        pg_provider->set_layouts.emplace("vke::deferred_render_set", m_deferred_set_layout);
+    }
 
     auto object_renderer  = m_render_server->get_object_renderer();
     auto resource_manager = object_renderer->get_resource_manager();
@@ -75,7 +87,11 @@ DeferredRenderPipeline::DeferredRenderPipeline(vke::RenderServer* render_server)
             .allow_hzb_culling     = true,
         });
 
-    m_deferred_pipeline = m_render_server->get_pipeline_loader()->load("vke::post_deferred");
+    m_deferred_pipeline = m_render_server->load_pipeline("vke::post_deferred");
+
+    m_shadow_mask = std::make_unique<ShadowMaskPass>(m_render_server,
+        m_deferred_render_pass.renderpass->get_attachment_view(m_deferred_render_pass.depth_id),
+        m_deferred_render_pass.renderpass->get_attachment_view(m_deferred_render_pass.normal_id));
 
     for (int i = 0; i < FRAME_OVERLAP; i++) {
         create_set(i, false);
@@ -120,6 +136,12 @@ void DeferredRenderPipeline::render(RenderServer::FrameArgs& args) {
     deferred_pass->set_external(false);
     deferred_pass->end(primary_cmd);
 
+    // the pages are read back FRAME_OVERLAP frames later, so they are requested for the depth buffer of this frame
+    m_render_server->get_object_renderer()->get_light_manager()->get_shadow_manager()->request_virtual_shadow_pages(primary_cmd);
+
+    m_shadow_mask->render(primary_cmd, m_camera);
+    m_shadow_mask->debug_menu();
+
     auto* timer =  m_render_server->get_gpu_timing_system();
     timer->timestamp(*args.main_pass_cmd, "pre deferred", VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 
@@ -154,6 +176,12 @@ void DeferredRenderPipeline::create_set(int index, bool update) {
     builder.add_ubo(object_renderer->get_view_buffer(m_deferred_render_pass.render_target_name, index), VK_SHADER_STAGE_FRAGMENT_BIT);
     builder.add_ssbo(light_manager->get_get_lights_buffer(), VK_SHADER_STAGE_FRAGMENT_BIT);
     builder.add_image_samplers(shadow_maps, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shadow_manager->get_shadow_sampler(), VK_SHADER_STAGE_FRAGMENT_BIT);
+    builder.add_image_sampler(shadow_manager->get_shadow_atlas()->get_image_view().get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shadow_manager->get_shadow_sampler(), VK_SHADER_STAGE_FRAGMENT_BIT);
+    builder.add_ssbo(light_manager->get_point_light_shadow_buffer(), VK_SHADER_STAGE_FRAGMENT_BIT);
+    builder.add_ssbo(shadow_manager->get_virtual_shadow_map()->get_data_buffer(index), VK_SHADER_STAGE_FRAGMENT_BIT);
+    builder.add_image_sampler(shadow_manager->get_virtual_shadow_map()->get_image_view().get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shadow_manager->get_shadow_sampler(), VK_SHADER_STAGE_FRAGMENT_BIT);
+    builder.add_image_sampler(m_shadow_mask->get_mask(index), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sampler, VK_SHADER_STAGE_FRAGMENT_BIT);
+    builder.add_ubo(m_shadow_mask->get_data_buffer(index), VK_SHADER_STAGE_FRAGMENT_BIT);
 
     if (!update) {
         m_deferred_set[index] = builder.build(m_render_server->get_descriptor_pool(), m_deferred_set_layout);
@@ -175,6 +203,8 @@ void DeferredRenderPipeline::check_for_resize(vke::CommandBuffer& cmd) {
         m_deferred_render_pass.renderpass->resize(cmd, w_extends.width, w_extends.height);
         
         create_hzb();
+        m_shadow_mask->set_gbuffer(m_deferred_render_pass.renderpass->get_attachment_view(m_deferred_render_pass.depth_id),
+            m_deferred_render_pass.renderpass->get_attachment_view(m_deferred_render_pass.normal_id));
         m_sets_needing_update.set();
     }
 
@@ -189,6 +219,9 @@ void DeferredRenderPipeline::check_for_resize(vke::CommandBuffer& cmd) {
 void DeferredRenderPipeline::create_hzb() {
     m_hzb = std::make_unique<HierarchicalZBuffers>(m_render_server,m_deferred_render_pass.renderpass->get_attachment_view(m_deferred_render_pass.depth_id));
     m_render_server->get_object_renderer()->set_hzb(m_deferred_render_pass.render_target_name, m_hzb.get());
+    auto* shadow_manager = m_render_server->get_object_renderer()->get_light_manager()->get_shadow_manager();
+    shadow_manager->set_receiver_hzb(m_hzb.get());
+    shadow_manager->set_receiver_depth(m_deferred_render_pass.renderpass->get_attachment_view(m_deferred_render_pass.depth_id));
 
 }
 } // namespace vke
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "fwd.hpp"
 #include "render/render_server.hpp"
+#include "shadow_mask_pass.hpp"
 
 namespace vke {
 
@@ -49,6 +50,7 @@ private:
 
     vke::RCResource<vke::IPipeline> m_deferred_pipeline;
     vke::RCResource<vke::HierarchicalZBuffers> m_hzb;
+    std::unique_ptr<ShadowMaskPass> m_shadow_mask;
 };
 
 } // namespace vke
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "shadow_mask_pass.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <vke/pipeline_loader.hpp>
+#include <vke/vke_builders.hpp>
+
+#include "imgui.h"
+
+#include "render/debug/gpu_timing_system.hpp"
+#include "render/object_renderer/light_buffers_manager.hpp"
+#include "render/object_renderer/object_renderer.hpp"
+#include "render/object_renderer/resource_manager.hpp"
+#include "render/render_server.hpp"
+#include "render/shadow/shadow_manager.hpp"
+#include "render/shadow/virtual_shadow_map.hpp"
+
+#include "scene/camera.hpp"
+
+namespace vke {
+
+namespace {
+
+constexpr u32 MASK_GROUP_SIZE  = 8;
+constexpr u32 MAX_SAMPLE_COUNT = 32; // size of the poisson table
+
+} // namespace
+
+ShadowMaskPass::ShadowMaskPass(RenderServer* render_server, IImageView* depth, IImageView* normal) {
+    m_render_server = render_server;
+
+    for (u32 i = 0; i < FRAME_OVERLAP; i++) {
+        m_data_buffers[i] = std::make_unique<vke::Buffer>(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(ShadowMaskData), true);
+        memset(m_data_buffers[i]->mapped_data_bytes().data(), 0, sizeof(ShadowMaskData));
+    }
+
+    vke::DescriptorSetLayoutBuilder layout_builder;
+    layout_builder.add_image_sampler(VK_SHADER_STAGE_COMPUTE_BIT); // depth
+    layout_builder.add_image_sampler(VK_SHADER_STAGE_COMPUTE_BIT); // normal
+    layout_builder.add_ubo(VK_SHADER_STAGE_COMPUTE_BIT);
+    layout_builder.add_ssbo(VK_SHADER_STAGE_COMPUTE_BIT);          // lights
+    layout_builder.add_image_sampler(VK_SHADER_STAGE_COMPUTE_BIT); // shadows
+    layout_builder.add_ssbo(VK_SHADER_STAGE_COMPUTE_BIT);          // virtual shadow map
+    layout_builder.add_image_sampler(VK_SHADER_STAGE_COMPUTE_BIT); // virtual shadow map pool
+    layout_builder.add_image_sampler(VK_SHADER_STAGE_COMPUTE_BIT); // history
+    layout_builder.add_binding(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT, 1);
+    m_set_layout = layout_builder.build();
+
+    {
+        auto lock = m_render_server->lock_pipeline_loader();
+        m_render_server->get_pipeline_loader()->get_pipeline_globals_provider()->set_layouts["vke::shadow_mask_set"] = m_set_layout;
+    }
+    m_pipeline = m_render_server->load_pipeline("vke::shadow_mask_pipeline");
+
+    set_gbuffer(depth, normal);
+}
+
+ShadowMaskPass::~ShadowMaskPass() {
+    vkDestroyDescriptorSetLayout(VulkanContext::get_context()->get_device(), m_set_layout, nullptr);
+}
+
+void ShadowMaskPass::set_gbuffer(IImageView* depth, IImageView* normal) {
+    m_depth  = depth;
+    m_normal = normal;
+
+    create_masks();
+
+    m_has_history = false;
+    m_sets_needing_update.set();
+}
+
+void ShadowMaskPass::create_masks() {
+    u32 width  = (m_depth->width() + 1) / 2;
+    u32 height = (m_depth->height() + 1) / 2;
+
+    for (u32 i = 0; i < FRAME_OVERLAP; i++) {
+        m_masks[i] = std::make_unique<vke::Image>(ImageArgs{
+            .format      = VK_FORMAT_R16G16_SFLOAT,
+            .usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            .width       = width,
+            .height      = height,
+        });
+    }
+
+    m_are_masks_new = true;
+}
+
+void ShadowMaskPass::update_set(u32 frame_index) {
+    auto* object_renderer = m_render_server->get_object_renderer();
+    auto* light_manager   = object_renderer->get_light_manager();
+    auto* shadow_manager  = light_manager->get_shadow_manager();
+
+    VkSampler sampler = object_renderer->get_resource_manager()->get_nearest_sampler();
+
+    IImageView* storage_images[] = {m_masks[frame_index].get()};
+
+    vke::DescriptorSetBuilder builder;
+    builder.add_image_sampler(m_depth, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sampler, VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_image_sampler(m_normal, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sampler, VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_ubo(m_data_buffers[frame_index].get(), VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_ssbo(light_manager->get_get_lights_buffer(), VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_image_sampler(shadow_manager->get_direct_shadow_map_texture(0).get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shadow_manager->get_shadow_sampler(), VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_ssbo(shadow_manager->get_virtual_shadow_map()->get_data_buffer(frame_index), VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_image_sampler(shadow_manager->get_virtual_shadow_map()->get_image_view().get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, shadow_manager->get_shadow_sampler(), VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_image_sampler(m_masks[(frame_index + FRAME_OVERLAP - 1) % FRAME_OVERLAP].get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sampler, VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_storage_images(storage_images, VK_IMAGE_LAYOUT_GENERAL, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    if (m_sets[frame_index] == VK_NULL_HANDLE) {
+        m_sets[frame_index] = builder.build(m_render_server->get_descriptor_pool(), m_set_layout);
+    } else {
+        builder.update_set(m_sets[frame_index], m_set_layout);
+    }
+
+    m_sets_needing_update[frame_index] = false;
+}
+
+void ShadowMaskPass::render(vke::CommandBuffer& primary_cmd, const Camera* camera) {
+    u32 frame_index = m_render_server->get_frame_index();
+
+    // the lighting samples the masks even while the pass is disabled
+    if (m_are_masks_new) {
+        std::array<VkImageMemoryBarrier, FRAME_OVERLAP> barriers;
+        for (u32 i = 0; i < FRAME_OVERLAP; i++) {
+            barriers[i] = VkImageMemoryBarrier{
+                .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask    = 0,
+                .dstAccessMask    = VK_ACCESS_SHADER_READ_BIT,
+                .oldLayout        = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                .image            = m_masks[i]->handle(),
+                .subresourceRange = m_masks[i]->get_subresource_range(),
+            };
+        }
+
+        primary_cmd.pipeline_barrier(PipelineBarrierArgs{
+            .src_stage_mask        = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            .dst_stage_mask        = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .image_memory_barriers = barriers,
+        });
+
+        m_are_masks_new = false;
+    }
+
+    bool is_rendered = is_enabled && camera != nullptr;
+
+    auto* data = reinterpret_cast<ShadowMaskData*>(m_data_buffers[frame_index]->mapped_data_bytes().data());
+    data->params.w = is_rendered ? 1.f : 0.f;
+
+    if (!is_rendered) {
+        m_has_history = false;
+        return;
+    }
+
+    glm::vec3 camera_pos = camera->get_world_pos();
+
+    data->inv_proj_view   = glm::inverse(camera->proj_view());
+    data->prev_proj_view  = m_prev_proj_view;
+    data->camera_pos      = glm::vec4(camera_pos, 1.f);
+    data->prev_camera_pos = glm::vec4(m_prev_camera_pos, 1.f);
+    data->params          = glm::vec4(is_temporal && m_has_history ? temporal_blend : 1.f, std::clamp<u32>(sample_count, 1, MAX_SAMPLE_COUNT), m_frame_counter, 1.f);
+
+    if (m_sets_needing_update[frame_index]) update_set(frame_index);
+
+    auto* timer = m_render_server->get_gpu_timing_system();
+    timer->timestamp(primary_cmd, "shadow mask start", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    auto* shadow_manager   = m_render_server->get_object_renderer()->get_light_manager()->get_shadow_manager();
+    IImageView* shadow_map = shadow_manager->get_direct_shadow_map_texture(0).get();
+    IImageView* vsm_pool   = shadow_manager->get_virtual_shadow_map()->get_image_view().get();
+    vke::Image* mask       = m_masks[frame_index].get();
+
+    auto make_read_barrier = [](IImageView* view, VkAccessFlags src_access) {
+        return VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = src_access,
+            .dstAccessMask    = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .image            = view->vke_image()->handle(),
+            .subresourceRange = view->get_subresource_range(),
+        };
+    };
+
+    VkImageMemoryBarrier input_barriers[] = {
+        make_read_barrier(m_depth, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT),
+        make_read_barrier(m_normal, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT),
+        make_read_barrier(shadow_map, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT),
+        make_read_barrier(vsm_pool, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT),
+        // the mask was last read by the lighting & as the history of the previous frame
+        VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = 0,
+            .dstAccessMask    = VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout        = VK_IMAGE_LAYOUT_GENERAL,
+            .image            = mask->handle(),
+            .subresourceRange = mask->get_subresource_range(),
+        },
+    };
+
+    primary_cmd.pipeline_barrier(PipelineBarrierArgs{
+        .src_stage_mask        = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        .dst_stage_mask        = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        .image_memory_barriers = input_barriers,
+    });
+
+    primary_cmd.bind_pipeline(m_pipeline.get());
+    primary_cmd.bind_descriptor_set(0, m_sets[frame_index]);
+
+    auto [sx, sy] = vke::calculate_dispatch_size(mask->width(), mask->height(), MASK_GROUP_SIZE, MASK_GROUP_SIZE);
+    primary_cmd.dispatch(sx, sy, 1);
+
+    VkImageMemoryBarrier output_barriers[] = {
+        VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask    = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_GENERAL,
+            .newLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .image            = mask->handle(),
+            .subresourceRange = mask->get_subresource_range(),
+        },
+    };
+
+    primary_cmd.pipeline_barrier(PipelineBarrierArgs{
+        .src_stage_mask        = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        .dst_stage_mask        = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        .image_memory_barriers = output_barriers,
+    });
+
+    timer->timestamp(primary_cmd, "shadow mask end", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    m_prev_proj_view  = camera->proj_view();
+    m_prev_camera_pos = camera_pos;
+    m_has_history     = true;
+    m_frame_counter++;
+}
+
+void ShadowMaskPass::debug_menu() {
+    if (ImGui::Begin("Shadow Mask", &m_menu_open)) {
+        ImGui::Checkbox("half resolution shadows", &is_enabled);
+        ImGui::Checkbox("temporal accumulation", &is_temporal);
+        ImGui::SliderFloat("temporal blend", &temporal_blend, 0.02f, 1.f);
+
+        int samples = sample_count;
+        if (ImGui::SliderInt("samples", &samples, 1, MAX_SAMPLE_COUNT)) sample_count = samples;
+
+        if (m_depth != nullptr) ImGui::Text("mask: %ux%u", (m_depth->width() + 1) / 2, (m_depth->height() + 1) / 2);
+
+        auto time = m_render_server->get_gpu_timing_system()->get_time_between("shadow mask start", "shadow mask end");
+        if (time) ImGui::Text("gpu time: %.3lf ms", *time);
+    }
+
+    ImGui::End();
+}
+
+} // namespace vke
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vke/vke.hpp>
+
+#include <array>
+#include <bitset>
+#include <memory>
+
+#include "common.hpp"
+#include "fwd.hpp"
+#include "render/shader/scene_data.h"
+
+namespace vke {
+
+// the shadow term of the directional light at half resolution, computed once per 4 pixels instead of by every pixel of the lighting.
+// a few samples of a disc rotated per texel & frame are accumulated over frames, the lighting upsamples the mask with depth aware weights
+class ShadowMaskPass {
+public:
+    ShadowMaskPass(RenderServer* render_server, IImageView* depth, IImageView* normal);
+    ~ShadowMaskPass();
+
+    // the gbuffer the mask is made from, it has to be set again when it is recreated. the history is thrown away
+    void set_gbuffer(IImageView* depth, IImageView* normal);
+
+    // cmd has to be a primary command buffer after the gbuffer & the shadow maps are written.
+    // the data is written even while it is disabled so that the lighting knows it
+    void render(vke::CommandBuffer& primary_cmd, const Camera* camera);
+
+    // the mask written in the frames of frame_index, the lighting of the same frame reads it
+    IImageView* get_mask(u32 frame_index) { return m_masks[frame_index].get(); }
+    vke::Buffer* get_data_buffer(u32 frame_index) { return m_data_buffers[frame_index].get(); }
+
+    void debug_menu();
+
+    bool is_enabled      = true;
+    bool is_temporal     = true;
+    float temporal_blend = 0.15f; // weight of the new term in the history
+    u32 sample_count     = 8;
+
+private:
+    void create_masks();
+    void update_set(u32 frame_index);
+
+private:
+    RenderServer* m_render_server;
+    IImageView* m_depth  = nullptr;
+    IImageView* m_normal = nullptr;
+
+    // rg16f, x is the shadow term & y the distance to the camera. the mask of the previous frame is the history
+    std::array<std::unique_ptr<vke::Image>, FRAME_OVERLAP> m_masks;
+    bool m_are_masks_new = true;
+
+    // host visible, written by the cpu every frame
+    std::array<std::unique_ptr<vke::Buffer>, FRAME_OVERLAP> m_data_buffers;
+
+    VkDescriptorSetLayout m_set_layout;
+    std::array<VkDescriptorSet, FRAME_OVERLAP> m_sets = {};
+    std::bitset<FRAME_OVERLAP> m_sets_needing_update;
+    RCResource<vke::IPipeline> m_pipeline;
+
+    glm::mat4 m_prev_proj_view  = glm::mat4(1);
+    glm::vec3 m_prev_camera_pos = glm::vec3(0);
+    bool m_has_history          = false;
+    u32 m_frame_counter         = 0;
+
+    bool m_menu_open = true;
+};
+
+} // namespace vke
@@ -11,6 +11,8 @@
 #include "window/window_sdl.hpp"
 
 #include "render/debug/gpu_timing_system.hpp"
+#include "render/streaming/async_uploader.hpp"
+#include "util/thread_pool.hpp"
 
 #include <filesystem>
 #include <vke/pipeline_loader.hpp>
@@ -25,22 +27,32 @@ void RenderServer::init() {
     vke::ContextConfig config{
         .app_name    = "app0",
         .features1_0 = {
-            .geometryShader        = true,
-            .tessellationShader    = true,
-            .shaderFloat64         = true,
-            .shaderInt64           = true,
-            .shaderInt16           = true,
-            .sparseBinding         = true,
-            .sparseResidencyBuffer = true,
+            .geometryShader            = true,
+            .tessellationShader        = true,
+            .multiDrawIndirect         = true,
+            .drawIndirectFirstInstance = true,
+            .samplerAnisotropy         = true,
+            .textureCompressionBC      = true,
+            .shaderClipDistance        = true,
+            .shaderFloat64             = true,
+            .shaderInt64               = true,
+            .shaderInt16               = true,
+            .sparseBinding             = true,
+            .sparseResidencyBuffer     = true,
         },
         .features1_2 = {
+            .drawIndirectCount   = true,
             .shaderInt8          = true,
             .samplerFilterMinmax = true,
+            .timelineSemaphore   = true,
         },
     };
 
     vke::VulkanContext::init(config);
 
+    m_thread_pool    = std::make_unique<ThreadPool>();
+    m_async_uploader = std::make_unique<vke::AsyncUploader>();
+
     m_descriptor_pool = std::make_unique<DescriptorPool>();
 
     m_window = std::make_unique<WindowSDL>();
@@ -61,7 +73,7 @@ void RenderServer::init() {
 
     auto pg_provider = std::make_unique<vke::PipelineGlobalsProvider>();
     pg_provider->subpasses.emplace("vke::default_forward", std::make_unique<SubpassDetails>(*m_window_renderpass->get_subpass(0)));
-    pg_provider->vertex_input_descriptions.emplace("vke::default_mesh", vke::make_default_vertex_layout());
+    pg_provider->vertex_input_descriptions.emplace("vke::default_mesh", vke::make_default_vertex_layout(m_vertex_format));
     pg_provider->shader_compiler->add_system_include_dir((vke_engine_path / "src/render/shader/include/").string());
 
     m_pipeline_loader->set_pipeline_globals_provider(std::move(pg_provider));
@@ -98,6 +110,9 @@ void RenderServer::frame(std::function<void(FrameArgs& args)> render_function) {
     VkFence fence = framely_data.fence->handle();
     VK_CHECK(vkWaitForFences(device(), 1, &fence, true, 1E9));
 
+    // submitted ahead of the frame on the same queue. resources only become visible once their batch has completed
+    m_async_uploader->update();
+
     if (!m_window->surface()->prepare(1E9)) {
         VK_CHECK(vkDeviceWaitIdle(device()));
         m_window->surface()->recrate_swapchain();
@@ -215,6 +230,20 @@ RenderServer::~RenderServer() {
 
 RenderServer::RenderServer() {}
 
+RCResource<IPipeline> RenderServer::load_pipeline(const std::string& name) {
+    auto lock = lock_pipeline_loader_shared();
+    return m_pipeline_loader->load(name.c_str());
+}
+
+void RenderServer::set_vertex_format(VertexFormat format) {
+    if (m_pipeline_loader != nullptr) {
+        LOG_ERROR("the vertex format can't be changed after RenderServer::init");
+        return;
+    }
+
+    m_vertex_format = format;
+}
+
 void RenderServer::early_cleanup() {
     assert(m_early_cleanup_called == false && "early cleanup called twice!");
     VK_CHECK(vkDeviceWaitIdle(device()));
@@ -3,6 +3,8 @@
 #include <memory>
 
 #include <any>
+#include <mutex>
+#include <shared_mutex>
 #include <vke/fwd.hpp>
 #include <vke/vke.hpp>
 
@@ -10,6 +12,7 @@
 
 #include "common.hpp" // IWYU pragma: export
 #include "render/iobject_renderer.hpp"
+#include "render/mesh/vertex_format.hpp"
 
 
 namespace vke {
@@ -33,15 +36,28 @@ public:
     RenderServer();
     ~RenderServer();
 
+    // has to be called before init, every mesh is built in this format
+    void set_vertex_format(VertexFormat format);
+
     void init();
     void run();
     void early_cleanup();
 
     IPipelineLoader* get_pipeline_loader() { return m_pipeline_loader.get(); }
+    // loads only read the globals provider, so they share the lock and run concurrently. subpasses, set layouts & vertex
+    // inputs are registered while the loads run on the thread pool, every write to the globals has to hold this lock
+    std::unique_lock<std::shared_mutex> lock_pipeline_loader() { return std::unique_lock(m_pipeline_loader_mutex); }
+    // for reading the globals or the pipeline files of the loader
+    std::shared_lock<std::shared_mutex> lock_pipeline_loader_shared() { return std::shared_lock(m_pipeline_loader_mutex); }
+    // loads the pipeline while holding the lock shared, it can be called from any thread
+    RCResource<IPipeline> load_pipeline(const std::string& name);
     Window* get_window() { return m_window.get(); }
     ObjectRenderer* get_object_renderer() { return m_object_renderer.get(); }
     LineDrawer* get_line_drawer() { return m_line_drawer.get(); }
     GPUTimingSystem* get_gpu_timing_system() { return m_timing_system.get(); }
+    ThreadPool* get_thread_pool() { return m_thread_pool.get(); }
+    AsyncUploader* get_async_uploader() { return m_async_uploader.get(); }
+    VertexFormat get_vertex_format() const { return m_vertex_format; }
 
     void frame(std::function<void(FrameArgs& args)> render_function);
     bool is_running() { return m_running && m_window->is_open(); }
@@ -65,11 +81,14 @@ private:
     std::unique_ptr<vke::Window> m_window;
     std::unique_ptr<vke::Renderpass> m_window_renderpass;
     std::unique_ptr<vke::IPipelineLoader> m_pipeline_loader;
+    std::shared_mutex m_pipeline_loader_mutex;
     std::unique_ptr<vke::ObjectRenderer> m_object_renderer;
     std::unique_ptr<vke::DescriptorPool> m_descriptor_pool;
     std::unique_ptr<vke::ImguiManager> m_imgui_manager;
     std::unique_ptr<vke::LineDrawer> m_line_drawer;
     std::unique_ptr<vke::GPUTimingSystem> m_timing_system;
+    std::unique_ptr<vke::AsyncUploader> m_async_uploader;
+    std::unique_ptr<vke::ThreadPool> m_thread_pool;
 
     std::unordered_map<std::string, std::any> m_custom_any_storage;
 
@@ -77,6 +96,8 @@ private:
     bool m_early_cleanup_called = false;
     int m_frame_index           = 0;
 
+    VertexFormat m_vertex_format = VertexFormat::SEPARATE_FLOAT;
+
     struct FramelyData {
         std::unique_ptr<vke::CommandPool> cmd_pool;
         std::unique_ptr<vke::CommandBuffer> cmd, main_pass_cmd;
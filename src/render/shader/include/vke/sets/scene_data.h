@@ -32,6 +32,27 @@ struct Frustum {
     vec4 planes[6];
 };
 
+// which instances a view draws, see InstanceFilter in object_renderer.hpp
+#define INSTANCE_FILTER_ALL 0
+#define INSTANCE_FILTER_STATIC 1
+#define INSTANCE_FILTER_DYNAMIC 2
+
+#define MAX_VIEW_LAYERS 4
+
+// a layer of a layered view, instances are only drawn into the layers they are visible in
+struct ViewLayerData {
+    mat4 proj_view;
+    Frustum frustum;
+};
+
+// the receivers a shadow view casts onto, casters whose shadow can't reach a visible receiver are culled
+struct ReceiverData {
+    mat4 proj_view;  // of the camera that sees the receivers, the hzb of the view is the depth of that camera
+    Frustum frustum; // the part of the camera frustum the view casts shadows into
+    vec4 sphere;     // bounds of the frustum, xyz center w radius
+    vec4 light_dir;  // xyz is the direction the light travels in, w is 1 when casters are culled against the receivers
+};
+
 struct ViewData {
     mat4 proj_view;
     mat4 inv_proj_view;
@@ -39,7 +60,13 @@ struct ViewData {
     dvec4 view_world_pos;
     Frustum frustum;
     uvec4 is_hzb_culling_enabled;
-    vec4 frame_times; // x is delta y is the running time of the game
+    vec4 frame_times;    // x is delta y is the running time of the game
+    vec4 lod_parameters; // x is the pixels per unit at a clip space w of 1, y is the lod error allowed in pixels
+    uvec4 instance_filter; // x is one of INSTANCE_FILTER_*
+    uvec4 layer_count;     // x is the layer count of a layered view, 0 for views that draw into a single layer
+    ViewLayerData layers[MAX_VIEW_LAYERS];
+    ReceiverData receivers;
+    vec4 atlas_rect; // xy offset & zw size of the view in the uv space of its framebuffer, views that don't draw into an atlas tile cover it
 };
 
 struct MaterialData {
@@ -50,18 +77,29 @@ struct MaterialData {
     float padd;
 };
 
+// the high bits of InstanceData::model_id are flags
+#define INSTANCE_MODEL_ID_MASK 0x00FFFFFFu
+// the instance moves, it is uploaded every frame and isn't drawn into cached views
+#define INSTANCE_FLAG_DYNAMIC 0x80000000u
+
 struct InstanceData {
     dvec4 world_position;
     vec4 rotation;
     vec3 size;
-    uint model_id;
+    uint model_id; // model id | INSTANCE_FLAG_*
 };
 
-#define MAX_PARTS 32
+// every lod of a primitive is a part of its own
+#define MAX_PARTS 64
 
 struct PartData {
     uint mesh_id;
     uint material_id;
+    // the part is one lod of a mesh, it is drawn while the error allowed for the instance is within [lod_error, lod_max_error)
+    float lod_error;
+    float lod_max_error;
+    // placement of the part in the model, the lod errors are already scaled by it
+    mat4 local_matrix;
 };
 
 struct ModelData {
@@ -71,12 +109,38 @@ struct ModelData {
     uint part_count;
 };
 
+// how the vertex attributes of a mesh are encoded, see VertexEncoding in vertex_format.hpp
+#define VERTEX_FLAG_QUANTIZED_POSITION 1
+#define VERTEX_FLAG_OCTAHEDRAL_NORMAL 2
+#define VERTEX_FLAG_HALF_UV 4
+#define VERTEX_FLAG_UNORM_UV 8
+
 struct MeshData {
     uint64_t vertex_pointers[3];
     uint index_offset;
     uint index_count;
+    vec4 position_offset; // w is unused
+    vec4 position_scale;
+    vec4 uv_transform; // xy offset, zw scale
+    uint vertex_flags;
+    uint meshlet_offset; // into the meshlet buffer, meshlet_count is 0 for meshes that aren't cluster culled
+    uint meshlet_count;
+    uint padd;
 };
 
+// bounds of a meshlet for cluster culling, see Meshlet in meshlet_builder.hpp
+struct MeshletData {
+    vec4 sphere; // xyz center, w radius
+    vec4 cone;   // xyz axis, w cutoff
+    uint triangle_offset;
+    uint triangle_count;
+    uint padd[2];
+};
+
+// the high bits of instance_draw_parts entries are the layers of a layered view the instance was visible in
+#define DRAW_PART_ID_MASK 0x00FFFFFFu
+#define DRAW_LAYER_MASK_SHIFT 24
+
 struct InstanceDrawParameter {
     mat4 model_matrix;
 };
@@ -90,6 +154,36 @@ struct PointLight {
     float range;
 };
 
+#define POINT_LIGHT_SHADOW_FACES 6
+
+// indexed like the point lights. the faces are in the order +x -x +y -y +z -z and are drawn into tiles of the shadow atlas
+struct PointLightShadow {
+    mat4 proj_view[POINT_LIGHT_SHADOW_FACES];  // the matrices the faces were drawn with
+    vec4 tile_rects[POINT_LIGHT_SHADOW_FACES]; // xy offset & zw size of the faces in the uv space of the atlas
+    vec4 params;                               // x is 1 when the light has shadows, y is the normal offset in texels & z the depth bias
+};
+
+#define MAX_VIRTUAL_SHADOW_LEVELS 4
+
+// the directional light's virtual shadow map. every level is an orthographic window of sizes.x² pages around the camera,
+// the pages are drawn into tiles of a physical pool & found through a toroidal page table that follows this struct in the buffer
+struct VirtualShadowMapData {
+    mat4 level_proj_views[MAX_VIRTUAL_SHADOW_LEVELS]; // of the whole window of each level
+    ivec4 level_origins[MAX_VIRTUAL_SHADOW_LEVELS];   // xy is the first page of the window of each level
+    mat4 camera_inv_proj_view;                        // of the camera the pages are requested for
+    vec4 params;                                      // x is the world size of a texel of level 0, y the size of a pixel at a distance of 1, z is 1 when it is enabled & w the depth bias
+    uvec4 sizes;                                      // x pages per side of a level, y texels per side of a page, z physical pages per side of the pool & w the level count
+};
+
+// the shadow term of the directional light computed at half resolution & upsampled by the lighting, see ShadowMaskPass
+struct ShadowMaskData {
+    mat4 inv_proj_view;   // of the camera the mask is made for
+    mat4 prev_proj_view;  // of the camera of the frame the history was made in
+    vec4 camera_pos;      // xyz
+    vec4 prev_camera_pos; // xyz, the distances in the history are to it
+    vec4 params;          // x is the weight of the new term in the history, 1 without a history, y the sample count, z the frame counter & w is 1 when it is enabled
+};
+
 struct DirectionalLight {
     vec4 dir;
     vec4 color;
@@ -60,4 +60,40 @@ layout(set = SCENE_SET, binding = 8, std430) readonly buffer BufferS4_MeshData {
     MeshData meshes[];
 };
 
+layout(set = SCENE_SET, binding = 9, std430) readonly buffer BufferS5_MeshletData {
+    // indexes come from MeshData::meshlet_offset
+    MeshletData meshlets[];
+};
+
+layout(set = SCENE_SET, binding = 10, std430) IF_NOT_COMPUTE(readonly) buffer BufferV6_InstanceDrawParts {
+    // the part each instance_draw_parameters entry was written for
+    uint instance_draw_parts[];
+};
+
+layout(set = SCENE_SET, binding = 11, std430) readonly buffer BufferV7_ClusterDrawLocations {
+    // indexes correspond to partIDs
+    // stores the offset & the capacity of the part in cluster_draw_commands, the capacity is 0 for parts that aren't cluster culled
+    uvec2 cluster_draw_locations[];
+};
+
+layout(set = SCENE_SET, binding = 12, std430) IF_NOT_COMPUTE(readonly) buffer BufferV8_ClusterCounters {
+    // indexes correspond to partIDs
+    uint cluster_counters[];
+};
+
+layout(set = SCENE_SET, binding = 13, std430) IF_NOT_COMPUTE(readonly) buffer BufferV9_ClusterDrawCommands {
+    // one draw per visible meshlet of an instance
+    VkDrawIndexedIndirectCommand_ cluster_draw_commands[];
+};
+
+layout(set = SCENE_SET, binding = 14, std430) readonly buffer BufferS6_GroupInstances {
+    // instances of every InstanceGroup, culled after the entity instances
+    InstanceData group_instances[];
+};
+
+layout(set = SCENE_SET, binding = 15, std430) IF_NOT_COMPUTE(readonly) buffer BufferV10_CullStats {
+    // instances that passed every other test but were hidden behind the hzb of the view
+    uint occlusion_culled_count;
+};
+
 #endif
\ No newline at end of file
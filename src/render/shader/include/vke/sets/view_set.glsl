@@ -21,4 +21,22 @@ bool is_visible(in AABB boundary, in vec3 position, in vec4 rotation, in vec3 si
     return is_visible(scene_view, hzb, boundary, position, rotation, size);
 }
 
+bool is_sphere_visible(vec3 center, float radius) {
+    return is_sphere_visible(scene_view, hzb, center, radius);
+}
+
+// the hzb of shadow views is the depth of the camera that sees their receivers
+bool is_shadow_receiver_visible(in AABB boundary, in vec3 position, in vec4 rotation, in vec3 size) {
+    vec3 center, right, up, forward;
+    transform_aabb(boundary, position, rotation, size, center, right, up, forward);
+
+    return is_shadow_receiver_visible(scene_view, hzb, center, right, up, forward);
+}
+
+bool is_shadow_receiver_visible(vec3 center, float radius) {
+    return is_shadow_receiver_visible(scene_view, hzb, center, vec3(radius, 0, 0), vec3(0, radius, 0), vec3(0, 0, radius));
+}
+
+bool is_layered_view() { return scene_view.layer_count.x > 0; }
+
 #endif
\ No newline at end of file
@@ -6,37 +6,24 @@
 
 float plane_sdf(vec4 plane, vec3 point) { return dot(plane.xyz, point) - plane.w; }
 
-bool is_visible(in ViewData view,in sampler2D _hzb, in AABB boundary, in vec3 position, in vec4 rotation, in vec3 size) {
-
-    vec3 center = quat_rotate(rotation, boundary.center_point * size) + position;
-
-    // Compute the transformed OBB axes
-    vec3 right   = quat_rotate(rotation, vec3(1.0, 0.0, 0.0)) * boundary.half_size.x * size.x;
-    vec3 up      = quat_rotate(rotation, vec3(0.0, 1.0, 0.0)) * boundary.half_size.y * size.y;
-    vec3 forward = quat_rotate(rotation, vec3(0.0, 0.0, 1.0)) * boundary.half_size.z * size.z;
-
-    for (int i = 0; i < 6; i++) { // Check all 6 frustum planes
-        vec4 plane = view.frustum.planes[i];
-
-        float center_distance = plane_sdf(plane, center);
-
-        // Correct projected radius (support mapping)
-        float extend_distance = abs(dot(plane.xyz, right)) + abs(dot(plane.xyz, up)) + abs(dot(plane.xyz, forward));
-
-        if (center_distance + extend_distance < 0.0) {
-            return false;
-        }
+// model_id is InstanceData::model_id with its flags
+bool passes_instance_filter(in ViewData view, uint model_id) {
+    bool is_dynamic = (model_id & INSTANCE_FLAG_DYNAMIC) != 0;
+
+    switch (view.instance_filter.x) {
+    case INSTANCE_FILTER_STATIC: return !is_dynamic;
+    case INSTANCE_FILTER_DYNAMIC: return is_dynamic;
+    default: return true;
     }
+}
 
-    // return true;
-
-#pragma region hzb culling
-    if (view.is_hzb_culling_enabled.x != 1) return true;
-
-    vec4 c_center  = view.old_proj_view * vec4(center, 1.0);
-    vec4 c_right   = view.old_proj_view * vec4(right, 0.0);
-    vec4 c_up      = view.old_proj_view * vec4(up, 0.0);
-    vec4 c_forward = view.old_proj_view * vec4(forward, 0.0);
+// the box is center +- right, up & forward in world space, proj_view is the matrix the hzb was rendered with.
+// mirrored by project_box_to_clip in receiver_culling.cpp
+bool is_box_hzb_visible(in mat4 proj_view, in sampler2D _hzb, vec3 center, vec3 right, vec3 up, vec3 forward) {
+    vec4 c_center  = proj_view * vec4(center, 1.0);
+    vec4 c_right   = proj_view * vec4(right, 0.0);
+    vec4 c_up      = proj_view * vec4(up, 0.0);
+    vec4 c_forward = proj_view * vec4(forward, 0.0);
 
     // it only has to be outside of (-1,1)
     vec3 clip_min = vec3(1E10);
@@ -50,6 +37,9 @@ bool is_visible(in ViewData view,in sampler2D _hzb, in AABB boundary, in vec3 po
                 sum += j == 0 ? -c_up : c_up;
                 sum += k == 0 ? -c_forward : c_forward;
 
+                // boxes crossing the camera plane can't be projected
+                if (sum.w <= 0.0) return true;
+
                 vec3 c_pos = sum.xyz / sum.w;
                 clip_min   = min(clip_min, c_pos);
                 clip_max   = max(clip_max, c_pos);
@@ -57,6 +47,9 @@ bool is_visible(in ViewData view,in sampler2D _hzb, in AABB boundary, in vec3 po
         }
     }
 
+    // nothing behind the far plane was drawn into the hzb, a view that moved since it was drawn may see past it
+    if (clip_min.z < 0.0) return true;
+
     clip_min.xy = clip_min.xy * 0.5 + 0.5;
     clip_max.xy = clip_max.xy * 0.5 + 0.5;
 
@@ -73,4 +66,127 @@ bool is_visible(in ViewData view,in sampler2D _hzb, in AABB boundary, in vec3 po
     return clip_max.z >= depth;
 }
 
+// the box is center +- right, up & forward in world space
+bool is_hzb_visible(in ViewData view, in sampler2D _hzb, vec3 center, vec3 right, vec3 up, vec3 forward) {
+    if (view.is_hzb_culling_enabled.x != 1) return true;
+
+    return is_box_hzb_visible(view.old_proj_view, _hzb, center, right, up, forward);
+}
+
+// the box is center +- right, up & forward in world space
+bool is_box_in_frustum(in Frustum frustum, vec3 center, vec3 right, vec3 up, vec3 forward) {
+    for (int i = 0; i < 6; i++) { // Check all 6 frustum planes
+        vec4 plane = frustum.planes[i];
+
+        float center_distance = plane_sdf(plane, center);
+
+        // Correct projected radius (support mapping)
+        float extend_distance = abs(dot(plane.xyz, right)) + abs(dot(plane.xyz, up)) + abs(dot(plane.xyz, forward));
+
+        if (center_distance + extend_distance < 0.0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool is_sphere_in_frustum(in Frustum frustum, vec3 center, float radius) {
+    for (int i = 0; i < 6; i++) {
+        if (plane_sdf(frustum.planes[i], center) + radius < 0.0) return false;
+    }
+
+    return true;
+}
+
+void transform_aabb(in AABB boundary, in vec3 position, in vec4 rotation, in vec3 size, out vec3 center, out vec3 right, out vec3 up, out vec3 forward) {
+    center = quat_rotate(rotation, boundary.center_point * size) + position;
+
+    // Compute the transformed OBB axes
+    right   = quat_rotate(rotation, vec3(1.0, 0.0, 0.0)) * boundary.half_size.x * size.x;
+    up      = quat_rotate(rotation, vec3(0.0, 1.0, 0.0)) * boundary.half_size.y * size.y;
+    forward = quat_rotate(rotation, vec3(0.0, 0.0, 1.0)) * boundary.half_size.z * size.z;
+}
+
+bool is_visible(in ViewData view,in sampler2D _hzb, in AABB boundary, in vec3 position, in vec4 rotation, in vec3 size) {
+    vec3 center, right, up, forward;
+    transform_aabb(boundary, position, rotation, size, center, right, up, forward);
+
+    if (!is_box_in_frustum(view.frustum, center, right, up, forward)) return false;
+
+    return is_hzb_visible(view, _hzb, center, right, up, forward);
+}
+
+// center & radius are in world space
+bool is_sphere_visible(in ViewData view, in sampler2D _hzb, vec3 center, float radius) {
+    if (!is_sphere_in_frustum(view.frustum, center, radius)) return false;
+
+    return is_hzb_visible(view, _hzb, center, vec3(radius, 0, 0), vec3(0, radius, 0), vec3(0, 0, radius));
+}
+
+// bit i is set when the box is in the frustum of layer i of a layered view, layered views aren't hzb culled
+uint calculate_layer_mask(in ViewData view, in AABB boundary, in vec3 position, in vec4 rotation, in vec3 size) {
+    vec3 center, right, up, forward;
+    transform_aabb(boundary, position, rotation, size, center, right, up, forward);
+
+    uint layer_mask = 0;
+    for (uint i = 0; i < min(view.layer_count.x, MAX_VIEW_LAYERS); i++) {
+        if (is_box_in_frustum(view.layers[i].frustum, center, right, up, forward)) layer_mask |= 1u << i;
+    }
+
+    return layer_mask;
+}
+
+// how far the box has to be swept along the light to be past every receiver, it can't shadow any of them if it is 0 or less.
+// mirrored by calculate_shadow_sweep_length in receiver_culling.cpp
+float calculate_shadow_sweep_length(in ReceiverData receivers, vec3 center, vec3 right, vec3 up, vec3 forward) {
+    vec3 light_dir = receivers.light_dir.xyz;
+
+    float box_start    = dot(center, light_dir) - abs(dot(right, light_dir)) - abs(dot(up, light_dir)) - abs(dot(forward, light_dir));
+    float receiver_end = dot(receivers.sphere.xyz, light_dir) + receivers.sphere.w;
+
+    return receiver_end - box_start;
+}
+
+// the convex hull of the box and the box moved by sweep. a plane separates it only if it separates both ends.
+// mirrored by is_swept_box_in_frustum in receiver_culling.cpp
+bool is_swept_box_in_frustum(in Frustum frustum, vec3 center, vec3 right, vec3 up, vec3 forward, vec3 sweep) {
+    for (int i = 0; i < 6; i++) {
+        vec4 plane = frustum.planes[i];
+
+        float center_distance = plane_sdf(plane, center) + max(dot(plane.xyz, sweep), 0.0);
+        float extend_distance = abs(dot(plane.xyz, right)) + abs(dot(plane.xyz, up)) + abs(dot(plane.xyz, forward));
+
+        if (center_distance + extend_distance < 0.0) return false;
+    }
+
+    return true;
+}
+
+// the shadow of the box is bounded by the box swept along the light until it is past every receiver. the box is kept only if
+// the sweep is in the receiver frustum and isn't entirely behind the depth of the camera, which would hide whatever it shadows.
+// mirrored by is_shadow_receiver_visible in receiver_culling.cpp
+bool is_shadow_receiver_visible(in ViewData view, in sampler2D _hzb, vec3 center, vec3 right, vec3 up, vec3 forward) {
+    if (view.receivers.light_dir.w == 0.0) return true;
+
+    float sweep_length = calculate_shadow_sweep_length(view.receivers, center, right, up, forward);
+    if (sweep_length <= 0.0) return false;
+
+    vec3 sweep = view.receivers.light_dir.xyz * sweep_length;
+    if (!is_swept_box_in_frustum(view.receivers.frustum, center, right, up, forward, sweep)) return false;
+
+    // the sweep is bounded by a world space aabb for the hzb test
+    vec3 half_size = abs(right) + abs(up) + abs(forward) + abs(sweep) * 0.5;
+    return is_box_hzb_visible(view.receivers.proj_view, _hzb, center + sweep * 0.5, vec3(half_size.x, 0, 0), vec3(0, half_size.y, 0), vec3(0, 0, half_size.z));
+}
+
+uint calculate_sphere_layer_mask(in ViewData view, vec3 center, float radius) {
+    uint layer_mask = 0;
+    for (uint i = 0; i < min(view.layer_count.x, MAX_VIEW_LAYERS); i++) {
+        if (is_sphere_in_frustum(view.layers[i].frustum, center, radius)) layer_mask |= 1u << i;
+    }
+
+    return layer_mask;
+}
+
 #endif
\ No newline at end of file
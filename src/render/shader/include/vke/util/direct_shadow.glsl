@@ -0,0 +1,114 @@
+#ifndef VKE_DIRECT_SHADOW
+#define VKE_DIRECT_SHADOW
+
+#include <vke/sets/scene_data.h>
+#include <vke/util/hash.glsl>
+#include <vke/util/virtual_shadow_map.glsl>
+
+// shadows of the directional light, shared by the lighting & the shadow mask pass.
+// the including shader declares lights, shadow_maps, vsm, vsm_page_table & vsm_pool
+
+const int poisson_table_size           = 32;
+vec2 poisson_table[poisson_table_size] = {
+    vec2(0.087164, -0.25865),
+    vec2(-0.71380, -0.31938),
+    vec2(-0.42212, -0.37691),
+    vec2(-0.35237, -0.048855),
+    vec2(0.80181, -0.073725),
+    vec2(-0.050746, -0.59212),
+    vec2(-0.030902, 0.044495),
+    vec2(0.11101, -0.17909),
+    vec2(-0.11017, -0.0071830),
+    vec2(0.57569, 0.42861),
+    vec2(-0.33310, 0.83733),
+    vec2(0.42835, 0.87701),
+    vec2(-0.64454, -0.68726),
+    vec2(0.19806, 0.33082),
+    vec2(0.048796, 0.24135),
+    vec2(0.21022, -0.84828),
+    vec2(0.27345, 0.34345),
+    vec2(0.42546, -0.084226),
+    vec2(-0.56231, 0.17967),
+    vec2(0.0056380, -0.11294),
+    vec2(-0.16145, -0.076814),
+    vec2(-0.029326, -0.017768),
+    vec2(0.28798, 0.14798),
+    vec2(-0.17497, -0.055957),
+    vec2(0.30198, -0.49570),
+    vec2(-0.84580, 0.40599),
+    vec2(-0.25414, 0.47697),
+    vec2(0.98356, -0.13102),
+    vec2(-0.10180, 0.032886),
+    vec2(0.032977, 0.24390),
+    vec2(0.66924, 0.032143),
+    vec2(-0.91677, 0.22138),
+};
+
+uint permutate(uint x) { return hash(x); }
+
+int determine_cascade_index(float clip_z) {
+    for (int i = 0; i < 4; i++) {
+        if (clip_z > lights.directional_light.min_zs_for_cascades[i]) {
+            return i;
+        }
+    }
+
+    return 3;
+}
+
+// sample_count points spread over the poisson disc, rotated by angle. the angle is changed per pixel & frame
+// so that the few samples turn into noise the temporal accumulation & the upsample filter out
+float calculate_direct_light_shadow_rotated(vec3 world_pos, vec3 normal, int cascade_index, float angle, int sample_count) {
+    // same offset & bias as the per pixel shadows of the lighting
+    const float normal_offset_value = 0.010;
+    const float base_bias           = 0.00025;
+
+    vec4 shadow_pos4 = lights.directional_light.proj_view[cascade_index] * vec4(world_pos + normal * (normal_offset_value * (cascade_index + 1)), 1.0);
+    vec3 shadow_pos  = shadow_pos4.xyz / shadow_pos4.w;
+    vec2 shadow_uv   = shadow_pos.xy * 0.5 + 0.5;
+
+    float bias = max(dot(lights.directional_light.dir.xyz, normal), 0.1) * base_bias * (cascade_index + 1);
+
+    mat2 rotation    = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+    vec2 poisson_mul = vec2(1.0) / vec2(textureSize(shadow_maps[0], 0).xy);
+    int stride       = max(poisson_table_size / sample_count, 1);
+
+    float is_lit = 0.0;
+    for (int i = 0; i < sample_count; i++) {
+        vec2 poisson_disc = rotation * poisson_table[(i * stride) % poisson_table_size];
+        is_lit += texture(shadow_maps[0], vec4(shadow_uv + poisson_disc * poisson_mul, cascade_index, shadow_pos.z + bias));
+    }
+
+    return is_lit / float(sample_count);
+}
+
+// the level the pages were requested for or the first coarser one whose page was drawn, lit when there is none
+float calculate_virtual_shadow(vec3 world_pos, vec3 normal, float distance) {
+    const float normal_offset_texels = 1.5;
+
+    float pool_pages  = float(vsm.sizes.z);
+    float page_texels = float(vsm.sizes.y);
+
+    for (int level = vsm_calculate_level(vsm, distance); level < int(vsm.sizes.w); level++) {
+        float texel_size = vsm.params.x * float(1 << level);
+        vec3 level_pos   = vsm_project(vsm, level, world_pos + normal * (normal_offset_texels * texel_size));
+        if (!vsm_is_in_window(level_pos.xy)) continue;
+
+        ivec2 local_page = vsm_local_page(vsm, level_pos.xy);
+        uint entry       = vsm_page_table[vsm_page_table_index(vsm, level, local_page)];
+        if (entry == 0) continue;
+
+        uint physical_page = entry - 1;
+        vec2 tile          = vec2(physical_page % vsm.sizes.z, physical_page / vsm.sizes.z) / pool_pages;
+
+        // kept half a texel inside the page so that the filtering doesn't read the neighbouring pages
+        float half_texel = 0.5 / page_texels;
+        vec2 page_uv     = clamp(level_pos.xy * float(vsm.sizes.x) - vec2(local_page), half_texel, 1.0 - half_texel);
+
+        return texture(vsm_pool, vec3(tile + page_uv / pool_pages, level_pos.z + vsm.params.w));
+    }
+
+    return 1.0;
+}
+
+#endif
@@ -26,4 +26,10 @@ float bayer8x8(float v, ivec2 f_coord) {
 
     return step(matrix[f_coord.x & 7][f_coord.y & 7], v);
 }
+
+// a 0..1 value per pixel whose neighbours differ a lot, offsetting the pixel every frame makes it change over time too
+float interleaved_gradient_noise(ivec2 f_coord, uint frame) {
+    vec2 p = vec2(f_coord) + 5.588238 * float(frame & 63u);
+    return fract(52.9829189 * fract(dot(p, vec2(0.06711056, 0.00583715))));
+}
 #endif
\ No newline at end of file
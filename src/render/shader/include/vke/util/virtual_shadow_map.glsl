@@ -0,0 +1,31 @@
+#ifndef VKE_VIRTUAL_SHADOW_MAP
+#define VKE_VIRTUAL_SHADOW_MAP
+
+#include <vke/sets/scene_data.h>
+
+// shared by the page requests & the lighting so that the pages that are sampled are the ones that were requested
+
+// the finest level whose texels aren't smaller than a pixel at the distance from the camera
+int vsm_calculate_level(in VirtualShadowMapData vsm, float distance) {
+    float pixel_size = vsm.params.y * distance;
+    return clamp(int(floor(log2(max(pixel_size / vsm.params.x, 1.0)))), 0, int(vsm.sizes.w) - 1);
+}
+
+// xy is the uv of the point in the window of the level, it is outside of 0..1 when the window doesn't contain it. z is the depth
+vec3 vsm_project(in VirtualShadowMapData vsm, int level, vec3 world_pos) {
+    vec4 p = vsm.level_proj_views[level] * vec4(world_pos, 1.0);
+    return vec3(p.xy * 0.5 + 0.5, p.z);
+}
+
+bool vsm_is_in_window(vec2 level_uv) { return all(greaterThanEqual(level_uv, vec2(0.0))) && all(lessThan(level_uv, vec2(1.0))); }
+
+// the page of the window the uv is in, 0..sizes.x
+ivec2 vsm_local_page(in VirtualShadowMapData vsm, vec2 level_uv) { return min(ivec2(level_uv * vsm.sizes.x), ivec2(vsm.sizes.x - 1)); }
+
+// mirrored by VirtualShadowPageTable::get_slot_index
+uint vsm_page_table_index(in VirtualShadowMapData vsm, int level, ivec2 local_page) {
+    ivec2 wrapped = (vsm.level_origins[level].xy + local_page) & ivec2(vsm.sizes.x - 1);
+    return (uint(level) * vsm.sizes.x + uint(wrapped.y)) * vsm.sizes.x + uint(wrapped.x);
+}
+
+#endif
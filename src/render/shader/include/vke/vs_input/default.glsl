@@ -1,10 +1,48 @@
 #ifndef VKE_UTL_VT_INPUT
 #define VKE_UTL_VT_INPUT
 
-layout(location = 0) in vec3 v_pos;
-layout(location = 1) in vec2 v_texture_coords;
-layout(location = 2) in vec3 v_normal;
+#include <vke/sets/scene_data.h>
 
-void setup_vt_input() { /*empty*/ }
+// the attributes are read as raw bits so that every VertexFormat can share these declarations.
+// missing components are filled by the input assembler and never read
+layout(location = 0) in uvec3 v_position_bits;
+layout(location = 1) in uvec2 v_texture_coord_bits;
+layout(location = 2) in uvec3 v_normal_bits;
 
-#endif
\ No newline at end of file
+vec3 v_pos;
+vec2 v_texture_coords;
+vec3 v_normal;
+
+float vt_unpack_snorm16(uint bits) { return max(float(int(bits << 16) >> 16) / 32767.0, -1.0); }
+
+vec3 vt_decode_octahedral(vec2 e) {
+    vec3 n  = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+// mirrors encode_vertices in vertex_format.cpp
+void setup_vt_input(MeshData mesh) {
+    if ((mesh.vertex_flags & VERTEX_FLAG_QUANTIZED_POSITION) != 0) {
+        v_pos = mesh.position_offset.xyz + vec3(v_position_bits) / 65535.0 * mesh.position_scale.xyz;
+    } else {
+        v_pos = uintBitsToFloat(v_position_bits);
+    }
+
+    if ((mesh.vertex_flags & VERTEX_FLAG_UNORM_UV) != 0) {
+        v_texture_coords = mesh.uv_transform.xy + vec2(v_texture_coord_bits) / 65535.0 * mesh.uv_transform.zw;
+    } else if ((mesh.vertex_flags & VERTEX_FLAG_HALF_UV) != 0) {
+        v_texture_coords = unpackHalf2x16(v_texture_coord_bits.x | (v_texture_coord_bits.y << 16));
+    } else {
+        v_texture_coords = uintBitsToFloat(v_texture_coord_bits);
+    }
+
+    if ((mesh.vertex_flags & VERTEX_FLAG_OCTAHEDRAL_NORMAL) != 0) {
+        v_normal = vt_decode_octahedral(vec2(vt_unpack_snorm16(v_normal_bits.x), vt_unpack_snorm16(v_normal_bits.y)));
+    } else {
+        v_normal = uintBitsToFloat(v_normal_bits);
+    }
+}
+
+#endif
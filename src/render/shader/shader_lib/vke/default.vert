@@ -11,13 +11,14 @@ layout(push_constant) uniform PC {
     mat4 p_model_matrix;
     mat4 p_normal_matrix;
     uint mode;
+    uint p_mesh_id;
 };
 
 mat4 model_matrix  = mode != 0 ? instance_draw_parameters[gl_InstanceIndex].model_matrix : p_model_matrix;
 mat4 normal_matrix = mode != 0 ? model_matrix : p_normal_matrix;
 
 void main() {
-    setup_vt_input();
+    setup_vt_input(meshes[p_mesh_id]);
 
     vec4 world_position = model_matrix * vec4(v_pos, 1.0);
     gl_Position         = scene_view.proj_view * vec4(world_position);
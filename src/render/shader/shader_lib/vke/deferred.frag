@@ -6,7 +6,6 @@
 #define PI 3.141592653589793
 
 #include <vke/sets/scene_data.h>
-#include <vke/util/hash.glsl>
 
 layout(set = DEFERRED_SET, binding = 0) uniform sampler2D textures[3];
 
@@ -21,48 +20,31 @@ layout(set = DEFERRED_SET, binding = 2) readonly buffer LightsBuffer {
 
 layout(set = DEFERRED_SET, binding = 3) uniform sampler2DArrayShadow shadow_maps[1];
 // layout(set = DEFERRED_SET,binding = 3) uniform samplerCubeArrayShadow shadow_point_maps[1];
+layout(set = DEFERRED_SET, binding = 4) uniform sampler2DShadow shadow_atlas;
+
+layout(set = DEFERRED_SET, binding = 5) readonly buffer PointLightShadowsBuffer {
+    PointLightShadow point_light_shadows[];
+};
+
+layout(set = DEFERRED_SET, binding = 6) readonly buffer VirtualShadowMapBuffer {
+    VirtualShadowMapData vsm;
+    uint vsm_page_table[];
+};
+layout(set = DEFERRED_SET, binding = 7) uniform sampler2DShadow vsm_pool;
+
+// the half resolution shadow term of the directional light, x is the term & y the distance of the texel to the camera
+layout(set = DEFERRED_SET, binding = 8) uniform sampler2D shadow_mask;
+layout(set = DEFERRED_SET, binding = 9) uniform ShadowMaskDataBuffer {
+    ShadowMaskData shadow_mask_data;
+};
+
+#include <vke/util/direct_shadow.glsl>
 
 float calculate_light_strength(vec3 light_dir, vec3 normal, vec3 view_dir);
 
 vec4 debug_color;
 vec4 clip;
 
-const int poisson_table_size           = 32;
-vec2 poisson_table[poisson_table_size] = {
-    vec2(0.087164, -0.25865),
-    vec2(-0.71380, -0.31938),
-    vec2(-0.42212, -0.37691),
-    vec2(-0.35237, -0.048855),
-    vec2(0.80181, -0.073725),
-    vec2(-0.050746, -0.59212),
-    vec2(-0.030902, 0.044495),
-    vec2(0.11101, -0.17909),
-    vec2(-0.11017, -0.0071830),
-    vec2(0.57569, 0.42861),
-    vec2(-0.33310, 0.83733),
-    vec2(0.42835, 0.87701),
-    vec2(-0.64454, -0.68726),
-    vec2(0.19806, 0.33082),
-    vec2(0.048796, 0.24135),
-    vec2(0.21022, -0.84828),
-    vec2(0.27345, 0.34345),
-    vec2(0.42546, -0.084226),
-    vec2(-0.56231, 0.17967),
-    vec2(0.0056380, -0.11294),
-    vec2(-0.16145, -0.076814),
-    vec2(-0.029326, -0.017768),
-    vec2(0.28798, 0.14798),
-    vec2(-0.17497, -0.055957),
-    vec2(0.30198, -0.49570),
-    vec2(-0.84580, 0.40599),
-    vec2(-0.25414, 0.47697),
-    vec2(0.98356, -0.13102),
-    vec2(-0.10180, 0.032886),
-    vec2(0.032977, 0.24390),
-    vec2(0.66924, 0.032143),
-    vec2(-0.91677, 0.22138),
-};
-
 float quad_average(float n) {
     float v = subgroupQuadSwapVertical(n);
     n       = (n + v) * 0.5;
@@ -73,8 +55,6 @@ float quad_average(float n) {
     return n;
 }
 
-uint permutate(uint x) { return hash(x); }
-
 vec2 calculate_direct_light_shadow(vec4 world_pos4, vec3 world_pos, vec3 normal, vec3 view_dir, int cascade_index) {
     // config
     const float normal_offset_value = 0.010;
@@ -133,14 +113,54 @@ vec2 calculate_direct_light_shadow(vec4 world_pos4, vec3 world_pos, vec3 normal,
     return vec2(is_lit, dist2border);
 }
 
-int determine_cascade_index(float clip_z) {
+// light_vec is from the light to the surface
+float calculate_point_light_shadow(int light_index, vec3 world_pos, vec3 normal, vec3 light_vec) {
+    PointLightShadow shadow = point_light_shadows[light_index];
+    if (shadow.params.x == 0.0) return 1.0;
+
+    // the face the direction falls into, in the order +x -x +y -y +z -z
+    vec3 a   = abs(light_vec);
+    int face = a.x >= a.y && a.x >= a.z ? (light_vec.x > 0.0 ? 0 : 1) : a.y >= a.z ? (light_vec.y > 0.0 ? 2 : 3) : (light_vec.z > 0.0 ? 4 : 5);
+
+    vec4 tile         = shadow.tile_rects[face];
+    float tile_texels = tile.z * textureSize(shadow_atlas, 0).x;
+
+    // the faces are 90 degrees wide, a texel covers 2 / tile_texels units at a distance of 1 along the face
+    float face_distance = max(a.x, max(a.y, a.z));
+    world_pos += normal * (shadow.params.y * 2.0 * face_distance / tile_texels);
+
+    vec4 shadow_pos4 = shadow.proj_view[face] * vec4(world_pos, 1.0);
+    vec3 shadow_pos  = shadow_pos4.xyz / shadow_pos4.w;
+
+    // kept half a texel inside the tile so that the filtering doesn't read the neighbouring tiles
+    float half_texel = 0.5 / tile_texels;
+    vec2 face_uv     = clamp(shadow_pos.xy * 0.5 + 0.5, half_texel, 1.0 - half_texel);
+
+    return texture(shadow_atlas, vec3(tile.xy + face_uv * tile.zw, shadow_pos.z + shadow.params.z));
+}
+
+// bilinear weights of the 4 closest texels of the mask, scaled down by how far their distances are from the pixel's
+// so that the texels of the surfaces behind or in front of it don't bleed over edges
+float upsample_shadow_mask(float distance) {
+    ivec2 size    = textureSize(shadow_mask, 0);
+    vec2 position = gl_FragCoord.xy * 0.5 - 0.5;
+    ivec2 base    = ivec2(floor(position));
+    vec2 f        = position - vec2(base);
+
+    float total_weight = 0.0;
+    float is_lit       = 0.0;
     for (int i = 0; i < 4; i++) {
-        if (clip_z > lights.directional_light.min_zs_for_cascades[i]) {
-            return i;
-        }
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        vec2 m       = texelFetch(shadow_mask, clamp(base + offset, ivec2(0), size - 1), 0).xy;
+
+        float bilinear = (offset.x == 1 ? f.x : 1.0 - f.x) * (offset.y == 1 ? f.y : 1.0 - f.y);
+        float weight   = bilinear / (abs(m.y - distance) / distance + 0.001);
+
+        is_lit += m.x * weight;
+        total_weight += weight;
     }
 
-    return 3;
+    return total_weight > 0.0 ? is_lit / total_weight : 1.0;
 }
 
 vec3 calculate_direct_light(vec4 world_pos4, vec3 world_pos, vec3 normal, vec3 view_dir) {
@@ -165,8 +185,16 @@ vec3 calculate_direct_light(vec4 world_pos4, vec3 world_pos, vec3 normal, vec3 v
     //     is_lit = 1.0;
     // }
 
-    int cascade = determine_cascade_index(clip.z);
-    is_lit      = calculate_direct_light_shadow(world_pos4, world_pos, normal, view_dir, cascade).x;
+    float distance = length(world_pos - vec3(view.view_world_pos.xyz));
+
+    if (shadow_mask_data.params.w != 0.0) {
+        is_lit = upsample_shadow_mask(distance);
+    } else if (vsm.params.z != 0.0) {
+        is_lit = calculate_virtual_shadow(world_pos, normal, distance);
+    } else {
+        int cascade = determine_cascade_index(clip.z);
+        is_lit      = calculate_direct_light_shadow(world_pos4, world_pos, normal, view_dir, cascade).x;
+    }
 
     is_lit = quad_average(is_lit);
 
@@ -192,6 +220,7 @@ vec3 calculate_total_light(vec4 world_pos4, vec3 world_pos, vec3 normal, vec3 vi
             float strength = calculate_light_strength(light_dir, normal, view_dir);
             float mul      = 1.0 - (d / p.range);
             strength *= mul * mul;
+            strength *= calculate_point_light_shadow(i, world_pos, normal, light_dir * d);
             total_light += p.color.xyz * strength;
 
             // total_light += normalize(light_dir);
@@ -0,0 +1,35 @@
+#version 460
+
+#include <vke/sets/scene_set.glsl>
+#include <vke/sets/view_set.glsl>
+
+#include <vke/vs_input/default.glsl>
+
+// vertex shader of views that draw into a tile of the shadow atlas. the view is squeezed into scene_view.atlas_rect
+// and the clip distances cut it at the edges of the tile so that it doesn't draw over the neighbouring ones
+
+layout(push_constant) uniform PC {
+    mat4 p_model_matrix;
+    mat4 p_normal_matrix;
+    uint mode;
+    uint p_mesh_id;
+};
+
+out float gl_ClipDistance[4];
+
+void main() {
+    setup_vt_input(meshes[p_mesh_id]);
+
+    mat4 model_matrix = mode != 0 ? instance_draw_parameters[gl_InstanceIndex].model_matrix : p_model_matrix;
+
+    vec4 clip = scene_view.proj_view * model_matrix * vec4(v_pos, 1.0);
+
+    gl_ClipDistance[0] = clip.w + clip.x;
+    gl_ClipDistance[1] = clip.w - clip.x;
+    gl_ClipDistance[2] = clip.w + clip.y;
+    gl_ClipDistance[3] = clip.w - clip.y;
+
+    // maps -w..w onto the ndc range of the tile
+    vec2 tile_offset = scene_view.atlas_rect.xy * 2.0 - 1.0 + scene_view.atlas_rect.zw;
+    gl_Position      = vec4(clip.xy * scene_view.atlas_rect.zw + tile_offset * clip.w, clip.zw);
+}
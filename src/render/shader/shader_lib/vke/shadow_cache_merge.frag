@@ -0,0 +1,21 @@
+#version 450
+
+// merges the cached static casters into a shadow map layer the dynamic casters were drawn into,
+// the depth test keeps the closer one of the two
+
+layout(set = 0, binding = 0) uniform sampler2DArray static_shadow_maps;
+
+layout(push_constant) uniform Push {
+    uint layer;
+};
+
+layout(location = 0) in vec2 f_uv;
+
+void main() {
+    float depth = texelFetch(static_shadow_maps, ivec3(gl_FragCoord.xy, layer), 0).x;
+
+    // the layer is already cleared to the far plane
+    if (depth == 0.0) discard;
+
+    gl_FragDepth = depth;
+}
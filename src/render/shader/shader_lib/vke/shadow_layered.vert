@@ -0,0 +1,28 @@
+#version 460
+
+#include <vke/sets/scene_set.glsl>
+#include <vke/sets/view_set.glsl>
+
+#include <vke/vs_input/default.glsl>
+
+// vertex shader of layered shadow passes, the vertices are transformed into the layers by shadow_layered.geom
+
+layout(push_constant) uniform PC {
+    mat4 p_model_matrix;
+    mat4 p_normal_matrix;
+    uint mode;
+    uint p_mesh_id;
+};
+
+// the instance draw parameter of the vertex, ~0 for draws that don't have one
+layout(location = 0) flat out uint g_draw_slot;
+
+void main() {
+    setup_vt_input(meshes[p_mesh_id]);
+
+    mat4 model_matrix = mode != 0 ? instance_draw_parameters[gl_InstanceIndex].model_matrix : p_model_matrix;
+
+    // world space, each layer has its own projection
+    gl_Position = model_matrix * vec4(v_pos, 1.0);
+    g_draw_slot = mode != 0 ? gl_InstanceIndex : ~0u;
+}
@@ -0,0 +1,78 @@
+#include "cascade_scheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace vke {
+
+namespace {
+
+// until a cascade has been timed it is assumed to take this much
+constexpr double DEFAULT_CASCADE_MS = 0.5;
+// weight of the newest timing in the running average of a cascade
+constexpr double COST_SMOOTHING = 0.2;
+
+float calculate_priority(const CascadeScheduler::CascadeInput& input, u32 frames_waited) {
+    if (!input.is_matrix_changed && !input.requires_rerender) return 0.f;
+
+    // a cascade moving by a whole width shows as much error as a snap. dynamic casters add less per caster the more of them there are
+    float urgency = (input.is_matrix_changed ? 1.f : 0.f) + input.camera_motion * 8.f + std::log2(1.f + static_cast<float>(input.dynamic_casters)) * 0.25f;
+
+    // the waiting time grows the priority so that no cascade is starved by the others
+    return std::max(urgency, 0.1f) * static_cast<float>(frames_waited + 1);
+}
+
+} // namespace
+
+CascadeScheduler::CascadeScheduler(u32 cascade_count) {
+    m_decisions.resize(cascade_count, CascadeDecision{.estimated_ms = DEFAULT_CASCADE_MS});
+    m_order.resize(cascade_count);
+}
+
+std::span<const CascadeScheduler::CascadeDecision> CascadeScheduler::schedule(std::span<const CascadeInput> inputs, bool is_budgeted) {
+    assert(inputs.size() == m_decisions.size());
+
+    for (u32 i = 0; i < inputs.size(); i++) {
+        auto& decision          = m_decisions[i];
+        decision.priority       = calculate_priority(inputs[i], decision.frames_waited);
+        decision.is_scheduled   = false;
+        decision.is_over_budget = false;
+    }
+
+    std::iota(m_order.begin(), m_order.end(), 0);
+    std::sort(m_order.begin(), m_order.end(), [&](u32 a, u32 b) { return m_decisions[a].priority > m_decisions[b].priority; });
+
+    double used_ms = 0.0;
+    for (u32 index : m_order) {
+        auto& decision = m_decisions[index];
+        if (decision.priority <= 0.f) break;
+
+        bool fits = !is_budgeted || used_ms + decision.estimated_ms <= budget_ms;
+
+        // the most urgent cascade is always updated, even when it alone is over the budget
+        if (!fits && used_ms > 0.0) continue;
+
+        decision.is_scheduled   = true;
+        decision.is_over_budget = !fits;
+        used_ms += decision.estimated_ms;
+    }
+
+    for (auto& decision : m_decisions) {
+        if (decision.is_scheduled || decision.priority <= 0.f) {
+            decision.frames_waited = 0;
+        } else {
+            decision.frames_waited++;
+        }
+    }
+
+    return m_decisions;
+}
+
+void CascadeScheduler::record_cost(u32 cascade_index, double milliseconds) {
+    auto& estimate = m_decisions[cascade_index].estimated_ms;
+    estimate += (milliseconds - estimate) * COST_SMOOTHING;
+}
+
+} // namespace vke
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "common.hpp"
+
+namespace vke {
+
+// picks the cascades that are refitted & redrawn in a frame. every cascade that needs an update gets a priority and they are
+// taken in the order of it until the gpu time they took the last time they were drawn fills the budget
+class CascadeScheduler {
+public:
+    struct CascadeInput {
+        float camera_motion;    // how far the camera moved since the cascade was updated, in widths of the cascade
+        bool is_matrix_changed; // the newly fitted cascade is different, stable cascades only change when they snap to another texel
+        bool requires_rerender; // the shadow map asks for it, the static casters or the dynamic ones changed
+        u64 dynamic_casters;    // of the last time the cascade was drawn
+    };
+
+    struct CascadeDecision {
+        float priority      = 0.f; // 0 when the cascade doesn't need an update
+        double estimated_ms = 0.0;
+        u32 frames_waited   = 0; // frames the cascade needed an update and didn't get it
+        bool is_scheduled   = false;
+        bool is_over_budget = false; // the most urgent cascade is scheduled even when it alone doesn't fit
+    };
+
+    explicit CascadeScheduler(u32 cascade_count);
+
+    // when is_budgeted is false every cascade that needs an update is scheduled
+    std::span<const CascadeDecision> schedule(std::span<const CascadeInput> inputs, bool is_budgeted = true);
+    std::span<const CascadeDecision> get_decisions() const { return m_decisions; }
+
+    // gpu time a cascade took, read back from GPUTimingSystem
+    void record_cost(u32 cascade_index, double milliseconds);
+
+    float budget_ms = 1.5f;
+
+private:
+    std::vector<CascadeDecision> m_decisions;
+    std::vector<u32> m_order;
+};
+
+} // namespace vke
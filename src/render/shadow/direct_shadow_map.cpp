@@ -1,8 +1,11 @@
 #include "direct_shadow_map.hpp"
 
+#include <cmath>
 #include <format>
 #include <vke/pipeline_loader.hpp>
+#include <vke/vke_builders.hpp>
 
+#include "render/debug/gpu_timing_system.hpp"
 #include "render/object_renderer/hierarchical_z_buffers.hpp"
 #include "render/object_renderer/object_renderer.hpp"
 #include "render/object_renderer/resource_manager.hpp"
@@ -19,53 +22,105 @@ DirectShadowMap::DirectShadowMap(RenderServer* render_server, u32 texture_size,
     builder.set_layer_count(layers);
     m_layer_count = layers;
     m_shadow_maps_waiting_for_rerender.resize(layers, true);
+    m_static_caches.resize(layers);
     u32 depth = builder.add_attachment(VK_FORMAT_D16_UNORM, VkClearValue{.depthStencil = {.depth = 0.0}}, true);
     builder.add_subpass({}, depth, {});
     m_shadow_pass = builder.build(texture_size, texture_size);
     m_shadow_map  = m_shadow_pass->get_attachment_view(depth);
 
+    // same attachments so the shadowD16 pipelines are compatible with it
+    m_static_pass       = builder.build(texture_size, texture_size);
+    m_static_shadow_map = m_static_pass->get_attachment_view(depth);
+
     m_render_server   = render_server;
     m_object_renderer = m_render_server->get_object_renderer();
 
-    auto& pgp_subpasses = m_render_server->get_pipeline_loader()->get_pipeline_globals_provider()->subpasses;
+    auto pipeline_loader_lock = m_render_server->lock_pipeline_loader();
+    auto& pgp_subpasses       = m_render_server->get_pipeline_loader()->get_pipeline_globals_provider()->subpasses;
     if (!pgp_subpasses.contains(shadowD16)) {
         m_shadow_pass->get_render_target_description(0).depth_compare_op = VK_COMPARE_OP_GREATER_OR_EQUAL;
 
         pgp_subpasses[shadowD16] = m_shadow_pass->get_subpass(0)->create_copy();
 
+        pgp_subpasses[shadowD16_layered] = m_shadow_pass->get_subpass(0)->create_copy();
+
         auto* resource_manager = m_render_server->get_object_renderer()->get_resource_manager();
         resource_manager->add_pipeline2multi_pipeline(ObjectRenderer::pbr_pipeline_name, "vke::shadowD16::default");
+        resource_manager->add_pipeline2multi_pipeline(ObjectRenderer::pbr_pipeline_name, "vke::shadowD16_layered::default");
     }
+    pipeline_loader_lock.unlock();
 
     u32 base_shadow_map_index = id_counter.fetch_add(1);
     for (int i = 0; i < layers; i++) {
 
         auto render_target_name = std::format("DirectShadowMapPass_{}:{}", base_shadow_map_index, i);
 
-        m_render_server->get_object_renderer()->create_render_target(render_target_name, shadowD16, {true});
+        auto static_render_target_name = render_target_name + ":static";
+
+        m_object_renderer->create_render_target(render_target_name, shadowD16, {.allow_indirect_render = true, .instance_filter = InstanceFilter::DYNAMIC, .framebuffer_height = texture_size});
+        m_object_renderer->create_render_target(static_render_target_name, shadowD16, {.allow_indirect_render = true, .instance_filter = InstanceFilter::STATIC, .framebuffer_height = texture_size});
 
         auto camera = std::make_unique<vke::OrthographicCamera>();
         m_object_renderer->set_camera(render_target_name, camera.get());
+        m_object_renderer->set_camera(static_render_target_name, camera.get());
+        m_static_render_target_names.push_back(std::move(static_render_target_name));
 
         m_cameras.push_back(std::move(camera));
 
-        if(false){
-            auto sub_view = dynamic_cast<vke::Image*>(m_shadow_map.get())->create_subview(SubViewArgs{
-                .base_layer  = static_cast<u32>(i),
-                .layer_count = 1,
-                .view_type   = VK_IMAGE_VIEW_TYPE_2D,
-            });
-    
-            m_hz_buffers.push_back(std::make_unique<HierarchicalZBuffers>(m_render_server, sub_view.get()));
-            m_sub_views.push_back(std::move(sub_view));
-            m_object_renderer->set_hzb(render_target_name, m_hz_buffers.back().get());
-        }
-
         m_render_target_names.push_back(std::move(render_target_name));
     }
+
+    std::vector<Camera*> layer_cameras;
+    for (auto& camera : m_cameras) layer_cameras.push_back(camera.get());
+
+    m_layered_render_target_name = std::format("DirectShadowMapPass_{}:layered", base_shadow_map_index);
+    m_object_renderer->create_render_target(m_layered_render_target_name, shadowD16_layered, {.allow_indirect_render = true, .framebuffer_height = texture_size});
+    m_object_renderer->set_camera(m_layered_render_target_name, m_cameras[0].get());
+    m_object_renderer->set_layer_cameras(m_layered_render_target_name, layer_cameras);
+
+    create_layered_framebuffer(texture_size);
+    create_static_cache_set();
+    m_static_merge_pipeline = m_render_server->load_pipeline("vke::shadowD16::static_cache_merge");
+}
+
+void DirectShadowMap::create_static_cache_set() {
+    const std::string set_layout_name = "vke::shadow_static_cache_set";
+
+    VkDescriptorSetLayout set_layout;
+    {
+        auto lock         = m_render_server->lock_pipeline_loader();
+        auto& set_layouts = m_render_server->get_pipeline_loader()->get_pipeline_globals_provider()->set_layouts;
+        if (!set_layouts.contains(set_layout_name)) {
+            vke::DescriptorSetLayoutBuilder layout_builder;
+            layout_builder.add_image_sampler(VK_SHADER_STAGE_FRAGMENT_BIT);
+            set_layouts[set_layout_name] = layout_builder.build();
+        }
+        set_layout = set_layouts[set_layout_name];
+    }
+
+    vke::DescriptorSetBuilder builder;
+    builder.add_image_sampler(m_static_shadow_map.get(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_object_renderer->get_resource_manager()->get_nearest_sampler(), VK_SHADER_STAGE_FRAGMENT_BIT);
+    m_static_cache_set = builder.build(m_render_server->get_descriptor_pool(), set_layout);
+}
+
+void DirectShadowMap::create_layered_framebuffer(u32 texture_size) {
+    VkImageView attachment = m_shadow_map->view();
+
+    VkFramebufferCreateInfo info{
+        .sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .renderPass      = m_shadow_pass->handle(),
+        .attachmentCount = 1,
+        .pAttachments    = &attachment,
+        .width           = texture_size,
+        .height          = texture_size,
+        .layers          = m_layer_count,
+    };
+
+    VK_CHECK(vkCreateFramebuffer(VulkanContext::get_context()->get_device(), &info, nullptr, &m_layered_framebuffer));
 }
 
 DirectShadowMap::~DirectShadowMap() {
+    vkDestroyFramebuffer(VulkanContext::get_context()->get_device(), m_layered_framebuffer, nullptr);
 }
 
 glm::mat4 DirectShadowMap::get_projection_view_matrix(u32 i, u32) { return m_cameras[i]->proj_view(); }
@@ -73,41 +128,224 @@ glm::mat4 DirectShadowMap::get_projection_view_matrix(u32 i, u32) { return m_cam
 void DirectShadowMap::render(vke::CommandBuffer& primary_buffer, u32 layer_index, std::vector<LateRasterData>* raster_buffers) {
     assert(layer_index < m_layer_count);
 
+    auto& cache               = m_static_caches[layer_index];
+    cache.was_rebuilt         = !is_static_cache_valid(layer_index);
+    cache.had_dynamic_casters = m_object_renderer->get_dynamic_instance_count() > 0;
+
+    // the static pass has to come first, the merge below samples it
+    if (cache.was_rebuilt) render_static_cache(primary_buffer, layer_index, raster_buffers);
+
     RCResource<vke::CommandBuffer> shadow_pass_cmd = m_render_server->get_framely_command_pool()->allocate(false);
 
     m_shadow_pass->set_active_frame_buffer_instance(layer_index);
     shadow_pass_cmd->begin_secondary(m_shadow_pass->get_subpass(0));
 
+    if (cache.had_dynamic_casters) {
+        m_object_renderer->render(RenderArguments{
+            .subpass_cmd        = shadow_pass_cmd.get(),
+            .compute_cmd        = &primary_buffer,
+            .render_target_name = m_render_target_names[layer_index],
+        });
+    }
+
+    // drawn after the dynamic casters so that the depth test keeps the closer one of the two
+    shadow_pass_cmd->bind_pipeline(m_static_merge_pipeline.get());
+    shadow_pass_cmd->bind_descriptor_set(0, m_static_cache_set);
+    shadow_pass_cmd->push_constant(&layer_index);
+    shadow_pass_cmd->draw(3, 1, 0, 0);
+
+    shadow_pass_cmd->end();
+
+    submit_pass(primary_buffer, m_shadow_pass.get(), std::move(shadow_pass_cmd), layer_index, raster_buffers);
+
+    m_shadow_maps_waiting_for_rerender[layer_index] = false;
+}
+
+void DirectShadowMap::render_layered(vke::CommandBuffer& primary_buffer, std::vector<LateRasterData>* raster_buffers) {
+    RCResource<vke::CommandBuffer> shadow_pass_cmd = m_render_server->get_framely_command_pool()->allocate(false);
+
+    shadow_pass_cmd->begin_secondary(m_shadow_pass->get_subpass(0));
+
+    // a single cull for every layer, it records which of the layers each instance is visible in
     m_object_renderer->render(RenderArguments{
         .subpass_cmd        = shadow_pass_cmd.get(),
         .compute_cmd        = &primary_buffer,
-        .render_target_name = m_render_target_names[layer_index],
+        .render_target_name = m_layered_render_target_name,
     });
 
     shadow_pass_cmd->end();
 
+    submit_pass(primary_buffer, m_shadow_pass.get(), std::move(shadow_pass_cmd), 0, raster_buffers, m_layered_framebuffer);
+
+    std::fill(m_shadow_maps_waiting_for_rerender.begin(), m_shadow_maps_waiting_for_rerender.end(), false);
+}
+
+u64 DirectShadowMap::get_layered_caster_count() const { return m_object_renderer->get_drawn_instance_count(m_layered_render_target_name); }
+
+void DirectShadowMap::set_shadow_receivers(u32 layer_index, const std::optional<ReceiverData>& receivers, HierarchicalZBuffers* receiver_hzb) {
+    m_object_renderer->set_shadow_receivers(m_render_target_names[layer_index], receivers, receiver_hzb);
+}
+
+void DirectShadowMap::set_occlusion_culling(bool is_enabled) {
+    if (m_occlusion_culling == is_enabled) return;
+    m_occlusion_culling = is_enabled;
+
+    if (is_enabled && m_hz_buffers.empty()) {
+        // the dynamic targets aren't culled, their hzb binding is taken by the receivers & the dynamic casters of a frame
+        // would hide static casters from a cache that outlives them
+        for (u32 i = 0; i < m_layer_count; i++) {
+            auto sub_view = dynamic_cast<vke::Image*>(m_static_shadow_map.get())->create_subview(SubViewArgs{
+                .base_layer  = i,
+                .layer_count = 1,
+                .view_type   = VK_IMAGE_VIEW_TYPE_2D,
+            });
+
+            m_hz_buffers.push_back(std::make_unique<HierarchicalZBuffers>(m_render_server, sub_view.get()));
+            m_sub_views.push_back(std::move(sub_view));
+        }
+    }
+
+    // the hzbs are attached by the next rebuild of each layer
+    if (!is_enabled) {
+        for (u32 i = 0; i < m_layer_count; i++) {
+            auto& cache = m_static_caches[i];
+            if (!cache.is_hzb_attached) continue;
+
+            m_object_renderer->set_hzb(m_static_render_target_names[i], nullptr);
+            cache.is_hzb_attached = false;
+        }
+    }
+}
+
+void DirectShadowMap::update_occlusion_culling(u32 layer_index) {
+    auto& cache = m_static_caches[layer_index];
+
+    // the layer holds nothing that could be reprojected before it is drawn for the first time
+    if (!m_occlusion_culling || cache.rebuild_count == 0) return;
+
+    auto* hzb = m_hz_buffers[layer_index].get();
+    if (!cache.is_hzb_attached) {
+        // it was last drawn without the hzb, the matrix the hzb has is of an older draw
+        hzb->invalidate();
+        m_object_renderer->set_hzb(m_static_render_target_names[layer_index], hzb);
+        cache.is_hzb_attached = true;
+        return;
+    }
+
+    auto* camera = m_cameras[layer_index].get();
+
+    // casters that were removed may have hidden the ones behind them, a turned light sees different sides of the casters
+    bool is_static_scene_changed = cache.static_revision != m_object_renderer->get_static_revision();
+    bool is_light_turned         = glm::dot(cache.light_direction, camera->forward()) < 0.99999f;
+
+    // the center of the new fit in the clip space of the old one, most of the new fit isn't covered by the old depth when it moved more than half of its size
+    glm::vec4 center  = hzb->get_hzb_proj_view() * glm::inverse(camera->proj_view()) * glm::vec4(0.f, 0.f, 0.5f, 1.f);
+    bool is_far_moved = std::abs(center.x / center.w) > 1.f || std::abs(center.y / center.w) > 1.f;
+
+    if (is_static_scene_changed || is_light_turned || is_far_moved) {
+        hzb->invalidate();
+        cache.occlusion_fallback_count++;
+    }
+}
+
+void DirectShadowMap::render_static_cache(vke::CommandBuffer& primary_buffer, u32 layer_index, std::vector<LateRasterData>* raster_buffers) {
+    update_occlusion_culling(layer_index);
+
+    RCResource<vke::CommandBuffer> static_pass_cmd = m_render_server->get_framely_command_pool()->allocate(false);
+
+    m_static_pass->set_active_frame_buffer_instance(layer_index);
+    static_pass_cmd->begin_secondary(m_static_pass->get_subpass(0));
+
+    m_object_renderer->render(RenderArguments{
+        .subpass_cmd        = static_pass_cmd.get(),
+        .compute_cmd        = &primary_buffer,
+        .render_target_name = m_static_render_target_names[layer_index],
+    });
+
+    static_pass_cmd->end();
+
+    submit_pass(primary_buffer, m_static_pass.get(), std::move(static_pass_cmd), layer_index, raster_buffers);
+
+    auto& cache           = m_static_caches[layer_index];
+    cache.is_valid        = true;
+    cache.static_revision = m_object_renderer->get_static_revision();
+    cache.light_direction = m_cameras[layer_index]->forward();
+    cache.rebuild_count++;
+}
+
+void DirectShadowMap::submit_pass(vke::CommandBuffer& primary_buffer, Renderpass* renderpass, RCResource<vke::CommandBuffer> pass_cmd, u32 layer_index, std::vector<LateRasterData>* raster_buffers, VkFramebuffer layered_framebuffer) {
+    LateRasterData raster_data{
+        .render_buffer       = std::move(pass_cmd),
+        .shadow_renderpass   = renderpass,
+        .layer_index         = layer_index,
+        .layered_framebuffer = layered_framebuffer,
+    };
+
     if (raster_buffers) {
-        raster_buffers->push_back(LateRasterData{
-            .render_buffer     = std::move(shadow_pass_cmd),
-            .shadow_renderpass = m_shadow_pass.get(),
-            .layer_index       = layer_index,
-        });
+        raster_buffers->push_back(std::move(raster_data));
     } else {
-        m_shadow_pass->set_external(true);
-        m_shadow_pass->begin(primary_buffer);
-
-        primary_buffer.execute_secondaries(shadow_pass_cmd.get());
-        m_shadow_pass->end(primary_buffer);
+        std::vector<LateRasterData> rasters;
+        rasters.push_back(std::move(raster_data));
 
-        primary_buffer.add_execution_dependency(shadow_pass_cmd->get_reference());
+        execute_late_rasters(primary_buffer, rasters);
     }
+}
 
-    m_shadow_maps_waiting_for_rerender[layer_index] = false;
+bool DirectShadowMap::is_static_cache_valid(u32 layer_index) const {
+    auto& cache = m_static_caches[layer_index];
+    return cache.is_valid && cache.static_revision == m_object_renderer->get_static_revision();
+}
+
+bool DirectShadowMap::requires_rerender(u32 index) const {
+    // dynamic casters may have moved since the last frame
+    return m_shadow_maps_waiting_for_rerender[index] || !is_static_cache_valid(index) || m_object_renderer->get_dynamic_instance_count() > 0;
+}
+
+DirectShadowMap::CacheStats DirectShadowMap::get_cache_stats(u32 layer_index) const {
+    auto& cache = m_static_caches[layer_index];
+
+    u64 static_casters  = m_object_renderer->get_drawn_instance_count(m_static_render_target_names[layer_index]);
+    u64 dynamic_casters = cache.had_dynamic_casters ? m_object_renderer->get_drawn_instance_count(m_render_target_names[layer_index]) : 0;
+
+    u64 occluded_casters = cache.was_rebuilt && cache.is_hzb_attached ? m_object_renderer->get_occlusion_culled_instance_count(m_static_render_target_names[layer_index]) : 0;
+
+    return CacheStats{
+        .cached_casters      = cache.was_rebuilt ? 0 : static_casters,
+        .redrawn_casters     = dynamic_casters + (cache.was_rebuilt ? static_casters : 0),
+        .rebuild_count       = cache.rebuild_count,
+        .occluded_casters    = occluded_casters,
+        .occlusion_fallbacks = cache.occlusion_fallback_count,
+    };
+}
+
+u64 DirectShadowMap::get_dynamic_caster_count(u32 layer_index) const {
+    return m_static_caches[layer_index].had_dynamic_casters ? m_object_renderer->get_drawn_instance_count(m_render_target_names[layer_index]) : 0;
+}
+
+std::optional<double> DirectShadowMap::get_gpu_time(u32 layer_index) const {
+    auto* timer = m_render_server->get_gpu_timing_system();
+
+    // the labels are the ones IndirectModelRenderer stamps around the cull & the draw of each render target
+    auto render_target_time = [&](const std::string& name) -> std::optional<double> {
+        auto cull_time = timer->get_time_between(std::format("cull start for render target: {}", name), std::format("cull end for render target: {}", name));
+        auto draw_time = timer->get_time_between(std::format("rendering start for render target: {}", name), std::format("rendering end for render target: {}", name));
+        if (!cull_time || !draw_time) return std::nullopt;
+
+        return *cull_time + *draw_time;
+    };
+
+    auto dynamic_time = render_target_time(m_render_target_names[layer_index]);
+    auto static_time  = render_target_time(m_static_render_target_names[layer_index]);
+    if (!dynamic_time && !static_time) return std::nullopt;
+
+    return dynamic_time.value_or(0.0) + static_time.value_or(0.0);
 }
 
 void DirectShadowMap::set_camera_data(const ShadowMapCameraData& camera_data, u32 layer_index) {
     auto* cam = m_cameras[layer_index].get();
 
+    glm::mat4 old_proj_view = cam->proj_view();
+
     cam->set_world_pos(camera_data.position);
     cam->set_rotation(camera_data.direction, camera_data.up);
     cam->z_far       = camera_data.far;
@@ -116,7 +354,11 @@ void DirectShadowMap::set_camera_data(const ShadowMapCameraData& camera_data, u3
     cam->half_width  = camera_data.width / 2.0f;
     cam->update();
 
-    m_shadow_maps_waiting_for_rerender[layer_index] = true;
+    // the cached layers stay valid while the cascade doesn't move, a change of the light direction moves it too
+    if (cam->proj_view() != old_proj_view) {
+        m_static_caches[layer_index].is_valid           = false;
+        m_shadow_maps_waiting_for_rerender[layer_index] = true;
+    }
 }
 
 glm::dvec3 DirectShadowMap::get_camera_position(u32 index) {
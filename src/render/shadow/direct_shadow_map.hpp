@@ -3,9 +3,11 @@
 #include <vke/vke.hpp>
 
 #include <memory>
+#include <optional>
 
 #include "fwd.hpp"
 #include "ishadow_map.hpp"
+#include "render/shader/scene_data.h"
 
 namespace vke {
 
@@ -26,9 +28,60 @@ public:
 
     void render(vke::CommandBuffer& primary_buffer, u32, std::vector<LateRasterData>* raster_buffers) override;
 
-    bool requires_rerender(u32 index) const override { return m_shadow_maps_waiting_for_rerender[index]; }
+    bool requires_rerender(u32 index) const override;
+
+    struct CacheStats {
+        u64 cached_casters;      // static casters that were reused from the cache
+        u64 redrawn_casters;     // the dynamic casters and the static ones when the cache was rebuilt
+        u32 rebuild_count;       // times the static cache of the layer was rebuilt
+        u64 occluded_casters;    // static casters the depth of the previous rebuild culled, 0 when it wasn't rebuilt
+        u32 occlusion_fallbacks; // rebuilds that weren't occlusion culled as the previous depth couldn't be reused
+    };
+
+    // of the last render of the layer, the caster counts are read back from the gpu so they lag a few frames behind
+    CacheStats get_cache_stats(u32 layer_index) const;
+    u64 get_dynamic_caster_count(u32 layer_index) const;
+    // gpu time of the culling & drawing of the layer in the frame GPUTimingSystem read back last, nullopt if it wasn't drawn in it
+    std::optional<double> get_gpu_time(u32 layer_index) const;
+    bool is_static_cache_valid(u32 layer_index) const;
+
+    // draws every layer in a single pass that sends each caster only to the layers it is visible in.
+    // it doesn't use the static caches, all of the layers are redrawn when one of them has to be
+    void set_layered_rendering(bool is_enabled) { m_layered_rendering = is_enabled; }
+    bool is_layered_rendering_enabled() const { return m_layered_rendering; }
+    void render_layered(vke::CommandBuffer& primary_buffer, std::vector<LateRasterData>* raster_buffers);
+    // casters drawn by the last layered pass, each is counted once no matter how many layers it was drawn into
+    u64 get_layered_caster_count() const;
+
+    // only the dynamic casters of a layer are culled against the receivers, they are redrawn every frame anyway
+    // while the static caches & the layered pass would have to be redrawn whenever the camera moves
+    void set_shadow_receivers(u32 layer_index, const std::optional<ReceiverData>& receivers, HierarchicalZBuffers* receiver_hzb);
+
+    // a rebuild of a static cache culls the casters hidden behind the depth the layer was drawn with last time, reprojected into the new fit.
+    // it falls back to drawing every caster when that depth doesn't fit anymore, e.g. the light turned or the static scene changed
+    void set_occlusion_culling(bool is_enabled);
+    bool is_occlusion_culling_enabled() const { return m_occlusion_culling; }
 
 private:
+    void render_static_cache(vke::CommandBuffer& primary_buffer, u32 layer_index, std::vector<LateRasterData>* raster_buffers);
+    void submit_pass(vke::CommandBuffer& primary_buffer, Renderpass* renderpass, RCResource<vke::CommandBuffer> pass_cmd, u32 layer_index, std::vector<LateRasterData>* raster_buffers, VkFramebuffer layered_framebuffer = VK_NULL_HANDLE);
+    void create_static_cache_set();
+    void create_layered_framebuffer(u32 texture_size);
+    // attaches the hzb of the layer to its static render target & decides whether the next rebuild can be culled against it
+    void update_occlusion_culling(u32 layer_index);
+
+private:
+    struct StaticCache {
+        bool is_valid                = false;
+        u64 static_revision          = 0; // ObjectRenderer::get_static_revision when it was drawn
+        bool was_rebuilt             = false;
+        bool had_dynamic_casters     = false;
+        u32 rebuild_count            = 0;
+        glm::vec3 light_direction    = glm::vec3(0); // the forward of the camera when it was drawn
+        bool is_hzb_attached         = false;
+        u32 occlusion_fallback_count = 0;
+    };
+
     vke::RCResource<vke::IImageView> m_shadow_map;
     std::unique_ptr<vke::Renderpass> m_shadow_pass;
     RenderServer* m_render_server;
@@ -37,8 +90,25 @@ private:
     std::vector<std::unique_ptr<vke::OrthographicCamera>> m_cameras;
     std::vector<bool> m_shadow_maps_waiting_for_rerender;
     u32 m_layer_count = 0;
+    // a layer of m_static_shadow_map & its hzb for every layer, created when occlusion culling is enabled for the first time.
+    // they are kept after it is disabled, the view sets of the frames in flight may still use them
     std::vector<std::unique_ptr<vke::IImageView>> m_sub_views;
     std::vector<RCResource<HierarchicalZBuffers>> m_hz_buffers;
+    bool m_occlusion_culling = false;
+
+    // static casters are drawn into layers of their own only when the cascade moves or the static scene changes.
+    // the dynamic casters are drawn into the shadow map every frame and the cache is merged on top of them
+    std::unique_ptr<vke::Renderpass> m_static_pass;
+    vke::RCResource<vke::IImageView> m_static_shadow_map;
+    std::vector<std::string> m_static_render_target_names;
+    std::vector<StaticCache> m_static_caches;
+    RCResource<vke::IPipeline> m_static_merge_pipeline;
+    VkDescriptorSet m_static_cache_set = VK_NULL_HANDLE;
+
+    // a framebuffer of every layer of m_shadow_map for the layered pass
+    std::string m_layered_render_target_name;
+    VkFramebuffer m_layered_framebuffer = VK_NULL_HANDLE;
+    bool m_layered_rendering            = false;
 };
 
 } // namespace vke
\ No newline at end of file
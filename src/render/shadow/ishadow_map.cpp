@@ -4,6 +4,27 @@ namespace vke {
 
 void IShadowMap::execute_late_rasters(vke::CommandBuffer& primary_cmd, std::vector<LateRasterData>& raster_buffers) {
     for (auto& rb : raster_buffers) {
+        if (rb.layered_framebuffer != VK_NULL_HANDLE) {
+            // shadow maps are reverse z, they are cleared to the far plane at 0
+            VkClearValue clear_value{.depthStencil = {.depth = 0.0}};
+
+            VkRenderPassBeginInfo begin_info{
+                .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+                .renderPass      = rb.shadow_renderpass->handle(),
+                .framebuffer     = rb.layered_framebuffer,
+                .renderArea      = {.extent = rb.shadow_renderpass->extend()},
+                .clearValueCount = 1,
+                .pClearValues    = &clear_value,
+            };
+
+            vkCmdBeginRenderPass(primary_cmd.handle(), &begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            primary_cmd.execute_secondaries(rb.render_buffer.get());
+            vkCmdEndRenderPass(primary_cmd.handle());
+
+            primary_cmd.add_execution_dependency(rb.render_buffer->get_reference());
+            continue;
+        }
+
         rb.shadow_renderpass->set_active_frame_buffer_instance(rb.layer_index);
 
         rb.shadow_renderpass->set_external(true);
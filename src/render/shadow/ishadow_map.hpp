@@ -9,6 +9,10 @@
 namespace vke {
 
 constexpr std::string shadowD16 = "vke::shadowD16";
+// the same subpass as shadowD16 with pipelines that route primitives into the layers of the framebuffer
+constexpr std::string shadowD16_layered = "vke::shadowD16_layered";
+// the same subpass as shadowD16 with pipelines that draw into a tile of the shadow atlas
+constexpr std::string shadowD16_atlas = "vke::shadowD16_atlas";
 
 enum class ShadowMapType {
     NONE   = 0,
@@ -28,6 +32,8 @@ public:
         RCResource<vke::CommandBuffer> render_buffer;
         Renderpass* shadow_renderpass;
         u32 layer_index;
+        // passes that draw every layer at once begin the render pass with it instead of the framebuffer of layer_index
+        VkFramebuffer layered_framebuffer = VK_NULL_HANDLE;
     };
 
 public:
@@ -0,0 +1,121 @@
+#include "receiver_culling.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include "render/object_renderer/render_util.hpp"
+#include "shadow_utils.hpp"
+
+namespace vke {
+
+namespace {
+
+float plane_sdf(glm::vec4 plane, glm::vec3 point) { return glm::dot(glm::vec3(plane), point) - plane.w; }
+
+} // namespace
+
+ReceiverData create_receiver_data(const glm::mat4& camera_proj_view, float z_near, float z_far, glm::vec3 light_dir) {
+    glm::mat4 inv_proj_view = glm::inverse(camera_proj_view);
+
+    // calculate_frustum takes the planes at the clip space z's 0 & 1, this maps them onto z_far & z_near
+    glm::mat4 slice(1.f);
+    slice[2][2] = z_near - z_far;
+    slice[3][2] = z_far;
+
+    return ReceiverData{
+        .proj_view = camera_proj_view,
+        .frustum   = calculate_frustum(inv_proj_view * slice),
+        .sphere    = calculate_frustum_slice_sphere(inv_proj_view, z_far, z_near),
+        .light_dir = glm::vec4(glm::normalize(light_dir), 1.f),
+    };
+}
+
+ClipBounds project_box_to_clip(const glm::mat4& proj_view, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward) {
+    glm::vec4 c_center  = proj_view * glm::vec4(center, 1.f);
+    glm::vec4 c_right   = proj_view * glm::vec4(right, 0.f);
+    glm::vec4 c_up      = proj_view * glm::vec4(up, 0.f);
+    glm::vec4 c_forward = proj_view * glm::vec4(forward, 0.f);
+
+    ClipBounds bounds{
+        .min            = glm::vec3(1e10f),
+        .max            = glm::vec3(-1e10f),
+        .is_projectable = true,
+    };
+
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) {
+            for (int k = 0; k < 2; k++) {
+                glm::vec4 sum = c_center + (i == 0 ? -c_right : c_right) + (j == 0 ? -c_up : c_up) + (k == 0 ? -c_forward : c_forward);
+
+                if (sum.w <= 0.f) {
+                    bounds.is_projectable = false;
+                    return bounds;
+                }
+
+                glm::vec3 c_pos = glm::vec3(sum) / sum.w;
+                bounds.min      = glm::min(bounds.min, c_pos);
+                bounds.max      = glm::max(bounds.max, c_pos);
+            }
+        }
+    }
+
+    bounds.min = glm::vec3(glm::vec2(bounds.min) * 0.5f + 0.5f, bounds.min.z);
+    bounds.max = glm::vec3(glm::vec2(bounds.max) * 0.5f + 0.5f, bounds.max.z);
+
+    return bounds;
+}
+
+bool is_box_hzb_visible(const glm::mat4& proj_view, const HZBSampler& sample_hzb, glm::vec2 hzb_size, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward) {
+    auto bounds = project_box_to_clip(proj_view, center, right, up, forward);
+    if (!bounds.is_projectable) return true;
+
+    // nothing behind the far plane was drawn into the hzb, a view that moved since it was drawn may see past it
+    if (bounds.min.z < 0.f) return true;
+
+    glm::vec3 clip_size   = bounds.max - bounds.min;
+    glm::vec3 clip_center = (bounds.max + bounds.min) * 0.5f;
+
+    float level = std::floor(std::log2(std::max(clip_size.x * hzb_size.x, clip_size.y * hzb_size.y)));
+
+    // 1 is closer to screen while 0 is far
+    return bounds.max.z >= sample_hzb(glm::vec2(clip_center), level);
+}
+
+float calculate_shadow_sweep_length(const ReceiverData& receivers, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward) {
+    glm::vec3 light_dir = glm::vec3(receivers.light_dir);
+
+    float box_start    = glm::dot(center, light_dir) - std::abs(glm::dot(right, light_dir)) - std::abs(glm::dot(up, light_dir)) - std::abs(glm::dot(forward, light_dir));
+    float receiver_end = glm::dot(glm::vec3(receivers.sphere), light_dir) + receivers.sphere.w;
+
+    return receiver_end - box_start;
+}
+
+bool is_swept_box_in_frustum(const Frustum& frustum, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward, glm::vec3 sweep) {
+    for (auto& plane : frustum.planes) {
+        glm::vec3 normal = glm::vec3(plane);
+
+        float center_distance = plane_sdf(plane, center) + std::max(glm::dot(normal, sweep), 0.f);
+        float extend_distance = std::abs(glm::dot(normal, right)) + std::abs(glm::dot(normal, up)) + std::abs(glm::dot(normal, forward));
+
+        if (center_distance + extend_distance < 0.f) return false;
+    }
+
+    return true;
+}
+
+bool is_shadow_receiver_visible(const ReceiverData& receivers, const HZBSampler& sample_hzb, glm::vec2 hzb_size, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward) {
+    if (receivers.light_dir.w == 0.f) return true;
+
+    float sweep_length = calculate_shadow_sweep_length(receivers, center, right, up, forward);
+    if (sweep_length <= 0.f) return false;
+
+    glm::vec3 sweep = glm::vec3(receivers.light_dir) * sweep_length;
+    if (!is_swept_box_in_frustum(receivers.frustum, center, right, up, forward, sweep)) return false;
+
+    glm::vec3 half_size = glm::abs(right) + glm::abs(up) + glm::abs(forward) + glm::abs(sweep) * 0.5f;
+    return is_box_hzb_visible(receivers.proj_view, sample_hzb, hzb_size, center + sweep * 0.5f, {half_size.x, 0, 0}, {0, half_size.y, 0}, {0, 0, half_size.z});
+}
+
+} // namespace vke
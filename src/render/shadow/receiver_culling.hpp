@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "common.hpp"
+#include "render/shader/scene_data.h"
+
+// cpu side of the receiver aware caster culling in cull_util.glsl. the functions mirror the glsl ones of the same name,
+// so the culling can be checked without a gpu. boxes are center +- right, up & forward in world space like in the shaders
+
+namespace vke {
+
+// the part of the camera frustum between the clip space z's z_near and z_far receives the shadows of a view, z_near > z_far with reverse z
+ReceiverData create_receiver_data(const glm::mat4& camera_proj_view, float z_near, float z_far, glm::vec3 light_dir);
+
+// returns the depth of the hzb at the uv and the mip level like textureLod, 1 is the closest and 0 is the far plane
+using HZBSampler = std::function<float(glm::vec2 uv, float level)>;
+
+struct ClipBounds {
+    glm::vec3 min, max;  // xy are uvs of the hzb and z is the depth
+    bool is_projectable; // false when the box crosses the camera plane
+};
+
+ClipBounds project_box_to_clip(const glm::mat4& proj_view, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward);
+bool is_box_hzb_visible(const glm::mat4& proj_view, const HZBSampler& sample_hzb, glm::vec2 hzb_size, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward);
+
+float calculate_shadow_sweep_length(const ReceiverData& receivers, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward);
+bool is_swept_box_in_frustum(const Frustum& frustum, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward, glm::vec3 sweep);
+bool is_shadow_receiver_visible(const ReceiverData& receivers, const HZBSampler& sample_hzb, glm::vec2 hzb_size, glm::vec3 center, glm::vec3 right, glm::vec3 up, glm::vec3 forward);
+
+} // namespace vke
@@ -0,0 +1,432 @@
+#include "shadow_atlas.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <format>
+
+#include <vke/pipeline_loader.hpp>
+#include <vke/vke_builders.hpp>
+
+#include <glm/gtc/constants.hpp>
+
+#include "imgui.h"
+#include "ishadow_map.hpp"
+
+#include "render/debug/gpu_timing_system.hpp"
+#include "render/object_renderer/object_renderer.hpp"
+#include "render/object_renderer/render_util.hpp"
+#include "render/object_renderer/resource_manager.hpp"
+#include "render/render_server.hpp"
+
+#include "scene/camera.hpp"
+
+namespace vke {
+
+namespace {
+
+std::atomic<u32> atlas_id_counter;
+
+// the order of the faces in PointLightShadow
+const glm::vec3 face_directions[POINT_LIGHT_SHADOW_FACES] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+const glm::vec3 face_ups[POINT_LIGHT_SHADOW_FACES]        = {{0, 1, 0}, {0, 1, 0}, {0, 0, 1}, {0, 0, 1}, {0, 1, 0}, {0, 1, 0}};
+
+// normal offset in texels of the face & the bias of the depth compare
+constexpr float POINT_SHADOW_NORMAL_OFFSET = 1.5f;
+constexpr float POINT_SHADOW_DEPTH_BIAS    = 0.0001f;
+
+} // namespace
+
+void register_shadow_atlas_subpass(RenderServer* render_server, vke::Renderpass* atlas_pass) {
+    auto lock           = render_server->lock_pipeline_loader();
+    auto& pgp_subpasses = render_server->get_pipeline_loader()->get_pipeline_globals_provider()->subpasses;
+    if (pgp_subpasses.contains(shadowD16_atlas)) return;
+
+    atlas_pass->get_render_target_description(0).depth_compare_op = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+    pgp_subpasses[shadowD16_atlas] = atlas_pass->get_subpass(0)->create_copy();
+
+    auto* resource_manager = render_server->get_object_renderer()->get_resource_manager();
+    resource_manager->add_pipeline2multi_pipeline(ObjectRenderer::pbr_pipeline_name, "vke::shadowD16_atlas::default");
+}
+
+void create_shadow_atlas_load_pass(IImageView* depth, VkExtent2D extent, VkRenderPass* load_pass, VkFramebuffer* load_framebuffer) {
+    VkAttachmentDescription attachment{
+        .format         = VK_FORMAT_D16_UNORM,
+        .samples        = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp         = VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout  = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .finalLayout    = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    VkAttachmentReference depth_reference{
+        .attachment = 0,
+        .layout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+
+    VkSubpassDescription subpass{
+        .pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .pDepthStencilAttachment = &depth_reference,
+    };
+
+    // the texture is sampled by the lighting of the previous frame & after the pass
+    VkSubpassDependency dependencies[] = {
+        {
+            .srcSubpass    = VK_SUBPASS_EXTERNAL,
+            .dstSubpass    = 0,
+            .srcStageMask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .dstStageMask  = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .srcAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        },
+        {
+            .srcSubpass    = 0,
+            .dstSubpass    = VK_SUBPASS_EXTERNAL,
+            .srcStageMask  = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+        },
+    };
+
+    VkRenderPassCreateInfo renderpass_info{
+        .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments    = &attachment,
+        .subpassCount    = 1,
+        .pSubpasses      = &subpass,
+        .dependencyCount = 2,
+        .pDependencies   = dependencies,
+    };
+
+    auto device = VulkanContext::get_context()->get_device();
+    VK_CHECK(vkCreateRenderPass(device, &renderpass_info, nullptr, load_pass));
+
+    VkImageView view = depth->view();
+
+    VkFramebufferCreateInfo framebuffer_info{
+        .sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .renderPass      = *load_pass,
+        .attachmentCount = 1,
+        .pAttachments    = &view,
+        .width           = extent.width,
+        .height          = extent.height,
+        .layers          = 1,
+    };
+
+    VK_CHECK(vkCreateFramebuffer(device, &framebuffer_info, nullptr, load_framebuffer));
+}
+
+ShadowAtlas::ShadowAtlas(RenderServer* render_server, u32 atlas_size, u32 max_tile_size, u32 min_tile_size) : m_allocator(atlas_size, min_tile_size) {
+    m_render_server   = render_server;
+    m_object_renderer = m_render_server->get_object_renderer();
+    m_max_tile_size   = max_tile_size;
+
+    vke::RenderPassBuilder builder;
+    u32 depth = builder.add_attachment(VK_FORMAT_D16_UNORM, VkClearValue{.depthStencil = {.depth = 0.0}}, true);
+    builder.add_subpass({}, depth, {});
+    m_atlas_pass = builder.build(atlas_size, atlas_size);
+    m_atlas      = m_atlas_pass->get_attachment_view(depth);
+
+    register_shadow_atlas_subpass(m_render_server, m_atlas_pass.get());
+
+    u32 atlas_id = atlas_id_counter.fetch_add(1);
+    for (u32 i = 0; i < MAX_FACES_PER_FRAME; i++) {
+        auto render_target_name = std::format("ShadowAtlasPass_{}:{}", atlas_id, i);
+        m_object_renderer->create_render_target(render_target_name, shadowD16_atlas, {.allow_indirect_render = true, .framebuffer_height = atlas_size});
+
+        auto camera = std::make_unique<vke::PerspectiveCamera>();
+        // perspectiveRH_ZO takes the field of view in radians
+        camera->fov_deg      = glm::half_pi<float>();
+        camera->aspect_ratio = 1.f;
+        camera->z_near       = 0.05f;
+        camera->update();
+
+        m_object_renderer->set_camera(render_target_name, camera.get());
+
+        m_face_render_target_names.push_back(std::move(render_target_name));
+        m_face_cameras.push_back(std::move(camera));
+    }
+
+    create_shadow_atlas_load_pass(m_atlas.get(), m_atlas_pass->extend(), &m_load_pass, &m_load_framebuffer);
+}
+
+ShadowAtlas::~ShadowAtlas() {
+    auto device = VulkanContext::get_context()->get_device();
+
+    vkDestroyFramebuffer(device, m_load_framebuffer, nullptr);
+    vkDestroyRenderPass(device, m_load_pass, nullptr);
+}
+
+void ShadowAtlas::update(std::span<const LightRequest> lights, const Camera* camera) {
+    u64 static_revision = m_object_renderer->get_static_revision();
+
+    Frustum frustum           = calculate_frustum(glm::inverse(camera->proj_view()));
+    float projection_scale    = std::abs(camera->projection()[1][1]);
+    glm::vec3 camera_position = glm::vec3(camera->get_world_pos());
+
+    for (auto& [id, light] : m_lights) light.is_requested = false;
+
+    for (auto& request : lights) {
+        auto& light = m_lights[request.light_id];
+
+        if (light.position != request.position || light.range != request.range || light.static_revision != static_revision) light.is_face_valid.fill(false);
+
+        light.position        = request.position;
+        light.range           = request.range;
+        light.static_revision = static_revision;
+        light.is_requested    = true;
+
+        bool is_visible = std::all_of(std::begin(frustum.planes), std::end(frustum.planes), [&](glm::vec4 plane) { return glm::dot(glm::vec3(plane), request.position) - plane.w >= -request.range; });
+        float distance  = glm::length(request.position - camera_position);
+
+        // the projected diameter of the light's sphere over the height of the screen
+        light.coverage = !is_visible ? 0.f : distance <= request.range ? 1.f : std::min(request.range * projection_scale / distance, 1.f);
+    }
+
+    assign_tiles();
+    schedule_faces();
+}
+
+void ShadowAtlas::assign_tiles() {
+    for (auto it = m_lights.begin(); it != m_lights.end();) {
+        if (it->second.is_requested) {
+            it++;
+            continue;
+        }
+
+        release_tiles(it->first, it->second);
+        it = m_lights.erase(it);
+    }
+
+    m_light_order.clear();
+    for (auto& [id, light] : m_lights) {
+        if (light.coverage > 0.f) {
+            m_light_order.push_back(id);
+        } else {
+            release_tiles(id, light);
+        }
+    }
+
+    std::sort(m_light_order.begin(), m_light_order.end(), [&](u32 a, u32 b) { return m_lights[a].coverage > m_lights[b].coverage; });
+
+    auto calculate_tile_size = [&](const Light& light) {
+        float size = std::clamp(light.coverage * m_max_tile_size, static_cast<float>(m_allocator.get_min_tile_size()), static_cast<float>(m_max_tile_size));
+        return std::bit_floor(static_cast<u32>(size));
+    };
+
+    // tiles are kept while the light is within a factor of two of their size, so that small movements don't throw the cache away
+    for (u32 id : m_light_order) {
+        auto& light = m_lights[id];
+        if (!light.has_tiles) continue;
+
+        u32 tile_size = calculate_tile_size(light);
+        if (tile_size > light.tiles[0].size || tile_size * 2 < light.tiles[0].size) release_tiles(id, light);
+    }
+
+    for (u32 i = 0; i < m_light_order.size(); i++) {
+        auto& light = m_lights[m_light_order[i]];
+        if (light.has_tiles) continue;
+
+        u32 tile_size     = calculate_tile_size(light);
+        bool is_allocated = allocate_tiles(light, tile_size);
+
+        // lights that cover less of the screen give their tiles up first, then the light settles for smaller tiles
+        for (u32 j = m_light_order.size() - 1; !is_allocated && j > i; j--) {
+            auto& other = m_lights[m_light_order[j]];
+            if (!other.has_tiles) continue;
+
+            release_tiles(m_light_order[j], other);
+            is_allocated = allocate_tiles(light, tile_size);
+        }
+
+        for (u32 size = tile_size / 2; !is_allocated && size >= m_allocator.get_min_tile_size(); size /= 2) {
+            is_allocated = allocate_tiles(light, size);
+        }
+    }
+}
+
+bool ShadowAtlas::allocate_tiles(Light& light, u32 tile_size) {
+    u32 count = 0;
+    for (; count < POINT_LIGHT_SHADOW_FACES; count++) {
+        auto tile = m_allocator.allocate(tile_size);
+        if (!tile) break;
+
+        light.tiles[count] = *tile;
+    }
+
+    if (count < POINT_LIGHT_SHADOW_FACES) {
+        for (u32 i = 0; i < count; i++) m_allocator.free(light.tiles[i]);
+        return false;
+    }
+
+    light.has_tiles = true;
+    light.is_face_drawn.fill(false);
+    light.is_face_valid.fill(false);
+    light.frames_waited.fill(0);
+
+    return true;
+}
+
+void ShadowAtlas::release_tiles(u32 light_id, Light& light) {
+    if (!light.has_tiles) return;
+
+    for (auto& tile : light.tiles) m_allocator.free(tile);
+
+    light.has_tiles       = false;
+    light.shadow.params.x = 0.f;
+    m_changed_lights.push_back(light_id);
+}
+
+void ShadowAtlas::schedule_faces() {
+    // dynamic casters may have moved, the faces of every light are redrawn for them but after the ones that are missing or invalid
+    bool has_dynamic_casters = m_object_renderer->get_dynamic_instance_count() > 0;
+
+    m_face_candidates.clear();
+    for (auto& [id, light] : m_lights) {
+        if (!light.has_tiles) continue;
+
+        for (u32 face = 0; face < POINT_LIGHT_SHADOW_FACES; face++) {
+            if (light.is_face_drawn[face] && light.is_face_valid[face] && !has_dynamic_casters) {
+                light.frames_waited[face] = 0;
+                continue;
+            }
+
+            float urgency = !light.is_face_drawn[face] ? 8.f : !light.is_face_valid[face] ? 4.f : 1.f;
+            m_face_candidates.push_back(ScheduledFace{
+                .light_id = id,
+                .face     = face,
+                .priority = light.coverage * urgency * static_cast<float>(light.frames_waited[face] + 1),
+            });
+        }
+    }
+
+    u32 face_count = std::min({face_budget, MAX_FACES_PER_FRAME, static_cast<u32>(m_face_candidates.size())});
+    std::partial_sort(m_face_candidates.begin(), m_face_candidates.begin() + face_count, m_face_candidates.end(), [](const ScheduledFace& a, const ScheduledFace& b) { return a.priority > b.priority; });
+
+    m_scheduled_faces.assign(m_face_candidates.begin(), m_face_candidates.begin() + face_count);
+    for (u32 i = face_count; i < m_face_candidates.size(); i++) {
+        m_lights[m_face_candidates[i].light_id].frames_waited[m_face_candidates[i].face]++;
+    }
+
+    float atlas_size = static_cast<float>(m_allocator.get_atlas_size());
+    for (u32 slot = 0; slot < m_scheduled_faces.size(); slot++) {
+        u32 light_id = m_scheduled_faces[slot].light_id;
+        u32 face     = m_scheduled_faces[slot].face;
+        auto& light  = m_lights[light_id];
+        auto& tile   = light.tiles[face];
+
+        auto* camera  = m_face_cameras[slot].get();
+        camera->z_far = light.range;
+        camera->set_rotation(face_directions[face], face_ups[face]);
+        camera->set_world_pos(glm::dvec3(light.position));
+
+        glm::vec4 tile_rect = glm::vec4(glm::vec2(tile.offset), glm::vec2(tile.size)) / atlas_size;
+        m_object_renderer->set_atlas_rect(m_face_render_target_names[slot], tile_rect);
+
+        // the faces are drawn later in the frame, after the shadow data is uploaded, so it can already point at them
+        light.shadow.proj_view[face]  = camera->proj_view();
+        light.shadow.tile_rects[face] = tile_rect;
+        light.is_face_drawn[face]     = true;
+        light.is_face_valid[face]     = true;
+        light.frames_waited[face]     = 0;
+
+        // the light has no shadows until every face of its tiles is drawn, the tiles may hold the faces of another light until then
+        bool is_complete    = std::all_of(light.is_face_drawn.begin(), light.is_face_drawn.end(), [](bool b) { return b; });
+        light.shadow.params = glm::vec4(is_complete ? 1.f : 0.f, POINT_SHADOW_NORMAL_OFFSET, POINT_SHADOW_DEPTH_BIAS, 0.f);
+        m_changed_lights.push_back(light_id);
+    }
+}
+
+void ShadowAtlas::render(vke::CommandBuffer& primary_cmd) {
+    // the atlas is sampled even without shadowed lights, it is cleared once to get it into a layout that can be sampled
+    if (m_scheduled_faces.empty() && m_is_atlas_cleared) return;
+
+    auto* timer = m_render_server->get_gpu_timing_system();
+    timer->timestamp(primary_cmd, "shadow atlas start", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    std::vector<RCResource<vke::CommandBuffer>> face_cmds;
+    for (u32 slot = 0; slot < m_scheduled_faces.size(); slot++) {
+        auto& scheduled = m_scheduled_faces[slot];
+        auto& tile      = m_lights[scheduled.light_id].tiles[scheduled.face];
+
+        RCResource<vke::CommandBuffer> face_cmd = m_render_server->get_framely_command_pool()->allocate(false);
+        face_cmd->begin_secondary(m_atlas_pass->get_subpass(0));
+
+        // reverse z, the tile is cleared to the far plane
+        VkClearAttachment clear_attachment{
+            .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+            .clearValue = {.depthStencil = {.depth = 0.0}},
+        };
+        VkClearRect clear_rect{
+            .rect       = {.offset = {static_cast<i32>(tile.offset.x), static_cast<i32>(tile.offset.y)}, .extent = {tile.size, tile.size}},
+            .layerCount = 1,
+        };
+        vkCmdClearAttachments(face_cmd->handle(), 1, &clear_attachment, 1, &clear_rect);
+
+        m_object_renderer->render(RenderArguments{
+            .subpass_cmd        = face_cmd.get(),
+            .compute_cmd        = &primary_cmd,
+            .render_target_name = m_face_render_target_names[slot],
+        });
+
+        face_cmd->end();
+        face_cmds.push_back(std::move(face_cmd));
+    }
+
+    if (m_is_atlas_cleared) {
+        VkRenderPassBeginInfo begin_info{
+            .sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass  = m_load_pass,
+            .framebuffer = m_load_framebuffer,
+            .renderArea  = {.extent = m_atlas_pass->extend()},
+        };
+
+        vkCmdBeginRenderPass(primary_cmd.handle(), &begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    } else {
+        m_atlas_pass->set_external(true);
+        m_atlas_pass->begin(primary_cmd);
+    }
+
+    for (auto& face_cmd : face_cmds) primary_cmd.execute_secondaries(face_cmd.get());
+
+    if (m_is_atlas_cleared) {
+        vkCmdEndRenderPass(primary_cmd.handle());
+    } else {
+        m_atlas_pass->end(primary_cmd);
+        m_is_atlas_cleared = true;
+    }
+
+    for (auto& face_cmd : face_cmds) primary_cmd.add_execution_dependency(face_cmd->get_reference());
+
+    timer->timestamp(primary_cmd, "shadow atlas end", VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT);
+}
+
+const PointLightShadow& ShadowAtlas::get_light_shadow(u32 light_id) const {
+    static const PointLightShadow no_shadow{};
+
+    auto it = m_lights.find(light_id);
+    return it != m_lights.end() ? it->second.shadow : no_shadow;
+}
+
+void ShadowAtlas::debug_menu() {
+    u32 atlas_size = m_allocator.get_atlas_size();
+    ImGui::Text("shadow atlas: %lu shadowed lights, %.1f%% free, %lu faces drawn", m_lights.size(), 100.0 * m_allocator.get_free_texel_count() / (double(atlas_size) * atlas_size), m_scheduled_faces.size());
+
+    int budget = face_budget;
+    if (ImGui::SliderInt("atlas faces per frame", &budget, 1, MAX_FACES_PER_FRAME)) face_budget = budget;
+
+    for (u32 id : m_light_order) {
+        auto& light = m_lights[id];
+
+        u32 drawn_faces = std::count(light.is_face_drawn.begin(), light.is_face_drawn.end(), true);
+        u32 valid_faces = std::count(light.is_face_valid.begin(), light.is_face_valid.end(), true);
+        ImGui::Text("light %u: coverage %.2f, %s, %u/%u faces drawn, %u valid", id, light.coverage, light.has_tiles ? std::format("{} texel tiles", light.tiles[0].size).c_str() : "no tiles", drawn_faces,
+            POINT_LIGHT_SHADOW_FACES, valid_faces);
+    }
+}
+
+} // namespace vke
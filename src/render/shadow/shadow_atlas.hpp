@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vke/vke.hpp>
+
+#include <array>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "fwd.hpp"
+#include "render/shader/scene_data.h"
+#include "shadow_atlas_allocator.hpp"
+
+namespace vke {
+
+// registers the subpass of shadowD16_atlas & its pipelines, only the first pass that draws into shadow tiles does it
+void register_shadow_atlas_subpass(RenderServer* render_server, vke::Renderpass* atlas_pass);
+// a render pass compatible with the subpass of shadowD16_atlas that loads the depth texture instead of clearing it, so that the tiles
+// that aren't redrawn stay cached. the texture has to be in the shader read only layout and is left in it
+void create_shadow_atlas_load_pass(IImageView* depth, VkExtent2D extent, VkRenderPass* load_pass, VkFramebuffer* load_framebuffer);
+
+// shadows of point lights drawn into tiles of a single depth texture. each point light takes 6 perspective, spot light like views.
+// the tiles are sized by how much of the screen the light covers and are kept while the size doesn't change,
+// so the faces of lights that don't move are only redrawn when the static scene changes or there are dynamic casters
+class ShadowAtlas {
+public:
+    constexpr static u32 MAX_FACES_PER_FRAME = 12;
+
+    struct LightRequest {
+        u32 light_id; // index of the light in the point light buffer
+        glm::vec3 position;
+        float range;
+    };
+
+    ShadowAtlas(RenderServer* render_server, u32 atlas_size = 4096, u32 max_tile_size = 512, u32 min_tile_size = 64);
+    ~ShadowAtlas();
+
+    // assigns the tiles of the lights that cast shadows this frame and picks the faces that are redrawn in it
+    void update(std::span<const LightRequest> lights, const Camera* camera);
+    // draws the faces picked by update, cmd has to be a primary command buffer
+    void render(vke::CommandBuffer& primary_cmd);
+
+    RCResource<IImageView> get_image_view() { return m_atlas; }
+
+    // lights whose shadow data changed since clear_changed_lights, their data has to be uploaded before the faces are sampled
+    std::span<const u32> get_changed_lights() const { return m_changed_lights; }
+    void clear_changed_lights() { m_changed_lights.clear(); }
+    // a light without shadows for the lights that don't have tiles
+    const PointLightShadow& get_light_shadow(u32 light_id) const;
+
+    void debug_menu();
+
+    u32 face_budget = 6; // faces drawn per frame at most, up to MAX_FACES_PER_FRAME
+
+private:
+    struct Light {
+        glm::vec3 position;
+        float range;
+        float coverage;      // the part of the screen height the light covers, 0 when it isn't visible
+        u64 static_revision; // ObjectRenderer::get_static_revision of the faces
+        bool is_requested;   // false for lights that stopped casting shadows or were destroyed
+
+        bool has_tiles = false;
+        std::array<AtlasTile, POINT_LIGHT_SHADOW_FACES> tiles;
+        std::array<bool, POINT_LIGHT_SHADOW_FACES> is_face_drawn; // since the tiles were assigned
+        std::array<bool, POINT_LIGHT_SHADOW_FACES> is_face_valid; // the light & the static scene didn't change since it was drawn
+        std::array<u32, POINT_LIGHT_SHADOW_FACES> frames_waited;
+
+        PointLightShadow shadow;
+    };
+
+    struct ScheduledFace {
+        u32 light_id;
+        u32 face;
+        float priority;
+    };
+
+    void assign_tiles();
+    bool allocate_tiles(Light& light, u32 tile_size);
+    void release_tiles(u32 light_id, Light& light);
+    void schedule_faces();
+
+private:
+    RenderServer* m_render_server;
+    ObjectRenderer* m_object_renderer;
+
+    ShadowAtlasAllocator m_allocator;
+    u32 m_max_tile_size;
+
+    // m_atlas_pass clears the whole atlas, it is only used for the first frame.
+    // later frames keep the cached tiles with m_load_pass which is compatible with it but loads the atlas
+    std::unique_ptr<vke::Renderpass> m_atlas_pass;
+    vke::RCResource<vke::IImageView> m_atlas;
+    VkRenderPass m_load_pass         = VK_NULL_HANDLE;
+    VkFramebuffer m_load_framebuffer = VK_NULL_HANDLE;
+    bool m_is_atlas_cleared          = false;
+
+    // a render target & camera for each face drawn in a frame
+    std::vector<std::string> m_face_render_target_names;
+    std::vector<std::unique_ptr<vke::PerspectiveCamera>> m_face_cameras;
+
+    std::unordered_map<u32, Light> m_lights;
+    std::vector<u32> m_light_order;
+    std::vector<ScheduledFace> m_scheduled_faces;
+    std::vector<ScheduledFace> m_face_candidates;
+    std::vector<u32> m_changed_lights;
+};
+
+} // namespace vke
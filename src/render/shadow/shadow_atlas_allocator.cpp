@@ -0,0 +1,105 @@
+#include "shadow_atlas_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace vke {
+
+ShadowAtlasAllocator::ShadowAtlasAllocator(u32 atlas_size, u32 min_tile_size) {
+    assert(std::has_single_bit(atlas_size) && std::has_single_bit(min_tile_size) && min_tile_size <= atlas_size);
+
+    m_atlas_size    = atlas_size;
+    m_min_tile_size = min_tile_size;
+    m_free_tiles.resize(std::countr_zero(atlas_size) - std::countr_zero(min_tile_size) + 1);
+
+    clear();
+}
+
+u32 ShadowAtlasAllocator::get_level(u32 size) const {
+    size = std::bit_ceil(std::max(size, m_min_tile_size));
+    return std::countr_zero(m_atlas_size) - std::countr_zero(size);
+}
+
+std::optional<AtlasTile> ShadowAtlasAllocator::allocate(u32 size) {
+    if (size > m_atlas_size) return std::nullopt;
+
+    u32 level = get_level(size);
+
+    // the smallest free tile that is at least as large
+    int source_level = level;
+    while (source_level >= 0 && m_free_tiles[source_level].empty()) source_level--;
+    if (source_level < 0) return std::nullopt;
+
+    glm::uvec2 offset = m_free_tiles[source_level].back();
+    m_free_tiles[source_level].pop_back();
+
+    // the first quarter is split further while the other 3 are freed
+    for (u32 l = source_level + 1; l <= level; l++) {
+        u32 half = get_level_size(l);
+        m_free_tiles[l].push_back(offset + glm::uvec2(half, 0));
+        m_free_tiles[l].push_back(offset + glm::uvec2(0, half));
+        m_free_tiles[l].push_back(offset + glm::uvec2(half, half));
+    }
+
+    return AtlasTile{
+        .offset = offset,
+        .size   = get_level_size(level),
+    };
+}
+
+void ShadowAtlasAllocator::free(const AtlasTile& tile) {
+    u32 level         = get_level(tile.size);
+    glm::uvec2 offset = tile.offset;
+
+    assert(get_level_size(level) == tile.size && offset.x % tile.size == 0 && offset.y % tile.size == 0);
+
+    while (level > 0) {
+        u32 size            = get_level_size(level);
+        glm::uvec2 parent   = offset & ~glm::uvec2(size * 2 - 1);
+        auto& free_tiles    = m_free_tiles[level];
+        glm::uvec2 siblings[3];
+        u32 sibling_count = 0;
+
+        for (u32 i = 0; i < 4; i++) {
+            glm::uvec2 sibling = parent + glm::uvec2(i & 1, i >> 1) * size;
+            if (sibling != offset) siblings[sibling_count++] = sibling;
+        }
+
+        bool are_siblings_free = std::all_of(std::begin(siblings), std::end(siblings), [&](glm::uvec2 s) { return std::find(free_tiles.begin(), free_tiles.end(), s) != free_tiles.end(); });
+        if (!are_siblings_free) break;
+
+        std::erase_if(free_tiles, [&](glm::uvec2 t) { return std::find(std::begin(siblings), std::end(siblings), t) != std::end(siblings); });
+
+        offset = parent;
+        level--;
+    }
+
+    m_free_tiles[level].push_back(offset);
+}
+
+void ShadowAtlasAllocator::clear() {
+    for (auto& free_tiles : m_free_tiles) free_tiles.clear();
+
+    m_free_tiles[0].push_back(glm::uvec2(0));
+}
+
+u64 ShadowAtlasAllocator::get_free_texel_count() const {
+    u64 count = 0;
+    for (u32 level = 0; level < m_free_tiles.size(); level++) {
+        u64 size = get_level_size(level);
+        count += m_free_tiles[level].size() * size * size;
+    }
+
+    return count;
+}
+
+u32 ShadowAtlasAllocator::get_largest_free_tile_size() const {
+    for (u32 level = 0; level < m_free_tiles.size(); level++) {
+        if (!m_free_tiles[level].empty()) return get_level_size(level);
+    }
+
+    return 0;
+}
+
+} // namespace vke
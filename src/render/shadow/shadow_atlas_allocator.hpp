@@ -0,0 +1,46 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "common.hpp"
+
+namespace vke {
+
+struct AtlasTile {
+    glm::uvec2 offset; // in texels of the atlas
+    u32 size;
+};
+
+// hands out square tiles of a square atlas. the sizes are powers of two and every tile is split from a tile twice its size,
+// so a freed tile merges back with the 3 others it was split with. it only tracks texels, it has no gpu resources
+class ShadowAtlasAllocator {
+public:
+    // both sizes have to be powers of two
+    ShadowAtlasAllocator(u32 atlas_size, u32 min_tile_size);
+
+    // size is rounded up to a power of two and clamped to the min tile size, nullopt when there is no free tile that large
+    std::optional<AtlasTile> allocate(u32 size);
+    void free(const AtlasTile& tile);
+    void clear();
+
+    u32 get_atlas_size() const { return m_atlas_size; }
+    u32 get_min_tile_size() const { return m_min_tile_size; }
+    u64 get_free_texel_count() const;
+    // the largest tile allocate can return without a free
+    u32 get_largest_free_tile_size() const;
+
+private:
+    u32 get_level(u32 size) const;
+    u32 get_level_size(u32 level) const { return m_atlas_size >> level; }
+
+private:
+    u32 m_atlas_size;
+    u32 m_min_tile_size;
+    // free tile offsets of each level, level 0 is the whole atlas and each level halves the size
+    std::vector<std::vector<glm::uvec2>> m_free_tiles;
+};
+
+} // namespace vke
@@ -7,6 +7,7 @@
 #include "glm/ext/matrix_transform.hpp"
 #include "imgui.h"
 #include "ishadow_map.hpp"
+#include "receiver_culling.hpp"
 #include "shadow_utils.hpp"
 
 #include "render/debug/line_drawer.hpp"
@@ -23,24 +24,35 @@ void ShadowManager::render_shadows(vke::CommandBuffer& cmd) {
     if (m_debug_menu_enabled) debug_menu();
     if (m_debug_draw_frustums) debug_draw_frustums();
 
-    if (m_update_proj_view) {
-        
+    if (m_update_proj_view && !m_virtual_shadows) {
         std::vector<IShadowMap::LateRasterData> raster_buffers;
-        
-        for (int i = 0; i < m_direct_shadow_map_count; i++) {
-            if (m_shadow_map->requires_rerender(i)) {
-                m_shadow_map->render(cmd, i,&raster_buffers);
+
+        auto* direct_shadow_map = dynamic_cast<DirectShadowMap*>(m_shadow_map.get());
+        if (direct_shadow_map && direct_shadow_map->is_layered_rendering_enabled()) {
+            bool requires_rerender = false;
+            for (int i = 0; i < m_direct_shadow_map_count; i++) requires_rerender |= m_shadow_map->requires_rerender(i);
+
+            if (requires_rerender) direct_shadow_map->render_layered(cmd, &raster_buffers);
+        } else {
+            auto decisions = m_cascade_scheduler->get_decisions();
+            for (int i = 0; i < m_direct_shadow_map_count; i++) {
+                if (decisions[i].is_scheduled && m_shadow_map->requires_rerender(i)) {
+                    m_shadow_map->render(cmd, i, &raster_buffers);
+                }
             }
         }
 
         IShadowMap::execute_late_rasters(cmd, raster_buffers);
     }
+
+    m_virtual_shadow_map->render(cmd);
+    m_shadow_atlas->render(cmd);
 }
 
 ShadowManager::ShadowManager(RenderServer* render_server) {
     m_render_server = render_server;
 
-    m_shadow_map = std::make_unique<vke::DirectShadowMap>(m_render_server, 4096, m_direct_shadow_map_count);
+    m_shadow_map = std::make_unique<vke::DirectShadowMap>(m_render_server, m_shadow_map_resolution, m_direct_shadow_map_count);
     m_shadow_map->set_camera_data({
         .position  = {-100, 100, 100},
         .direction = glm::normalize(glm::vec3(1, -1, 1)),
@@ -49,6 +61,10 @@ ShadowManager::ShadowManager(RenderServer* render_server) {
         .height    = 100,
     });
 
+    m_cascade_scheduler  = std::make_unique<CascadeScheduler>(m_direct_shadow_map_count);
+    m_shadow_atlas       = std::make_unique<ShadowAtlas>(m_render_server);
+    m_virtual_shadow_map = std::make_unique<VirtualShadowMap>(m_render_server);
+
     VkFilter filter = VK_FILTER_LINEAR;
     VkSamplerCreateInfo sampler_info{
         .sType         = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
@@ -76,10 +92,47 @@ void ShadowManager::debug_menu() {
     if (ImGui::BeginMenu("Shadow Manager", m_debug_menu_enabled)) {
         ImGui::Checkbox("draw shadow frustums", &m_debug_draw_frustums);
         ImGui::Checkbox("update proj view", &m_update_proj_view);
+        ImGui::Checkbox("stable cascades", &m_stable_cascades);
+        ImGui::Checkbox("receiver culling", &m_receiver_culling);
+        ImGui::Checkbox("virtual shadow map", &m_virtual_shadows);
 
         ImGui::SliderFloat("csm multiple constant", &m_csm_multiple_constant, 1.0f, 10.f);
         ImGui::SliderFloat("max shadow distance", &m_max_shadow_distance, 100.0f, 1000.f);
 
+        if (auto* direct_shadow_map = dynamic_cast<DirectShadowMap*>(m_shadow_map.get())) {
+            bool is_layered = direct_shadow_map->is_layered_rendering_enabled();
+            if (ImGui::Checkbox("single pass cascades", &is_layered)) direct_shadow_map->set_layered_rendering(is_layered);
+
+            if (is_layered) ImGui::Text("single pass: %lu casters", direct_shadow_map->get_layered_caster_count());
+
+            ImGui::Text("cascade updates");
+            if (is_layered) ImGui::Text("the budget is ignored as the single pass redraws every cascade");
+            ImGui::SliderFloat("cascade budget ms", &m_cascade_scheduler->budget_ms, 0.1f, 8.f);
+
+            auto decisions = m_cascade_scheduler->get_decisions();
+            for (u32 i = 0; i < m_cascade_inputs.size(); i++) {
+                auto& input    = m_cascade_inputs[i];
+                auto& decision = decisions[i];
+
+                const char* state = decision.is_over_budget ? "over budget" : decision.is_scheduled ? "updated" : decision.priority > 0.f ? "waiting" : "idle";
+                ImGui::Text("cascade %d: %s, priority %.2f, %.3f ms, moved %.3f, %s, %lu dynamic casters, waited %u frames", i, state, decision.priority, decision.estimated_ms, input.camera_motion,
+                    input.is_matrix_changed ? "snapped" : "not snapped", input.dynamic_casters, decision.frames_waited);
+            }
+
+            ImGui::Text("static caster caches");
+            bool is_occlusion_culled = direct_shadow_map->is_occlusion_culling_enabled();
+            if (ImGui::Checkbox("cascade occlusion culling", &is_occlusion_culled)) direct_shadow_map->set_occlusion_culling(is_occlusion_culled);
+
+            for (u32 i = 0; i < m_direct_shadow_map_count; i++) {
+                auto stats = direct_shadow_map->get_cache_stats(i);
+                ImGui::Text("cascade %d: %lu cached casters, %lu redrawn, rebuilt %u times", i, stats.cached_casters, stats.redrawn_casters, stats.rebuild_count);
+                if (is_occlusion_culled) ImGui::Text("cascade %d: %lu occlusion culled, fell back %u times", i, stats.occluded_casters, stats.occlusion_fallbacks);
+            }
+        }
+
+        m_shadow_atlas->debug_menu();
+        m_virtual_shadow_map->debug_menu();
+
         ImGui::EndMenu();
     };
 }
@@ -106,12 +159,8 @@ void ShadowManager::update_direct_cascaded_shadows(u32 index, glm::vec3 directio
     if (!m_update_proj_view) return;
 
     auto* player_camera = dynamic_cast<PerspectiveCamera*>(GameEngine::get_instance()->get_scene()->get_camera());
-    u64 frame_index     = GameEngine::get_instance()->get_frame_counter();
-
-
 
     float base_z_distance = m_max_shadow_distance / (std::pow(m_csm_multiple_constant, m_direct_shadow_map_count) - 1.f);
-    float prev_z          = 1.0f;
     float prev_world_far  = 0.f;
 
     auto calculate_clip_z = [&](float world_far) {
@@ -121,30 +170,46 @@ void ShadowManager::update_direct_cascaded_shadows(u32 index, glm::vec3 directio
 
     float shadow_far = 1000.f;
 
-    bool updated_cascades[4]                = {true, false, false, false};
-    updated_cascades[(frame_index % 3) + 1] = true;
-
     m_min_z_for_csm.resize(m_direct_shadow_map_count);
+    m_cascade_zs.resize(m_direct_shadow_map_count + 1);
+    m_cascade_camera_data.resize(m_direct_shadow_map_count);
 
+    m_cascade_zs[0] = 1.0f;
     for (int i = 0; i < m_direct_shadow_map_count; i++) {
         float world_far = std::pow(m_csm_multiple_constant, i) * base_z_distance + prev_world_far;
         auto z          = calculate_clip_z(-world_far);
 
-        m_min_z_for_csm[i] = z;
+        m_min_z_for_csm[i]  = z;
+        m_cascade_zs[i + 1] = z;
 
-        if (updated_cascades[i]) {
-            auto shadow_data = calculate_optimal_direct_shadow_map_frustum(
-                glm::inverse(player_camera->proj_view()),
-                z, prev_z,
-                glm::normalize(glm::vec3(1, -1, 1)), //,
-                shadow_far                           //
-            );
+        prev_world_far = world_far;
+    }
 
-            m_shadow_map->set_camera_data(shadow_data, i);
-        }
+    glm::vec3 light_dir = glm::normalize(glm::vec3(1, -1, 1));
 
-        prev_z         = z;
-        prev_world_far = world_far;
+    m_virtual_shadow_map->update(player_camera, light_dir, m_virtual_shadows);
+    if (m_virtual_shadows) return;
+
+    // every cascade is fitted at once so the frustum corners of the shared slice planes are only computed once
+    calculate_direct_shadow_map_frustums(glm::inverse(player_camera->proj_view()), m_cascade_zs, light_dir, shadow_far, m_stable_cascades, m_shadow_map_resolution, m_cascade_camera_data);
+
+    schedule_cascades(player_camera);
+
+    auto decisions = m_cascade_scheduler->get_decisions();
+    for (int i = 0; i < m_direct_shadow_map_count; i++) {
+        if (!decisions[i].is_scheduled) continue;
+
+        m_shadow_map->set_camera_data(m_cascade_camera_data[i], i);
+        m_applied_camera_data[i]        = m_cascade_camera_data[i];
+        m_camera_positions_at_update[i] = player_camera->get_world_pos();
+    }
+
+    // the receivers change whenever the camera moves, so they are updated for every cascade
+    if (auto* direct_shadow_map = dynamic_cast<DirectShadowMap*>(m_shadow_map.get())) {
+        for (int i = 0; i < m_direct_shadow_map_count; i++) {
+            auto receivers = m_receiver_culling ? std::optional(create_receiver_data(player_camera->proj_view(), m_cascade_zs[i], m_cascade_zs[i + 1], light_dir)) : std::nullopt;
+            direct_shadow_map->set_shadow_receivers(i, receivers, m_receiver_hzb);
+        }
     }
 
     // float excess_z = shadow_far - shadow_data.far;
@@ -152,4 +217,43 @@ void ShadowManager::update_direct_cascaded_shadows(u32 index, glm::vec3 directio
     // shadow_data.far = 1000.f;
 }
 
+void ShadowManager::update_point_light_shadows(std::span<const ShadowAtlas::LightRequest> lights) {
+    auto* player_camera = GameEngine::get_instance()->get_scene()->get_camera();
+    m_shadow_atlas->update(lights, player_camera);
+}
+
+void ShadowManager::schedule_cascades(const PerspectiveCamera* player_camera) {
+    auto* direct_shadow_map = dynamic_cast<DirectShadowMap*>(m_shadow_map.get());
+    bool is_layered         = direct_shadow_map && direct_shadow_map->is_layered_rendering_enabled();
+
+    m_cascade_inputs.resize(m_direct_shadow_map_count);
+    m_applied_camera_data.resize(m_direct_shadow_map_count);
+    m_camera_positions_at_update.resize(m_direct_shadow_map_count);
+
+    for (u32 i = 0; i < m_direct_shadow_map_count; i++) {
+        // the single pass isn't timed per cascade
+        if (direct_shadow_map && !is_layered) {
+            if (auto gpu_time = direct_shadow_map->get_gpu_time(i)) m_cascade_scheduler->record_cost(i, *gpu_time);
+        }
+
+        auto& fitted  = m_cascade_camera_data[i];
+        auto& applied = m_applied_camera_data[i];
+
+        bool is_matrix_changed = fitted.position != applied.position || fitted.direction != applied.direction || fitted.up != applied.up || fitted.far != applied.far ||
+                                 fitted.width != applied.width || fitted.height != applied.height;
+
+        float camera_motion = static_cast<float>(glm::length(player_camera->get_world_pos() - m_camera_positions_at_update[i])) / fitted.width;
+
+        m_cascade_inputs[i] = CascadeScheduler::CascadeInput{
+            .camera_motion     = camera_motion,
+            .is_matrix_changed = is_matrix_changed,
+            .requires_rerender = m_shadow_map->requires_rerender(i),
+            .dynamic_casters   = direct_shadow_map ? direct_shadow_map->get_dynamic_caster_count(i) : 0,
+        };
+    }
+
+    // the single pass redraws every cascade at once, so there is nothing to save by leaving some of them out
+    m_cascade_scheduler->schedule(m_cascade_inputs, !is_layered);
+}
+
 } // namespace vke
\ No newline at end of file
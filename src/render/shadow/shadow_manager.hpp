@@ -6,7 +6,10 @@
 #include <vke/fwd.hpp>
 #include <vulkan/vulkan_core.h>
 
+#include "cascade_scheduler.hpp"
 #include "ishadow_map.hpp"
+#include "shadow_atlas.hpp"
+#include "virtual_shadow_map.hpp"
 
 namespace vke {
 
@@ -29,24 +32,56 @@ public:
 
     VkSampler get_shadow_sampler() { return m_shadow_sampler; }
 
+    // the hzb of the main camera, dynamic casters that can't shadow anything visible in it are culled
+    void set_receiver_hzb(HierarchicalZBuffers* hzb) { m_receiver_hzb = hzb; }
+
+    // the point lights that cast shadows this frame, they are given tiles of the shadow atlas by how much of the screen they cover
+    void update_point_light_shadows(std::span<const ShadowAtlas::LightRequest> lights);
+    ShadowAtlas* get_shadow_atlas() { return m_shadow_atlas.get(); }
+
+    // the depth buffer of the main camera, the pages of the virtual shadow map are requested for the receivers in it
+    void set_receiver_depth(IImageView* depth) { m_virtual_shadow_map->set_receiver_depth(depth); }
+    // has to be recorded after the depth buffer of the main camera is written
+    void request_virtual_shadow_pages(vke::CommandBuffer& cmd) { m_virtual_shadow_map->request_pages(cmd); }
+    VirtualShadowMap* get_virtual_shadow_map() { return m_virtual_shadow_map.get(); }
+
 private:
     void debug_menu();
     void debug_draw_frustums();
+    void schedule_cascades(const PerspectiveCamera* player_camera);
 
 private:
     RenderServer* m_render_server;
     VkSampler m_shadow_sampler = VK_NULL_HANDLE;
 
     std::vector<float> m_min_z_for_csm;
+    // reused between frames so that fitting the cascades doesn't allocate
+    std::vector<float> m_cascade_zs;
+    std::vector<ShadowMapCameraData> m_cascade_camera_data;
+
+    // a cascade is only refitted & redrawn in the frames it is scheduled in, in between it keeps the fit it was drawn with
+    std::unique_ptr<CascadeScheduler> m_cascade_scheduler;
+    std::vector<CascadeScheduler::CascadeInput> m_cascade_inputs;
+    std::vector<ShadowMapCameraData> m_applied_camera_data;
+    std::vector<glm::dvec3> m_camera_positions_at_update;
 
     std::unique_ptr<vke::IShadowMap> m_shadow_map;
+    std::unique_ptr<ShadowAtlas> m_shadow_atlas;
+    std::unique_ptr<VirtualShadowMap> m_virtual_shadow_map;
+    // the directional light is shadowed by the virtual shadow map instead of the cascades
+    bool m_virtual_shadows     = false;
     bool m_debug_draw_frustums = false;
     bool m_debug_menu_enabled  = true;
     bool m_update_proj_view    = true;
+    // cascades that move in whole texels, they are fitted every frame as they are only redrawn when they snap to a new texel
+    bool m_stable_cascades               = true;
+    bool m_receiver_culling              = true;
+    HierarchicalZBuffers* m_receiver_hzb = nullptr;
 
     float m_csm_multiple_constant = 3.f;
     float m_max_shadow_distance   = 500.f;
     u32 m_direct_shadow_map_count = 4;
+    u32 m_shadow_map_resolution   = 4096;
 };
 
 } // namespace vke
\ No newline at end of file
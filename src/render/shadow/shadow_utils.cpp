@@ -1,7 +1,9 @@
 #include "shadow_utils.hpp"
 
 #include <algorithm>
+#include <array>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <ranges>
 #include <vke/util.hpp>
@@ -18,101 +20,106 @@ static glm::vec3 translate_by_matrix(const glm::mat4& m, glm::vec3 p) {
     return glm::vec3(p4) / p4.w;
 }
 
-static std::vector<u16> graham_scan(std::span<const glm::vec2> points) {
-    auto ccw = +[](glm::vec2 a, glm::vec2 b, glm::vec2 c) -> float {
-        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
-    };
-
-    std::vector<u16> sorted_points;
-    u16 smallest_index = 0;
-    for (int i = 0; i < points.size(); i++) {
-        glm::vec2 s = points[smallest_index];
-        glm::vec2 c = points[i];
-        if (s.y < c.y) {
-            smallest_index = i;
-        }
-    }
-
-    glm::vec2 p0 = points[smallest_index];
-
-    auto thetas = vke::map_vec(points, [&](glm::vec2 v) {
-        auto d = v - p0;
-        return std::atan2(d.y, d.x);
-    });
-
-    sorted_points.reserve(points.size() - 1);
-    for (u16 i = 0; i < smallest_index; i++) {
-        sorted_points.push_back(i);
-    }
-    for (u16 i = smallest_index + 1; i < points.size(); i++) {
-        sorted_points.push_back(i);
-    }
-
-    std::sort(sorted_points.begin(), sorted_points.end(), [&](u16 a, u16 b) {
-        return thetas[a] < thetas[b];
-    });
-
-    std::vector<u16> stack = {smallest_index, sorted_points[0]};
+static ShadowMapCameraData create_camera_data(glm::vec3 eye, glm::vec3 up, glm::vec2 extend, float shadow_z_min, float shadow_z_max, glm::vec3 direct_light_dir, float shadow_z_far) {
+    float far        = shadow_z_max - shadow_z_min;
+    float far_excess = shadow_z_far - far;
 
-    for (u16 i = 1; i < sorted_points.size(); i++) {
-        while (stack.size() >= 2 ? ccw(points[stack[stack.size() - 2]], points[stack[stack.size() - 1]], points[sorted_points[i]]) <= 0 : false) {
-            stack.pop_back();
-        }
-        stack.push_back(sorted_points[i]);
-    }
+    eye += direct_light_dir * -far_excess;
 
-    return stack;
+    return ShadowMapCameraData{
+        .position  = eye,
+        .direction = direct_light_dir,
+        .up        = up,
+        .far       = shadow_z_far,
+        .width     = extend.x,
+        .height    = extend.y,
+    };
 }
 
-std::tuple<glm::vec2, glm::vec2> compute_aabb(auto&& points) {
-    glm::vec2 max = {-std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
-    glm::vec2 min = -max;
+namespace {
 
-    for (auto p : points) {
-        min = glm::min(min, p);
-        max = glm::max(max, p);
-    }
+// the 4 corners of a clip space z plane in world space, a frustum slice is the corners of its two planes
+using PlaneCorners = std::array<glm::vec3, 4>;
 
-    return std::tuple(min, max);
+PlaneCorners calculate_plane_corners(const glm::mat4& inv_proj_view, float z) {
+    return PlaneCorners{
+        translate_by_matrix(inv_proj_view, {-1, -1, z}),
+        translate_by_matrix(inv_proj_view, {-1, +1, z}),
+        translate_by_matrix(inv_proj_view, {+1, -1, z}),
+        translate_by_matrix(inv_proj_view, {+1, +1, z}),
+    };
 }
 
+// a convex hull of the 8 corners of a frustum slice, counter clockwise
+struct ShadowHull {
+    std::array<glm::vec2, 8> points;
+    u32 size = 0;
+};
+
 struct ShadowOBB {
     glm::vec2 rotated_min, rotated_max;
     glm::vec2 mid_point;
     glm::mat2 rotation_mat;
-    float rotation_rad;
 };
 
-ShadowOBB find_obb(auto&& hull) {
-    float smallest_obb_size = std::numeric_limits<float>::infinity();
+float cross_2d(glm::vec2 o, glm::vec2 a, glm::vec2 b) { return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x); }
 
-    ShadowOBB smallest_obb;
+// andrew's monotone chain, it only needs a sort by x and no angles. collinear points are dropped
+ShadowHull calculate_hull(std::array<glm::vec2, 8> points) {
+    std::sort(points.begin(), points.end(), [](glm::vec2 a, glm::vec2 b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
 
-    for (int i = 0; i < hull.size(); i++) {
-        auto p0 = hull[i];
-        auto p1 = hull[(i + 1) % hull.size()];
+    // the lower and the upper hull, the last point of the upper one is the first point again
+    std::array<glm::vec2, 16> chain;
+    u32 size = 0;
 
-        auto dir = glm::normalize(p1 - p0);
+    for (u32 i = 0; i < points.size(); i++) {
+        while (size >= 2 && cross_2d(chain[size - 2], chain[size - 1], points[i]) <= 0) size--;
+        chain[size++] = points[i];
+    }
+
+    for (u32 i = points.size() - 1, lower_size = size + 1; i-- > 0;) {
+        while (size >= lower_size && cross_2d(chain[size - 2], chain[size - 1], points[i]) <= 0) size--;
+        chain[size++] = points[i];
+    }
+
+    ShadowHull hull;
+    hull.size = std::min<u32>(size - 1, hull.points.size());
+    std::copy_n(chain.begin(), hull.size, hull.points.begin());
+
+    return hull;
+}
+
+ShadowOBB find_obb(const ShadowHull& hull) {
+    float smallest_area = std::numeric_limits<float>::infinity();
+
+    ShadowOBB smallest_obb{};
+
+    for (u32 i = 0; i < hull.size; i++) {
+        glm::vec2 dir = glm::normalize(hull.points[(i + 1) % hull.size] - hull.points[i]);
 
         glm::mat2 m;
         m[0] = dir;
         m[1] = {-dir.y, dir.x};
 
-        auto [min, max] = compute_aabb(hull | views::transform([&](auto p) { return m * p; }));
+        glm::vec2 min(std::numeric_limits<float>::infinity());
+        glm::vec2 max = -min;
+        for (u32 j = 0; j < hull.size; j++) {
+            glm::vec2 p = m * hull.points[j];
+            min         = glm::min(min, p);
+            max         = glm::max(max, p);
+        }
 
-        auto area_vec = max - min;
-        float area    = area_vec.x * area_vec.y;
-        assert(area >= 0.f);
+        glm::vec2 extend = max - min;
+        float area       = extend.x * extend.y;
 
-        if (area < smallest_obb_size) {
-            smallest_obb_size = area;
+        if (area < smallest_area) {
+            smallest_area = area;
 
             smallest_obb = {
                 .rotated_min  = min,
                 .rotated_max  = max,
-                .mid_point    = glm::inverse(m) * ((min + max) * 0.5f),
+                .mid_point    = glm::transpose(m) * ((min + max) * 0.5f), // m is a rotation, its inverse is its transpose
                 .rotation_mat = m,
-                .rotation_rad = std::atan2(m[0].y, m[0].x), // compute the rotation in radians
             };
         }
     }
@@ -120,82 +127,124 @@ ShadowOBB find_obb(auto&& hull) {
     return smallest_obb;
 }
 
-std::vector<glm::vec3> calculate_camera_frustum(const glm::mat4& inv_proj_view, float z_s, float z_e) {
-    std::vector<glm::vec3> points = {
-        {-1, -1, z_s},
-        {-1, +1, z_s},
-        {+1, -1, z_s},
-        {+1, +1, z_s},
-        {-1, -1, z_e},
-        {-1, +1, z_e},
-        {+1, -1, z_e},
-        {+1, +1, z_e},
-    };
+// the light space is the same for every cascade, so it is only calculated once per batch
+struct LightSpace {
+    glm::mat4 shadow;
+    glm::mat4 inv_shadow;
 
-    // transform the points
-    for (auto& p : points) {
-        p = translate_by_matrix(inv_proj_view, p);
+    explicit LightSpace(glm::vec3 direct_light_dir) {
+        shadow     = glm::lookAtRH({0, 0, 0}, direct_light_dir, {0, 1, 0});
+        inv_shadow = glm::inverse(shadow);
     }
+};
+
+ShadowMapCameraData fit_cascade(const PlaneCorners& start, const PlaneCorners& end, const LightSpace& light_space, glm::vec3 direct_light_dir, float shadow_z_far) {
+    std::array<glm::vec2, 8> shadow_points;
 
-    return points;
+    float shadow_z_min = std::numeric_limits<float>::max(), shadow_z_max = std::numeric_limits<float>::lowest();
+    for (u32 i = 0; i < 8; i++) {
+        glm::vec3 p = translate_by_matrix(light_space.shadow, i < 4 ? start[i] : end[i - 4]);
+
+        shadow_z_min = std::min(shadow_z_min, p.z);
+        shadow_z_max = std::max(shadow_z_max, p.z);
+
+        shadow_points[i] = glm::vec2(p);
+    }
+
+    auto obb = find_obb(calculate_hull(shadow_points));
+
+    auto transform_shadow2world = [&](glm::vec2 p) { return translate_by_matrix(light_space.inv_shadow, glm::vec3(p, shadow_z_max)); };
+
+    glm::vec3 eye = transform_shadow2world(obb.mid_point);
+    glm::vec3 up  = glm::normalize(transform_shadow2world(obb.mid_point + glm::transpose(obb.rotation_mat) * glm::vec2(0, 1)) - eye);
+
+    return create_camera_data(eye, up, obb.rotated_max - obb.rotated_min, shadow_z_min, shadow_z_max, direct_light_dir, shadow_z_far);
 }
 
-//calculates the hull in shadow space
-std::vector<glm::vec2> calculate_hull(std::span<const glm::vec3> points, const glm::mat4& inital_shadow, float& z_min, float z_max) {
+glm::vec4 calculate_slice_sphere(const PlaneCorners& start, const PlaneCorners& end) {
+    glm::vec3 center(0.f);
+    for (u32 i = 0; i < 4; i++) center += start[i] + end[i];
+    center /= 8.f;
 
-    float shadow_z_min = std::numeric_limits<float>::max(), shadow_z_max = std::numeric_limits<float>::min();
+    float radius = 0.f;
+    for (u32 i = 0; i < 4; i++) radius = std::max({radius, glm::distance(center, start[i]), glm::distance(center, end[i])});
 
-    auto shadow_points = vke::map_vec(points, [&](glm::vec3 p0) {
-        glm::vec3 p = translate_by_matrix(inital_shadow, p0);
+    return glm::vec4(center, radius);
+}
 
-        shadow_z_max = std::max(shadow_z_max, p.z);
-        shadow_z_min = std::min(shadow_z_min, p.z);
+ShadowMapCameraData fit_stable_cascade(const PlaneCorners& start, const PlaneCorners& end, glm::vec3 direct_light_dir, glm::vec3 up, float shadow_z_far, u32 shadow_map_resolution) {
+    glm::vec4 sphere = calculate_slice_sphere(start, end);
 
-        return glm::vec2(p);
-    });
+    // the radius only changes by float error when the camera moves, rounding it up keeps the texel size the same
+    float radius     = std::ceil(sphere.w * 16.f) / 16.f;
+    float texel_size = radius * 2.f / static_cast<float>(shadow_map_resolution);
 
-    const auto hull_indices = graham_scan(shadow_points);
+    glm::vec3 center = snap_to_light_texel_grid(glm::vec3(sphere), direct_light_dir, up, texel_size);
 
-    z_min = shadow_z_min;
-    z_max = shadow_z_max;
+    // the sphere ends at the far plane, everything in front of it up to shadow_z_far casts shadows
+    glm::vec3 eye = center - direct_light_dir * (shadow_z_far - radius);
 
-    return vke::map_vec(hull_indices, [&](auto i) { return shadow_points[i]; });
+    return ShadowMapCameraData{
+        .position  = eye,
+        .direction = direct_light_dir,
+        .up        = up,
+        .far       = shadow_z_far,
+        .width     = radius * 2.f,
+        .height    = radius * 2.f,
+    };
 }
 
+} // namespace
+
 ShadowMapCameraData calculate_optimal_direct_shadow_map_frustum(const glm::mat4& inv_proj_view, float z_s, float z_e, glm::vec3 direct_light_dir, float shadow_z_far, vke::LineDrawer* ld) {
     assert(std::abs(glm::length(direct_light_dir) - 1.0) < 0.05 && "direct_light_dir must be normalized");
 
-    auto points = calculate_camera_frustum(inv_proj_view, z_s, z_e);
+    return fit_cascade(calculate_plane_corners(inv_proj_view, z_s), calculate_plane_corners(inv_proj_view, z_e), LightSpace(direct_light_dir), direct_light_dir, shadow_z_far);
+}
 
-    glm::mat4 inital_shadow = glm::lookAtRH({0, 0, 0}, direct_light_dir, {0, 1, 0});
+void calculate_direct_shadow_map_frustums(const glm::mat4& inv_proj_view, std::span<const float> cascade_zs, glm::vec3 direct_light_dir, float shadow_z_far, bool is_stable, u32 shadow_map_resolution, std::span<ShadowMapCameraData> results) {
+    assert(std::abs(glm::length(direct_light_dir) - 1.0) < 0.05 && "direct_light_dir must be normalized");
+    assert(cascade_zs.size() == results.size() + 1);
 
-    // calculate in shadow space
-    float shadow_z_min,shadow_z_max;
-    auto hull = calculate_hull(points, inital_shadow, shadow_z_min, shadow_z_max);
+    LightSpace light_space(direct_light_dir);
+    glm::vec3 up = calculate_light_up(direct_light_dir);
 
-    auto obb = find_obb(hull);
+    PlaneCorners start = calculate_plane_corners(inv_proj_view, cascade_zs[0]);
+    for (u32 i = 0; i < results.size(); i++) {
+        PlaneCorners end = calculate_plane_corners(inv_proj_view, cascade_zs[i + 1]);
 
-    auto inv_initial_shadow     = glm::inverse(inital_shadow);
-    auto transform_shadow2world = [&](auto p) { return translate_by_matrix(inv_initial_shadow, glm::vec3(p, shadow_z_max)); };
+        results[i] = is_stable ? fit_stable_cascade(start, end, direct_light_dir, up, shadow_z_far, shadow_map_resolution)
+                               : fit_cascade(start, end, light_space, direct_light_dir, shadow_z_far);
 
-    glm::vec3 eye = transform_shadow2world(obb.mid_point);
-    glm::vec3 up  = glm::normalize(transform_shadow2world(obb.mid_point + (glm::inverse(obb.rotation_mat) * glm::vec2(0, 1))) - eye);
+        start = end;
+    }
+}
 
-    glm::vec2 extend = (obb.rotated_max - obb.rotated_min);
+glm::vec3 calculate_light_up(glm::vec3 direct_light_dir) {
+    // world up is used unless the light is close to parallel with it
+    glm::vec3 world_up = std::abs(direct_light_dir.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
 
-    float far        = shadow_z_max - shadow_z_min;
-    float far_excess = shadow_z_far - far;
+    glm::vec3 right = glm::normalize(glm::cross(direct_light_dir, world_up));
+    return glm::cross(right, direct_light_dir);
+}
 
-    eye += direct_light_dir * -far_excess;
+glm::vec4 calculate_frustum_slice_sphere(const glm::mat4& inv_proj_view, float z_s, float z_e) {
+    return calculate_slice_sphere(calculate_plane_corners(inv_proj_view, z_s), calculate_plane_corners(inv_proj_view, z_e));
+}
 
-    return ShadowMapCameraData{
-        .position  = eye,
-        .direction = direct_light_dir,
-        .up        = up,
-        .far       = shadow_z_far,
-        .width     = extend.x,
-        .height    = extend.y,
-    };
+glm::vec3 snap_to_light_texel_grid(glm::vec3 point, glm::vec3 direct_light_dir, glm::vec3 up, float texel_size) {
+    glm::vec3 right = glm::cross(direct_light_dir, up);
+
+    glm::vec3 light_space_point = glm::vec3(glm::dot(point, right), glm::dot(point, up), glm::dot(point, direct_light_dir));
+    glm::vec3 snapped           = glm::floor(light_space_point / texel_size + 0.5f) * texel_size;
+
+    return right * snapped.x + up * snapped.y + direct_light_dir * snapped.z;
+}
+
+ShadowMapCameraData calculate_stable_direct_shadow_map_frustum(const glm::mat4& inv_proj_view, float z_s, float z_e, glm::vec3 direct_light_dir, float shadow_z_far, u32 shadow_map_resolution) {
+    assert(std::abs(glm::length(direct_light_dir) - 1.0) < 0.05 && "direct_light_dir must be normalized");
+
+    return fit_stable_cascade(calculate_plane_corners(inv_proj_view, z_s), calculate_plane_corners(inv_proj_view, z_e), direct_light_dir, calculate_light_up(direct_light_dir), shadow_z_far, shadow_map_resolution);
 }
 
-} // namespace vke
\ No newline at end of file
+} // namespace vke
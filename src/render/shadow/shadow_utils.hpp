@@ -3,6 +3,8 @@
 #include <glm/mat4x4.hpp>
 #include "glm/vec3.hpp"
 
+#include <span>
+
 #include "ishadow_map.hpp"
 
 #include "fwd.hpp"
@@ -14,5 +16,23 @@ namespace vke{
 // these values are for in clip space 
 ShadowMapCameraData calculate_optimal_direct_shadow_map_frustum(const glm::mat4& inv_proj_view, float z_start, float z_end,glm::vec3 direct_light_dir,float shadow_z_far,vke::LineDrawer* debug_line_drawer = nullptr);
 
+// fits every cascade in one call, cascade i is between the clip space z's cascade_zs[i] and cascade_zs[i + 1].
+// the corners of the planes between the cascades are only calculated once and nothing is allocated
+void calculate_direct_shadow_map_frustums(const glm::mat4& inv_proj_view, std::span<const float> cascade_zs, glm::vec3 direct_light_dir, float shadow_z_far, bool is_stable, u32 shadow_map_resolution, std::span<ShadowMapCameraData> results);
+
+// fits a cascade that only moves in whole texels of the shadow map, so that it can stay cached while the camera moves less than a texel.
+// the extent is the bounding sphere of the frustum slice which doesn't change when the camera rotates,
+// the orientation only depends on the light and the center is snapped to the texel grid in light space
+ShadowMapCameraData calculate_stable_direct_shadow_map_frustum(const glm::mat4& inv_proj_view, float z_start, float z_end, glm::vec3 direct_light_dir, float shadow_z_far, u32 shadow_map_resolution);
+
+// bounding sphere of the camera frustum between the clip space z_start and z_end. xyz is the center and w is the radius
+glm::vec4 calculate_frustum_slice_sphere(const glm::mat4& inv_proj_view, float z_start, float z_end);
+
+// rounds point to the closest multiple of texel_size along right, up & the light direction
+glm::vec3 snap_to_light_texel_grid(glm::vec3 point, glm::vec3 direct_light_dir, glm::vec3 up, float texel_size);
+
+// an up vector for the light that doesn't change unless the light does
+glm::vec3 calculate_light_up(glm::vec3 direct_light_dir);
+
 
 }
\ No newline at end of file
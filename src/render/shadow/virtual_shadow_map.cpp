@@ -0,0 +1,380 @@
+#include "virtual_shadow_map.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <format>
+
+#include <vke/pipeline_loader.hpp>
+#include <vke/vke_builders.hpp>
+
+#include "glm/ext/matrix_transform.hpp"
+#include "imgui.h"
+#include "ishadow_map.hpp"
+#include "shadow_atlas.hpp"
+#include "shadow_utils.hpp"
+
+#include "render/debug/gpu_timing_system.hpp"
+#include "render/object_renderer/object_renderer.hpp"
+#include "render/object_renderer/resource_manager.hpp"
+#include "render/render_server.hpp"
+
+#include "scene/camera.hpp"
+
+namespace vke {
+
+namespace {
+
+std::atomic<u32> virtual_shadow_map_id_counter;
+
+constexpr u32 REQUEST_GROUP_SIZE = 8;
+
+} // namespace
+
+VirtualShadowMap::VirtualShadowMap(RenderServer* render_server, u32 page_size, u32 physical_pages_per_side, u32 level_size, u32 level_count)
+    : m_page_table(level_count, level_size, physical_pages_per_side * physical_pages_per_side) {
+    assert(level_count <= MAX_VIRTUAL_SHADOW_LEVELS);
+
+    m_render_server           = render_server;
+    m_object_renderer         = m_render_server->get_object_renderer();
+    m_page_size               = page_size;
+    m_physical_pages_per_side = physical_pages_per_side;
+
+    u32 pool_size = page_size * physical_pages_per_side;
+
+    vke::RenderPassBuilder builder;
+    u32 depth = builder.add_attachment(VK_FORMAT_D16_UNORM, VkClearValue{.depthStencil = {.depth = 0.0}}, true);
+    builder.add_subpass({}, depth, {});
+    m_pool_pass = builder.build(pool_size, pool_size);
+    m_pool      = m_pool_pass->get_attachment_view(depth);
+
+    // the pages are drawn like the tiles of the shadow atlas
+    register_shadow_atlas_subpass(m_render_server, m_pool_pass.get());
+    create_shadow_atlas_load_pass(m_pool.get(), m_pool_pass->extend(), &m_load_pass, &m_load_framebuffer);
+
+    u32 map_id = virtual_shadow_map_id_counter.fetch_add(1);
+    for (u32 i = 0; i < MAX_PAGES_PER_FRAME; i++) {
+        auto render_target_name = std::format("VirtualShadowMapPass_{}:{}", map_id, i);
+        m_object_renderer->create_render_target(render_target_name, shadowD16_atlas, {.allow_indirect_render = true, .framebuffer_height = pool_size});
+
+        auto camera = std::make_unique<vke::OrthographicCamera>();
+        m_object_renderer->set_camera(render_target_name, camera.get());
+
+        m_page_render_target_names.push_back(std::move(render_target_name));
+        m_page_cameras.push_back(std::move(camera));
+    }
+
+    for (u32 i = 0; i < level_count; i++) m_level_cameras.push_back(std::make_unique<vke::OrthographicCamera>());
+
+    u64 data_size    = sizeof(VirtualShadowMapData) + sizeof(u32) * m_page_table.get_page_table().size();
+    u64 request_size = sizeof(u32) * m_page_table.get_page_table().size();
+    for (u32 i = 0; i < FRAME_OVERLAP; i++) {
+        m_data_buffers[i]    = std::make_unique<vke::Buffer>(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, data_size, true);
+        m_request_buffers[i] = std::make_unique<vke::Buffer>(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, request_size, true);
+
+        memset(m_data_buffers[i]->mapped_data_bytes().data(), 0, data_size);
+        memset(m_request_buffers[i]->mapped_data_bytes().data(), 0, request_size);
+    }
+
+    vke::DescriptorSetLayoutBuilder layout_builder;
+    layout_builder.add_image_sampler(VK_SHADER_STAGE_COMPUTE_BIT);
+    layout_builder.add_ssbo(VK_SHADER_STAGE_COMPUTE_BIT);
+    layout_builder.add_ssbo(VK_SHADER_STAGE_COMPUTE_BIT);
+    m_request_set_layout = layout_builder.build();
+
+    {
+        auto lock = m_render_server->lock_pipeline_loader();
+        m_render_server->get_pipeline_loader()->get_pipeline_globals_provider()->set_layouts["vke::vsm_page_request_set"] = m_request_set_layout;
+    }
+    m_request_pipeline = m_render_server->load_pipeline("vke::vsm_page_request_pipeline");
+}
+
+VirtualShadowMap::~VirtualShadowMap() {
+    auto device = VulkanContext::get_context()->get_device();
+
+    vkDestroyFramebuffer(device, m_load_framebuffer, nullptr);
+    vkDestroyRenderPass(device, m_load_pass, nullptr);
+    vkDestroyDescriptorSetLayout(device, m_request_set_layout, nullptr);
+}
+
+void VirtualShadowMap::set_receiver_depth(IImageView* depth) {
+    m_receiver_depth = depth;
+    m_sets_needing_update.set();
+}
+
+void VirtualShadowMap::update_request_set(u32 frame_index) {
+    VkSampler sampler = m_object_renderer->get_resource_manager()->get_nearest_sampler();
+
+    vke::DescriptorSetBuilder builder;
+    builder.add_image_sampler(m_receiver_depth, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, sampler, VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_ssbo(m_data_buffers[frame_index].get(), VK_SHADER_STAGE_COMPUTE_BIT);
+    builder.add_ssbo(m_request_buffers[frame_index].get(), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    if (m_request_sets[frame_index] == VK_NULL_HANDLE) {
+        m_request_sets[frame_index] = builder.build(m_render_server->get_descriptor_pool(), m_request_set_layout);
+    } else {
+        builder.update_set(m_request_sets[frame_index], m_request_set_layout);
+    }
+
+    m_sets_needing_update[frame_index] = false;
+}
+
+void VirtualShadowMap::read_requests() {
+    u32 frame_index = m_render_server->get_frame_index();
+
+    m_page_table.begin_frame();
+    if (!m_has_requests[frame_index]) return;
+
+    // the requests were written FRAME_OVERLAP frames ago, the frame fence guarantees they are visible on the host by now
+    auto requests       = m_request_buffers[frame_index]->mapped_data_as_span<u32>();
+    auto& origins       = m_request_origins[frame_index];
+    u32 level_size      = m_page_table.get_level_size();
+    u32 pages_per_level = level_size * level_size;
+
+    for (u32 i = 0; i < requests.size(); i++) {
+        if (requests[i] == 0) continue;
+
+        u32 level        = i / pages_per_level;
+        glm::ivec2 local = glm::ivec2(i % level_size, (i / level_size) % level_size);
+
+        // pages the windows moved away from since are ignored
+        m_page_table.request_page(level, origins[level] + local);
+        requests[i] = 0;
+    }
+
+    m_has_requests[frame_index] = false;
+}
+
+void VirtualShadowMap::update(const PerspectiveCamera* camera, glm::vec3 light_dir, bool is_enabled) {
+    u32 frame_index = m_render_server->get_frame_index();
+    auto data_bytes = m_data_buffers[frame_index]->mapped_data_bytes();
+    auto* data      = reinterpret_cast<VirtualShadowMapData*>(data_bytes.data());
+
+    m_is_enabled = is_enabled;
+    if (!m_is_enabled) {
+        data->params.z = 0.f;
+        return;
+    }
+
+    if (light_dir != m_light_dir) {
+        m_light_dir  = light_dir;
+        m_light_view = glm::lookAt(glm::vec3(0), light_dir, calculate_light_up(light_dir));
+        m_page_table.invalidate();
+    }
+
+    u64 static_revision = m_object_renderer->get_static_revision();
+    if (static_revision != m_static_revision) {
+        m_static_revision = static_revision;
+        m_page_table.invalidate();
+    }
+
+    // the view looks down -z, the depth along the light is -z
+    glm::vec3 light_space_camera = glm::vec3(m_light_view * glm::vec4(glm::vec3(camera->get_world_pos()), 1.f));
+    float camera_depth           = -light_space_camera.z;
+
+    // every page shares the depth range so that they can be looked up with the matrix of their level, it is only moved once the camera
+    // gets far from its center as every page has to be redrawn then
+    if (std::abs(camera_depth - (m_depth_plane + shadow_far * 0.5f)) > depth_snap) {
+        m_depth_plane = std::floor((camera_depth - shadow_far * 0.5f) / depth_snap) * depth_snap;
+        m_page_table.invalidate();
+    }
+
+    glm::mat4 inv_light_view = glm::inverse(m_light_view);
+    glm::vec3 light_up       = calculate_light_up(light_dir);
+
+    auto setup_camera = [&](vke::OrthographicCamera* ortho_camera, glm::vec2 light_space_center, float width) {
+        ortho_camera->set_world_pos(glm::dvec3(inv_light_view * glm::vec4(light_space_center, -m_depth_plane, 1.f)));
+        ortho_camera->set_rotation(light_dir, light_up);
+        ortho_camera->half_width  = width * 0.5f;
+        ortho_camera->half_height = width * 0.5f;
+        ortho_camera->z_near      = 0.1f;
+        ortho_camera->z_far       = shadow_far;
+        ortho_camera->update();
+    };
+
+    u32 level_size = m_page_table.get_level_size();
+    for (u32 level = 0; level < m_page_table.get_level_count(); level++) {
+        float page_world_size = get_page_world_size(level);
+
+        // the windows move in whole pages, so the pages that stay in them keep their contents
+        glm::ivec2 camera_page = glm::ivec2(glm::floor(glm::vec2(light_space_camera) / page_world_size));
+        glm::ivec2 origin      = camera_page - glm::ivec2(level_size / 2);
+        m_page_table.set_level_origin(level, origin);
+
+        setup_camera(m_level_cameras[level].get(), (glm::vec2(origin) + static_cast<float>(level_size) * 0.5f) * page_world_size, page_world_size * level_size);
+    }
+
+    read_requests();
+
+    // dynamic casters may have moved, every requested page is redrawn for them but after the ones that are missing or stale
+    bool has_dynamic_casters = m_object_renderer->get_dynamic_instance_count() > 0;
+    m_page_table.update(std::min(page_budget, MAX_PAGES_PER_FRAME), has_dynamic_casters);
+
+    auto pages_to_draw = m_page_table.get_pages_to_draw();
+    for (u32 slot = 0; slot < pages_to_draw.size(); slot++) {
+        auto& page            = pages_to_draw[slot];
+        float page_world_size = get_page_world_size(page.level);
+
+        setup_camera(m_page_cameras[slot].get(), (glm::vec2(page.coord) + 0.5f) * page_world_size, page_world_size);
+
+        glm::vec2 tile = glm::vec2(page.physical_page % m_physical_pages_per_side, page.physical_page / m_physical_pages_per_side);
+        m_object_renderer->set_atlas_rect(m_page_render_target_names[slot], glm::vec4(tile, 1.f, 1.f) / static_cast<float>(m_physical_pages_per_side));
+    }
+
+    float screen_height = m_receiver_depth ? static_cast<float>(m_receiver_depth->height()) : 1080.f;
+
+    for (u32 level = 0; level < m_page_table.get_level_count(); level++) {
+        data->level_proj_views[level] = m_level_cameras[level]->proj_view();
+        data->level_origins[level]    = glm::ivec4(m_page_table.get_level_origin(level), 0, 0);
+    }
+
+    data->camera_inv_proj_view = glm::inverse(camera->proj_view());
+    // a pixel at a distance of 1 covers 2 / (projection[1][1] * height) units
+    data->params = glm::vec4(texel_size, 2.f / (std::abs(camera->projection()[1][1]) * screen_height), 1.f, depth_bias);
+    data->sizes  = glm::uvec4(level_size, m_page_size, m_physical_pages_per_side, m_page_table.get_level_count());
+
+    auto page_table = m_page_table.get_page_table();
+    memcpy(data_bytes.data() + sizeof(VirtualShadowMapData), page_table.data(), page_table.size_bytes());
+
+    auto& origins = m_request_origins[frame_index];
+    origins.resize(m_page_table.get_level_count());
+    for (u32 level = 0; level < origins.size(); level++) origins[level] = m_page_table.get_level_origin(level);
+}
+
+void VirtualShadowMap::request_pages(vke::CommandBuffer& primary_cmd) {
+    if (!m_is_enabled || m_receiver_depth == nullptr) return;
+
+    u32 frame_index = m_render_server->get_frame_index();
+    if (m_sets_needing_update[frame_index]) update_request_set(frame_index);
+
+    auto* timer = m_render_server->get_gpu_timing_system();
+    timer->timestamp(primary_cmd, "virtual shadow requests start", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    VkImageMemoryBarrier depth_barriers[] = {
+        VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask    = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .image            = m_receiver_depth->vke_image()->handle(),
+            .subresourceRange = m_receiver_depth->get_subresource_range(),
+        },
+    };
+
+    primary_cmd.pipeline_barrier(PipelineBarrierArgs{
+        .src_stage_mask        = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        .dst_stage_mask        = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        .image_memory_barriers = depth_barriers,
+    });
+
+    primary_cmd.bind_pipeline(m_request_pipeline.get());
+    primary_cmd.bind_descriptor_set(0, m_request_sets[frame_index]);
+
+    auto [sx, sy] = vke::calculate_dispatch_size(m_receiver_depth->width(), m_receiver_depth->height(), REQUEST_GROUP_SIZE, REQUEST_GROUP_SIZE);
+    primary_cmd.dispatch(sx, sy, 1);
+
+    VkBufferMemoryBarrier request_barriers[] = {
+        VkBufferMemoryBarrier{
+            .sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+            .buffer        = m_request_buffers[frame_index]->handle(),
+            .offset        = 0,
+            .size          = VK_WHOLE_SIZE,
+        },
+    };
+
+    primary_cmd.pipeline_barrier(PipelineBarrierArgs{
+        .src_stage_mask         = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        .dst_stage_mask         = VK_PIPELINE_STAGE_HOST_BIT,
+        .buffer_memory_barriers = request_barriers,
+    });
+
+    timer->timestamp(primary_cmd, "virtual shadow requests end", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    m_has_requests[frame_index] = true;
+}
+
+void VirtualShadowMap::render(vke::CommandBuffer& primary_cmd) {
+    auto pages_to_draw = m_is_enabled ? m_page_table.get_pages_to_draw() : std::span<const VirtualShadowPage>();
+    // the pool is sampled even while it is disabled, it is cleared once to get it into a layout that can be sampled
+    if (pages_to_draw.empty() && m_is_pool_cleared) return;
+
+    auto* timer = m_render_server->get_gpu_timing_system();
+    timer->timestamp(primary_cmd, "virtual shadow map start", VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    std::vector<RCResource<vke::CommandBuffer>> page_cmds;
+    for (u32 slot = 0; slot < pages_to_draw.size(); slot++) {
+        u32 physical_page = pages_to_draw[slot].physical_page;
+        glm::uvec2 offset = glm::uvec2(physical_page % m_physical_pages_per_side, physical_page / m_physical_pages_per_side) * m_page_size;
+
+        RCResource<vke::CommandBuffer> page_cmd = m_render_server->get_framely_command_pool()->allocate(false);
+        page_cmd->begin_secondary(m_pool_pass->get_subpass(0));
+
+        // reverse z, the page is cleared to the far plane
+        VkClearAttachment clear_attachment{
+            .aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT,
+            .clearValue = {.depthStencil = {.depth = 0.0}},
+        };
+        VkClearRect clear_rect{
+            .rect       = {.offset = {static_cast<i32>(offset.x), static_cast<i32>(offset.y)}, .extent = {m_page_size, m_page_size}},
+            .layerCount = 1,
+        };
+        vkCmdClearAttachments(page_cmd->handle(), 1, &clear_attachment, 1, &clear_rect);
+
+        m_object_renderer->render(RenderArguments{
+            .subpass_cmd        = page_cmd.get(),
+            .compute_cmd        = &primary_cmd,
+            .render_target_name = m_page_render_target_names[slot],
+        });
+
+        page_cmd->end();
+        page_cmds.push_back(std::move(page_cmd));
+    }
+
+    if (m_is_pool_cleared) {
+        VkRenderPassBeginInfo begin_info{
+            .sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass  = m_load_pass,
+            .framebuffer = m_load_framebuffer,
+            .renderArea  = {.extent = m_pool_pass->extend()},
+        };
+
+        vkCmdBeginRenderPass(primary_cmd.handle(), &begin_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    } else {
+        m_pool_pass->set_external(true);
+        m_pool_pass->begin(primary_cmd);
+    }
+
+    for (auto& page_cmd : page_cmds) primary_cmd.execute_secondaries(page_cmd.get());
+
+    if (m_is_pool_cleared) {
+        vkCmdEndRenderPass(primary_cmd.handle());
+    } else {
+        m_pool_pass->end(primary_cmd);
+        m_is_pool_cleared = true;
+    }
+
+    for (auto& page_cmd : page_cmds) primary_cmd.add_execution_dependency(page_cmd->get_reference());
+
+    timer->timestamp(primary_cmd, "virtual shadow map end", VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT);
+}
+
+void VirtualShadowMap::debug_menu() {
+    u32 physical_page_count = m_page_table.get_physical_page_count();
+    ImGui::Text("virtual shadow map: %u requested pages, %u/%u physical pages free, %u failed requests, %lu pages drawn", m_page_table.get_requested_page_count(),
+        m_page_table.get_free_page_count(), physical_page_count, m_page_table.get_failed_request_count(), m_page_table.get_pages_to_draw().size());
+
+    int budget = page_budget;
+    if (ImGui::SliderInt("virtual pages per frame", &budget, 1, MAX_PAGES_PER_FRAME)) page_budget = budget;
+
+    if (ImGui::SliderFloat("virtual texel size", &texel_size, 0.005f, 0.2f)) m_page_table.invalidate();
+
+    for (u32 level = 0; level < m_page_table.get_level_count(); level++) {
+        float window_size = get_page_world_size(level) * m_page_table.get_level_size();
+        glm::ivec2 origin = m_page_table.get_level_origin(level);
+        ImGui::Text("level %u: %.1f units wide, origin (%d,%d)", level, window_size, origin.x, origin.y);
+    }
+}
+
+} // namespace vke
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vke/vke.hpp>
+
+#include <array>
+#include <bitset>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "fwd.hpp"
+#include "render/shader/scene_data.h"
+#include "virtual_shadow_page_table.hpp"
+
+namespace vke {
+
+// shadows of the directional light in a virtual texture of clipmap levels around the camera, an alternative to the cascades.
+// a compute pass over the depth buffer requests the pages visible receivers sample, only those get a page of the physical pool
+// and are drawn, and they stay cached while the window of their level doesn't move away from them & the scene doesn't change
+class VirtualShadowMap {
+public:
+    constexpr static u32 MAX_PAGES_PER_FRAME = 32;
+
+    VirtualShadowMap(RenderServer* render_server, u32 page_size = 256, u32 physical_pages_per_side = 16, u32 level_size = 32, u32 level_count = MAX_VIRTUAL_SHADOW_LEVELS);
+    ~VirtualShadowMap();
+
+    // the depth buffer of the camera the pages are requested for, it has to be set again when it is recreated
+    void set_receiver_depth(IImageView* depth);
+
+    // reads back the requests of the frame FRAME_OVERLAP frames ago, moves the levels with the camera, picks the pages drawn in this frame
+    // and writes the data the lighting & the requests use. a disabled map only writes that it is disabled
+    void update(const PerspectiveCamera* camera, glm::vec3 light_dir, bool is_enabled);
+    // draws the pages picked by update, cmd has to be a primary command buffer. the pool is cleared in the first call even when it is disabled
+    void render(vke::CommandBuffer& primary_cmd);
+    // marks the pages the receivers need, cmd has to be a primary command buffer after the depth buffer is written
+    void request_pages(vke::CommandBuffer& primary_cmd);
+
+    RCResource<IImageView> get_image_view() { return m_pool; }
+    // VirtualShadowMapData followed by the page table
+    vke::Buffer* get_data_buffer(u32 frame_index) { return m_data_buffers[frame_index].get(); }
+
+    void debug_menu();
+
+    u32 page_budget  = 16;    // pages drawn per frame at most, up to MAX_PAGES_PER_FRAME
+    float texel_size = 0.02f; // world size of a texel of level 0, each level doubles it
+    float depth_bias = 0.00005f;
+    float shadow_far = 1000.f;
+    float depth_snap = 100.f; // the depth range of the pages moves in these steps, every page is redrawn when it does
+
+private:
+    float get_page_world_size(u32 level) const { return texel_size * static_cast<float>(m_page_size << level); }
+    void read_requests();
+    void update_request_set(u32 frame_index);
+
+private:
+    RenderServer* m_render_server;
+    ObjectRenderer* m_object_renderer;
+
+    u32 m_page_size;
+    u32 m_physical_pages_per_side;
+    VirtualShadowPageTable m_page_table;
+
+    // same as the shadow atlas, m_pool_pass clears the pool in the first frame and m_load_pass keeps the cached pages after it
+    std::unique_ptr<vke::Renderpass> m_pool_pass;
+    vke::RCResource<vke::IImageView> m_pool;
+    VkRenderPass m_load_pass         = VK_NULL_HANDLE;
+    VkFramebuffer m_load_framebuffer = VK_NULL_HANDLE;
+    bool m_is_pool_cleared           = false;
+
+    std::vector<std::string> m_page_render_target_names;
+    std::vector<std::unique_ptr<vke::OrthographicCamera>> m_page_cameras;
+    // a camera over the whole window of each level, its matrix is the one the pages are looked up with
+    std::vector<std::unique_ptr<vke::OrthographicCamera>> m_level_cameras;
+
+    // host visible, written by the cpu every frame
+    std::array<std::unique_ptr<vke::Buffer>, FRAME_OVERLAP> m_data_buffers;
+    // host visible, written by the request pass & read back by the cpu
+    std::array<std::unique_ptr<vke::Buffer>, FRAME_OVERLAP> m_request_buffers;
+    // the level origins the requests of each frame were made with
+    std::array<std::vector<glm::ivec2>, FRAME_OVERLAP> m_request_origins;
+    std::array<bool, FRAME_OVERLAP> m_has_requests = {};
+
+    IImageView* m_receiver_depth = nullptr;
+    VkDescriptorSetLayout m_request_set_layout;
+    std::array<VkDescriptorSet, FRAME_OVERLAP> m_request_sets = {};
+    std::bitset<FRAME_OVERLAP> m_sets_needing_update;
+    RCResource<vke::IPipeline> m_request_pipeline;
+
+    glm::vec3 m_light_dir  = glm::vec3(0);
+    glm::mat4 m_light_view = glm::mat4(1);
+    float m_depth_plane    = 0.f; // light space depth of the near plane of every page
+    u64 m_static_revision  = 0;
+    bool m_is_enabled      = false;
+};
+
+} // namespace vke
@@ -0,0 +1,169 @@
+#include "virtual_shadow_page_table.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace vke {
+
+VirtualShadowPageTable::VirtualShadowPageTable(u32 level_count, u32 level_size, u32 physical_page_count) {
+    assert(level_count > 0 && std::has_single_bit(level_size) && physical_page_count > 0);
+
+    m_level_size          = level_size;
+    m_physical_page_count = physical_page_count;
+
+    m_level_origins.resize(level_count, glm::ivec2(0));
+    m_slots.resize(level_count * level_size * level_size);
+    m_page_table.resize(m_slots.size(), 0);
+
+    // popped from the back, so the pages are handed out in order
+    for (u32 i = physical_page_count; i > 0; i--) m_free_pages.push_back(i - 1);
+}
+
+u32 VirtualShadowPageTable::get_slot_index(u32 level, glm::ivec2 coord) const {
+    // the windows are toroidal, a page keeps its slot while the window moves
+    glm::ivec2 wrapped = coord & glm::ivec2(m_level_size - 1);
+    return (level * m_level_size + wrapped.y) * m_level_size + wrapped.x;
+}
+
+bool VirtualShadowPageTable::is_in_window(u32 level, glm::ivec2 coord) const {
+    glm::ivec2 local = coord - m_level_origins[level];
+    return local.x >= 0 && local.y >= 0 && local.x < static_cast<i32>(m_level_size) && local.y < static_cast<i32>(m_level_size);
+}
+
+void VirtualShadowPageTable::release(u32 slot_index) {
+    auto& slot = m_slots[slot_index];
+    if (slot.physical_page == NO_PHYSICAL_PAGE) return;
+
+    m_free_pages.push_back(slot.physical_page);
+
+    slot.physical_page       = NO_PHYSICAL_PAGE;
+    slot.is_drawn            = false;
+    slot.is_valid            = false;
+    m_page_table[slot_index] = 0;
+}
+
+void VirtualShadowPageTable::set_level_origin(u32 level, glm::ivec2 origin) {
+    if (m_level_origins[level] == origin) return;
+
+    m_level_origins[level] = origin;
+
+    u32 first_slot = level * m_level_size * m_level_size;
+    for (u32 i = first_slot; i < first_slot + m_level_size * m_level_size; i++) {
+        if (m_slots[i].physical_page != NO_PHYSICAL_PAGE && !is_in_window(level, m_slots[i].coord)) release(i);
+    }
+}
+
+void VirtualShadowPageTable::begin_frame() {
+    m_frame++;
+    m_requested_slots.clear();
+}
+
+void VirtualShadowPageTable::request_page(u32 level, glm::ivec2 coord) {
+    if (level >= get_level_count() || !is_in_window(level, coord)) return;
+
+    u32 slot_index = get_slot_index(level, coord);
+    auto& slot     = m_slots[slot_index];
+
+    if (slot.last_requested_frame == m_frame) return;
+
+    // only a page that left the window had the slot before, they are released when the window moves
+    if (slot.coord != coord) release(slot_index);
+
+    slot.coord                = coord;
+    slot.last_requested_frame = m_frame;
+    m_requested_slots.push_back(slot_index);
+}
+
+void VirtualShadowPageTable::invalidate() {
+    for (auto& slot : m_slots) slot.is_valid = false;
+}
+
+void VirtualShadowPageTable::update(u32 max_draw_count, bool is_redraw_needed) {
+    u32 pages_per_level = m_level_size * m_level_size;
+
+    // slots are laid out by level, so this puts the coarse levels first
+    std::sort(m_requested_slots.begin(), m_requested_slots.end(), std::greater<u32>());
+
+    m_eviction_candidates.clear();
+    bool are_candidates_collected = false;
+    m_failed_request_count        = 0;
+
+    for (u32 slot_index : m_requested_slots) {
+        auto& slot = m_slots[slot_index];
+        if (slot.physical_page != NO_PHYSICAL_PAGE) continue;
+
+        if (m_free_pages.empty()) {
+            // the least recently requested pages are evicted first, they are popped from the back
+            if (!are_candidates_collected) {
+                for (u32 i = 0; i < m_slots.size(); i++) {
+                    if (m_slots[i].physical_page != NO_PHYSICAL_PAGE && m_slots[i].last_requested_frame != m_frame) m_eviction_candidates.push_back(i);
+                }
+
+                std::sort(m_eviction_candidates.begin(), m_eviction_candidates.end(), [&](u32 a, u32 b) { return m_slots[a].last_requested_frame > m_slots[b].last_requested_frame; });
+                are_candidates_collected = true;
+            }
+
+            if (m_eviction_candidates.empty()) {
+                m_failed_request_count++;
+                continue;
+            }
+
+            release(m_eviction_candidates.back());
+            m_eviction_candidates.pop_back();
+        }
+
+        slot.physical_page = m_free_pages.back();
+        slot.is_drawn      = false;
+        slot.is_valid      = false;
+        slot.frames_waited = 0;
+        m_free_pages.pop_back();
+    }
+
+    m_draw_candidates.clear();
+    for (u32 slot_index : m_requested_slots) {
+        auto& slot = m_slots[slot_index];
+        if (slot.physical_page == NO_PHYSICAL_PAGE) continue;
+
+        if (slot.is_drawn && slot.is_valid && !is_redraw_needed) {
+            slot.frames_waited = 0;
+            continue;
+        }
+
+        float urgency = !slot.is_drawn ? 8.f : !slot.is_valid ? 4.f : 1.f;
+        float level   = static_cast<float>(slot_index / pages_per_level);
+
+        m_draw_candidates.push_back(DrawCandidate{
+            .slot     = slot_index,
+            .priority = urgency * (level + 1.f) * static_cast<float>(slot.frames_waited + 1),
+        });
+    }
+
+    u32 draw_count = std::min<u32>(max_draw_count, m_draw_candidates.size());
+    std::partial_sort(m_draw_candidates.begin(), m_draw_candidates.begin() + draw_count, m_draw_candidates.end(), [](const DrawCandidate& a, const DrawCandidate& b) { return a.priority > b.priority; });
+
+    m_pages_to_draw.clear();
+    for (u32 i = 0; i < m_draw_candidates.size(); i++) {
+        u32 slot_index = m_draw_candidates[i].slot;
+        auto& slot     = m_slots[slot_index];
+
+        if (i >= draw_count) {
+            slot.frames_waited++;
+            continue;
+        }
+
+        // the pages are drawn later in the frame, before they are sampled, so the table can already point at them
+        slot.is_drawn            = true;
+        slot.is_valid            = true;
+        slot.frames_waited       = 0;
+        m_page_table[slot_index] = slot.physical_page + 1;
+
+        m_pages_to_draw.push_back(VirtualShadowPage{
+            .level         = slot_index / pages_per_level,
+            .coord         = slot.coord,
+            .physical_page = slot.physical_page,
+        });
+    }
+}
+
+} // namespace vke
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "common.hpp"
+
+namespace vke {
+
+struct VirtualShadowPage {
+    u32 level;
+    glm::ivec2 coord; // in pages of the level, light space
+    u32 physical_page;
+};
+
+// the cpu side of a virtual shadow map. every level is a window of level_size² pages that moves with the camera in whole pages,
+// the pages of a level are twice the size of the previous one. requested pages get a page of the physical pool and keep it
+// while they are requested and stay in the window, the least recently requested pages are evicted when the pool runs out.
+// it has no gpu resources so it can be tested on its own
+class VirtualShadowPageTable {
+public:
+    constexpr static u32 NO_PHYSICAL_PAGE = ~0u;
+
+    // level_size has to be a power of two
+    VirtualShadowPageTable(u32 level_count, u32 level_size, u32 physical_page_count);
+
+    // the pages that fall out of the new window are released
+    void set_level_origin(u32 level, glm::ivec2 origin);
+    glm::ivec2 get_level_origin(u32 level) const { return m_level_origins[level]; }
+
+    // starts the requests of a new frame
+    void begin_frame();
+    // pages outside the window of their level are ignored
+    void request_page(u32 level, glm::ivec2 coord);
+    // the contents of every page are stale, they are still sampled until they are redrawn
+    void invalidate();
+    // commits physical pages to the requested pages, coarser levels first as the finer ones fall back to them, and picks up to max_draw_count
+    // pages to draw. with is_redraw_needed valid pages are redrawn too but after the ones that are missing or stale, it is for dynamic casters
+    void update(u32 max_draw_count, bool is_redraw_needed);
+
+    std::span<const VirtualShadowPage> get_pages_to_draw() const { return m_pages_to_draw; }
+    // an entry for each page of the windows at level * level_size² + (y mod level_size) * level_size + (x mod level_size).
+    // it is the physical page + 1 for the pages that were drawn and 0 for the others
+    std::span<const u32> get_page_table() const { return m_page_table; }
+
+    u32 get_level_count() const { return m_level_origins.size(); }
+    u32 get_level_size() const { return m_level_size; }
+    u32 get_physical_page_count() const { return m_physical_page_count; }
+    u32 get_free_page_count() const { return m_free_pages.size(); }
+    u32 get_requested_page_count() const { return m_requested_slots.size(); }
+    // requested pages of the last update that didn't get a physical page
+    u32 get_failed_request_count() const { return m_failed_request_count; }
+
+private:
+    struct Slot {
+        glm::ivec2 coord;
+        u32 physical_page        = NO_PHYSICAL_PAGE;
+        u64 last_requested_frame = 0;
+        u32 frames_waited        = 0;
+        bool is_drawn            = false; // since the physical page was committed
+        bool is_valid            = false; // nothing changed since it was drawn
+    };
+
+    struct DrawCandidate {
+        u32 slot;
+        float priority;
+    };
+
+    u32 get_slot_index(u32 level, glm::ivec2 coord) const;
+    bool is_in_window(u32 level, glm::ivec2 coord) const;
+    void release(u32 slot_index);
+
+private:
+    u32 m_level_size;
+    u32 m_physical_page_count;
+    u64 m_frame = 0;
+
+    std::vector<glm::ivec2> m_level_origins;
+    std::vector<Slot> m_slots;
+    std::vector<u32> m_page_table;
+    std::vector<u32> m_free_pages;
+
+    // reused between frames
+    std::vector<u32> m_requested_slots;
+    std::vector<u32> m_eviction_candidates;
+    std::vector<DrawCandidate> m_draw_candidates;
+    std::vector<VirtualShadowPage> m_pages_to_draw;
+    u32 m_failed_request_count = 0;
+};
+
+} // namespace vke
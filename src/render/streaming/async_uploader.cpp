@@ -0,0 +1,126 @@
+#include "async_uploader.hpp"
+
+namespace vke {
+
+AsyncUploader::AsyncUploader(size_t frame_budget) : m_frame_budget(frame_budget) {
+    m_cmd_pool = std::make_unique<vke::CommandPool>();
+
+    VkSemaphoreTypeCreateInfo type_info{
+        .sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue  = 0,
+    };
+
+    VkSemaphoreCreateInfo info{
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+    };
+
+    VK_CHECK(vkCreateSemaphore(device(), &info, nullptr, &m_timeline_semaphore));
+}
+
+AsyncUploader::~AsyncUploader() {
+    // callbacks of unfinished batches are dropped, their owners are being destroyed as well
+    u64 last_value = m_next_timeline_value - 1;
+
+    VkSemaphoreWaitInfo wait_info{
+        .sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores    = &m_timeline_semaphore,
+        .pValues        = &last_value,
+    };
+
+    VK_CHECK(vkWaitSemaphores(device(), &wait_info, 5E9));
+
+    m_in_flight_batches.clear();
+    m_free_cmds.clear();
+
+    vkDestroySemaphore(device(), m_timeline_semaphore, nullptr);
+}
+
+void AsyncUploader::enqueue(Job job) {
+    m_pending_jobs.push_back(std::move(job));
+}
+
+void AsyncUploader::retire_finished_batches() {
+    u64 completed_value;
+    VK_CHECK(vkGetSemaphoreCounterValue(device(), m_timeline_semaphore, &completed_value));
+
+    while (!m_in_flight_batches.empty() && m_in_flight_batches.front().timeline_value <= completed_value) {
+        auto batch = std::move(m_in_flight_batches.front());
+        m_in_flight_batches.pop_front();
+
+        // releases the staging buffers the batch depended on
+        batch.cmd->reset();
+        m_free_cmds.push_back(std::move(batch.cmd));
+
+        for (auto& callback : batch.callbacks) {
+            if (callback) callback();
+        }
+    }
+}
+
+void AsyncUploader::update() {
+    retire_finished_batches();
+
+    m_last_frame_upload_size = 0;
+    if (m_pending_jobs.empty()) return;
+
+    std::unique_ptr<vke::CommandBuffer> cmd;
+    if (m_free_cmds.empty()) {
+        cmd = m_cmd_pool->allocate();
+    } else {
+        cmd = std::move(m_free_cmds.back());
+        m_free_cmds.pop_back();
+    }
+
+    cmd->begin();
+
+    Batch batch;
+    while (!m_pending_jobs.empty()) {
+        auto& job = m_pending_jobs.front();
+
+        // a job larger than the whole budget still goes out alone, otherwise it would never be submitted
+        if (m_last_frame_upload_size != 0 && m_last_frame_upload_size + job.byte_size > m_frame_budget) break;
+
+        job.record(*cmd);
+        m_last_frame_upload_size += job.byte_size;
+        batch.callbacks.push_back(std::move(job.on_complete));
+
+        m_pending_jobs.pop_front();
+    }
+
+    cmd->end();
+
+    batch.timeline_value = m_next_timeline_value++;
+    submit(*cmd, batch.timeline_value);
+
+    batch.cmd = std::move(cmd);
+    m_in_flight_batches.push_back(std::move(batch));
+}
+
+void AsyncUploader::submit(vke::CommandBuffer& cmd, u64 signal_value) {
+    VkTimelineSemaphoreSubmitInfo timeline_info{
+        .sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues    = &signal_value,
+    };
+
+    VkCommandBuffer cmd_handle = cmd.handle();
+
+    VkSubmitInfo submit_info{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+
+        .commandBufferCount   = 1,
+        .pCommandBuffers      = &cmd_handle,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores    = &m_timeline_semaphore,
+    };
+
+    // uploads go to the graphics queue on purpose. vke_core only creates that one, and on it the images need no
+    // queue family ownership transfer before they are sampled
+    VK_CHECK(vkQueueSubmit(get_context()->get_graphics_queue(), 1, &submit_info, VK_NULL_HANDLE));
+}
+
+} // namespace vke
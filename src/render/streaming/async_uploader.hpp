@@ -0,0 +1,66 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <vke/fwd.hpp>
+#include <vke/vke.hpp>
+
+#include "common.hpp"
+
+namespace vke {
+
+// batches upload jobs into command buffers that are submitted once per frame.
+// completion is tracked with a timeline semaphore so the frame never waits on uploads.
+// every method has to be called from the thread that runs the frame loop
+class AsyncUploader : vke::DeviceGetter {
+public:
+    struct Job {
+        // staging bytes the job records, counted against the frame budget
+        size_t byte_size = 0;
+        std::function<void(vke::CommandBuffer& cmd)> record;
+        // called from update() once the gpu has finished the batch the job was recorded into
+        std::function<void()> on_complete;
+    };
+
+    AsyncUploader(size_t frame_budget = 32 * 1024 * 1024);
+    ~AsyncUploader();
+
+    void enqueue(Job job);
+
+    // runs the callbacks of finished batches and submits the next batch within the frame budget
+    void update();
+
+    void set_frame_budget(size_t bytes) { m_frame_budget = bytes; }
+    size_t get_frame_budget() const { return m_frame_budget; }
+    size_t get_pending_job_count() const { return m_pending_jobs.size(); }
+    size_t get_in_flight_batch_count() const { return m_in_flight_batches.size(); }
+    size_t get_last_frame_upload_size() const { return m_last_frame_upload_size; }
+
+private:
+    struct Batch {
+        std::unique_ptr<vke::CommandBuffer> cmd;
+        u64 timeline_value;
+        std::vector<std::function<void()>> callbacks;
+    };
+
+    void retire_finished_batches();
+    void submit(vke::CommandBuffer& cmd, u64 signal_value);
+
+private:
+    std::unique_ptr<vke::CommandPool> m_cmd_pool;
+    std::vector<std::unique_ptr<vke::CommandBuffer>> m_free_cmds;
+
+    std::deque<Job> m_pending_jobs;
+    std::deque<Batch> m_in_flight_batches;
+
+    VkSemaphore m_timeline_semaphore = VK_NULL_HANDLE;
+    u64 m_next_timeline_value        = 1;
+
+    size_t m_frame_budget;
+    size_t m_last_frame_upload_size = 0;
+};
+
+} // namespace vke
@@ -0,0 +1,555 @@
+#include "bc_encoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+
+#include "util/thread_pool.hpp"
+
+namespace vke {
+
+namespace {
+
+constexpr int BLOCK_PIXELS = 16;
+
+struct EndpointPair {
+    float e0[4];
+    float e1[4];
+};
+
+float square(float f) { return f * f; }
+
+float distance2(const float* a, const float* b, int channels) {
+    float d = 0.f;
+    for (int c = 0; c < channels; c++) d += square(a[c] - b[c]);
+    return d;
+}
+
+EndpointPair bounding_box_endpoints(const float pixels[BLOCK_PIXELS][4], int channels) {
+    EndpointPair pair;
+    for (int c = 0; c < channels; c++) {
+        pair.e0[c] = 255.f;
+        pair.e1[c] = 0.f;
+    }
+
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        for (int c = 0; c < channels; c++) {
+            pair.e0[c] = std::min(pair.e0[c], pixels[i][c]);
+            pair.e1[c] = std::max(pair.e1[c], pixels[i][c]);
+        }
+    }
+
+    return pair;
+}
+
+// fits the endpoints to the extremes of the pixels projected onto the principal axis.
+// the axis is found with a few rounds of power iteration on the covariance matrix
+EndpointPair principal_axis_endpoints(const float pixels[BLOCK_PIXELS][4], int channels) {
+    float mean[4] = {};
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        for (int c = 0; c < channels; c++) mean[c] += pixels[i][c];
+    }
+    for (int c = 0; c < channels; c++) mean[c] /= BLOCK_PIXELS;
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) {
+                covariance[a][b] += (pixels[i][a] - mean[a]) * (pixels[i][b] - mean[b]);
+            }
+        }
+    }
+
+    auto box    = bounding_box_endpoints(pixels, channels);
+    float axis[4] = {};
+    for (int c = 0; c < channels; c++) axis[c] = box.e1[c] - box.e0[c];
+
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+        }
+
+        float length = 0.f;
+        for (int c = 0; c < channels; c++) length = std::max(length, std::abs(next[c]));
+
+        // flat blocks have no principal axis
+        if (length < 1e-6f) break;
+
+        for (int c = 0; c < channels; c++) axis[c] = next[c] / length;
+    }
+
+    float axis_length2 = 0.f;
+    for (int c = 0; c < channels; c++) axis_length2 += square(axis[c]);
+    if (axis_length2 < 1e-12f) return box;
+
+    float t_min = INFINITY, t_max = -INFINITY;
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        float t = 0.f;
+        for (int c = 0; c < channels; c++) t += (pixels[i][c] - mean[c]) * axis[c];
+        t /= axis_length2;
+
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    EndpointPair pair;
+    for (int c = 0; c < channels; c++) {
+        pair.e0[c] = std::clamp(mean[c] + axis[c] * t_min, 0.f, 255.f);
+        pair.e1[c] = std::clamp(mean[c] + axis[c] * t_max, 0.f, 255.f);
+    }
+
+    return pair;
+}
+
+// solves for the endpoints that minimize the squared error for fixed interpolation weights
+bool least_squares_endpoints(const float pixels[BLOCK_PIXELS][4], const float weights[BLOCK_PIXELS], int channels, EndpointPair& pair) {
+    float a = 0.f, b = 0.f, c = 0.f;
+    float x[4] = {}, y[4] = {};
+
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        float w  = weights[i];
+        float iw = 1.f - w;
+
+        a += iw * iw;
+        b += iw * w;
+        c += w * w;
+
+        for (int ch = 0; ch < channels; ch++) {
+            x[ch] += iw * pixels[i][ch];
+            y[ch] += w * pixels[i][ch];
+        }
+    }
+
+    float det = a * c - b * b;
+    if (std::abs(det) < 1e-6f) return false;
+
+    for (int ch = 0; ch < channels; ch++) {
+        pair.e0[ch] = std::clamp((c * x[ch] - b * y[ch]) / det, 0.f, 255.f);
+        pair.e1[ch] = std::clamp((a * y[ch] - b * x[ch]) / det, 0.f, 255.f);
+    }
+
+    return true;
+}
+
+EndpointPair initial_endpoints(const float pixels[BLOCK_PIXELS][4], int channels, BCQuality quality) {
+    return quality == BCQuality::FAST ? bounding_box_endpoints(pixels, channels) : principal_axis_endpoints(pixels, channels);
+}
+
+#pragma region BC1
+
+u16 quantize_565(const float* color) {
+    u16 r = static_cast<u16>(std::lround(color[0] * 31.f / 255.f));
+    u16 g = static_cast<u16>(std::lround(color[1] * 63.f / 255.f));
+    u16 b = static_cast<u16>(std::lround(color[2] * 31.f / 255.f));
+    return static_cast<u16>((r << 11) | (g << 5) | b);
+}
+
+void expand_565(u16 c, float* out) {
+    u32 r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = static_cast<float>((r << 3) | (r >> 2));
+    out[1] = static_cast<float>((g << 2) | (g >> 4));
+    out[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+// returns the squared error of the block
+float encode_bc1_indices(const float pixels[BLOCK_PIXELS][4], u16 c0, u16 c1, u32& indices, float weights[BLOCK_PIXELS]) {
+    // palette entries in index order with their weight towards color1
+    float palette[4][4];
+    expand_565(c0, palette[0]);
+    expand_565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        palette[2][c] = (2.f * palette[0][c] + palette[1][c]) / 3.f;
+        palette[3][c] = (palette[0][c] + 2.f * palette[1][c]) / 3.f;
+    }
+    constexpr float palette_weights[4] = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+
+    indices     = 0;
+    float error = 0.f;
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        int best_index   = 0;
+        float best_error = INFINITY;
+        for (int p = 0; p < 4; p++) {
+            float e = distance2(pixels[i], palette[p], 3);
+            if (e < best_error) {
+                best_error = e;
+                best_index = p;
+            }
+        }
+
+        indices |= static_cast<u32>(best_index) << (i * 2);
+        weights[i] = palette_weights[best_index];
+        error += best_error;
+    }
+
+    return error;
+}
+
+void encode_bc1_block(const float pixels[BLOCK_PIXELS][4], u8* output, BCQuality quality) {
+    auto endpoints = initial_endpoints(pixels, 3, quality);
+
+    u16 best_c0 = 0, best_c1 = 0;
+    u32 best_indices = 0;
+    float best_error = INFINITY;
+
+    int iterations = quality == BCQuality::HIGH ? 3 : 1;
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        // color0 > color1 selects the 4 color mode, the endpoints are ordered accordingly
+        u16 c0 = quantize_565(endpoints.e1);
+        u16 c1 = quantize_565(endpoints.e0);
+        if (c0 < c1) std::swap(c0, c1);
+
+        float weights[BLOCK_PIXELS];
+        u32 indices;
+        float error;
+
+        if (c0 == c1) {
+            // single color block, every pixel uses color0
+            float color[4];
+            expand_565(c0, color);
+
+            indices = 0;
+            error   = 0.f;
+            for (int i = 0; i < BLOCK_PIXELS; i++) {
+                error += distance2(pixels[i], color, 3);
+                weights[i] = 0.f;
+            }
+        } else {
+            error = encode_bc1_indices(pixels, c0, c1, indices, weights);
+        }
+
+        if (error < best_error) {
+            best_error   = error;
+            best_c0      = c0;
+            best_c1      = c1;
+            best_indices = indices;
+        }
+
+        if (c0 == c1 || !least_squares_endpoints(pixels, weights, 3, endpoints)) break;
+        // least squares returns e0 as color0 while the loop expects e1 to be color0
+        std::swap(endpoints.e0, endpoints.e1);
+    }
+
+    memcpy(output + 0, &best_c0, 2);
+    memcpy(output + 2, &best_c1, 2);
+    memcpy(output + 4, &best_indices, 4);
+}
+
+#pragma endregion
+
+#pragma region BC4
+
+// encodes a single channel in the 8 value mode of BC4.
+float encode_bc4_channel(const float pixels[BLOCK_PIXELS][4], int channel, u8* output, BCQuality quality) {
+    float min_value = 255.f, max_value = 0.f;
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        min_value = std::min(min_value, pixels[i][channel]);
+        max_value = std::max(max_value, pixels[i][channel]);
+    }
+
+    u64 best_bits    = 0;
+    float best_error = INFINITY;
+
+    // HIGH quality additionally tries endpoints inset by a step to better cover the inner values
+    int variants = quality == BCQuality::HIGH ? 3 : 1;
+    for (int variant = 0; variant < variants; variant++) {
+        float inset = (max_value - min_value) * (variant / 32.f);
+
+        u8 r0 = static_cast<u8>(std::lround(std::clamp(max_value - inset, 0.f, 255.f)));
+        u8 r1 = static_cast<u8>(std::lround(std::clamp(min_value + inset, 0.f, 255.f)));
+
+        u64 bits    = static_cast<u64>(r0) | (static_cast<u64>(r1) << 8);
+        float error = 0.f;
+
+        if (r0 > r1) {
+            float palette[8];
+            palette[0] = r0;
+            palette[1] = r1;
+            for (int p = 1; p < 7; p++) {
+                palette[p + 1] = ((7 - p) * r0 + p * r1) / 7.f;
+            }
+
+            for (int i = 0; i < BLOCK_PIXELS; i++) {
+                int best_index = 0;
+                float best_e   = INFINITY;
+                for (int p = 0; p < 8; p++) {
+                    float e = square(pixels[i][channel] - palette[p]);
+                    if (e < best_e) {
+                        best_e     = e;
+                        best_index = p;
+                    }
+                }
+
+                bits |= static_cast<u64>(best_index) << (16 + i * 3);
+                error += best_e;
+            }
+        } else {
+            for (int i = 0; i < BLOCK_PIXELS; i++) error += square(pixels[i][channel] - r0);
+        }
+
+        if (error < best_error) {
+            best_error = error;
+            best_bits  = bits;
+        }
+    }
+
+    memcpy(output, &best_bits, 8);
+    return best_error;
+}
+
+#pragma endregion
+
+#pragma region BC7
+
+constexpr u8 BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BC7Endpoint {
+    u8 values[4]; // 7 bit
+    u8 pbit;
+
+    float expanded(int c) const { return static_cast<float>((values[c] << 1) | pbit); }
+};
+
+// quantizes an endpoint to 7 bits per channel and picks the shared p bit with the lower error
+BC7Endpoint quantize_bc7_endpoint(const float* e) {
+    BC7Endpoint best;
+    float best_error = INFINITY;
+
+    for (u8 pbit = 0; pbit < 2; pbit++) {
+        BC7Endpoint candidate;
+        candidate.pbit = pbit;
+
+        float error = 0.f;
+        for (int c = 0; c < 4; c++) {
+            float q            = std::clamp(std::round((e[c] - pbit) / 2.f), 0.f, 127.f);
+            candidate.values[c] = static_cast<u8>(q);
+            error += square(candidate.expanded(c) - e[c]);
+        }
+
+        if (error < best_error) {
+            best_error = error;
+            best       = candidate;
+        }
+    }
+
+    return best;
+}
+
+float bc7_interpolate(float e0, float e1, int index) {
+    u32 w = BC7_WEIGHTS4[index];
+    return static_cast<float>(((64 - w) * static_cast<u32>(e0) + w * static_cast<u32>(e1) + 32) >> 6);
+}
+
+float find_bc7_indices(const float pixels[BLOCK_PIXELS][4], const BC7Endpoint& p0, const BC7Endpoint& p1, u8 indices[BLOCK_PIXELS], float weights[BLOCK_PIXELS]) {
+    float palette[16][4];
+    for (int p = 0; p < 16; p++) {
+        for (int c = 0; c < 4; c++) palette[p][c] = bc7_interpolate(p0.expanded(c), p1.expanded(c), p);
+    }
+
+    float error = 0.f;
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        int best_index = 0;
+        float best_e   = INFINITY;
+        for (int p = 0; p < 16; p++) {
+            float e = distance2(pixels[i], palette[p], 4);
+            if (e < best_e) {
+                best_e     = e;
+                best_index = p;
+            }
+        }
+
+        indices[i] = static_cast<u8>(best_index);
+        weights[i] = BC7_WEIGHTS4[best_index] / 64.f;
+        error += best_e;
+    }
+
+    return error;
+}
+
+class BitWriter {
+public:
+    BitWriter(u8* output) : m_output(output) { memset(m_output, 0, 16); }
+
+    void write(u32 value, u32 bit_count) {
+        for (u32 i = 0; i < bit_count; i++, m_position++) {
+            if ((value >> i) & 1) m_output[m_position / 8] |= static_cast<u8>(1 << (m_position % 8));
+        }
+    }
+
+private:
+    u8* m_output;
+    u32 m_position = 0;
+};
+
+void encode_bc7_block(const float pixels[BLOCK_PIXELS][4], u8* output, BCQuality quality) {
+    auto endpoints = initial_endpoints(pixels, 4, quality);
+
+    BC7Endpoint best_p0, best_p1;
+    u8 best_indices[BLOCK_PIXELS];
+    float best_error = INFINITY;
+
+    int iterations = quality == BCQuality::HIGH ? 3 : 1;
+    for (int iteration = 0; iteration < iterations; iteration++) {
+        auto p0 = quantize_bc7_endpoint(endpoints.e0);
+        auto p1 = quantize_bc7_endpoint(endpoints.e1);
+
+        u8 indices[BLOCK_PIXELS];
+        float weights[BLOCK_PIXELS];
+        float error = find_bc7_indices(pixels, p0, p1, indices, weights);
+
+        if (error < best_error) {
+            best_error = error;
+            best_p0    = p0;
+            best_p1    = p1;
+            memcpy(best_indices, indices, sizeof(indices));
+        }
+
+        if (!least_squares_endpoints(pixels, weights, 4, endpoints)) break;
+    }
+
+    // the msb of the anchor index is implicit zero, flip the endpoints when it isn't
+    if (best_indices[0] & 8) {
+        std::swap(best_p0, best_p1);
+        for (auto& index : best_indices) index = 15 - index;
+    }
+
+    BitWriter writer(output);
+    writer.write(1 << 6, 7); // mode 6
+
+    for (int c = 0; c < 4; c++) {
+        writer.write(best_p0.values[c], 7);
+        writer.write(best_p1.values[c], 7);
+    }
+
+    writer.write(best_p0.pbit, 1);
+    writer.write(best_p1.pbit, 1);
+
+    writer.write(best_indices[0], 3);
+    for (int i = 1; i < BLOCK_PIXELS; i++) {
+        writer.write(best_indices[i], 4);
+    }
+}
+
+#pragma endregion
+
+void load_block(std::span<const u8> rgba, u32 width, u32 height, u32 block_x, u32 block_y, u8 block[64]) {
+    for (u32 y = 0; y < BC_BLOCK_DIMENSION; y++) {
+        u32 sy = std::min(block_y * BC_BLOCK_DIMENSION + y, height - 1);
+        for (u32 x = 0; x < BC_BLOCK_DIMENSION; x++) {
+            u32 sx = std::min(block_x * BC_BLOCK_DIMENSION + x, width - 1);
+            memcpy(block + (y * BC_BLOCK_DIMENSION + x) * 4, rgba.data() + (sy * width + sx) * 4, 4);
+        }
+    }
+}
+
+} // namespace
+
+const char* bc_format_name(BCFormat format) {
+    switch (format) {
+    case BCFormat::BC1: return "BC1";
+    case BCFormat::BC3: return "BC3";
+    case BCFormat::BC4: return "BC4";
+    case BCFormat::BC5: return "BC5";
+    case BCFormat::BC7: return "BC7";
+    }
+
+    return "unknown";
+}
+
+u32 bc_block_byte_size(BCFormat format) {
+    switch (format) {
+    case BCFormat::BC1:
+    case BCFormat::BC4: return 8;
+    case BCFormat::BC3:
+    case BCFormat::BC5:
+    case BCFormat::BC7: return 16;
+    }
+
+    return 0;
+}
+
+size_t bc_compressed_size(BCFormat format, u32 width, u32 height) {
+    size_t blocks_x = (width + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+    size_t blocks_y = (height + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+    return blocks_x * blocks_y * bc_block_byte_size(format);
+}
+
+VkFormat bc_format_to_vk_format(BCFormat format, bool srgb) {
+    switch (format) {
+    case BCFormat::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case BCFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case BCFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case BCFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case BCFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+void encode_bc_block(BCFormat format, const u8 block[64], u8* output, BCQuality quality) {
+    float pixels[BLOCK_PIXELS][4];
+    for (int i = 0; i < BLOCK_PIXELS; i++) {
+        for (int c = 0; c < 4; c++) pixels[i][c] = block[i * 4 + c];
+    }
+
+    switch (format) {
+    case BCFormat::BC1:
+        encode_bc1_block(pixels, output, quality);
+        break;
+    case BCFormat::BC3:
+        encode_bc4_channel(pixels, 3, output, quality);
+        encode_bc1_block(pixels, output + 8, quality);
+        break;
+    case BCFormat::BC4:
+        encode_bc4_channel(pixels, 0, output, quality);
+        break;
+    case BCFormat::BC5:
+        encode_bc4_channel(pixels, 0, output, quality);
+        encode_bc4_channel(pixels, 1, output + 8, quality);
+        break;
+    case BCFormat::BC7:
+        encode_bc7_block(pixels, output, quality);
+        break;
+    }
+}
+
+std::vector<u8> encode_bc_image(BCFormat format, std::span<const u8> rgba, u32 width, u32 height, BCQuality quality, ThreadPool* thread_pool) {
+    assert(rgba.size() >= static_cast<size_t>(width) * height * 4);
+
+    u32 blocks_x   = (width + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+    u32 blocks_y   = (height + BC_BLOCK_DIMENSION - 1) / BC_BLOCK_DIMENSION;
+    u32 block_size = bc_block_byte_size(format);
+
+    std::vector<u8> output(bc_compressed_size(format, width, height));
+
+    auto encode_rows = [&, block_size](u32 row_begin, u32 row_end) {
+        u8 block[64];
+        for (u32 by = row_begin; by < row_end; by++) {
+            for (u32 bx = 0; bx < blocks_x; bx++) {
+                load_block(rgba, width, height, bx, by, block);
+                encode_bc_block(format, block, output.data() + (by * blocks_x + bx) * block_size, quality);
+            }
+        }
+    };
+
+    if (thread_pool == nullptr || blocks_y < 8) {
+        encode_rows(0, blocks_y);
+        return output;
+    }
+
+    // a few jobs per thread keeps the workers busy when rows differ in cost
+    u32 job_count     = std::min(blocks_y, thread_pool->thread_count() * 4);
+    u32 rows_per_job  = (blocks_y + job_count - 1) / job_count;
+
+    std::vector<std::future<void>> jobs;
+    for (u32 row = 0; row < blocks_y; row += rows_per_job) {
+        jobs.push_back(thread_pool->submit([&, row] { encode_rows(row, std::min(row + rows_per_job, blocks_y)); }));
+    }
+
+    for (auto& job : jobs) thread_pool->wait(job);
+
+    return output;
+}
+
+} // namespace vke
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "common.hpp"
+
+namespace vke {
+
+class ThreadPool;
+
+enum class BCFormat {
+    BC1, // rgb, 1 bit alpha is not used
+    BC3, // rgba
+    BC4, // r
+    BC5, // rg
+    BC7, // rgba, only mode 6 is emitted
+};
+
+enum class BCQuality {
+    FAST,   // bounding box endpoints
+    NORMAL, // principal axis endpoints
+    HIGH,   // principal axis endpoints refined with least squares
+};
+
+constexpr u32 BC_BLOCK_DIMENSION = 4;
+
+const char* bc_format_name(BCFormat format);
+u32 bc_block_byte_size(BCFormat format);
+size_t bc_compressed_size(BCFormat format, u32 width, u32 height);
+VkFormat bc_format_to_vk_format(BCFormat format, bool srgb);
+
+// encodes a single 4x4 block. pixels are tightly packed rgba8 in row major order
+void encode_bc_block(BCFormat format, const u8 pixels[64], u8* output, BCQuality quality);
+
+// encodes a whole rgba8 image. rows of blocks are split across the thread pool when one is passed
+// edges of images that are not a multiple of 4 are padded by clamping
+std::vector<u8> encode_bc_image(BCFormat format, std::span<const u8> rgba, u32 width, u32 height, BCQuality quality, ThreadPool* thread_pool = nullptr);
+
+} // namespace vke
@@ -0,0 +1,259 @@
+#include "texture_compression.hpp"
+
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <optional>
+
+#include <vke/vke.hpp>
+
+#include "texture_util.hpp"
+#include "util/hash.hpp"
+
+namespace vke {
+
+namespace {
+
+constexpr u32 CACHE_MAGIC   = 0x43'42'4B'56; // "VKBC"
+constexpr u32 CACHE_VERSION = 1;
+
+struct CacheHeader {
+    u32 magic;
+    u32 version;
+    u32 format;
+    u32 srgb;
+    u32 width;
+    u32 height;
+    u32 mip_count;
+    u32 padding;
+};
+
+fs::path cache_path(const TextureCompressionSettings& settings, std::span<const u8> rgba, u32 width, u32 height, BCFormat format, bool srgb) {
+    u64 hash = hash_bytes(rgba);
+    hash     = hash_value(width, hash);
+    hash     = hash_value(height, hash);
+    hash     = hash_value(format, hash);
+    hash     = hash_value(srgb, hash);
+    hash     = hash_value(settings.quality, hash);
+    hash     = hash_value(CACHE_VERSION, hash);
+
+    return fs::path(settings.cache_directory) / std::format("{:016x}.vkbc", hash);
+}
+
+// entries that don't describe the texture they are looked up for are rejected like a stale hash, the texture is encoded again
+std::optional<CompressedTexture> read_cache(const fs::path& path, u32 width, u32 height, BCFormat format, bool srgb) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return std::nullopt;
+
+    CacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return std::nullopt;
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) return std::nullopt;
+
+    // the mips are sized from the header, a corrupted one could make them arbitrarily large
+    if (header.format != static_cast<u32>(format) || (header.srgb != 0) != srgb || header.width != width || header.height != height ||
+        header.mip_count != calculate_mip_count(width, height)) {
+        LOG_WARNING("texture cache %s doesn't match its texture, encoding it again", path.c_str());
+        return std::nullopt;
+    }
+
+    CompressedTexture texture{
+        .format = static_cast<BCFormat>(header.format),
+        .srgb   = header.srgb != 0,
+        .width  = header.width,
+        .height = header.height,
+    };
+
+    for (u32 i = 0; i < header.mip_count; i++) {
+        std::vector<u8> mip(bc_compressed_size(texture.format, width, height));
+        if (!file.read(reinterpret_cast<char*>(mip.data()), mip.size())) return std::nullopt;
+        texture.mips.push_back(std::move(mip));
+
+        width  = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    return texture;
+}
+
+void write_cache(const fs::path& path, const CompressedTexture& texture) {
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+
+    // written to a temporary file first so that a crash never leaves a truncated cache entry behind
+    auto temp_path = path;
+    temp_path += ".tmp";
+
+    {
+        std::ofstream file(temp_path, std::ios::binary);
+        if (!file) {
+            LOG_WARNING("failed to write texture cache %s", temp_path.c_str());
+            return;
+        }
+
+        CacheHeader header{
+            .magic     = CACHE_MAGIC,
+            .version   = CACHE_VERSION,
+            .format    = static_cast<u32>(texture.format),
+            .srgb      = texture.srgb,
+            .width     = texture.width,
+            .height    = texture.height,
+            .mip_count = static_cast<u32>(texture.mips.size()),
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (auto& mip : texture.mips) {
+            file.write(reinterpret_cast<const char*>(mip.data()), mip.size());
+        }
+    }
+
+    fs::rename(temp_path, path, ec);
+}
+
+} // namespace
+
+BCFormat select_bc_format(TextureUsage usage) {
+    switch (usage) {
+    case TextureUsage::COLOR:
+    case TextureUsage::LINEAR_COLOR: return BCFormat::BC7;
+    case TextureUsage::NORMAL: return BCFormat::BC5;
+    case TextureUsage::SINGLE_CHANNEL: return BCFormat::BC4;
+    }
+
+    return BCFormat::BC7;
+}
+
+CompressedTexture compress_texture(std::span<const u8> rgba, u32 width, u32 height, TextureUsage usage, const TextureCompressionSettings& settings, ThreadPool* thread_pool) {
+    BCFormat format = select_bc_format(usage);
+    bool srgb       = usage == TextureUsage::COLOR;
+
+    fs::path path;
+    if (settings.use_disk_cache) {
+        path = cache_path(settings, rgba, width, height, format, srgb);
+
+        if (auto cached = read_cache(path, width, height, format, srgb)) return std::move(cached.value());
+    }
+
+    CompressedTexture texture{
+        .format = format,
+        .srgb   = srgb,
+        .width  = width,
+        .height = height,
+    };
+
+    u32 mip_count = calculate_mip_count(width, height);
+    texture.mips.reserve(mip_count);
+
+    std::vector<u8> mip_pixels;
+    std::span<const u8> current = rgba;
+
+    u32 mip_width = width, mip_height = height;
+    for (u32 i = 0; i < mip_count; i++) {
+        texture.mips.push_back(encode_bc_image(format, current, mip_width, mip_height, settings.quality, thread_pool));
+
+        if (i + 1 == mip_count) break;
+
+        mip_pixels = downsample_rgba8(current, mip_width, mip_height, srgb);
+        current    = mip_pixels;
+        mip_width  = std::max(mip_width / 2, 1u);
+        mip_height = std::max(mip_height / 2, 1u);
+    }
+
+    if (settings.use_disk_cache) {
+        write_cache(path, texture);
+    }
+
+    return texture;
+}
+
+std::unique_ptr<vke::Image> upload_compressed_texture(vke::CommandBuffer& cmd, const CompressedTexture& texture, u32 first_mip) {
+    first_mip     = std::min(first_mip, static_cast<u32>(texture.mips.size()) - 1);
+    u32 mip_count = static_cast<u32>(texture.mips.size()) - first_mip;
+
+    u32 width  = std::max(texture.width >> first_mip, 1u);
+    u32 height = std::max(texture.height >> first_mip, 1u);
+
+    auto image = std::make_unique<vke::Image>(ImageArgs{
+        .format      = texture.vk_format(),
+        .usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .width       = width,
+        .height      = height,
+        .layers      = 1,
+        .mip_levels  = mip_count,
+    });
+
+    size_t total_size = 0;
+    for (u32 i = first_mip; i < texture.mips.size(); i++) total_size += texture.mips[i].size();
+
+    RCResource<vke::Buffer> staging = std::make_unique<vke::Buffer>(VK_BUFFER_USAGE_TRANSFER_SRC_BIT, total_size, true);
+    auto staging_bytes              = staging->mapped_data_bytes();
+
+    std::vector<VkBufferImageCopy> regions;
+    regions.reserve(mip_count);
+
+    size_t offset = 0;
+    for (u32 i = 0; i < mip_count; i++) {
+        auto& mip = texture.mips[first_mip + i];
+        memcpy(staging_bytes.data() + offset, mip.data(), mip.size());
+
+        regions.push_back(VkBufferImageCopy{
+            .bufferOffset     = offset,
+            .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1},
+            .imageExtent      = {width, height, 1},
+        });
+
+        offset += mip.size();
+        width  = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    VkImageSubresourceRange range{
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .levelCount = mip_count,
+        .layerCount = 1,
+    };
+
+    VkImageMemoryBarrier pre_barriers[] = {
+        VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = 0,
+            .dstAccessMask    = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .image            = image->handle(),
+            .subresourceRange = range,
+        },
+    };
+
+    cmd.pipeline_barrier(PipelineBarrierArgs{
+        .src_stage_mask        = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        .dst_stage_mask        = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .image_memory_barriers = pre_barriers,
+    });
+
+    vkCmdCopyBufferToImage(cmd.handle(), staging->handle(), image->handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
+
+    VkImageMemoryBarrier post_barriers[] = {
+        VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask    = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .newLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .image            = image->handle(),
+            .subresourceRange = range,
+        },
+    };
+
+    cmd.pipeline_barrier(PipelineBarrierArgs{
+        .src_stage_mask        = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .dst_stage_mask        = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        .image_memory_barriers = post_barriers,
+    });
+
+    // the staging buffer has to outlive the copy
+    cmd.add_execution_dependency(staging->get_reference());
+
+    return image;
+}
+
+} // namespace vke
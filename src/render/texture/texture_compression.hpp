@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <vke/fwd.hpp>
+
+#include "bc_encoder.hpp"
+#include "common.hpp"
+#include "util/shared_bytes.hpp"
+
+namespace vke {
+
+class ThreadPool;
+
+// decides which block compressed format an imported image gets
+enum class TextureUsage {
+    COLOR,          // srgb color, BC7
+    LINEAR_COLOR,   // non color data with several channels(metallic roughness), BC7
+    NORMAL,         // tangent space normals, BC5. z has to be reconstructed in the shader
+    SINGLE_CHANNEL, // occlusion etc, BC4
+};
+
+struct TextureCompressionSettings {
+    bool enabled      = true;
+    BCQuality quality = BCQuality::NORMAL;
+    // compressed results are stored on disk keyed by the hash of their source pixels
+    bool use_disk_cache         = true;
+    std::string cache_directory = ".vke_cache/textures";
+};
+
+struct CompressedTexture {
+    BCFormat format;
+    bool srgb;
+    u32 width, height;
+    // mips read from the asset cache view its mapping, so they are copied straight into staging memory
+    std::vector<SharedBytes> mips;
+
+    VkFormat vk_format() const { return bc_format_to_vk_format(format, srgb); }
+};
+
+BCFormat select_bc_format(TextureUsage usage);
+
+// builds the full mip chain on the cpu and compresses every mip.
+// results are read from / written to the disk cache depending on the settings
+CompressedTexture compress_texture(std::span<const u8> rgba, u32 width, u32 height, TextureUsage usage, const TextureCompressionSettings& settings, ThreadPool* thread_pool = nullptr);
+
+// records the upload of every mip starting from first_mip into cmd. the image is left in SHADER_READ_ONLY_OPTIMAL
+std::unique_ptr<vke::Image> upload_compressed_texture(vke::CommandBuffer& cmd, const CompressedTexture& texture, u32 first_mip = 0);
+
+} // namespace vke
@@ -0,0 +1,192 @@
+#include "texture_util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+#include <vke/vke.hpp>
+
+namespace vke {
+
+u32 calculate_mip_count(u32 width, u32 height) {
+    return std::bit_width(std::max(std::max(width, height), 1u));
+}
+
+void generate_mipmaps(vke::CommandBuffer& cmd, vke::Image* image) {
+    u32 mip_count = image->miplevel_count();
+    if (mip_count <= 1) return;
+
+    auto mip_range = [&](u32 base_mip, u32 count = 1) {
+        return VkImageSubresourceRange{
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel   = base_mip,
+            .levelCount     = count,
+            .baseArrayLayer = 0,
+            .layerCount     = 1,
+        };
+    };
+
+    // mip 0 becomes the first blit source, the rest of the chain is discarded and made a blit target
+    VkImageMemoryBarrier pre_barriers[] = {
+        VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask    = VK_ACCESS_TRANSFER_READ_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout        = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .image            = image->handle(),
+            .subresourceRange = mip_range(0),
+        },
+        VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = 0,
+            .dstAccessMask    = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .image            = image->handle(),
+            .subresourceRange = mip_range(1, mip_count - 1),
+        },
+    };
+
+    cmd.pipeline_barrier(PipelineBarrierArgs{
+        .src_stage_mask        = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .dst_stage_mask        = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .image_memory_barriers = pre_barriers,
+    });
+
+    i32 width  = static_cast<i32>(image->width());
+    i32 height = static_cast<i32>(image->height());
+
+    for (u32 mip = 1; mip < mip_count; mip++) {
+        i32 next_width  = std::max(width / 2, 1);
+        i32 next_height = std::max(height / 2, 1);
+
+        VkImageBlit blit{
+            .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, 1},
+            .srcOffsets     = {{0, 0, 0}, {width, height, 1}},
+            .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1},
+            .dstOffsets     = {{0, 0, 0}, {next_width, next_height, 1}},
+        };
+
+        vkCmdBlitImage(cmd.handle(), image->handle(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image->handle(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        // the freshly written mip is the source of the next blit
+        VkImageMemoryBarrier barriers[] = {
+            VkImageMemoryBarrier{
+                .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+                .srcAccessMask    = VK_ACCESS_TRANSFER_WRITE_BIT,
+                .dstAccessMask    = VK_ACCESS_TRANSFER_READ_BIT,
+                .oldLayout        = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .newLayout        = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                .image            = image->handle(),
+                .subresourceRange = mip_range(mip),
+            },
+        };
+
+        cmd.pipeline_barrier(PipelineBarrierArgs{
+            .src_stage_mask        = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .dst_stage_mask        = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .image_memory_barriers = barriers,
+        });
+
+        width  = next_width;
+        height = next_height;
+    }
+
+    VkImageMemoryBarrier post_barriers[] = {
+        VkImageMemoryBarrier{
+            .sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask    = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask    = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout        = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .newLayout        = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .image            = image->handle(),
+            .subresourceRange = mip_range(0, mip_count),
+        },
+    };
+
+    cmd.pipeline_barrier(PipelineBarrierArgs{
+        .src_stage_mask        = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .dst_stage_mask        = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        .image_memory_barriers = post_barriers,
+    });
+}
+
+static float srgb_to_linear(u8 value) {
+    static const auto table = [] {
+        std::array<float, 256> t;
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.f;
+            t[i]    = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+
+    return table[value];
+}
+
+static u8 linear_to_srgb(float c) {
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f;
+    return static_cast<u8>(std::clamp(c * 255.f + 0.5f, 0.f, 255.f));
+}
+
+std::vector<u8> downsample_rgba8(std::span<const u8> rgba, u32 width, u32 height, bool srgb) {
+    u32 next_width  = std::max(width / 2, 1u);
+    u32 next_height = std::max(height / 2, 1u);
+
+    std::vector<u8> result(static_cast<size_t>(next_width) * next_height * 4);
+
+    for (u32 y = 0; y < next_height; y++) {
+        u32 y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+
+        for (u32 x = 0; x < next_width; x++) {
+            u32 x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+
+            const u8* samples[4] = {
+                &rgba[(y0 * width + x0) * 4],
+                &rgba[(y0 * width + x1) * 4],
+                &rgba[(y1 * width + x0) * 4],
+                &rgba[(y1 * width + x1) * 4],
+            };
+
+            u8* out = &result[(y * next_width + x) * 4];
+
+            for (int c = 0; c < 4; c++) {
+                if (srgb && c < 3) {
+                    float sum = 0.f;
+                    for (auto* s : samples) sum += srgb_to_linear(s[c]);
+                    out[c] = linear_to_srgb(sum * 0.25f);
+                } else {
+                    u32 sum = 0;
+                    for (auto* s : samples) sum += s[c];
+                    out[c] = static_cast<u8>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+VkSamplerCreateInfo SamplerDescription::to_create_info(float max_supported_anisotropy) const {
+    float anisotropy        = std::min(max_anisotropy, max_supported_anisotropy);
+    bool anisotropy_enabled = anisotropy > 1.f;
+
+    return VkSamplerCreateInfo{
+        .sType            = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter        = mag_filter,
+        .minFilter        = min_filter,
+        .mipmapMode       = mipmap_mode,
+        .addressModeU     = address_mode_u,
+        .addressModeV     = address_mode_v,
+        .addressModeW     = address_mode_u,
+        .anisotropyEnable = anisotropy_enabled,
+        .maxAnisotropy    = anisotropy_enabled ? anisotropy : 1.f,
+        .minLod           = 0.f,
+        // a max lod of 0 restricts sampling to the base level as gltf's non mipmapped min filters require
+        .maxLod = use_mips ? VK_LOD_CLAMP_NONE : 0.f,
+    };
+}
+
+} // namespace vke
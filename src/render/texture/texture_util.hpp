@@ -0,0 +1,54 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <vke/fwd.hpp>
+#include <vulkan/vulkan.h>
+
+#include "common.hpp"
+
+namespace vke {
+
+// full mip chain length for an image of the given size
+u32 calculate_mip_count(u32 width, u32 height);
+
+// fills mips 1..N from mip 0 with linear blits.
+// mip 0 is expected to be in SHADER_READ_ONLY_OPTIMAL and have been written in transfer stage(as done by Image::image_from_bytes).
+// the image needs TRANSFER_SRC & TRANSFER_DST usages. every mip is left in SHADER_READ_ONLY_OPTIMAL
+void generate_mipmaps(vke::CommandBuffer& cmd, vke::Image* image);
+
+// 2x2 box filter of a tightly packed rgba8 image on the cpu. odd edges are clamped.
+// color channels are averaged in linear space when srgb is set, alpha is always linear
+std::vector<u8> downsample_rgba8(std::span<const u8> rgba, u32 width, u32 height, bool srgb);
+
+struct SamplerDescription {
+    VkFilter mag_filter                 = VK_FILTER_LINEAR;
+    VkFilter min_filter                 = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode mipmap_mode     = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode address_mode_u = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    VkSamplerAddressMode address_mode_v = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    float max_anisotropy                = 8.f; // values <= 1 disable anisotropic filtering
+    bool use_mips                       = true;
+
+    bool operator==(const SamplerDescription& other) const = default;
+
+    // max_supported_anisotropy is the limit of the device, 1 when it doesn't support anisotropic filtering
+    VkSamplerCreateInfo to_create_info(float max_supported_anisotropy) const;
+};
+
+} // namespace vke
+
+template <>
+struct std::hash<vke::SamplerDescription> {
+    std::size_t operator()(const vke::SamplerDescription& d) const noexcept {
+        std::size_t h = 0;
+        h             = (h << 3) ^ d.mag_filter;
+        h             = (h << 3) ^ d.min_filter;
+        h             = (h << 3) ^ d.mipmap_mode;
+        h             = (h << 3) ^ d.address_mode_u;
+        h             = (h << 3) ^ d.address_mode_v;
+        h             = (h << 1) ^ d.use_mips;
+        h             = (h * 31) ^ std::hash<float>{}(d.max_anisotropy);
+        return h;
+    }
+};
@@ -5,11 +5,45 @@
 
 namespace vke {
 
+flecs::entity spawn_prefab_instance(flecs::world* world, flecs::entity prefab, std::optional<Transform> transform) {
+    auto entity = world->entity().is_a(prefab);
 
+    auto* rel_transform = entity.get<RelativeTransform>();
 
+    auto t1 = transform.value_or(Transform::IDENTITY);
 
+    if (rel_transform) {
+        entity.set<Transform>(t1 * static_cast<Transform>(*rel_transform));
+        entity.remove<RelativeTransform>();
+    } else {
+        entity.set<Transform>(t1);
+    }
 
+    return entity;
+}
 
+std::vector<flecs::entity_t> spawn_prefab_instances(flecs::world* world, flecs::entity prefab, std::span<const Transform> transforms) {
+    if (transforms.empty()) return {};
 
+    std::vector<Transform> world_transforms(transforms.begin(), transforms.end());
 
-} // namespace vke
\ No newline at end of file
+    // the relative transform is baked in up front. it is left on the instances since removing it would be an operation per entity,
+    // Transform takes precedence over it everywhere
+    if (auto* rel_transform = prefab.get<RelativeTransform>()) {
+        for (auto& t : world_transforms) t = t * static_cast<Transform>(*rel_transform);
+    }
+
+    void* component_data[] = {nullptr, world_transforms.data()};
+
+    ecs_bulk_desc_t desc = {};
+    desc.count           = static_cast<i32>(world_transforms.size());
+    desc.ids[0]          = ecs_pair(EcsIsA, prefab.id());
+    desc.ids[1]          = world->component<Transform>().id();
+    desc.data            = component_data;
+
+    const ecs_entity_t* entities = ecs_bulk_init(world->c_ptr(), &desc);
+
+    return std::vector<flecs::entity_t>(entities, entities + world_transforms.size());
+}
+
+} // namespace vke
@@ -2,9 +2,19 @@
 
 #include <flecs.h>
 
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "common.hpp"
+#include "transform.hpp"
 
 namespace vke{
 
-class Transform;
+// creates an instance of the prefab. the relative transform of the prefab root is applied under transform
+flecs::entity spawn_prefab_instance(flecs::world* world, flecs::entity prefab, std::optional<Transform> transform);
+// creates an instance per transform with a single bulk creation, the observers see them as one batch.
+// the returned ids are in the order of the transforms
+std::vector<flecs::entity_t> spawn_prefab_instances(flecs::world* world, flecs::entity prefab, std::span<const Transform> transforms);
 
-}
\ No newline at end of file
+}
@@ -22,6 +22,7 @@ void InstantiateMenu::draw_menu() {
         const float min_range = 0.1f, max_range = 100.f;
         ImGui::SliderFloat("range", &m_light_range, min_range, max_range);
         ImGui::SliderFloat("strength", &m_light_strength, 0.1f, 20.f);
+        ImGui::Checkbox("casts shadows", &m_light_casts_shadows);
 
         if (ImGui::CollapsingHeader("color")) {
             ImGui::ColorPicker3("color", m_picker_color);
@@ -30,7 +31,7 @@ void InstantiateMenu::draw_menu() {
         if (ImGui::Button("add light")) {
             auto entity = world->entity();
             entity.set<vke::Transform>(vke::Transform{.position = player->get_world_pos()});
-            entity.set<vke::CPointLight>(vke::CPointLight{.color = glm::vec3(m_picker_color[0], m_picker_color[1], m_picker_color[2]) * m_light_strength, .range = m_light_range});
+            entity.set<vke::CPointLight>(vke::CPointLight{.color = glm::vec3(m_picker_color[0], m_picker_color[1], m_picker_color[2]) * m_light_strength, .range = m_light_range, .casts_shadows = m_light_casts_shadows});
         }
     }
 
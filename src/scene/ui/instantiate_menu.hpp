@@ -18,6 +18,7 @@ private:
     GameEngine* m_game_engine = nullptr;
 
     float m_light_range = 5.f, m_light_strength = 2.f;
+    bool m_light_casts_shadows = false;
     float m_picker_color[4] = {};
     std::string m_selected_prefab;
     char m_coord_input_buffer[128] = "r(0,0,0) (1,1,1) (0,0,0)";
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+namespace vke {
+
+// 64 bit FNV-1a. used for content hashing of imported assets so it has to be stable across runs & platforms
+constexpr uint64_t FNV1A_SEED = 0xcbf29ce484222325ull;
+
+inline uint64_t hash_bytes(std::span<const uint8_t> bytes, uint64_t seed = FNV1A_SEED) {
+    uint64_t hash = seed;
+    for (uint8_t b : bytes) {
+        hash ^= b;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template <class T>
+uint64_t hash_value(const T& value, uint64_t seed = FNV1A_SEED) {
+    return hash_bytes(std::span(reinterpret_cast<const uint8_t*>(&value), sizeof(T)), seed);
+}
+
+} // namespace vke
@@ -0,0 +1,91 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define VKE_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define VKE_HAS_MMAP 0
+#include <fstream>
+#endif
+
+namespace vke {
+
+#if VKE_HAS_MMAP
+std::optional<MappedFile> MappedFile::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) return std::nullopt;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        return std::nullopt;
+    }
+
+    void* data = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+
+    if (data == MAP_FAILED) return std::nullopt;
+
+    MappedFile file;
+    file.m_data = static_cast<const u8*>(data);
+    file.m_size = static_cast<size_t>(file_stat.st_size);
+    return file;
+}
+#else
+std::optional<MappedFile> MappedFile::open(const std::string& path) {
+    std::ifstream stream(path, std::ios::binary | std::ios::ate);
+    if (!stream) return std::nullopt;
+
+    auto size = static_cast<size_t>(stream.tellg());
+    if (size == 0) return std::nullopt;
+
+    MappedFile file;
+    file.m_buffer.resize(size);
+
+    stream.seekg(0);
+    if (!stream.read(reinterpret_cast<char*>(file.m_buffer.data()), size)) return std::nullopt;
+
+    file.m_data = file.m_buffer.data();
+    file.m_size = size;
+    return file;
+}
+#endif
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    m_data   = std::exchange(other.m_data, nullptr);
+    m_size   = std::exchange(other.m_size, 0);
+    m_buffer = std::move(other.m_buffer);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        m_data   = std::exchange(other.m_data, nullptr);
+        m_size   = std::exchange(other.m_size, 0);
+        m_buffer = std::move(other.m_buffer);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+void MappedFile::unmap() {
+    if (m_data == nullptr) return;
+
+#if VKE_HAS_MMAP
+    munmap(const_cast<u8*>(m_data), m_size);
+#endif
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+}
+
+} // namespace vke
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+namespace vke {
+
+// a read only memory mapping of a whole file. without posix the file is read into memory instead
+class MappedFile {
+public:
+    static std::optional<MappedFile> open(const std::string& path);
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::span<const u8> bytes() const { return {m_data, m_size}; }
+
+private:
+    MappedFile() {}
+    void unmap();
+
+private:
+    const u8* m_data = nullptr;
+    size_t m_size    = 0;
+    // owns the bytes when the file was read instead of mapped
+    std::vector<u8> m_buffer;
+};
+
+} // namespace vke
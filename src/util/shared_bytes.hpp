@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "common.hpp"
+
+namespace vke {
+
+// read only bytes that either own their buffer or view memory that owner keeps alive, like a mapped file.
+// copies share the same bytes
+class SharedBytes {
+public:
+    SharedBytes() {}
+    SharedBytes(std::vector<u8> bytes) {
+        auto owned = std::make_shared<const std::vector<u8>>(std::move(bytes));
+        m_bytes    = *owned;
+        m_owner    = std::move(owned);
+    }
+    SharedBytes(std::span<const u8> bytes, std::shared_ptr<const void> owner) : m_bytes(bytes), m_owner(std::move(owner)) {}
+
+    std::span<const u8> span() const { return m_bytes; }
+    const u8* data() const { return m_bytes.data(); }
+    size_t size() const { return m_bytes.size(); }
+    bool empty() const { return m_bytes.empty(); }
+
+    operator std::span<const u8>() const { return m_bytes; }
+
+private:
+    std::span<const u8> m_bytes;
+    std::shared_ptr<const void> m_owner;
+};
+
+} // namespace vke
@@ -0,0 +1,74 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace vke {
+
+ThreadPool::ThreadPool(u32 thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_threads.reserve(thread_count);
+    for (u32 i = 0; i < thread_count; i++) {
+        m_threads.emplace_back([this] { worker_loop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_condition.notify_all();
+
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::push_task(std::function<void()> task) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+
+    m_condition.notify_one();
+}
+
+bool ThreadPool::run_pending_task() {
+    std::function<void()> task;
+
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_tasks.empty()) return false;
+
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+    }
+
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [&] { return m_stopping || !m_tasks.empty(); });
+
+            // remaining tasks are drained before exiting so that no future is left without a value
+            if (m_tasks.empty()) return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+} // namespace vke
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+namespace vke {
+
+// a simple fixed size worker pool.
+// tasks are executed in FIFO order, results are handed back through std::future
+class ThreadPool {
+public:
+    // 0 means std::thread::hardware_concurrency()
+    ThreadPool(u32 thread_count = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&)            = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <class F>
+    auto submit(F&& func) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using R = std::invoke_result_t<std::decay_t<F>>;
+
+        // std::function requires copyable callables so the task is kept behind a shared_ptr
+        auto task   = std::make_shared<std::packaged_task<R()>>(std::forward<F>(func));
+        auto future = task->get_future();
+
+        push_task([task] { (*task)(); });
+
+        return future;
+    }
+
+    // waits for the future while running queued tasks on the calling thread.
+    // tasks that wait on other pool tasks must use this, otherwise they can block every worker
+    template <class T>
+    T wait(std::future<T>& future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            // once the queue is empty the awaited task is already running on another thread
+            if (!run_pending_task()) break;
+        }
+
+        return future.get();
+    }
+
+    // runs func(i) for every i in [0, count) and waits for all of them.
+    // the first exception thrown by a task is rethrown once every task has finished
+    template <class F>
+    void parallel_for(u32 count, F&& func) {
+        std::vector<std::future<void>> futures;
+        futures.reserve(count);
+
+        for (u32 i = 0; i < count; i++) {
+            futures.push_back(submit([&func, i] { func(i); }));
+        }
+
+        std::exception_ptr exception;
+        for (auto& future : futures) {
+            try {
+                wait(future);
+            } catch (...) {
+                if (!exception) exception = std::current_exception();
+            }
+        }
+
+        if (exception) std::rethrow_exception(exception);
+    }
+
+    u32 thread_count() const { return static_cast<u32>(m_threads.size()); }
+
+private:
+    bool run_pending_task();
+    void push_task(std::function<void()> task);
+    void worker_loop();
+
+private:
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
+
+} // namespace vke
@@ -0,0 +1,55 @@
+#include "bench.hpp"
+
+#include <chrono>
+
+#include "render/gltf_loader/gltf_loader.hpp"
+#include "util/thread_pool.hpp"
+
+namespace vke {
+
+// the time it takes to import the files from gltf and from a warm asset cache.
+// the texture disk cache is left on so that the gltf import doesn't include the texture compression
+VKE_BENCHMARK(asset_cache_read) {
+    if (file_paths.empty()) {
+        LOG_WARNING("asset_cache_read needs gltf files, skipping it");
+        return;
+    }
+
+    ThreadPool thread_pool;
+    TextureCompressionSettings compression_settings;
+    LodSettings lod_settings;
+
+    AssetCacheSettings source_settings;
+    source_settings.enabled = false;
+
+    AssetCacheSettings cache_settings;
+
+    auto time_ms = [](auto&& func) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    for (auto& file_path : file_paths) {
+        std::optional<GltfImportData> source_data;
+        double source_ms = time_ms([&] { source_data = import_gltf_file(file_path, compression_settings, source_settings, lod_settings, &thread_pool); });
+        if (!source_data.has_value()) {
+            LOG_ERROR("benchmark failed to import gltf file %s", file_path.c_str());
+            continue;
+        }
+
+        // makes sure the cache is warm
+        write_asset_cache(cache_settings, source_data.value(), compression_settings, lod_settings);
+
+        bool cache_hit  = false;
+        double cache_ms = time_ms([&] { cache_hit = read_asset_cache(cache_settings, file_path, compression_settings, lod_settings).has_value(); });
+        if (!cache_hit) {
+            LOG_ERROR("benchmark failed to read the asset cache of %s", file_path.c_str());
+            continue;
+        }
+
+        LOG_INFO("%s: gltf import %.1f ms, asset cache %.1f ms (%.1fx)", file_path.c_str(), source_ms, cache_ms, source_ms / cache_ms);
+    }
+}
+
+} // namespace vke
@@ -0,0 +1,197 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include "render/gltf_loader/asset_cache.hpp"
+#include "render/gltf_loader/gltf_loader.hpp"
+#include "render/texture/texture_util.hpp"
+#include "meshlet_validation.hpp"
+
+namespace vke {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr u32 GRID_SIZE = 16;
+
+fs::path test_directory() {
+    return fs::temp_directory_path() / "vke_engine_tests" / "asset_cache";
+}
+
+AssetCacheSettings test_cache_settings() {
+    return AssetCacheSettings{.enabled = true, .cache_directory = (test_directory() / "cache").string()};
+}
+
+// the cache is keyed by the size & write time of the source, its content doesn't matter
+std::string create_source_file() {
+    fs::create_directories(test_directory());
+
+    auto path = (test_directory() / "source.gltf").string();
+    std::ofstream(path) << "{}";
+    return path;
+}
+
+MeshBuilder create_grid_builder() {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    for (u32 y = 0; y <= GRID_SIZE; y++) {
+        for (u32 x = 0; x <= GRID_SIZE; x++) {
+            positions.push_back(glm::vec3(x, y, 0.f));
+            uvs.push_back(glm::vec2(x, y) / static_cast<float>(GRID_SIZE));
+        }
+    }
+
+    std::vector<u32> indicies;
+    for (u32 y = 0; y < GRID_SIZE; y++) {
+        for (u32 x = 0; x < GRID_SIZE; x++) {
+            u32 a = y * (GRID_SIZE + 1) + x;
+            u32 c = a + GRID_SIZE + 1;
+            indicies.insert(indicies.end(), {a, a + 1, c, a + 1, c + 1, c});
+        }
+    }
+
+    MeshBuilder builder;
+    builder.set_positions(positions);
+    builder.set_texture_coords(uvs);
+    builder.set_normals(std::vector<glm::vec3>(positions.size(), glm::vec3(0.f, 0.f, 1.f)));
+    builder.set_indicies(std::span<const u32>(indicies));
+    builder.calculate_boundary();
+    builder.optimize();
+    return builder;
+}
+
+std::vector<u8> create_bytes(size_t size, u8 seed) {
+    std::vector<u8> bytes(size);
+    for (size_t i = 0; i < size; i++) bytes[i] = static_cast<u8>(i * 31 + seed);
+    return bytes;
+}
+
+GltfImportData create_import_data(const std::string& source_path, MeshBuilder builder) {
+    GltfImportData data;
+    data.file_path = source_path;
+
+    auto& rgba_image  = data.images.emplace_back();
+    rgba_image.usage  = TextureUsage::COLOR;
+    rgba_image.width  = 8;
+    rgba_image.height = 4;
+    rgba_image.rgba   = create_bytes(8 * 4 * 4, 1);
+
+    auto& compressed_image  = data.images.emplace_back();
+    compressed_image.usage  = TextureUsage::NORMAL;
+    compressed_image.width  = 16;
+    compressed_image.height = 8;
+
+    auto& compressed = compressed_image.compressed.emplace(CompressedTexture{.format = BCFormat::BC5, .srgb = false, .width = 16, .height = 8});
+    u32 width = 16, height = 8;
+    for (u32 mip = 0; mip < calculate_mip_count(16, 8); mip++) {
+        compressed.mips.push_back(create_bytes(bc_compressed_size(compressed.format, width, height), static_cast<u8>(mip)));
+        width  = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+
+    data.materials.push_back(ImportedMaterial{.base_color_image = 0});
+
+    auto& mesh             = data.meshes.emplace_back();
+    mesh.name              = "grid";
+    auto& primitive        = mesh.primitives.emplace_back();
+    primitive.builder      = std::move(builder);
+    primitive.material     = 0;
+    primitive.content_hash = primitive.builder.content_hash();
+
+    auto& node     = data.nodes.emplace_back();
+    node.mesh      = 0;
+    node.transform = RelativeTransform{.position = glm::vec3(1.f, 2.f, 3.f), .rotation = glm::quat(1.f, 0.f, 0.f, 0.f), .scale = glm::vec3(1.f)};
+
+    return data;
+}
+
+bool equal_bytes(std::span<const u8> a, std::span<const u8> b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end());
+}
+
+template <class T>
+bool equal_items(std::span<const T> a, std::span<const T> b) {
+    return equal_bytes(vke::span_cast<const u8>(a), vke::span_cast<const u8>(b));
+}
+
+} // namespace
+
+VKE_TEST(asset_cache_round_trip) {
+    std::vector<std::string> errors;
+
+    auto source_path = create_source_file();
+    auto settings    = test_cache_settings();
+    auto data        = create_import_data(source_path, create_grid_builder());
+
+    write_asset_cache(settings, data, TextureCompressionSettings{}, LodSettings{});
+    auto read = read_asset_cache(settings, source_path, TextureCompressionSettings{}, LodSettings{});
+    if (!read.has_value()) return {"the cache entry that was just written was rejected"};
+
+    if (read->images.size() != 2) return {std::format("{} images were read", read->images.size())};
+    if (!equal_bytes(read->images[0].rgba, data.images[0].rgba)) errors.push_back("the rgba pixels changed");
+
+    auto& compressed = read->images[1].compressed;
+    if (!compressed.has_value() || compressed->mips.size() != data.images[1].compressed->mips.size()) {
+        errors.push_back("the mips of the compressed image were lost");
+    } else {
+        for (u32 mip = 0; mip < compressed->mips.size(); mip++) {
+            if (!equal_bytes(compressed->mips[mip], data.images[1].compressed->mips[mip])) errors.push_back(std::format("mip {} changed", mip));
+        }
+    }
+
+    if (read->meshes.size() != 1 || read->meshes[0].primitives.size() != 1) return {"the mesh was lost"};
+
+    auto& builder        = read->meshes[0].primitives[0].builder;
+    auto& source_builder = data.meshes[0].primitives[0].builder;
+    if (!equal_items(builder.get_positions(), source_builder.get_positions())) errors.push_back("the positions changed");
+    if (!equal_items(builder.get_indicies(), source_builder.get_indicies())) errors.push_back("the indicies changed");
+    if (builder.get_index_type() != source_builder.get_index_type()) errors.push_back("the index type changed");
+    if (builder.content_hash() != read->meshes[0].primitives[0].content_hash) errors.push_back("the content hash doesn't match the builder");
+
+    for (auto& error : validate_meshlets(builder.get_meshlets(), builder.get_indicies(), builder.get_positions())) errors.push_back(error);
+
+    if (read->nodes.size() != 1 || read->nodes[0].mesh != 0 || read->nodes[0].transform.position != glm::vec3(1.f, 2.f, 3.f)) errors.push_back("the node changed");
+    if (read->file_path != source_path) errors.push_back("the file path isn't the source path");
+
+    return errors;
+}
+
+VKE_TEST(asset_cache_rejects_out_of_range_indicies) {
+    auto source_path = create_source_file();
+    auto settings    = test_cache_settings();
+
+    // an index past the last vertex, setting the indicies after optimize drops the meshlets so only the index check can catch it
+    auto builder  = create_grid_builder();
+    auto indicies = std::vector<u32>(builder.get_indicies().begin(), builder.get_indicies().end());
+    indicies[7]   = static_cast<u32>(builder.get_positions().size());
+    builder.set_indicies(std::span<const u32>(indicies), builder.get_index_type());
+
+    write_asset_cache(settings, create_import_data(source_path, std::move(builder)), TextureCompressionSettings{}, LodSettings{});
+    if (read_asset_cache(settings, source_path, TextureCompressionSettings{}, LodSettings{}).has_value()) return {"an entry with an out of range index was read"};
+
+    return {};
+}
+
+VKE_TEST(asset_cache_rejects_stale_and_truncated_entries) {
+    std::vector<std::string> errors;
+
+    auto source_path = create_source_file();
+    auto settings    = test_cache_settings();
+
+    write_asset_cache(settings, create_import_data(source_path, create_grid_builder()), TextureCompressionSettings{}, LodSettings{});
+
+    LodSettings other_lod_settings;
+    other_lod_settings.max_lod_count++;
+    if (read_asset_cache(settings, source_path, TextureCompressionSettings{}, other_lod_settings).has_value()) errors.push_back("an entry with other lod settings was read");
+
+    auto cache_path = asset_cache_path(settings, source_path);
+    fs::resize_file(cache_path, fs::file_size(cache_path) - 16);
+    if (read_asset_cache(settings, source_path, TextureCompressionSettings{}, LodSettings{}).has_value()) errors.push_back("a truncated entry was read");
+
+    return errors;
+}
+
+} // namespace vke
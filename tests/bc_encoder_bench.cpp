@@ -0,0 +1,58 @@
+#include "bench.hpp"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "render/texture/bc_encoder.hpp"
+#include "util/thread_pool.hpp"
+
+namespace vke {
+
+// encodes a generated image into every format the importer picks at every quality, on one thread and on the pool.
+// the image is gradients with noise so that the endpoint searches have work to do
+VKE_BENCHMARK(bc_encoder_throughput) {
+    constexpr u32 size = 1024;
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<u32> noise(0, 31);
+
+    std::vector<u8> rgba(size * size * 4);
+    for (u32 y = 0; y < size; y++) {
+        for (u32 x = 0; x < size; x++) {
+            u8* pixel = &rgba[(y * size + x) * 4];
+            pixel[0]  = static_cast<u8>(x * 224 / size + noise(rng));
+            pixel[1]  = static_cast<u8>(y * 224 / size + noise(rng));
+            pixel[2]  = static_cast<u8>((x + y) * 112 / size + noise(rng));
+            pixel[3]  = static_cast<u8>(255 - noise(rng));
+        }
+    }
+
+    ThreadPool thread_pool;
+
+    const BCFormat formats[]    = {BCFormat::BC7, BCFormat::BC5, BCFormat::BC4};
+    const BCQuality qualities[] = {BCQuality::FAST, BCQuality::NORMAL, BCQuality::HIGH};
+    const char* quality_names[] = {"fast", "normal", "high"};
+
+    // summed so that the encodes aren't optimized away
+    u64 checksum = 0;
+
+    for (auto format : formats) {
+        for (u32 q = 0; q < std::size(qualities); q++) {
+            for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr), &thread_pool}) {
+                auto start = std::chrono::steady_clock::now();
+
+                auto blocks = encode_bc_image(format, rgba, size, size, qualities[q], pool);
+
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                for (u8 byte : blocks) checksum += byte;
+
+                LOG_INFO("%s %s with %u threads: %.1f ms (%.1f MPix/s)", bc_format_name(format), quality_names[q], pool ? pool->thread_count() : 1, seconds * 1000.0, size * size / (seconds * 1e6));
+            }
+        }
+    }
+
+    LOG_INFO("bc encoder checksum %lu", checksum);
+}
+
+} // namespace vke
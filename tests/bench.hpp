@@ -0,0 +1,21 @@
+#pragma once
+
+#include <span>
+#include <string>
+
+namespace vke::bench {
+
+// file_paths are the gltf files given on the command line, benchmarks that import files skip when there are none
+using BenchmarkFunction = void (*)(std::span<const std::string> file_paths);
+
+struct BenchmarkRegistration {
+    BenchmarkRegistration(const char* name, BenchmarkFunction function);
+};
+
+} // namespace vke::bench
+
+// defines a benchmark that is run by vke_engine_bench, it logs its own timings
+#define VKE_BENCHMARK(name)                                                          \
+    static void name(std::span<const std::string> file_paths);                       \
+    static const vke::bench::BenchmarkRegistration name##_registration(#name, name); \
+    static void name(std::span<const std::string> file_paths)
@@ -0,0 +1,52 @@
+#include "bench.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace vke::bench {
+
+namespace {
+
+struct Benchmark {
+    const char* name;
+    BenchmarkFunction function;
+};
+
+// a function local so that it exists before the registrations of the other files run
+std::vector<Benchmark>& registered_benchmarks() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+} // namespace
+
+BenchmarkRegistration::BenchmarkRegistration(const char* name, BenchmarkFunction function) {
+    registered_benchmarks().push_back(Benchmark{.name = name, .function = function});
+}
+
+} // namespace vke::bench
+
+// vke_engine_bench [--filter <name>] [gltf files...]
+// runs every benchmark, or the ones whose name contains the filter
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    std::vector<std::string> file_paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            file_paths.push_back(argv[i]);
+        }
+    }
+
+    for (auto& benchmark : vke::bench::registered_benchmarks()) {
+        if (filter != nullptr && std::strstr(benchmark.name, filter) == nullptr) continue;
+
+        printf("[run] %s\n", benchmark.name);
+        benchmark.function(file_paths);
+    }
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "test.hpp"
+
+#include "render/iobject_renderer.hpp"
+
+namespace vke {
+
+VKE_TEST(id_ranges_are_consecutive_after_frees) {
+    std::vector<std::string> errors;
+
+    GenericIDManager<InstanceID> id_manager(0);
+
+    std::vector<InstanceID> ids;
+    for (u32 i = 0; i < 100; i++) ids.push_back(id_manager.new_id());
+
+    // every other id is freed, no run of them is long enough for the range
+    for (u32 i = 0; i < 100; i += 2) id_manager.free_id(ids[i]);
+
+    auto first_id = id_manager.new_id_range(10);
+    if (first_id.id != 100) errors.push_back(std::format("range of 10 with scattered frees: starts at {} instead of 100", first_id.id));
+    if (id_manager.id_count() != 110) errors.push_back(std::format("range of 10 with scattered frees: id count is {} instead of 110", id_manager.id_count()));
+
+    // single ids still reuse the freed ones, lowest first
+    auto id = id_manager.new_id();
+    if (id.id != 0) errors.push_back(std::format("single id after frees: got {} instead of 0", id.id));
+
+    return errors;
+}
+
+VKE_TEST(id_ranges_reuse_freed_runs) {
+    std::vector<std::string> errors;
+
+    GenericIDManager<InstanceID> id_manager(0);
+    auto first_id = id_manager.new_id_range(100);
+
+    for (u32 i = 20; i < 40; i++) id_manager.free_id(InstanceID(first_id.id + i));
+
+    auto reused = id_manager.new_id_range(15);
+    if (reused.id != 20) errors.push_back(std::format("range of 15 in a freed run of 20: starts at {} instead of 20", reused.id));
+
+    // the 5 ids left of the run are too few, the range goes to the end
+    auto appended = id_manager.new_id_range(10);
+    if (appended.id != 100) errors.push_back(std::format("range of 10 with a freed run of 5: starts at {} instead of 100", appended.id));
+
+    // a freed run at the end is extended instead of leaving it unused
+    for (u32 i = 105; i < 110; i++) id_manager.free_id(InstanceID(i));
+    auto extended = id_manager.new_id_range(8);
+    if (extended.id != 105 || id_manager.id_count() != 113) {
+        errors.push_back(std::format("range of 8 on a trailing run of 5: starts at {} with an id count of {} instead of 105 and 113", extended.id, id_manager.id_count()));
+    }
+
+    // the remaining ids of the first run are still free
+    for (u32 expected : {35, 36, 37, 38, 39}) {
+        auto id = id_manager.new_id();
+        if (id.id != expected) errors.push_back(std::format("single id after ranges: got {} instead of {}", id.id, expected));
+    }
+
+    return errors;
+}
+
+} // namespace vke
@@ -0,0 +1,48 @@
+#include "bench.hpp"
+
+#include <chrono>
+#include <thread>
+
+#include "render/gltf_loader/gltf_loader.hpp"
+#include "util/thread_pool.hpp"
+
+namespace vke {
+
+// imports the files with a pool of each thread count.
+// the texture disk cache and the asset cache are bypassed so that every run does the same work
+VKE_BENCHMARK(gltf_import_thread_scaling) {
+    if (file_paths.empty()) {
+        LOG_WARNING("gltf_import_thread_scaling needs gltf files, skipping it");
+        return;
+    }
+
+    TextureCompressionSettings compression_settings;
+    compression_settings.use_disk_cache = false;
+
+    AssetCacheSettings cache_settings;
+    cache_settings.enabled = false;
+
+    u32 max_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+
+    double first_ms = 0.0;
+    for (u32 thread_count = 1;; thread_count = std::min(thread_count * 2, max_thread_count)) {
+        ThreadPool thread_pool(thread_count);
+
+        auto start = std::chrono::steady_clock::now();
+
+        thread_pool.parallel_for(static_cast<u32>(file_paths.size()), [&](u32 i) {
+            if (!import_gltf_file(file_paths[i], compression_settings, cache_settings, LodSettings{}, &thread_pool).has_value()) {
+                LOG_ERROR("benchmark failed to import gltf file %s", file_paths[i].c_str());
+            }
+        });
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (first_ms == 0.0) first_ms = ms;
+
+        LOG_INFO("gltf import of %lu files with %u threads took %.1f ms (%.2fx of the first run)", file_paths.size(), thread_count, ms, first_ms / ms);
+
+        if (thread_count == max_thread_count) break;
+    }
+}
+
+} // namespace vke
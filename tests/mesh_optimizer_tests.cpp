@@ -0,0 +1,154 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include "render/mesh/mesh_optimizer.hpp"
+
+namespace vke {
+
+namespace {
+
+constexpr u32 GRID_SIZE = 64; // quads per side
+
+// two triangles per quad, in row order
+std::vector<u32> create_grid_indicies() {
+    std::vector<u32> indicies;
+    for (u32 y = 0; y < GRID_SIZE; y++) {
+        for (u32 x = 0; x < GRID_SIZE; x++) {
+            u32 a = y * (GRID_SIZE + 1) + x;
+            u32 b = a + 1;
+            u32 c = a + GRID_SIZE + 1;
+            u32 d = c + 1;
+            indicies.insert(indicies.end(), {a, b, c, b, d, c});
+        }
+    }
+    return indicies;
+}
+
+std::vector<glm::vec3> create_grid_positions() {
+    std::vector<glm::vec3> positions;
+    for (u32 y = 0; y <= GRID_SIZE; y++) {
+        for (u32 x = 0; x <= GRID_SIZE; x++) positions.push_back(glm::vec3(x, y, 0.f));
+    }
+    return positions;
+}
+
+// the worst order for the cache, seeded so that every run measures the same mesh
+std::vector<u32> shuffle_triangles(std::span<const u32> indicies) {
+    std::vector<u32> triangles(indicies.size() / 3);
+    for (u32 i = 0; i < triangles.size(); i++) triangles[i] = i;
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1234));
+
+    std::vector<u32> shuffled;
+    for (u32 t : triangles) shuffled.insert(shuffled.end(), {indicies[t * 3], indicies[t * 3 + 1], indicies[t * 3 + 2]});
+    return shuffled;
+}
+
+constexpr u32 GRID_VERTEX_COUNT = (GRID_SIZE + 1) * (GRID_SIZE + 1);
+
+// forsyth's order gets about 0.67 on a large grid with a 16 entry fifo, row order about 1.0 and a random order about 3.0
+constexpr float OPTIMIZED_MAX_ACMR = 0.75f;
+constexpr float OPTIMIZED_MAX_ATVR = 1.4f;
+
+void check_optimized(std::vector<std::string>& errors, const char* name, std::span<u32> indicies) {
+    auto before = analyze_vertex_cache(indicies, GRID_VERTEX_COUNT);
+    optimize_vertex_cache(indicies, GRID_VERTEX_COUNT);
+    auto after = analyze_vertex_cache(indicies, GRID_VERTEX_COUNT);
+
+    if (after.acmr >= before.acmr) errors.push_back(std::format("{}: acmr went from {} to {}", name, before.acmr, after.acmr));
+    if (after.atvr >= before.atvr) errors.push_back(std::format("{}: atvr went from {} to {}", name, before.atvr, after.atvr));
+    if (after.acmr > OPTIMIZED_MAX_ACMR) errors.push_back(std::format("{}: acmr is {} after the optimization", name, after.acmr));
+    if (after.atvr > OPTIMIZED_MAX_ATVR) errors.push_back(std::format("{}: atvr is {} after the optimization", name, after.atvr));
+}
+
+// every triangle of the source has to be in the result once, with its winding
+std::vector<std::string> compare_triangles(std::span<const u32> expected, std::span<const u32> result) {
+    auto canonical_triangles = [](std::span<const u32> indicies) {
+        std::vector<std::array<u32, 3>> triangles;
+        for (u32 i = 0; i < indicies.size(); i += 3) {
+            std::array<u32, 3> triangle = {indicies[i], indicies[i + 1], indicies[i + 2]};
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.push_back(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    };
+
+    if (canonical_triangles(expected) != canonical_triangles(result)) return {"the triangles changed"};
+    return {};
+}
+
+} // namespace
+
+VKE_TEST(vertex_cache_optimizes_row_order_grid) {
+    std::vector<std::string> errors;
+
+    auto indicies = create_grid_indicies();
+    auto source   = indicies;
+    check_optimized(errors, "row order", indicies);
+
+    for (auto& error : compare_triangles(source, indicies)) errors.push_back(error);
+    return errors;
+}
+
+VKE_TEST(vertex_cache_optimizes_shuffled_grid) {
+    std::vector<std::string> errors;
+
+    auto indicies = shuffle_triangles(create_grid_indicies());
+    auto source   = indicies;
+    check_optimized(errors, "shuffled", indicies);
+
+    for (auto& error : compare_triangles(source, indicies)) errors.push_back(error);
+    return errors;
+}
+
+VKE_TEST(overdraw_keeps_acmr_within_threshold) {
+    std::vector<std::string> errors;
+
+    auto indicies  = shuffle_triangles(create_grid_indicies());
+    auto positions = create_grid_positions();
+    optimize_vertex_cache(indicies, GRID_VERTEX_COUNT);
+
+    constexpr float threshold = 1.05f;
+
+    auto source      = indicies;
+    float cache_acmr = analyze_vertex_cache(indicies, GRID_VERTEX_COUNT).acmr;
+    optimize_overdraw(indicies, positions, threshold);
+
+    float acmr = analyze_vertex_cache(indicies, GRID_VERTEX_COUNT).acmr;
+    if (acmr > cache_acmr * threshold + 1e-4f) errors.push_back(std::format("acmr went from {} to {} with a threshold of {}", cache_acmr, acmr, threshold));
+
+    for (auto& error : compare_triangles(source, indicies)) errors.push_back(error);
+    return errors;
+}
+
+VKE_TEST(vertex_fetch_remap_keeps_acmr) {
+    std::vector<std::string> errors;
+
+    auto indicies = shuffle_triangles(create_grid_indicies());
+    optimize_vertex_cache(indicies, GRID_VERTEX_COUNT);
+    auto before = analyze_vertex_cache(indicies, GRID_VERTEX_COUNT);
+
+    auto remap = optimize_vertex_fetch_remap(indicies, GRID_VERTEX_COUNT);
+    auto after = analyze_vertex_cache(indicies, GRID_VERTEX_COUNT);
+
+    if (after.acmr != before.acmr) errors.push_back(std::format("acmr went from {} to {}", before.acmr, after.acmr));
+
+    // every vertex of the grid is referenced, so the remap is a permutation that follows the first references
+    u32 next_vertex = 0;
+    for (u32 index : indicies) {
+        if (index > next_vertex) {
+            errors.push_back(std::format("vertex {} is referenced before vertex {}", index, next_vertex));
+            break;
+        }
+        if (index == next_vertex) next_vertex++;
+    }
+    if (next_vertex != GRID_VERTEX_COUNT) errors.push_back(std::format("{} of {} vertices are referenced", next_vertex, GRID_VERTEX_COUNT));
+    if (std::count(remap.begin(), remap.end(), UNUSED_VERTEX) != 0) errors.push_back("a used vertex was dropped");
+
+    return errors;
+}
+
+} // namespace vke
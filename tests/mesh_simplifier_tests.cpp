@@ -0,0 +1,158 @@
+#include "test.hpp"
+
+#include <cmath>
+
+#include "render/mesh/mesh.hpp"
+#include "render/mesh/mesh_simplifier.hpp"
+
+namespace vke {
+
+namespace {
+
+constexpr u32 GRID_SIZE = 64; // quads per side
+
+// a wavy open grid, the waves give the collapses an error. seam_x duplicates the column of vertices at that x,
+// the two sides of it only share positions like the two sides of an attribute seam
+struct Grid {
+    std::vector<glm::vec3> positions;
+    std::vector<u32> indicies;
+};
+
+Grid create_grid(u32 seam_x = ~0u) {
+    Grid grid;
+
+    auto vertex_index = [&](u32 x, u32 y) { return y * (GRID_SIZE + 1) + x; };
+    for (u32 y = 0; y <= GRID_SIZE; y++) {
+        for (u32 x = 0; x <= GRID_SIZE; x++) grid.positions.push_back(glm::vec3(x, y, std::sin(x * 0.3f) * std::cos(y * 0.2f) * 2.f));
+    }
+
+    // the seam copies are after the grid, the quads right of the seam use them
+    u32 seam_start = grid.positions.size();
+    if (seam_x <= GRID_SIZE) {
+        for (u32 y = 0; y <= GRID_SIZE; y++) grid.positions.push_back(grid.positions[vertex_index(seam_x, y)]);
+    }
+
+    auto index = [&](u32 x, u32 y, u32 quad_x) { return x == seam_x && quad_x >= seam_x ? seam_start + y : vertex_index(x, y); };
+    for (u32 y = 0; y < GRID_SIZE; y++) {
+        for (u32 x = 0; x < GRID_SIZE; x++) {
+            u32 a = index(x, y, x), b = index(x + 1, y, x), c = index(x, y + 1, x), d = index(x + 1, y + 1, x);
+            grid.indicies.insert(grid.indicies.end(), {a, b, c, b, d, c});
+        }
+    }
+
+    return grid;
+}
+
+// every vertex of the list has to still be used by a triangle, a moved vertex is never used again
+void check_vertices_kept(std::vector<std::string>& errors, const char* name, std::span<const u32> indicies, std::span<const u32> vertices, u32 vertex_count) {
+    std::vector<bool> is_used(vertex_count, false);
+    for (u32 index : indicies) is_used[index] = true;
+
+    for (u32 vertex : vertices) {
+        if (!is_used[vertex]) errors.push_back(std::format("{}: vertex {} was collapsed", name, vertex));
+    }
+}
+
+} // namespace
+
+VKE_TEST(simplify_mesh_reaches_target_triangle_count) {
+    std::vector<std::string> errors;
+
+    auto grid          = create_grid();
+    u32 triangle_count = grid.indicies.size() / 3;
+
+    for (u32 divisor : {2, 4, 8}) {
+        u32 target                = triangle_count / divisor;
+        auto result               = simplify_mesh(grid.indicies, grid.positions, target * 3);
+        u32 result_triangle_count = result.indicies.size() / 3;
+
+        // a collapse removes two triangles, so the last one can go one below the target
+        if (result_triangle_count > target || result_triangle_count + 1 < target) {
+            errors.push_back(std::format("target of {} triangles: simplified to {}", target, result_triangle_count));
+        }
+        if (result.indicies.size() % 3 != 0) errors.push_back(std::format("target of {} triangles: {} indicies aren't whole triangles", target, result.indicies.size()));
+    }
+
+    // the error limit stops the collapses before the target
+    auto limited = simplify_mesh(grid.indicies, grid.positions, 0, 0.01f);
+    if (limited.error > 0.01f) errors.push_back(std::format("error limit of 0.01: simplified with an error of {}", limited.error));
+
+    return errors;
+}
+
+VKE_TEST(generate_lods_errors_never_decrease) {
+    std::vector<std::string> errors;
+
+    auto grid = create_grid();
+
+    MeshBuilder builder;
+    builder.set_positions(grid.positions);
+    builder.set_indicies(std::span<const u32>(grid.indicies));
+    builder.calculate_boundary();
+
+    LodSettings settings{.max_lod_count = 6, .min_triangle_count = 64, .max_relative_error = 1.f};
+
+    auto lods = builder.generate_lods(settings);
+    if (lods.size() < 2) errors.push_back(std::format("only {} lods were generated", lods.size()));
+
+    u32 previous_triangle_count = grid.indicies.size() / 3;
+    float previous_error        = 0.f;
+    for (u32 i = 0; i < lods.size(); i++) {
+        u32 triangle_count = lods[i].builder.get_indicies().size() / 3;
+
+        if (triangle_count > previous_triangle_count * settings.triangle_ratio) {
+            errors.push_back(std::format("lod {}: {} triangles for a target of {}", i + 1, triangle_count, static_cast<u32>(previous_triangle_count * settings.triangle_ratio)));
+        }
+        if (lods[i].error < previous_error) errors.push_back(std::format("lod {}: error {} is below the error {} of the previous lod", i + 1, lods[i].error, previous_error));
+
+        previous_triangle_count = triangle_count;
+        previous_error          = lods[i].error;
+    }
+
+    return errors;
+}
+
+VKE_TEST(simplify_mesh_keeps_border_and_seam_vertices) {
+    std::vector<std::string> errors;
+
+    constexpr u32 seam_x = GRID_SIZE / 2;
+    auto grid            = create_grid(seam_x);
+
+    std::vector<u32> border, seam;
+    for (u32 i = 0; i <= GRID_SIZE; i++) {
+        border.insert(border.end(), {i, GRID_SIZE * (GRID_SIZE + 1) + i, i * (GRID_SIZE + 1), i * (GRID_SIZE + 1) + GRID_SIZE});
+        seam.insert(seam.end(), {i * (GRID_SIZE + 1) + seam_x, (GRID_SIZE + 1) * (GRID_SIZE + 1) + i});
+    }
+
+    auto result = simplify_mesh(grid.indicies, grid.positions, grid.indicies.size() / 8);
+
+    check_vertices_kept(errors, "border", result.indicies, border, grid.positions.size());
+    check_vertices_kept(errors, "seam", result.indicies, seam, grid.positions.size());
+
+    // the seam has to stay closed, both sides keep every edge between neighbouring vertices along it
+    auto count_seam_edges = [&](u32 side_start, u32 stride) {
+        auto seam_row = [&](u32 v) -> i32 {
+            if (v < side_start || (v - side_start) % stride != 0 || (v - side_start) / stride > GRID_SIZE) return -1;
+            return (v - side_start) / stride;
+        };
+
+        u32 count = 0;
+        for (u32 i = 0; i < result.indicies.size(); i += 3) {
+            for (u32 e = 0; e < 3; e++) {
+                i32 a = seam_row(result.indicies[i + e]), b = seam_row(result.indicies[i + (e + 1) % 3]);
+                if (a != -1 && b != -1 && std::abs(a - b) == 1) count++;
+            }
+        }
+        return count;
+    };
+
+    u32 left_edges  = count_seam_edges(seam_x, GRID_SIZE + 1);
+    u32 right_edges = count_seam_edges((GRID_SIZE + 1) * (GRID_SIZE + 1), 1);
+    if (left_edges != GRID_SIZE || right_edges != GRID_SIZE) {
+        errors.push_back(std::format("the seam has {} edges on the left and {} on the right instead of {}", left_edges, right_edges, GRID_SIZE));
+    }
+
+    return errors;
+}
+
+} // namespace vke
@@ -0,0 +1,138 @@
+#include "test.hpp"
+
+#include <cmath>
+#include <numbers>
+#include <random>
+
+#include "render/mesh/mesh_optimizer.hpp"
+#include "meshlet_validation.hpp"
+
+namespace vke {
+
+namespace {
+
+struct TestMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<u32> indicies;
+};
+
+// a flat grid in vertex cache order like MeshBuilder::optimize leaves it
+TestMesh create_grid(u32 size) {
+    TestMesh mesh;
+    for (u32 y = 0; y <= size; y++) {
+        for (u32 x = 0; x <= size; x++) mesh.positions.push_back(glm::vec3(x, y, 0.f));
+    }
+
+    for (u32 y = 0; y < size; y++) {
+        for (u32 x = 0; x < size; x++) {
+            u32 a = y * (size + 1) + x;
+            u32 c = a + size + 1;
+            mesh.indicies.insert(mesh.indicies.end(), {a, a + 1, c, a + 1, c + 1, c});
+        }
+    }
+
+    optimize_vertex_cache(mesh.indicies, mesh.positions.size());
+    return mesh;
+}
+
+// the normals of a sphere spread out, so the cones of its meshlets are actually tested
+TestMesh create_sphere(u32 rings, u32 segments) {
+    TestMesh mesh;
+    for (u32 r = 0; r <= rings; r++) {
+        float theta = std::numbers::pi_v<float> * r / rings;
+        for (u32 s = 0; s <= segments; s++) {
+            float phi = 2.f * std::numbers::pi_v<float> * s / segments;
+            mesh.positions.push_back(glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)) * 10.f);
+        }
+    }
+
+    for (u32 r = 0; r < rings; r++) {
+        for (u32 s = 0; s < segments; s++) {
+            u32 a = r * (segments + 1) + s;
+            u32 c = a + segments + 1;
+            mesh.indicies.insert(mesh.indicies.end(), {a, c, a + 1, a + 1, c, c + 1});
+        }
+    }
+
+    optimize_vertex_cache(mesh.indicies, mesh.positions.size());
+    return mesh;
+}
+
+// triangles that share no vertices, the vertex limit closes every meshlet
+TestMesh create_triangle_soup(u32 triangle_count) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coordinate(-50.f, 50.f);
+
+    TestMesh mesh;
+    for (u32 i = 0; i < triangle_count * 3; i++) {
+        mesh.positions.push_back(glm::vec3(coordinate(rng), coordinate(rng), coordinate(rng)));
+        mesh.indicies.push_back(i);
+    }
+
+    return mesh;
+}
+
+void check_meshlets(std::vector<std::string>& errors, const char* name, const TestMesh& mesh, u32 max_vertices = MESHLET_MAX_VERTICES, u32 max_triangles = MESHLET_MAX_TRIANGLES) {
+    auto meshlets = build_meshlets(mesh.indicies, mesh.positions, max_vertices, max_triangles);
+
+    for (auto& error : validate_meshlets(meshlets, mesh.indicies, mesh.positions, max_vertices, max_triangles)) {
+        errors.push_back(std::format("{}: {}", name, error));
+    }
+}
+
+} // namespace
+
+VKE_TEST(meshlets_cover_triangles_within_limits) {
+    std::vector<std::string> errors;
+
+    check_meshlets(errors, "grid", create_grid(64));
+    check_meshlets(errors, "sphere", create_sphere(32, 64));
+    check_meshlets(errors, "triangle soup", create_triangle_soup(1000));
+    check_meshlets(errors, "grid with small limits", create_grid(64), 16, 8);
+
+    return errors;
+}
+
+// a meshlet is only closed when the next triangle doesn't fit, a soup needs 3 new vertices for every triangle
+VKE_TEST(meshlets_fill_up_to_the_limits) {
+    std::vector<std::string> errors;
+
+    auto soup          = create_triangle_soup(1000);
+    auto soup_meshlets = build_meshlets(soup.indicies, soup.positions);
+    for (u32 i = 0; i + 1 < soup_meshlets.size(); i++) {
+        if (soup_meshlets[i].triangle_count != MESHLET_MAX_VERTICES / 3) {
+            errors.push_back(std::format("triangle soup: meshlet {} was closed at {} triangles instead of {}", i, soup_meshlets[i].triangle_count, MESHLET_MAX_VERTICES / 3));
+        }
+    }
+
+    auto grid          = create_grid(64);
+    auto grid_meshlets = build_meshlets(grid.indicies, grid.positions);
+    u32 full_count     = std::count_if(grid_meshlets.begin(), grid_meshlets.end(), [](const Meshlet& m) { return m.triangle_count == MESHLET_MAX_TRIANGLES || m.vertex_count + 3 > MESHLET_MAX_VERTICES; });
+    if (full_count + 1 < grid_meshlets.size()) errors.push_back(std::format("grid: only {} of {} meshlets are full", full_count, grid_meshlets.size()));
+
+    return errors;
+}
+
+// the cone test only runs for meshlets with a cone, every meshlet of a flat grid has a tight one and most of a sphere have one
+VKE_TEST(meshlet_cones_bound_triangle_normals) {
+    std::vector<std::string> errors;
+
+    auto grid = create_grid(64);
+    for (auto& meshlet : build_meshlets(grid.indicies, grid.positions)) {
+        if (meshlet.cone_cutoff > 0.01f || glm::dot(meshlet.cone_axis, glm::vec3(0, 0, 1)) < 0.999f) {
+            errors.push_back(std::format("grid: a meshlet has a cone around ({},{},{}) with a cutoff of {}", meshlet.cone_axis.x, meshlet.cone_axis.y, meshlet.cone_axis.z, meshlet.cone_cutoff));
+            break;
+        }
+    }
+
+    auto sphere          = create_sphere(32, 64);
+    auto sphere_meshlets = build_meshlets(sphere.indicies, sphere.positions);
+    u32 cone_count       = std::count_if(sphere_meshlets.begin(), sphere_meshlets.end(), [](const Meshlet& m) { return m.cone_cutoff < 1.f; });
+    if (cone_count * 2 < sphere_meshlets.size()) errors.push_back(std::format("sphere: only {} of {} meshlets have a cone", cone_count, sphere_meshlets.size()));
+
+    for (auto& error : validate_meshlets(sphere_meshlets, sphere.indicies, sphere.positions)) errors.push_back(std::format("sphere: {}", error));
+
+    return errors;
+}
+
+} // namespace vke
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/geometric.hpp>
+
+#include "render/mesh/meshlet_builder.hpp"
+
+namespace vke {
+
+// checks that the meshlets cover every triangle exactly once, stay within the limits and that their spheres & cones bound their triangles.
+// returns a description of every problem that was found, an empty result means the meshlets are valid
+inline std::vector<std::string> validate_meshlets(std::span<const Meshlet> meshlets, std::span<const u32> indicies, std::span<const glm::vec3> positions, u32 max_vertices = MESHLET_MAX_VERTICES, u32 max_triangles = MESHLET_MAX_TRIANGLES) {
+    std::vector<std::string> errors;
+
+    u32 triangle_count = indicies.size() / 3;
+    u32 next_triangle  = 0;
+
+    std::vector<u32> unique_vertices;
+
+    for (u32 i = 0; i < meshlets.size(); i++) {
+        auto& meshlet = meshlets[i];
+
+        // meshlets are in index order so covering every triangle once means they are back to back
+        if (meshlet.triangle_offset != next_triangle) {
+            errors.push_back(std::format("meshlet {} starts at triangle {} instead of {}", i, meshlet.triangle_offset, next_triangle));
+        }
+        next_triangle = meshlet.triangle_offset + meshlet.triangle_count;
+
+        if (meshlet.triangle_count == 0 || meshlet.triangle_count > max_triangles) errors.push_back(std::format("meshlet {} has {} triangles", i, meshlet.triangle_count));
+        if (next_triangle > triangle_count) {
+            errors.push_back(std::format("meshlet {} goes past the last triangle", i));
+            break;
+        }
+
+        auto meshlet_indicies = indicies.subspan(meshlet.triangle_offset * 3, meshlet.triangle_count * 3);
+
+        unique_vertices.assign(meshlet_indicies.begin(), meshlet_indicies.end());
+        std::sort(unique_vertices.begin(), unique_vertices.end());
+        u32 vertex_count = std::unique(unique_vertices.begin(), unique_vertices.end()) - unique_vertices.begin();
+
+        if (vertex_count != meshlet.vertex_count) errors.push_back(std::format("meshlet {} reports {} vertices but has {}", i, meshlet.vertex_count, vertex_count));
+        if (vertex_count > max_vertices) errors.push_back(std::format("meshlet {} has {} vertices", i, vertex_count));
+
+        float tolerance = meshlet.radius * 1e-4f + 1e-6f;
+        for (u32 index : meshlet_indicies) {
+            if (glm::distance(positions[index], meshlet.center) > meshlet.radius + tolerance) {
+                errors.push_back(std::format("vertex {} is outside of the sphere of meshlet {}", index, i));
+                break;
+            }
+        }
+
+        if (meshlet.cone_cutoff < 1.f) {
+            float min_dot = std::sqrt(1.f - meshlet.cone_cutoff * meshlet.cone_cutoff);
+            for (u32 t = meshlet.triangle_offset; t < next_triangle; t++) {
+                glm::vec3 p0 = positions[indicies[t * 3]], p1 = positions[indicies[t * 3 + 1]], p2 = positions[indicies[t * 3 + 2]];
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float length     = glm::length(normal);
+                if (length > 0.f && glm::dot(normal / length, meshlet.cone_axis) < min_dot - 1e-4f) {
+                    errors.push_back(std::format("triangle {} is outside of the cone of meshlet {}", t, i));
+                    break;
+                }
+            }
+        }
+    }
+
+    if (next_triangle != triangle_count) errors.push_back(std::format("meshlets cover {} of {} triangles", next_triangle, triangle_count));
+
+    return errors;
+}
+
+} // namespace vke
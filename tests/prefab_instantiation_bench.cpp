@@ -0,0 +1,52 @@
+#include "bench.hpp"
+
+#include <chrono>
+#include <cmath>
+
+#include "render/iobject_renderer.hpp"
+#include "render/object_renderer/generic_entity_gpu_handle_manager.hpp"
+#include "scene/components/components.hpp"
+#include "scene/components/util.hpp"
+
+namespace vke {
+
+// spawns a single mesh prefab in a scratch world one by one and in bulk, with the gpu handle registration
+VKE_BENCHMARK(prefab_instantiation) {
+    constexpr u32 instance_count = 100'000;
+
+    std::vector<Transform> transforms(instance_count, Transform::IDENTITY);
+
+    u32 row_length = static_cast<u32>(std::ceil(std::sqrt(static_cast<double>(instance_count))));
+    for (u32 i = 0; i < instance_count; i++) {
+        transforms[i].position = glm::dvec3(i % row_length, 0.0, i / row_length) * 4.0;
+    }
+
+    auto run = [&](const char* name, auto&& spawn) {
+        // a fresh world each run so that both start with the same tables
+        flecs::world world;
+        GPUHandleIDManager<Renderable> handle_manager(&world);
+
+        auto prefab = world.prefab();
+        prefab.set<RelativeTransform>(static_cast<RelativeTransform>(Transform::IDENTITY));
+        prefab.set<Renderable>(Renderable{});
+
+        auto start = std::chrono::steady_clock::now();
+
+        spawn(&world, prefab);
+        handle_manager.flush_and_register_handles([](flecs::entity, auto) {});
+
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        LOG_INFO("prefab instantiation %s: %u instances in %.1f ms, %.0f instances/s", name, instance_count, ms, instance_count / (ms / 1000.0));
+    };
+
+    run("one by one", [&](flecs::world* world, flecs::entity prefab) {
+        for (auto& t : transforms) spawn_prefab_instance(world, prefab, t);
+    });
+
+    run("bulk", [&](flecs::world* world, flecs::entity prefab) {
+        spawn_prefab_instances(world, prefab, transforms);
+    });
+}
+
+} // namespace vke
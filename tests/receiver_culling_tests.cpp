@@ -0,0 +1,115 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <random>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "render/shadow/receiver_culling.hpp"
+
+namespace vke {
+
+namespace {
+
+// the receivers of a reverse z camera at the origin looking down -z, the light goes straight down
+ReceiverData create_test_receivers() {
+    glm::mat4 proj      = glm::perspectiveRH_ZO(glm::radians(60.f), 1.f, 500.f, 0.1f);
+    glm::mat4 proj_view = proj * glm::lookAtRH(glm::vec3(0.f), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+
+    auto clip_z = [&](float distance) {
+        glm::vec4 p = proj * glm::vec4(0, 0, -distance, 1);
+        return p.z / p.w;
+    };
+
+    return create_receiver_data(proj_view, clip_z(0.1f), clip_z(100.f), glm::vec3(0, -1, 0));
+}
+
+const glm::vec2 hzb_size(1024.f);
+const HZBSampler empty_hzb    = [](glm::vec2, float) { return 0.f; };
+const HZBSampler occluder_hzb = [](glm::vec2, float) { return 1.f; };
+
+} // namespace
+
+VKE_TEST(receiver_culling_keeps_casters_of_visible_receivers) {
+    std::vector<std::string> errors;
+
+    auto receivers = create_test_receivers();
+
+    struct Case {
+        const char* name;
+        glm::vec3 center;
+        const HZBSampler* hzb;
+        bool is_visible;
+    };
+
+    Case cases[] = {
+        {"caster above the receivers", {0, 20, -30}, &empty_hzb, true},
+        {"caster above the view", {0, 200, -30}, &empty_hzb, true},
+        {"caster below the receivers", {0, -200, -30}, &empty_hzb, false},
+        {"caster beside the view", {500, 20, -30}, &empty_hzb, false},
+        {"caster behind the camera", {0, 20, 200}, &empty_hzb, false},
+        {"caster with every receiver hidden", {0, 20, -30}, &occluder_hzb, false},
+    };
+
+    glm::vec3 right(1, 0, 0), up(0, 1, 0), forward(0, 0, 1);
+    for (auto& c : cases) {
+        if (is_shadow_receiver_visible(receivers, *c.hzb, hzb_size, c.center, right, up, forward) != c.is_visible) {
+            errors.push_back(std::format("{}: expected to be {}", c.name, c.is_visible ? "kept" : "culled"));
+        }
+    }
+
+    return errors;
+}
+
+// a reverse z orthographic view 100 units deep like a shadow cascade, its hzb is reprojected when it moves along the light
+VKE_TEST(receiver_culling_ortho_hzb) {
+    std::vector<std::string> errors;
+
+    glm::mat4 ortho_proj_view = glm::orthoRH_ZO(-50.f, 50.f, -50.f, 50.f, 100.f, 0.f) * glm::lookAtRH(glm::vec3(0.f), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+
+    glm::vec3 right(1, 0, 0), up(0, 1, 0), forward(0, 0, 1);
+    if (!is_box_hzb_visible(ortho_proj_view, occluder_hzb, hzb_size, {0, 0, -150}, right, up, forward)) {
+        errors.push_back("box behind the far plane of the hzb: expected to be kept");
+    }
+    if (is_box_hzb_visible(ortho_proj_view, occluder_hzb, hzb_size, {0, 0, -50}, right, up, forward)) {
+        errors.push_back("box behind the occluders of the hzb: expected to be culled");
+    }
+
+    return errors;
+}
+
+// the sweep test has to keep every box that has a point of the sweep in the frustum
+VKE_TEST(receiver_culling_sweep_keeps_boxes_in_frustum) {
+    std::vector<std::string> errors;
+
+    auto receivers = create_test_receivers();
+    auto& planes   = receivers.frustum.planes;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    for (u32 i = 0; i < 1000; i++) {
+        glm::vec3 center  = (glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * 400.f;
+        glm::vec3 sweep   = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * unit(rng) * 300.f;
+        glm::vec3 extends = glm::vec3(unit(rng), unit(rng), unit(rng)) * 10.f;
+
+        bool is_in_frustum = false;
+        for (u32 t = 0; t <= 16 && !is_in_frustum; t++) {
+            for (u32 corner = 0; corner < 8 && !is_in_frustum; corner++) {
+                glm::vec3 side(corner & 1 ? 1 : -1, corner & 2 ? 1 : -1, corner & 4 ? 1 : -1);
+                glm::vec3 point = center + side * extends + sweep * (t / 16.f);
+
+                is_in_frustum = std::all_of(std::begin(planes), std::end(planes), [&](glm::vec4 plane) { return glm::dot(glm::vec3(plane), point) - plane.w >= 0.f; });
+            }
+        }
+
+        if (is_in_frustum && !is_swept_box_in_frustum(receivers.frustum, center, {extends.x, 0, 0}, {0, extends.y, 0}, {0, 0, extends.z}, sweep)) {
+            errors.push_back(std::format("sample {}: a swept box in the frustum was culled", i));
+        }
+    }
+
+    return errors;
+}
+
+} // namespace vke
@@ -0,0 +1,75 @@
+#include "test.hpp"
+
+#include <random>
+
+#include "render/shadow/shadow_atlas_allocator.hpp"
+
+namespace vke {
+
+// allocates & frees random tiles, the tiles have to stay in the atlas and never overlap and freeing every tile has to give back the whole atlas
+VKE_TEST(shadow_atlas_allocator_random_allocations) {
+    std::vector<std::string> errors;
+
+    const u32 atlas_size = 1024, min_tile_size = 32;
+    ShadowAtlasAllocator allocator(atlas_size, min_tile_size);
+
+    std::vector<AtlasTile> tiles;
+    std::vector<u8> owners(atlas_size / min_tile_size * atlas_size / min_tile_size, 0);
+
+    auto mark_tile = [&](const AtlasTile& tile, u8 value) {
+        for (u32 y = tile.offset.y / min_tile_size; y < (tile.offset.y + tile.size) / min_tile_size; y++) {
+            for (u32 x = tile.offset.x / min_tile_size; x < (tile.offset.x + tile.size) / min_tile_size; x++) {
+                auto& owner = owners[y * (atlas_size / min_tile_size) + x];
+                if (value != 0 && owner != 0) {
+                    errors.push_back(std::format("tile ({},{}) of size {} overlaps another tile", tile.offset.x, tile.offset.y, tile.size));
+                    return;
+                }
+                owner = value;
+            }
+        }
+    };
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<u32> size_exponent(0, 6);
+    std::uniform_int_distribution<u32> action(0, 2);
+
+    u64 used_texels = 0;
+    for (u32 i = 0; i < 10'000 && errors.empty(); i++) {
+        if (action(rng) != 0 || tiles.empty()) {
+            u32 size = (min_tile_size << size_exponent(rng)) - (rng() % 2); // some sizes that aren't powers of two
+
+            auto tile = allocator.allocate(size);
+            if (!tile) continue;
+
+            if (tile->size < size || tile->offset.x + tile->size > atlas_size || tile->offset.y + tile->size > atlas_size || tile->offset.x % tile->size != 0 || tile->offset.y % tile->size != 0) {
+                errors.push_back(std::format("iteration {}: tile ({},{}) of size {} for a request of {} is invalid", i, tile->offset.x, tile->offset.y, tile->size, size));
+            }
+
+            mark_tile(*tile, 1);
+            used_texels += u64(tile->size) * tile->size;
+            tiles.push_back(*tile);
+        } else {
+            u32 index = rng() % tiles.size();
+            mark_tile(tiles[index], 0);
+            used_texels -= u64(tiles[index].size) * tiles[index].size;
+            allocator.free(tiles[index]);
+
+            tiles[index] = tiles.back();
+            tiles.pop_back();
+        }
+
+        if (allocator.get_free_texel_count() + used_texels != u64(atlas_size) * atlas_size) {
+            errors.push_back(std::format("iteration {}: {} free and {} used texels don't add up to the atlas", i, allocator.get_free_texel_count(), used_texels));
+        }
+    }
+
+    for (auto& tile : tiles) allocator.free(tile);
+
+    if (allocator.get_largest_free_tile_size() != atlas_size) {
+        errors.push_back(std::format("the freed tiles didn't merge back into the atlas, the largest free tile is {}", allocator.get_largest_free_tile_size()));
+    }
+
+    return errors;
+}
+
+} // namespace vke
@@ -0,0 +1,50 @@
+#include "bench.hpp"
+
+#include <chrono>
+
+#include "render/shadow/shadow_utils.hpp"
+#include "shadow_fitting_reference.hpp"
+
+namespace vke {
+
+// the time it takes to fit 4 cascades with the reference and with the batched fitting
+VKE_BENCHMARK(shadow_frustum_fitting) {
+    constexpr u32 iteration_count = 100'000;
+
+    auto samples = reference::create_fitting_samples(64);
+
+    // summed so that the fits aren't optimized away
+    double checksum = 0.0;
+
+    auto run = [&](const char* name, auto&& fit) {
+        auto start = std::chrono::steady_clock::now();
+
+        for (u32 i = 0; i < iteration_count; i++) {
+            checksum += fit(samples[i % samples.size()]);
+        }
+
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        LOG_INFO("shadow frustum fitting %s: %.2f us for 4 cascades", name, us / iteration_count);
+    };
+
+    run("reference", [](const reference::FittingSample& sample) {
+        float sum = 0.f;
+        for (u32 i = 0; i < 4; i++) {
+            sum += reference::calculate_optimal_direct_shadow_map_frustum(sample.inv_proj_view, sample.cascade_zs[i], sample.cascade_zs[i + 1], sample.light_dir, 1000.f).width;
+        }
+        return sum;
+    });
+
+    run("batched", [](const reference::FittingSample& sample) {
+        std::array<ShadowMapCameraData, 4> results;
+        calculate_direct_shadow_map_frustums(sample.inv_proj_view, sample.cascade_zs, sample.light_dir, 1000.f, false, 0, results);
+
+        float sum = 0.f;
+        for (auto& result : results) sum += result.width;
+        return sum;
+    });
+
+    LOG_INFO("shadow frustum fitting checksum %f", checksum);
+}
+
+} // namespace vke
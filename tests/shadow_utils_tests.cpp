@@ -0,0 +1,174 @@
+#include "test.hpp"
+
+#include "render/shadow/shadow_utils.hpp"
+#include "scene/camera.hpp"
+#include "shadow_fitting_reference.hpp"
+
+namespace vke {
+
+namespace {
+
+constexpr u32 STABLE_RESOLUTION     = 2048;
+constexpr float STABLE_SHADOW_Z_FAR = 500.f;
+
+const glm::vec3 stable_light_dir = glm::normalize(glm::vec3(0.3f, -1.f, 0.2f));
+
+// a 60 degree 16:9 camera, the stable cascade covers the slice between 5 and 25 units in front of it.
+// the slice sphere has a radius of ~31.093, far from the 1/16 steps the radius is rounded up to
+struct StableCamera {
+    glm::vec3 position;
+    glm::vec3 forward;
+};
+
+// reverse z like the engine's cameras, it keeps the depth of the slice precise
+glm::mat4 create_proj() { return glm::perspectiveRH_ZO(glm::radians(60.f), 16.f / 9.f, 200.f, 0.1f); }
+
+glm::mat4 create_inv_proj_view(const StableCamera& camera) {
+    return glm::inverse(create_proj() * glm::lookAtRH(camera.position, camera.position + camera.forward, glm::vec3(0, 1, 0)));
+}
+
+float clip_z(float distance) {
+    glm::vec4 p = create_proj() * glm::vec4(0, 0, -distance, 1);
+    return p.z / p.w;
+}
+
+ShadowMapCameraData fit_stable(const StableCamera& camera) {
+    return calculate_stable_direct_shadow_map_frustum(create_inv_proj_view(camera), clip_z(5.f), clip_z(25.f), stable_light_dir, STABLE_SHADOW_Z_FAR, STABLE_RESOLUTION);
+}
+
+glm::vec4 slice_sphere(const StableCamera& camera) { return calculate_frustum_slice_sphere(create_inv_proj_view(camera), clip_z(5.f), clip_z(25.f)); }
+
+// the matrix the cascade is drawn with, set up the same way DirectShadowMap::set_camera_data does
+glm::mat4 shadow_proj_view(const ShadowMapCameraData& data) {
+    OrthographicCamera camera;
+    camera.z_far       = data.far;
+    camera.z_near      = 0.1f;
+    camera.half_height = data.height / 2.0f;
+    camera.half_width  = data.width / 2.0f;
+    camera.set_rotation(data.direction, data.up);
+    camera.set_world_pos(data.position);
+    camera.update();
+
+    return camera.proj_view();
+}
+
+} // namespace
+
+// fits cascades of random cameras with the batched fitting and with the reference, they have to be equivalent
+VKE_TEST(shadow_frustum_fitting_matches_reference) {
+    std::vector<std::string> errors;
+
+    constexpr float shadow_z_far = 1000.f;
+
+    for (auto& sample : reference::create_fitting_samples(1000)) {
+        std::array<ShadowMapCameraData, 4> batched;
+        calculate_direct_shadow_map_frustums(sample.inv_proj_view, sample.cascade_zs, sample.light_dir, shadow_z_far, false, 0, batched);
+
+        for (u32 i = 0; i < batched.size(); i++) {
+            auto expected = reference::calculate_optimal_direct_shadow_map_frustum(sample.inv_proj_view, sample.cascade_zs[i], sample.cascade_zs[i + 1], sample.light_dir, shadow_z_far);
+            auto& result  = batched[i];
+
+            // hulls start at different points, so when two edges give the same area the box may be turned by 90 degrees.
+            // the area and the center of the box don't depend on that
+            float expected_area = expected.width * expected.height;
+            float area          = result.width * result.height;
+            float extent        = std::max(expected.width, expected.height);
+
+            if (std::abs(area - expected_area) > expected_area * 1e-3f) {
+                errors.push_back(std::format("cascade {}: area {} instead of {}", i, area, expected_area));
+            }
+
+            if (glm::distance(glm::dvec3(result.position), glm::dvec3(expected.position)) > extent * 1e-3f) {
+                errors.push_back(std::format("cascade {}: position is {} away from the reference", i, glm::distance(glm::dvec3(result.position), glm::dvec3(expected.position))));
+            }
+        }
+    }
+
+    return errors;
+}
+
+// a camera that moves less than a texel keeps the cascade in place, so the cached shadow map stays valid
+VKE_TEST(stable_shadow_frustum_ignores_sub_texel_motion) {
+    std::vector<std::string> errors;
+
+    glm::vec3 up     = calculate_light_up(stable_light_dir);
+    glm::vec3 right  = glm::cross(stable_light_dir, up);
+    float texel_size = fit_stable({glm::vec3(0.f), glm::vec3(0, 0, -1)}).width / STABLE_RESOLUTION;
+
+    // centers the slice sphere on a texel so that moving less than half a texel on each axis stays on it
+    StableCamera camera{glm::vec3(3.3f, 1.7f, -2.1f), glm::normalize(glm::vec3(0.4f, -0.2f, -1.f))};
+    glm::vec3 center = glm::vec3(slice_sphere(camera));
+    camera.position += snap_to_light_texel_grid(center, stable_light_dir, up, texel_size) - center;
+
+    auto data      = fit_stable(camera);
+    auto proj_view = shadow_proj_view(data);
+
+    glm::vec3 motions[] = {right * 0.3f, up * -0.3f, stable_light_dir * 0.3f, (right + up - stable_light_dir) * 0.25f};
+    for (auto motion : motions) {
+        auto moved = fit_stable({camera.position + motion * texel_size, camera.forward});
+
+        if (moved.position != data.position || moved.width != data.width || moved.height != data.height || shadow_proj_view(moved) != proj_view) {
+            errors.push_back(std::format("moving ({},{},{}) texels changed the cascade", glm::dot(motion, right), glm::dot(motion, up), glm::dot(motion, stable_light_dir)));
+        }
+    }
+
+    return errors;
+}
+
+// when the cascade does move it moves by whole texels, so the texels of the old and the new shadow map line up
+VKE_TEST(stable_shadow_frustum_moves_in_whole_texels) {
+    std::vector<std::string> errors;
+
+    glm::vec3 up    = calculate_light_up(stable_light_dir);
+    glm::vec3 right = glm::cross(stable_light_dir, up);
+
+    StableCamera camera{glm::vec3(-12.f, 4.f, 30.f), glm::normalize(glm::vec3(-0.7f, -0.1f, -0.5f))};
+    auto data        = fit_stable(camera);
+    float texel_size = data.width / STABLE_RESOLUTION;
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> offset(-20.f, 20.f);
+
+    for (u32 i = 0; i < 100; i++) {
+        auto moved = fit_stable({camera.position + glm::vec3(offset(rng), offset(rng), offset(rng)), camera.forward});
+        if (moved.width != data.width) errors.push_back(std::format("move {}: the width went from {} to {}", i, data.width, moved.width));
+
+        glm::vec3 delta = glm::vec3(moved.position - data.position) / texel_size;
+        glm::vec3 texels(glm::dot(delta, right), glm::dot(delta, up), glm::dot(delta, stable_light_dir));
+        glm::vec3 fraction = glm::abs(texels - glm::round(texels));
+
+        if (fraction.x > 0.01f || fraction.y > 0.01f || fraction.z > 0.01f) {
+            errors.push_back(std::format("move {}: the cascade moved ({},{},{}) texels", i, texels.x, texels.y, texels.z));
+        }
+    }
+
+    return errors;
+}
+
+// the extent comes from the slice sphere, turning the camera in place must not resize the cascade
+VKE_TEST(stable_shadow_frustum_size_ignores_rotation) {
+    std::vector<std::string> errors;
+
+    glm::vec3 position(3.f, 2.f, 1.f);
+    StableCamera first{position, glm::vec3(0, 0, -1)};
+
+    float radius = slice_sphere(first).w;
+    float width  = fit_stable(first).width;
+
+    for (u32 i = 0; i < 32; i++) {
+        float yaw   = glm::radians(i * 37.f);
+        float pitch = glm::radians(static_cast<float>(i % 7) * 20.f - 60.f);
+
+        StableCamera camera{position, glm::vec3(std::cos(pitch) * std::sin(yaw), std::sin(pitch), -std::cos(pitch) * std::cos(yaw))};
+
+        float rotated_radius = slice_sphere(camera).w;
+        if (std::abs(rotated_radius - radius) > radius * 1e-4f) errors.push_back(std::format("rotation {}: the sphere radius went from {} to {}", i, radius, rotated_radius));
+
+        float rotated_width = fit_stable(camera).width;
+        if (rotated_width != width) errors.push_back(std::format("rotation {}: the width went from {} to {}", i, width, rotated_width));
+    }
+
+    return errors;
+}
+
+} // namespace vke
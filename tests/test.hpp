@@ -0,0 +1,22 @@
+#pragma once
+
+#include <format>
+#include <string>
+#include <vector>
+
+namespace vke::test {
+
+// a test returns what went wrong, it passed when the list is empty
+using TestFunction = std::vector<std::string> (*)();
+
+struct TestRegistration {
+    TestRegistration(const char* name, TestFunction function);
+};
+
+} // namespace vke::test
+
+// defines a test that is run by vke_engine_tests
+#define VKE_TEST(name)                                                    \
+    static std::vector<std::string> name();                               \
+    static const vke::test::TestRegistration name##_registration(#name, name); \
+    static std::vector<std::string> name()
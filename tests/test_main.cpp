@@ -0,0 +1,53 @@
+#include "test.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+namespace vke::test {
+
+namespace {
+
+struct Test {
+    const char* name;
+    TestFunction function;
+};
+
+// a function local so that it exists before the registrations of the other files run
+std::vector<Test>& registered_tests() {
+    static std::vector<Test> tests;
+    return tests;
+}
+
+} // namespace
+
+TestRegistration::TestRegistration(const char* name, TestFunction function) {
+    registered_tests().push_back(Test{.name = name, .function = function});
+}
+
+} // namespace vke::test
+
+// runs every test, or the ones whose name contains the first argument
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+
+    int run_count    = 0;
+    int failed_count = 0;
+    for (auto& test : vke::test::registered_tests()) {
+        if (filter != nullptr && std::strstr(test.name, filter) == nullptr) continue;
+
+        auto errors = test.function();
+        run_count++;
+
+        if (errors.empty()) {
+            printf("[pass] %s\n", test.name);
+            continue;
+        }
+
+        failed_count++;
+        printf("[fail] %s\n", test.name);
+        for (auto& error : errors) printf("    %s\n", error.c_str());
+    }
+
+    printf("%d of %d tests passed\n", run_count - failed_count, run_count);
+    return failed_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+#include "test.hpp"
+
+#include <random>
+
+#include "render/mesh/vertex_format.hpp"
+
+namespace vke {
+
+namespace {
+
+constexpr VertexFormat ALL_FORMATS[] = {VertexFormat::SEPARATE_FLOAT, VertexFormat::INTERLEAVED_FLOAT, VertexFormat::INTERLEAVED_COMPACT, VertexFormat::INTERLEAVED_QUANTIZED};
+
+const char* format_name(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::SEPARATE_FLOAT: return "SEPARATE_FLOAT";
+    case VertexFormat::INTERLEAVED_FLOAT: return "INTERLEAVED_FLOAT";
+    case VertexFormat::INTERLEAVED_COMPACT: return "INTERLEAVED_COMPACT";
+    case VertexFormat::INTERLEAVED_QUANTIZED: return "INTERLEAVED_QUANTIZED";
+    }
+    return "unknown";
+}
+
+struct SourceVertices {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> uvs;
+    std::vector<glm::vec3> normals;
+};
+
+// seeded so that every run encodes the same vertices
+SourceVertices create_source_vertices(u32 vertex_count, float position_extent, float uv_extent) {
+    std::mt19937 rng(vertex_count);
+    std::uniform_real_distribution<float> unit(-1.f, 1.f);
+
+    SourceVertices source;
+    for (u32 i = 0; i < vertex_count; i++) {
+        source.positions.push_back(glm::vec3(unit(rng), unit(rng), unit(rng)) * position_extent);
+        source.uvs.push_back(glm::vec2(unit(rng), unit(rng)) * uv_extent);
+
+        glm::vec3 normal(unit(rng), unit(rng), unit(rng));
+        source.normals.push_back(glm::length(normal) > 1e-3f ? glm::normalize(normal) : glm::vec3(0.f, 0.f, 1.f));
+    }
+
+    // the axes are where the octahedral fold is, and a zero normal has no direction to keep
+    source.normals[0] = glm::vec3(0.f, 0.f, -1.f);
+    source.normals[1] = glm::vec3(1.f, 0.f, 0.f);
+    source.normals[2] = glm::vec3(0.f);
+    return source;
+}
+
+void check_round_trip(std::vector<std::string>& errors, const std::string& name, const SourceVertices& source) {
+    for (auto format : ALL_FORMATS) {
+        auto encoded = encode_vertices(format, source.positions, source.uvs, source.normals);
+
+        size_t byte_size = 0;
+        for (auto& stream : encoded.streams) byte_size += stream.size();
+
+        if (encoded.vertex_count != source.positions.size()) errors.push_back(std::format("{} {}: {} vertices were encoded instead of {}", name, format_name(format), encoded.vertex_count, source.positions.size()));
+        if (byte_size != vertex_format_stride(format) * source.positions.size()) errors.push_back(std::format("{} {}: the streams are {} bytes", name, format_name(format), byte_size));
+
+        auto error = measure_vertex_encoding_error(encoded, source.positions, source.uvs, source.normals);
+        auto bound = vertex_encoding_error_bound(encoded.encoding, source.positions, source.uvs);
+        if (!error.is_within(bound)) {
+            errors.push_back(std::format("{} {}: error of position {}, uv {} & normal {} degrees is above the bound of {}, {} & {}", name, format_name(format), //
+                                         error.position, error.uv, error.normal_degrees, bound.position, bound.uv, bound.normal_degrees));
+        }
+    }
+}
+
+} // namespace
+
+VKE_TEST(vertex_encoding_stays_within_bound) {
+    std::vector<std::string> errors;
+
+    check_round_trip(errors, "unit", create_source_vertices(1000, 1.f, 1.f));
+    check_round_trip(errors, "large", create_source_vertices(1000, 5000.f, 64.f));
+    // uvs this small are f16 subnormals
+    check_round_trip(errors, "small", create_source_vertices(1000, 1e-3f, 1e-5f));
+
+    return errors;
+}
+
+VKE_TEST(vertex_encoding_fills_missing_attributes) {
+    std::vector<std::string> errors;
+
+    auto source = create_source_vertices(100, 1.f, 1.f);
+    for (auto format : ALL_FORMATS) {
+        auto encoded = encode_vertices(format, source.positions, {}, {});
+
+        // missing uvs are zeroes and missing normals are +z, so measuring against those has to stay within the bound
+        std::vector<glm::vec2> zero_uvs(source.positions.size(), glm::vec2(0.f));
+        std::vector<glm::vec3> up_normals(source.positions.size(), glm::vec3(0.f, 0.f, 1.f));
+
+        auto error = measure_vertex_encoding_error(encoded, source.positions, zero_uvs, up_normals);
+        if (!error.is_within(vertex_encoding_error_bound(encoded.encoding, source.positions, zero_uvs))) {
+            errors.push_back(std::format("{}: the missing attributes don't decode to the defaults", format_name(format)));
+        }
+    }
+
+    return errors;
+}
+
+VKE_TEST(scalar_encoders_round_trip) {
+    std::vector<std::string> errors;
+
+    for (float value : {0.f, 1.f, -2.f, 0.5f, 65504.f}) {
+        if (decode_half(encode_half(value)) != value) errors.push_back(std::format("half {} decodes to {}", value, decode_half(encode_half(value))));
+    }
+
+    // the ends of the range are exact so that quantized boxes don't shrink
+    for (float value : {-3.f, 5.f}) {
+        float decoded = decode_unorm16(encode_unorm16(value, -3.f, 8.f), -3.f, 8.f);
+        if (decoded != value) errors.push_back(std::format("unorm16 {} decodes to {}", value, decoded));
+    }
+
+    for (auto axis : {glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f)}) {
+        glm::vec3 decoded = decode_octahedral_normal(encode_octahedral_normal(axis));
+        if (glm::distance(decoded, axis) > 1e-4f) errors.push_back(std::format("octahedral normal ({}, {}, {}) decodes {} away", axis.x, axis.y, axis.z, glm::distance(decoded, axis)));
+    }
+
+    return errors;
+}
+
+} // namespace vke
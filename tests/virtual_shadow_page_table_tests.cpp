@@ -0,0 +1,155 @@
+#include "test.hpp"
+
+#include <algorithm>
+#include <random>
+
+#include "render/shadow/virtual_shadow_page_table.hpp"
+
+namespace vke {
+
+// moves the windows & requests random pages over many frames. no physical page may be shared, the page table has to match the
+// committed pages, cached pages keep their physical page and every request is drawn once the pool & the budget allow it
+VKE_TEST(virtual_shadow_page_table_random_requests) {
+    std::vector<std::string> errors;
+
+    const u32 frame_count = 1'000, level_count = 3, level_size = 8, physical_page_count = 48, draw_budget = 4, max_request_count = 40;
+    VirtualShadowPageTable table(level_count, level_size, physical_page_count);
+
+    struct Request {
+        u32 level;
+        glm::ivec2 coord;
+    };
+
+    auto get_slot_index = [&](u32 level, glm::ivec2 coord) {
+        glm::ivec2 wrapped = coord & glm::ivec2(level_size - 1);
+        return (level * level_size + wrapped.y) * level_size + wrapped.x;
+    };
+
+    auto is_in_window = [&](u32 level, glm::ivec2 coord) {
+        glm::ivec2 local = coord - table.get_level_origin(level);
+        return local.x >= 0 && local.y >= 0 && local.x < static_cast<i32>(level_size) && local.y < static_cast<i32>(level_size);
+    };
+
+    std::mt19937 rng(7);
+    std::vector<Request> requests;
+    std::vector<u32> previous_table(level_count * level_size * level_size, 0);
+    // the page each slot of the table was last drawn for & whether it was invalidated since
+    std::vector<Request> slot_pages(previous_table.size());
+    std::vector<bool> stale_slots(previous_table.size(), false);
+
+    auto random_request = [&]() {
+        u32 level = rng() % level_count;
+        return Request{level, table.get_level_origin(level) + glm::ivec2(rng() % level_size, rng() % level_size)};
+    };
+
+    auto check_frame = [&](u32 frame, bool is_stable) {
+        auto page_table = table.get_page_table();
+        auto drawn      = table.get_pages_to_draw();
+
+        if (drawn.size() > draw_budget) errors.push_back(std::format("frame {}: {} pages drawn over a budget of {}", frame, drawn.size(), draw_budget));
+        if (table.get_failed_request_count() != 0) errors.push_back(std::format("frame {}: {} of {} requests didn't get a physical page", frame, table.get_failed_request_count(), requests.size()));
+
+        for (auto& page : drawn) {
+            u32 index = get_slot_index(page.level, page.coord);
+            if (page_table[index] != page.physical_page + 1) errors.push_back(std::format("frame {}: drawn page ({},{}) of level {} isn't in the table", frame, page.coord.x, page.coord.y, page.level));
+            if (!is_in_window(page.level, page.coord)) errors.push_back(std::format("frame {}: drawn page ({},{}) of level {} is outside the window", frame, page.coord.x, page.coord.y, page.level));
+
+            bool is_requested = std::any_of(requests.begin(), requests.end(), [&](const Request& r) { return r.level == page.level && r.coord == page.coord; });
+            if (!is_requested) errors.push_back(std::format("frame {}: page ({},{}) of level {} is drawn without a request", frame, page.coord.x, page.coord.y, page.level));
+
+            slot_pages[index] = Request{page.level, page.coord};
+        }
+
+        std::vector<u32> users(physical_page_count, 0);
+        u32 used_page_count = 0;
+        for (u32 i = 0; i < page_table.size(); i++) {
+            if (page_table[i] == 0) continue;
+
+            u32 physical_page = page_table[i] - 1;
+            if (physical_page >= physical_page_count || users[physical_page]++ != 0) errors.push_back(std::format("frame {}: physical page {} is shared or out of the pool", frame, physical_page));
+            used_page_count++;
+
+            bool is_drawn = std::any_of(drawn.begin(), drawn.end(), [&](const VirtualShadowPage& p) { return get_slot_index(p.level, p.coord) == i; });
+            if (page_table[i] != previous_table[i] && !is_drawn) errors.push_back(std::format("frame {}: entry {} changed without its page being drawn", frame, i));
+            if (!is_in_window(slot_pages[i].level, slot_pages[i].coord)) errors.push_back(std::format("frame {}: entry {} belongs to a page that left the window", frame, i));
+        }
+
+        if (used_page_count + table.get_free_page_count() > physical_page_count) {
+            errors.push_back(std::format("frame {}: {} pages in the table and {} free ones don't fit in the pool", frame, used_page_count, table.get_free_page_count()));
+        }
+
+        // a valid page that is requested again stays where it is and isn't redrawn
+        if (is_stable) {
+            for (auto& request : requests) {
+                u32 index = get_slot_index(request.level, request.coord);
+                if (previous_table[index] == 0 || stale_slots[index]) continue;
+
+                bool is_drawn = std::any_of(drawn.begin(), drawn.end(), [&](const VirtualShadowPage& p) { return get_slot_index(p.level, p.coord) == index; });
+                if (page_table[index] != previous_table[index] || is_drawn) errors.push_back(std::format("frame {}: cached page ({},{}) of level {} was moved or redrawn", frame, request.coord.x, request.coord.y, request.level));
+            }
+        }
+
+        for (auto& page : drawn) stale_slots[get_slot_index(page.level, page.coord)] = false;
+        previous_table.assign(page_table.begin(), page_table.end());
+    };
+
+    for (u32 frame = 0; frame < frame_count && errors.empty(); frame++) {
+        // the camera moves a page at a time every few frames
+        bool is_stable = rng() % 4 != 0;
+        if (!is_stable) {
+            u32 level = rng() % level_count;
+            table.set_level_origin(level, table.get_level_origin(level) + glm::ivec2(static_cast<i32>(rng() % 3) - 1, static_cast<i32>(rng() % 3) - 1));
+            std::erase_if(requests, [&](const Request& r) { return !is_in_window(r.level, r.coord); });
+
+            for (u32 i = 0; i < previous_table.size(); i++) {
+                u32 level = i / (level_size * level_size);
+                if (previous_table[i] != 0 && !is_in_window(slot_pages[i].level, slot_pages[i].coord) && table.get_page_table()[i] != 0) {
+                    errors.push_back(std::format("frame {}: entry {} wasn't released when its page of level {} left the window", frame, i, level));
+                }
+            }
+            previous_table.assign(table.get_page_table().begin(), table.get_page_table().end());
+        }
+
+        for (u32 i = rng() % 3; i > 0 && !requests.empty(); i--) requests.erase(requests.begin() + rng() % requests.size());
+        for (u32 i = rng() % 4; i > 0 && requests.size() < max_request_count; i--) {
+            auto request     = random_request();
+            bool is_repeated = std::any_of(requests.begin(), requests.end(), [&](const Request& r) { return r.level == request.level && r.coord == request.coord; });
+            if (!is_repeated) requests.push_back(request);
+        }
+
+        bool is_invalidated = rng() % 50 == 0;
+        if (is_invalidated) {
+            table.invalidate();
+            std::fill(stale_slots.begin(), stale_slots.end(), true);
+        }
+
+        table.begin_frame();
+        for (auto& request : requests) table.request_page(request.level, request.coord);
+        table.update(draw_budget, false);
+
+        check_frame(frame, is_stable);
+    }
+
+    // with the requests fixed every page is drawn once the budget catches up
+    for (u32 i = 0; i < max_request_count / draw_budget + 1; i++) {
+        table.begin_frame();
+        for (auto& request : requests) table.request_page(request.level, request.coord);
+        table.update(draw_budget, false);
+
+        check_frame(frame_count + i, true);
+    }
+
+    for (auto& request : requests) {
+        if (table.get_page_table()[get_slot_index(request.level, request.coord)] == 0) {
+            errors.push_back(std::format("page ({},{}) of level {} was never drawn", request.coord.x, request.coord.y, request.level));
+        }
+    }
+
+    if (table.get_requested_page_count() != requests.size()) {
+        errors.push_back(std::format("{} pages were requested but the table counted {}", requests.size(), table.get_requested_page_count()));
+    }
+
+    return errors;
+}
+
+} // namespace vke